@@ -42,19 +42,19 @@ private:
 	void OnMouseUp(WPARAM btnState, int x, int y) override;
 	void OnMouseMove(WPARAM btnState, int x, int y) override;
 
-	// RootSignaturePSO
+	// RootSignature与PSO
 	ComPtr<ID3D12RootSignature> mRootSignature;
 	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs; // Solid and WireFrame
 	//ComPtr<ID3D12PipelineState> mPSO;
 
-	// ÿ֡MVPĳѺͳ
+	// 用于每帧MVP矩阵的常量描述符堆和常量缓冲区
 	ComPtr<ID3D12DescriptorHeap> mCbvHeap;
 	std::unique_ptr<UploadBuffer<ObjectConstants>> mObjectCB;
 
-	// ݹ
+	// 几何数据管理
 	std::unique_ptr<MeshGeometry> mBoxGeo;
 
-	// Shaders
+	// Shaders代码
     ComPtr<ID3DBlob> mVsByteCode;
     ComPtr<ID3DBlob> mPsByteCode;
     std::wstring mShaderPath = L"C:\\Users\\Lenovo\\Desktop\\EngineZeroOne\\Shaders\\BoxShader.hlsl";
@@ -66,7 +66,7 @@ private:
 	Camera mCamera;
 	POINT mLastMousePos;
 
-	// 任
+	// 变换矩阵
 	XMFLOAT4X4 mModel = Identity4X4();
 	XMFLOAT4X4 mView = Identity4X4();
 	XMFLOAT4X4 mProj = Identity4X4();
@@ -78,16 +78,16 @@ struct Camera {
 		UpdateProjectionMatrix();
 	}
 
-	// 
+	// 俯仰
 	void Pitch(float dTheta) {
-		// ת
+		// 旋转矩阵
 		XMMATRIX R = XMMatrixRotationAxis(XMLoadFloat3(&mRightDirection), dTheta);
 
 		XMStoreFloat3(&mUpDirection, XMVector3TransformNormal(XMLoadFloat3(&mUpDirection), R));
 		XMStoreFloat3(&mFocusDirection, XMVector3TransformNormal(XMLoadFloat3(&mFocusDirection), R));
 	}
 	
-	// ƫ
+	// 偏航
 	void Yaw(float dPhi) {
 		//XMMATRIX R = XMMatrixRotationAxis(XMLoadFloat3(&mUpDirection), dPhi);
 
@@ -100,7 +100,7 @@ struct Camera {
 		XMStoreFloat3(&mFocusDirection, XMVector3TransformNormal(XMLoadFloat3(&mFocusDirection), R));
 	}
 
-	// ƶ
+	// 六向移动
 	void MoveForward() {
 		XMVECTOR dis = XMVectorReplicate(mMoveStride);
 		XMVECTOR focus = XMLoadFloat3(&mFocusDirection);
@@ -133,7 +133,7 @@ struct Camera {
 		XMStoreFloat3(&mPosition, XMVectorMultiplyAdd(dis, right, pos));
 	}
 
-	// ƶԾΪ׼
+	// 上下移动以绝对坐标为准
 	void MoveUp() {
 		XMVECTOR dis = XMVectorReplicate(mMoveStride);
 		XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
@@ -201,10 +201,10 @@ struct Camera {
 	XMFLOAT4X4 mViewMatrix;
 	XMFLOAT4X4 mProjectionMatrix;
 
-	// Cameraƶ
+	// Camera移动设置
 	float mMoveStride = 0.1f;
 
-	// FrustumϢ
+	// Frustum信息
 	UINT mWidth;
 	UINT mHeight;
 	float mFov;
@@ -0,0 +1,106 @@
+#pragma once
+#include "D3D12App.h"
+#include "UploadBuffer.h"
+#include "Light.h"
+
+#include <memory>
+#include <vector>
+
+// 分簇光照(Clustered Lighting): 视锥按屏幕Tile与指数分布的深度切片划分为CLUSTER_COUNT_X * Y * Z个Cluster
+// 点光源、聚光灯与面光源每帧在CPU上分配到与其影响范围相交的Cluster，Shader只计算像素所在Cluster的光源
+// 逐光源只遍历其包围球投影覆盖的Cluster，一次测试一行中的4个Cluster(DirectXMath的SIMD向量)
+// 结果为三个Structured Buffer: 光源、每个Cluster的(起始位置, 数量)以及紧凑的光源索引列表
+class ClusteredLighting {
+public:
+	static const UINT ClusterCount = CLUSTER_COUNT_X * CLUSTER_COUNT_Y * CLUSTER_COUNT_Z;
+
+	// Upload Buffer的初始容量，不足时在Update中扩容
+	static const UINT InitialLightCapacity = 4096;
+	static const UINT InitialLightIndexCapacity = 256 * 1024;
+	// 光源索引的上限(64 MB)，超出的部分舍弃并在统计中报告，避免极端情况下无限扩容
+	static const UINT MaxLightIndices = 16 * 1024 * 1024;
+
+	ClusteredLighting(ID3D12Device* device);
+	ClusteredLighting(const ClusteredLighting&) = delete;
+	ClusteredLighting& operator=(const ClusteredLighting&) = delete;
+
+	// 光源为世界空间，返回在光源列表中的位置
+	UINT AddPointLight(const PointLight& light);
+	UINT AddSpotLight(const SpotLight& light);
+	UINT AddRectLight(const RectLight& light);
+	UINT LightCount() const { return static_cast<UINT>(mLights.size()); }
+
+	// 以摄像机的View与Proj(未转置，透视投影)分配光源并写入Upload Buffer，每帧在绘制前调用一次
+	// 投影改变时重建各Cluster的包围盒；视角与光源都未改变时直接返回
+	// 容量不足时扩容，之后各BufferAddress改变，旧的Buffer保留到ReleaseRetiredBuffers
+	void Update(DirectX::FXMMATRIX view, DirectX::CXMMATRIX proj, float nearZ, float farZ);
+
+	// GPU执行完使用旧Buffer的命令后调用
+	void ReleaseRetiredBuffers() { mRetiredBuffers.clear(); }
+
+	// 写入Shader计算Cluster所需的常量
+	void WriteConstants(Light& lights) const;
+
+	D3D12_GPU_VIRTUAL_ADDRESS LightBufferAddress() const { return mLightsGPU->GetBufferPointer(); }
+	D3D12_GPU_VIRTUAL_ADDRESS ClusterBufferAddress() const { return mClustersGPU->GetBufferPointer(); }
+	D3D12_GPU_VIRTUAL_ADDRESS LightIndexBufferAddress() const { return mLightIndicesGPU->GetBufferPointer(); }
+	UINT LightCapacity() const { return mLightsGPU->ElementCount(); }
+	UINT LightIndexCapacity() const { return mLightIndicesGPU->ElementCount(); }
+
+	// 上一次Update的统计
+	UINT mLightIndexCount = 0;		// 所有Cluster的光源数之和
+	UINT mMaxClusterLights = 0;		// 单个Cluster中最多的光源数
+	UINT mDroppedIndices = 0;		// 超出MaxLightIndices而被舍弃的索引数
+	UINT mCapacityGrowths = 0;		// Upload Buffer扩容的次数
+	double mUpdateMs = 0.0;
+	// 写入Upload Buffer的字节数，未改变时为0
+	UINT64 mUploadedBytes = 0;
+
+private:
+	struct ClusterLightPair {
+		UINT Cluster;
+		UINT Light;
+	};
+
+	UINT AddLight(const ClusterLight& light);
+
+	void BuildClusterBounds(DirectX::CXMMATRIX proj, float nearZ, float farZ);
+
+	// 深度所在的切片，范围外的深度截断到首尾切片
+	UINT DepthSlice(float viewZ) const;
+
+	// 将一个光源分配到与之相交的Cluster，结果追加到pairs
+	void BinLight(UINT lightIndex, DirectX::FXMMATRIX view, std::vector<ClusterLightPair>& pairs) const;
+
+	std::vector<ClusterLight> mLights;
+	bool mLightsDirty = true;
+
+	// 当前的投影与视角
+	DirectX::XMFLOAT4X4 mProj;
+	DirectX::XMFLOAT4X4 mView;
+	float mNearZ = 0.0f;
+	float mFarZ = 0.0f;
+	float mDepthScale = 0.0f;
+	float mDepthBias = 0.0f;
+	bool mHasProjection = false;
+
+	// View Space中各Cluster的AABB与包围球，SoA，以(z * CLUSTER_COUNT_Y + y) * CLUSTER_COUNT_X + x为索引
+	std::vector<float> mMinX, mMinY, mMinZ;
+	std::vector<float> mMaxX, mMaxY, mMaxZ;
+	std::vector<float> mCenterX, mCenterY, mCenterZ, mRadius;
+	// 各切片的深度范围
+	float mSliceNear[CLUSTER_COUNT_Z];
+	float mSliceFar[CLUSTER_COUNT_Z];
+
+	// Update使用: 每组光源的(Cluster, 光源)对，各Cluster的(起始位置, 数量)，以及按Cluster排列后的索引列表
+	std::vector<std::vector<ClusterLightPair>> mGroupPairs;
+	std::vector<UINT> mClusterOffsets;
+	std::vector<XMUINT2> mClusterRanges;
+	std::vector<UINT> mLightIndices;
+
+	ID3D12Device* mDevice = nullptr;
+	std::unique_ptr<UploadBuffer<ClusterLight>> mLightsGPU;
+	std::unique_ptr<UploadBuffer<XMUINT2>> mClustersGPU;
+	std::unique_ptr<UploadBuffer<UINT>> mLightIndicesGPU;
+	std::vector<ComPtr<ID3D12Resource>> mRetiredBuffers;
+};
@@ -10,11 +10,15 @@
 using namespace DirectX;
 #endif
 
+// World Matrix单独存放在以RenderItemIndex为索引的Structured Buffer中
 struct RenderItemData {
-	XMFLOAT4X4 World;
 	XMFLOAT4X4 TexTransform;
 
 	UINT MaterialIndex;
+
+	// 压缩顶点格式的Position反量化参数: PosL = Quantized * PositionScale + PositionOffset
+	XMFLOAT3 PositionScale;
+	XMFLOAT3 PositionOffset;
 };
 
 struct PassData {
@@ -22,7 +22,7 @@
 #include "D3D12Exception.h"
 #include "Resource.h"
 
-// D3D12
+// 链接D3D12库
 #pragma comment(lib, "d3dcompiler.lib")
 #pragma comment(lib, "D3D12.lib")
 #pragma comment(lib, "dxgi.lib")
@@ -62,22 +62,22 @@ public:
     D3D12App(HINSTANCE hInstance);
     ~D3D12App();
 
-    // ߱
+    // 宽高比
     float AspectRatio() const;
 
     static D3D12App* GetApp();
     static D3D12App* mApp;
 
-    int Run(); // Ϣѭ
+    int Run(); // 消息循环函数
 
     virtual bool Init();
-    virtual LRESULT CALLBACK MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam); // WindowsϵͳעϢص
+    virtual LRESULT CALLBACK MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam); // 向Windows系统注册的消息回调函数
 protected:
-    bool InitMainWindow(); // עᡢʾ´
+    bool InitMainWindow(); // 注册、创建、显示、更新窗口
     bool InitD3D12();
     bool InitImGui();
 
-    virtual void OnResize(); // ڴСıʱҪһϵв
+    virtual void OnResize(); // 窗口大小发生改变时，我们要进行一系列操作来进行适配
     virtual void Update(const GameTimer& gt) = 0;
     virtual void Draw(const GameTimer& gt) = 0;
 
@@ -102,7 +102,7 @@ protected:
     void CreateDepthStencilView();
     void SetViewPortAndScissorRect();
 
-    // Static Samplers
+    // 创建Static Samplers
     std::array<const CD3DX12_STATIC_SAMPLER_DESC, 7>
         GetStaticSamplers();
 
@@ -110,10 +110,10 @@ protected:
     D3D12_CPU_DESCRIPTOR_HANDLE CurrentBackBufferView() const;
     D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilView() const;
 
-    // FlushCommandQueue()fenceһӦãʹCPUǿƵȴGPUִCommandQueueе
+    // FlushCommandQueue()是fence的一个应用，利用它可使CPU强制等待至GPU执行完所有CommandQueue中的命令
     void FlushCommandQueue();
 
-    // Windows
+    // Windows窗口设置
     HINSTANCE mAppInstance = nullptr;
     HWND mhMainWindow = nullptr;
     std::wstring mMainWindowCaption = L"EngineZeroOne";
@@ -121,7 +121,7 @@ protected:
     bool mMinimized;
     bool mResizing = false;
 
-    // ʱ
+    // 计时器相关设置
     bool mAppPaused = false;
     GameTimer mTimer;
 
@@ -134,7 +134,7 @@ protected:
     ComPtr<ID3D12CommandAllocator> mCommandAllocator;
     ComPtr<ID3D12GraphicsCommandList4> mCommandList;
 
-    // ʾʽ
+    // 显示缓冲区格式设置
     int mClientWidth = 720;
     int mClientHeight = 1080;
 
@@ -143,7 +143,7 @@ protected:
     DXGI_FORMAT mBackBufferFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
     ComPtr<ID3D12Resource> mSwapChainBuffer[swapChainBufferCount];
 
-    // Depth/Stencil
+    // Depth/Stencil设置
     DXGI_FORMAT mDepthStencilFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
     ComPtr<ID3D12Resource> mDepthStencilBuffer;
 
@@ -156,11 +156,11 @@ protected:
     UINT mDsvDescriptorSize;
     UINT mCbvSrvUavDescriptorSize;
 
-    // ӿںͲü
+    // 视口和裁剪矩形
     D3D12_VIEWPORT mViewPort;
     D3D12_RECT mScissorRect;
     
-    // MSAA
+    // MSAA设置
     bool mMsaaState = true;
     UINT mMsaaQuality = 0;
     ComPtr<ID3D12Resource> mMsaaRenderTarget;
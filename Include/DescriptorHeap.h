@@ -0,0 +1,47 @@
+#pragma once
+#include "D3D12App.h"
+
+#include <vector>
+
+// 可增长的Shader可见CBV/SRV/UAV Descriptor Heap
+// Descriptor同时写入一个非Shader可见的副本: Shader可见的Heap位于写合并内存中，不适合作为CopyDescriptors的源
+// 容量不足时按块扩容，新建更大的两个Heap并从副本拷贝全部Descriptor
+// 扩容后Heap与GPU句柄都会改变，使用者需在每帧绘制时重新获取
+class DescriptorHeap {
+public:
+	static const UINT GrowthChunk = 256;
+
+	DescriptorHeap(ID3D12Device* device, UINT capacity);
+	DescriptorHeap(const DescriptorHeap&) = delete;
+	DescriptorHeap& operator=(const DescriptorHeap&) = delete;
+
+	// 在第index个位置创建SRV，超出容量时先扩容
+	void CreateShaderResourceView(UINT index, ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc);
+
+	// 保证至少能容纳count个Descriptor，返回是否重新创建了Heap
+	bool Reserve(UINT count);
+
+	ID3D12DescriptorHeap* Heap() const { return mHeap.Get(); }
+	D3D12_GPU_DESCRIPTOR_HANDLE GpuHandle(UINT index) const;
+
+	UINT Capacity() const { return mCapacity; }
+	// 写入过的最大位置 + 1
+	UINT UsedCount() const { return mUsedCount; }
+	UINT GrowthCount() const { return mGrowthCount; }
+
+	// 已提交的命令可能仍引用扩容前的Heap，由调用者在GPU执行完毕后释放
+	void ReleaseRetiredHeaps();
+
+private:
+	ComPtr<ID3D12DescriptorHeap> CreateHeap(UINT capacity, bool shaderVisible) const;
+
+	ComPtr<ID3D12Device> mDevice;
+	ComPtr<ID3D12DescriptorHeap> mHeap;
+	ComPtr<ID3D12DescriptorHeap> mStagingHeap;
+	std::vector<ComPtr<ID3D12DescriptorHeap>> mRetiredHeaps;
+
+	UINT mDescriptorSize = 0;
+	UINT mCapacity = 0;
+	UINT mUsedCount = 0;
+	UINT mGrowthCount = 0;
+};
@@ -10,7 +10,7 @@
 
 using namespace DirectX;
 
-// ÿ֡ĻGPUԴ
+// 每帧的绘制中GPU所需的资源
 class FrameResource {
 
 };
@@ -20,22 +20,38 @@ struct RenderItem {
 
 	}
 
-	// Ϣ
+	// 不变信息
 	// Mesh
 	UINT MeshIndex;
 	UINT NumVertices;
 	UINT NumIndices;
 
 	INT BaseVertexLocation;
-	UINT StartIndexLocation;
+	UINT StartIndexLocation;	// 以IndexFormat为单位
+	DXGI_FORMAT IndexFormat = DXGI_FORMAT_R32_UINT;
 
 	D3D_PRIMITIVE_TOPOLOGY PrimitiveTopology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
-	// ɱϢ
+	// 对应的SubMesh，LOD信息保存在其中
+	UINT SubMeshIndex = 0;
+	// 当前使用的LOD，NumIndices与StartIndexLocation随之改变
+	UINT CurrentLOD = 0;
+
+	// 绝对的MaterialIndex，与RenderItemData中的相同
+	UINT MaterialIndex = 0;
+
+	// 可变信息（）
 	// Render Item Index
-	// World Matrix, Texture Transformation Matrix, Material Index
+	// 存放World Matrix, Texture Transformation Matrix, Material Index
 	UINT RenderItemIndex;
 
-	// Dirtyλ
+	// Dirty位以RenderItemIndex为索引保存在Scene::mItemDirty中，Render Item本身会被拷贝进实例化绘制列表
+};
 
+// 几何与材质相同的一组Render Item，以一次DrawIndexedInstanced绘制
+struct InstancedDraw {
+	RenderItem Item;			// 第一个实例，提供几何信息
+	TextureFlags Type = 0;		// Render Item所在的PSO分组
+	UINT InstanceBase = 0;		// 在实例列表中的起始位置
+	UINT InstanceCount = 0;
 };
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+#include <windows.h>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <vector>
+
+// 视锥的6个平面(左、右、下、上、近、远)，法线指向视锥内部且已归一化
+struct FrustumPlanes {
+	DirectX::XMFLOAT4 Planes[6];
+};
+
+// 以结构数组(SoA)保存的AABB中心与半长，每个分量各占一段连续的float
+// 与视锥的测试一次处理4个AABB(DirectXMath的SIMD向量)
+class PackedBoxArray {
+public:
+	// 新增的AABB中心与半长为0
+	void Resize(size_t count);
+	size_t Size() const { return mCenterX.size(); }
+
+	void Set(size_t i, const DirectX::BoundingBox& box);
+
+	// 测试[begin, end)内的AABB，与视锥相交或位于其中时visible[i - begin]为1，否则为0
+	// 返回可见的数量；只读取成员，可由多个线程对不同的区间同时调用
+	UINT Cull(const FrustumPlanes& frustum, size_t begin, size_t end, UINT8* visible) const;
+
+private:
+	std::vector<float> mCenterX, mCenterY, mCenterZ;
+	std::vector<float> mExtentX, mExtentY, mExtentZ;
+};
+
+namespace FrustumCulling {
+	// 由ViewProj矩阵(行向量约定，未转置)提取视锥平面，深度范围为D3D的[0, 1]
+	FrustumPlanes ExtractPlanes(DirectX::FXMMATRIX viewProj);
+}
@@ -15,13 +15,13 @@ public:
 
 private:
 	double mSecondsPerCount;
-	double mDeltaTime;			// ֮֡ʱ
+	double mDeltaTime;			// 两帧之间的时间差
 
-	INT64 mBaseTime;			// ׼ʱ
-	INT64 mPausedTimeInterval;  // ͣʱܺ
-	INT64 mLastPasedTime;		// һͣʱ
-	INT64 mPrevTime;			// һνлƵʱ
-	INT64 mCurrTime;			// ǰʱ
+	INT64 mBaseTime;			// 基准时间点
+	INT64 mPausedTimeInterval;  // 暂停的时间总和
+	INT64 mLastPasedTime;		// 上一次暂停的时间点
+	INT64 mPrevTime;			// 上一次进行绘制的时间点
+	INT64 mCurrTime;			// 当前时间
 
 	bool mStopped;
 };
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+#include <windows.h>
+#include <map>
+#include <string>
+#include <vector>
+
+using Microsoft::WRL::ComPtr;
+
+// 一维范围分配器，以元素为单位
+// 空闲块同时按起始位置与大小索引: 分配时取最小的足够大的块(Best Fit)，释放时与相邻的空闲块合并
+class RangeAllocator {
+public:
+	static const UINT64 kInvalidOffset = ~0ull;
+
+	explicit RangeAllocator(UINT64 capacity = 0);
+
+	// 失败时返回kInvalidOffset
+	UINT64 Allocate(UINT64 count);
+	void Free(UINT64 offset, UINT64 count);
+
+	// 在末尾追加空闲空间，与末尾的空闲块合并
+	void Grow(UINT64 newCapacity);
+
+	UINT64 Capacity() const { return mCapacity; }
+	UINT64 UsedCount() const { return mUsed; }
+	UINT64 FreeBlockCount() const { return mFreeByOffset.size(); }
+	UINT64 LargestFreeBlock() const;
+
+private:
+	void InsertFreeBlock(UINT64 offset, UINT64 count);
+	void EraseFreeBlock(std::map<UINT64, UINT64>::iterator it);
+
+	UINT64 mCapacity = 0;
+	UINT64 mUsed = 0;
+
+	std::map<UINT64, UINT64> mFreeByOffset;			// offset -> count
+	std::multimap<UINT64, UINT64> mFreeBySize;		// count -> offset
+};
+
+struct GeometryArenaStats {
+	UINT64 CapacityInBytes = 0;
+	UINT64 UsedInBytes = 0;
+	UINT64 FreeBlockCount = 0;
+	UINT64 LargestFreeBlockInBytes = 0;
+
+	// 1 - 最大空闲块 / 全部空闲空间，为0时空闲空间完全连续
+	float Fragmentation() const {
+		UINT64 freeBytes = CapacityInBytes - UsedInBytes;
+		return freeBytes > 0 ? 1.0f - static_cast<float>(LargestFreeBlockInBytes) / freeBytes : 0.0f;
+	}
+};
+
+// 常驻GPU的大块Buffer，由若干子Buffer共用同一个分配器
+// 第k块子Buffer中元素的大小为elementSizes[k]，同一次分配在每块子Buffer中的元素序号相同
+// 例如顶点的Position流与属性流: 两者共用BaseVertexLocation
+// Buffer平时处于GENERIC_READ状态，空间不足时在Command List上记录扩容与拷贝
+class GeometryArena {
+public:
+	void Init(ID3D12Device* device, const std::vector<UINT>& elementSizes, UINT64 initialCapacity, const std::wstring& name);
+
+	// 返回起始元素序号
+	UINT64 Allocate(ID3D12GraphicsCommandList* cmdList, UINT64 count);
+	void Free(UINT64 first, UINT64 count);
+
+	// 从uploadBuffer的srcOffset处拷贝count个元素到第bufferIndex块子Buffer的first处
+	void Upload(ID3D12GraphicsCommandList* cmdList, UINT bufferIndex, UINT64 first, UINT64 count,
+		ID3D12Resource* uploadBuffer, UINT64 srcOffset);
+
+	D3D12_GPU_VIRTUAL_ADDRESS Address(UINT bufferIndex, UINT64 element = 0) const;
+	UINT64 SizeInBytes(UINT bufferIndex) const;
+	UINT ElementSize(UINT bufferIndex) const { return mElementSizes[bufferIndex]; }
+
+	GeometryArenaStats Stats() const;
+
+	// 扩容前的Buffer需保留到GPU完成拷贝之后
+	void ReleaseRetiredBuffers();
+
+private:
+	void Grow(ID3D12GraphicsCommandList* cmdList, UINT64 newCapacity);
+
+	ID3D12Device* mDevice = nullptr;
+	std::wstring mName;
+
+	std::vector<UINT> mElementSizes;
+	std::vector<ComPtr<ID3D12Resource>> mBuffers;
+	std::vector<ComPtr<ID3D12Resource>> mRetiredBuffers;
+
+	RangeAllocator mAllocator;
+	UINT64 mInitialCapacity = 0;
+};
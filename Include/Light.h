@@ -9,10 +9,18 @@ using namespace DirectX;
 #endif
 
 // Maximum Lights Amount
-#define MAX_DIRECTIONAL_LIGHT 16
-#define MAX_POINT_LIGHT 16
-#define MAX_RECT_LIGHT 16
-#define MAX_SPOT_LIGHT 16 
+// Point, rect and spot lights are not limited here, they are binned into clusters (see ClusteredLighting.h)
+#define MAX_DIRECTIONAL_LIGHT 4
+
+// Cluster Grid: screen tiles x depth slices, slices are exponential between NearZ and FarZ
+#define CLUSTER_COUNT_X 16
+#define CLUSTER_COUNT_Y 9
+#define CLUSTER_COUNT_Z 24
+
+// ClusterLight Types
+#define CLUSTER_LIGHT_POINT 0
+#define CLUSTER_LIGHT_SPOT 1
+#define CLUSTER_LIGHT_RECT 2
 
 struct DirectionalLight {
 	XMFLOAT3	Strength;
@@ -48,15 +56,26 @@ struct SpotLight {
 	float		Padding;
 };
 
+// Point/Spot/Rect Light in the clustered light buffer, in world space
+struct ClusterLight {
+	XMFLOAT3	Strength;
+	float		AttenuationRange;
+	XMFLOAT3	Position;
+	UINT		Type;			// CLUSTER_LIGHT_*
+	XMFLOAT3	Direction;		// Spot/Rect
+	float		MaxAngle;		// Spot
+	XMFLOAT2	Rect;			// Rect
+	XMFLOAT2	Padding;
+};
+
 struct Light {
 	DirectionalLight    DirectionalLights[MAX_DIRECTIONAL_LIGHT];
-	PointLight          PointLights[MAX_POINT_LIGHT];
-	RectLight			RectLights[MAX_RECT_LIGHT];
-	SpotLight           SpotLights[MAX_SPOT_LIGHT];
 	UINT        NumDirectionalLights;
-	UINT        NumPointLights;
-	UINT		NumRectLights;
-	UINT        NumSpotLights;
+
+	// slice = log(viewZ) * ClusterDepthScale + ClusterDepthBias
+	float		ClusterDepthScale;
+	float		ClusterDepthBias;
+	UINT		NumClusterLights;
 };
 
 #endif
\ No newline at end of file
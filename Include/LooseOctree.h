@@ -0,0 +1,83 @@
+#pragma once
+#include <windows.h>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <unordered_map>
+#include <vector>
+
+#include "FrustumCulling.h"
+
+// 松散八叉树: 每个节点的松散包围盒为其格子的2倍(半长为2 * HalfSize)
+// 物体放入格子半长不小于其AABB最大半长的最深一层，再由中心所在的格子确定节点，插入、移动与删除都不需要遍历
+// 节点按(层, x, y, z)散列，只在有物体时创建，子树为空时回收
+// 中心位于根格子之外的物体放在根节点中，查询时总是逐个测试
+class LooseOctree {
+public:
+	// center、halfSize为根格子的中心与半长，maxDepth不超过MaxDepthLimit
+	LooseOctree(const DirectX::XMFLOAT3& center, float halfSize, UINT maxDepth);
+
+	// 节点键中层号占4位，最大为15；各维格子坐标占20位，第15层的坐标小于2^15
+	static const UINT MaxDepthLimit = 15;
+
+	// id为调用者的索引(例如RenderItemIndex)，不要求连续
+	void Insert(UINT id, const DirectX::BoundingBox& box);
+	// 仍在原节点中时只更新AABB
+	void Update(UINT id, const DirectX::BoundingBox& box);
+	void Remove(UINT id);
+	bool Contains(UINT id) const;
+
+	// 与视锥相交的物体追加到results，物体逐个以AABB测试，结果与逐个测试所有物体相同
+	// 完全位于视锥内的节点，其子树中的物体不再测试
+	void QueryFrustum(const FrustumPlanes& frustum, std::vector<UINT>& results) const;
+	// 与球相交的物体追加到results
+	void QuerySphere(const DirectX::BoundingSphere& sphere, std::vector<UINT>& results) const;
+
+	size_t ItemCount() const { return mItemCount; }
+	size_t NodeCount() const { return mNodeLookup.size(); }
+
+	// 在与本树相同的根格子与深度下，以随机的1k、10k、100k个AABB比较八叉树与PackedBoxArray逐个测试的耗时
+	// 并检查两者结果一致，结果输出到调试窗口；不改变本树
+	void Benchmark(const FrustumPlanes& frustum) const;
+
+private:
+	struct Node {
+		DirectX::XMFLOAT3 Center;
+		float HalfSize = 0.0f;
+		UINT64 Key = 0;
+		UINT Parent = UINT_MAX;
+		UINT Children[8];
+		std::vector<UINT> Items;		// 物体的id
+		UINT SubtreeItemCount = 0;		// 包括子节点中的物体，为0时回收
+	};
+
+	struct ItemSlot {
+		DirectX::BoundingBox Box;
+		UINT Node = UINT_MAX;			// UINT_MAX表示不在树中
+		UINT Position = 0;				// 在Node::Items中的位置
+	};
+
+	// 物体应放入的节点的键
+	UINT64 NodeKey(const DirectX::BoundingBox& box) const;
+	// 查找或创建节点，同时创建缺少的祖先节点
+	UINT AcquireNode(UINT64 key);
+	void ReleaseEmptyNodes(UINT nodeIndex);
+
+	void Link(UINT id, UINT nodeIndex);
+	void Unlink(UINT id);
+
+	void CollectSubtree(UINT nodeIndex, std::vector<UINT>& results) const;
+	// planeMask: 仍需测试的平面，父节点已完全位于其内侧的平面不再测试
+	void QueryFrustum(UINT nodeIndex, const FrustumPlanes& frustum, UINT planeMask, std::vector<UINT>& results) const;
+	void QuerySphere(UINT nodeIndex, DirectX::FXMVECTOR center, float radius, std::vector<UINT>& results) const;
+
+	DirectX::XMFLOAT3 mCenter;
+	float mHalfSize;
+	UINT mMaxDepth;
+
+	std::vector<Node> mNodes;
+	std::vector<UINT> mFreeNodes;
+	std::unordered_map<UINT64, UINT> mNodeLookup;
+
+	std::vector<ItemSlot> mItems;		// 以id为索引
+	size_t mItemCount = 0;
+};
@@ -1,5 +1,7 @@
 #pragma once
 #include <DirectXMath.h>
+#include <string>
+#include <vector>
 using namespace DirectX;
 
 using TextureFlags = UINT;
@@ -13,6 +15,7 @@ enum TextureType {
 	EnvironmentMapping	= 1 << 5,
 	BumpTexture			= 1 << 6,
 	MaskTexture			= 1 << 7,
+	CompactVertex		= 1 << 8,	// 非纹理，表示Mesh使用压缩顶点格式
 };
 
 class Material {
@@ -38,4 +41,21 @@ public:
 	UINT MaskTextureIndex;
 
 	TextureFlags ItemType;
+};
+
+// 材质的描述，只记录参数与纹理的相对路径，不持有任何资源
+// 由Assimp的aiMaterial、OBJ/PBRT读取器或网格缓存得到，再由Scene加载纹理并创建Material
+struct MaterialTextureRef {
+	TextureType Slot;			// 纹理索引写入Material的哪个位置
+	std::string RelativePath;	// 相对于模型所在的文件夹
+};
+
+struct MaterialDesc {
+	// 默认值与Material相同
+	XMFLOAT4 DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	XMFLOAT3 FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05f);
+	float Roughness = 0.3f;
+
+	// 按加载顺序排列
+	std::vector<MaterialTextureRef> Textures;
 };
\ No newline at end of file
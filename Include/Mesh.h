@@ -11,6 +11,9 @@
 #include <wrl.h>
 #include <string>
 #include <unordered_map>
+#include <cmath>
+#include <algorithm>
+#include <xmmintrin.h>
 
 #include "assimp/Importer.hpp"
 #include "assimp/scene.h"
@@ -19,6 +22,15 @@
 #include "D3D12App.h"
 #include "Util.h"
 #include "VertexType.h"
+#include "MeshOptimizer.h"
+#include "Meshlet.h"
+#include "MeshSimplifier.h"
+#include "ThreadPool.h"
+#include "MeshCache.h"
+#include "MeshBounds.h"
+#include "GeometryArena.h"
+#include "ObjLoader.h"
+#include "TangentSpace.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -28,6 +40,88 @@ using namespace DirectX;
 //	XMFLOAT2 TexCoord;
 //};
 
+// 导入模型时对网格数据执行的可选处理
+using MeshImportFlags = UINT;
+enum MESH_IMPORT_FLAG_TYPE {
+	VertexCacheOptimization		= 1 << 0,	// 重排Index以提高后变换顶点缓存的命中率
+	VertexFetchOptimization		= 1 << 1,	// 按首次使用的顺序重排Vertex，提高顶点读取的局部性
+	CompactVertexFormat			= 1 << 2,	// 以VertexPositionNormalTangentTextureCompact格式上传顶点
+	LODGeneration				= 1 << 3,	// 为每个SubMesh生成LOD链
+	TangentGeneration			= 1 << 4,	// 由TangentSpace并行生成Tangent，不再使用aiProcess_CalcTangentSpace
+};
+
+const MeshImportFlags DefaultMeshImportFlags = VertexCacheOptimization | VertexFetchOptimization | LODGeneration | TangentGeneration;
+
+// 包括完整精度的LOD 0在内
+const UINT MaxLODCount = 5;
+
+// 最粗糙一级LOD的三角形数不超过此值的SubMesh才能作为软件遮挡剔除的遮挡体
+const UINT MaxOccluderTriangles = 1024;
+
+// Scene::mMeshes中某个Mesh的SubMesh
+struct SubMeshRef {
+	UINT MeshIndex = 0;
+	UINT SubMeshIndex = 0;
+};
+
+// 上传数据中属于某个SubMesh的部分，由Mesh::SubMeshContentOf得到，指向上传前的vertexData与indexData
+struct SubMeshContent {
+	// 顶点格式与量化参数不同时，相同的字节代表不同的几何体
+	bool CompactVertices = false;
+	PositionQuantization Quantization;
+	D3D_PRIMITIVE_TOPOLOGY PrimitiveTopology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	DXGI_FORMAT IndexFormat = DXGI_FORMAT_UNKNOWN;
+
+	UINT NumVertices = 0;
+	UINT PositionStrideInBytes = 0;
+	UINT AttributeStrideInBytes = 0;
+	const BYTE* Positions = nullptr;
+	const BYTE* Attributes = nullptr;
+
+	// 各级LOD的Index，没有LOD时只有SubMesh本身
+	std::vector<UINT> NumIndices;
+	std::vector<const BYTE*> Indices;
+
+	UINT64 Hash() const;
+	// 格式、数量与各段字节均相同
+	bool Equals(const SubMeshContent& other) const;
+	// 将引用的字节依次拷贝到storage中，返回指向storage的副本
+	SubMeshContent CopyTo(std::vector<BYTE>& storage) const;
+};
+
+// 以内容哈希索引已上传到几何Arena的SubMesh，由Scene持有
+// Mesh上传时查询: 命中的SubMesh直接引用已有的数据，未命中的SubMesh注册后上传
+// 哈希只用于查找，命中还需内容逐字节相同，因此注册时保存一份上传数据的副本，RemoveMesh时释放
+class SubMeshRegistry {
+public:
+	bool Find(UINT64 contentHash, const SubMeshContent& content, SubMeshRef& ref) const;
+	void Add(UINT64 contentHash, const SubMeshContent& content, const SubMeshRef& ref);
+
+	// Mesh的几何数据被释放时调用
+	void RemoveMesh(UINT meshIndex);
+
+	size_t Size() const { return mSubMeshes.size(); }
+
+private:
+	struct Entry {
+		SubMeshRef Ref;
+		SubMeshContent Content;		// 指向Storage
+		std::vector<BYTE> Storage;
+	};
+
+	// 内容不同而哈希碰撞的SubMesh各自保留一项
+	std::unordered_multimap<UINT64, Entry> mSubMeshes;
+};
+
+// 各级LOD共用SubMesh的顶点，只有Index不同
+struct SubMeshLOD {
+	UINT StartIndexLocation = 0;		// IndexBufferCPU中的位置
+	UINT NumIndices = 0;
+	UINT IndexBufferOffsetInBytes = 0;	// GPU端Index Buffer中的位置，格式同SubMesh::IndexFormat
+
+	float Error = 0.0f;		// 相对于完整精度的最大误差，以包围球半径为单位
+};
+
 struct SubMesh {
 	UINT NumVertices = 0;
 	UINT NumIndices = 0;
@@ -39,21 +133,72 @@ struct SubMesh {
 
 	UINT MaterialIndex = 0;
 
+	// 局部空间的AABB与包围球
 	BoundingBox Bounds;
+	BoundingSphere Sphere;
+
+	// 压缩顶点格式下，Position相对于Bounds量化
+	PositionQuantization Quantization;
+
+	// GPU端的Index Buffer中，每个SubMesh的Index格式可以不同
+	// StartIndexLocation仍是IndexBufferCPU中的位置
+	DXGI_FORMAT IndexFormat = DXGI_FORMAT_R32_UINT;
+	UINT IndexBufferOffsetInBytes = 0;
+
+	// LODs[0]为SubMesh本身，之后的各级LOD的Index追加在IndexBufferCPU的末尾
+	std::vector<SubMeshLOD> LODs;
+
+	// 上传的顶点与Index数据(包括各级LOD与量化参数)的哈希
+	UINT64 ContentHash = 0;
+	// 内容与已上传的SubMesh相同时为true，此时自身不占用几何Arena，绘制时使用SharedWith
+	bool IsShared = false;
+	SubMeshRef SharedWith;
+
+	// 软件遮挡剔除使用的遮挡体: 最粗糙一级LOD的三角形，局部空间，只保留用到的顶点
+	// 三角形过多(见MaxOccluderTriangles)或IsShared时为空
+	std::vector<XMFLOAT3> OccluderPositions;
+	std::vector<UINT> OccluderIndices;
+
+	// Mesh::Meshlets中属于该SubMesh的范围，由LOD 0生成，Meshlet内的顶点编号相对于BaseVertexLocation
+	// 不是三角形列表或IsShared时为空，后者使用SharedWith的Meshlet
+	UINT MeshletOffset = 0;
+	UINT MeshletCount = 0;
 };
 
+// 一个模型在MeshManager几何Arena中占用的范围
+// BaseVertex以顶点为单位，对Position流与属性流均有效；Index以字节为单位，4字节对齐
+struct GeometryAllocation {
+	bool CompactVertices = false;
+	UINT BaseVertex = 0;
+	UINT VertexCount = 0;
+	UINT IndexOffsetInBytes = 0;
+	UINT IndexSizeInBytes = 0;
+
+	bool IsValid() const {
+		return VertexCount > 0 || IndexSizeInBytes > 0;
+	}
+};
+
+class MeshManager;
+
 class Mesh {
 public:
-	// ָVertexΪDirectXTK12/VertexTypesе
+	// 指定Vertex类型为DirectXTK12/VertexTypes中的类型
 	using Vertex = VertexPositionNormalTangentTexture;
-	Mesh(ComPtr<ID3D12Device> device, ComPtr<ID3D12GraphicsCommandList> cmdList) 
+	using CompactVertex = VertexPositionNormalTangentTextureCompact;
+	// 顶点与Index数据上传到meshManager的几何Arena中，Mesh只记录所占的范围
+	Mesh(ComPtr<ID3D12Device> device, ComPtr<ID3D12GraphicsCommandList> cmdList, MeshManager* meshManager) 
 		: mDevice(device),
-		mCommandList(cmdList) {
+		mCommandList(cmdList),
+		mMeshManager(meshManager) {
 
 	}
 
-	void InitFromAssimp(const aiScene* pAiScene) {
-		// ȷС
+	// cacheWriter不为空时，同时记录上传的数据以写入网格缓存
+	void InitFromAssimp(const aiScene* pAiScene, MeshImportFlags importFlags = DefaultMeshImportFlags, MeshCacheWriter* cacheWriter = nullptr) {
+		INT64 stageStart = Util::QueryTimestamp();
+
+		// 确定大小
 		unsigned int numSubMeshes = pAiScene->mNumMeshes;
 		SubMeshes.resize(numSubMeshes);
 
@@ -62,9 +207,9 @@ public:
 		for (unsigned int i = 0; i < numSubMeshes; ++i) {
 			pAiSubmesh = pAiScene->mMeshes[i];
 			
-			// дSubMeshes
+			// 写入SubMeshes描述符
 			SubMeshes[i].NumVertices = pAiSubmesh->mNumVertices;
-			SubMeshes[i].NumIndices = pAiSubmesh->mFaces->mNumIndices * pAiSubmesh->mNumFaces;
+			SubMeshes[i].NumIndices = 3 * CountTriangles(pAiSubmesh);
 
 			SubMeshes[i].StartIndexLocation = NumIndices;
 			SubMeshes[i].BaseVertexLocation = NumVertices;
@@ -75,7 +220,7 @@ public:
 
 			SubMeshes[i].MaterialIndex = pAiSubmesh->mMaterialIndex;
 
-			// ܼVertexIndex
+			// 总计Vertex和Index数量
 			NumVertices += SubMeshes[i].NumVertices;
 			NumIndices += SubMeshes[i].NumIndices;
 		}
@@ -87,70 +232,554 @@ public:
 		IndexBufferCPU.resize(NumIndices);
 
 		// Second Loop, copy data
+		// 顶点与面按固定大小分块，所有SubMesh的分块一起交给线程池并行转换
+		struct ConversionTask {
+			UINT SubMeshIndex;
+			UINT Begin;
+			UINT End;
+			bool IsIndexTask;
+		};
+
+		const UINT verticesPerTask = 16 * 1024;
+		const UINT facesPerTask = 32 * 1024;
+
+		std::vector<ConversionTask> tasks;
 		for (unsigned int i = 0; i < numSubMeshes; ++i) {
 			pAiSubmesh = pAiScene->mMeshes[i];
+			for (UINT begin = 0; begin < pAiSubmesh->mNumVertices; begin += verticesPerTask) {
+				tasks.push_back({ i, begin, (std::min)(begin + verticesPerTask, pAiSubmesh->mNumVertices), false });
+			}
+
+			// 混有点和线的Mesh无法直接由面的序号得到Index的位置，只能整体串行处理
+			if (IsTriangleOnly(pAiSubmesh)) {
+				for (UINT begin = 0; begin < pAiSubmesh->mNumFaces; begin += facesPerTask) {
+					tasks.push_back({ i, begin, (std::min)(begin + facesPerTask, pAiSubmesh->mNumFaces), true });
+				}
+			}
+			else {
+				tasks.push_back({ i, 0, pAiSubmesh->mNumFaces, true });
+			}
+		}
+
+		ThreadPool::Get().ParallelFor(tasks.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t t = begin; t < end; ++t) {
+				const ConversionTask& task = tasks[t];
+				const aiMesh* pAiMesh = pAiScene->mMeshes[task.SubMeshIndex];
+				const SubMesh& submesh = SubMeshes[task.SubMeshIndex];
+
+				if (task.IsIndexTask) {
+					CopyTriangleIndices(IndexBufferCPU.data() + submesh.StartIndexLocation, pAiMesh, task.Begin, task.End);
+				}
+				else {
+					InterleaveVertices(VertexBufferCPU.data() + submesh.BaseVertexLocation, pAiMesh, task.Begin, task.End);
+				}
+			}
+		});
+
+		double convertTime = Util::MillisecondsSince(stageStart);
+		if (importFlags & TangentGeneration) {
+			GenerateTangents();
+		}
+
+		FinishImport(importFlags, cacheWriter, convertTime);
+	}
+
+	// 由OBJ读取器的结果初始化，数据直接移入VertexBufferCPU与IndexBufferCPU
+	void InitFromObj(ObjModel& model, MeshImportFlags importFlags = DefaultMeshImportFlags, MeshCacheWriter* cacheWriter = nullptr) {
+		INT64 stageStart = Util::QueryTimestamp();
+
+		VertexBufferCPU = std::move(model.Vertices);
+		IndexBufferCPU = std::move(model.Indices);
+		NumVertices = static_cast<UINT>(VertexBufferCPU.size());
+		NumIndices = static_cast<UINT>(IndexBufferCPU.size());
+		VertexBufferSizeInBytes = sizeof(Vertex) * NumVertices;
+		IndexBufferSizeInBytes = sizeof(UINT) * NumIndices;
+
+		SubMeshes.resize(model.SubMeshes.size());
+		for (size_t i = 0; i < model.SubMeshes.size(); ++i) {
+			const ObjSubMesh& objSubmesh = model.SubMeshes[i];
+			SubMeshes[i].NumVertices = objSubmesh.NumVertices;
+			SubMeshes[i].NumIndices = objSubmesh.NumIndices;
+			SubMeshes[i].BaseVertexLocation = objSubmesh.BaseVertexLocation;
+			SubMeshes[i].StartIndexLocation = objSubmesh.StartIndexLocation;
+			SubMeshes[i].PrimitiveTopology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+			SubMeshes[i].MaterialIndex = objSubmesh.MaterialIndex;
+		}
+
+		FinishImport(importFlags, cacheWriter, Util::MillisecondsSince(stageStart));
+	}
+
+	// 导入的公共后半段: 顶点缓存与顶点读取优化、包围体、LOD、上传及写入缓存
+	// 调用前VertexBufferCPU、IndexBufferCPU与SubMeshes已填好，Index相对于SubMesh的BaseVertexLocation
+	void FinishImport(MeshImportFlags importFlags, MeshCacheWriter* cacheWriter, double convertTime) {
+		INT64 stageStart = Util::QueryTimestamp();
+		double vertexCacheTime = 0.0, vertexFetchTime = 0.0, lodTime = 0.0, uploadTime = 0.0;
+		const UINT numSubMeshes = static_cast<UINT>(SubMeshes.size());
+
+		// 后变换顶点缓存优化
+		// 每个顶点的VS调用在Shadow Pass和Main Pass中各发生一次，节省的调用次数需乘2
+		if (importFlags & VertexCacheOptimization) {
+			UINT transformedBefore = 0, transformedAfter = 0, triangleCount = 0, vertexCount = 0;
+			for (unsigned int i = 0; i < numSubMeshes; ++i) {
+				UINT* indices = &IndexBufferCPU[SubMeshes[i].StartIndexLocation];
+
+				MeshOptimizer::VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(indices, SubMeshes[i].NumIndices, SubMeshes[i].NumVertices);
+				MeshOptimizer::OptimizeVertexCache(indices, SubMeshes[i].NumIndices, SubMeshes[i].NumVertices);
+				MeshOptimizer::VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(indices, SubMeshes[i].NumIndices, SubMeshes[i].NumVertices);
+
+				transformedBefore += before.VerticesTransformed;
+				transformedAfter += after.VerticesTransformed;
+				triangleCount += before.TriangleCount;
+				vertexCount += before.VertexCount;
+			}
+
+			if (triangleCount > 0 && vertexCount > 0) {
+				Util::DebugLog("[Mesh] Vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %u fewer VS invocations per frame (shadow + main)\n",
+					static_cast<float>(transformedBefore) / triangleCount, static_cast<float>(transformedAfter) / triangleCount,
+					static_cast<float>(transformedBefore) / vertexCount, static_cast<float>(transformedAfter) / vertexCount,
+					2 * (transformedBefore - transformedAfter));
+			}
+		}
+
+		vertexCacheTime = Util::MillisecondsSince(stageStart);
+		stageStart = Util::QueryTimestamp();
+
+		// 顶点读取优化，依赖于上一步确定的Index顺序
+		if (importFlags & VertexFetchOptimization) {
+			UINT bytesBefore = 0, bytesAfter = 0;
+			for (unsigned int i = 0; i < numSubMeshes; ++i) {
+				Vertex* vertices = &VertexBufferCPU[SubMeshes[i].BaseVertexLocation];
+				UINT* indices = &IndexBufferCPU[SubMeshes[i].StartIndexLocation];
+
+				bytesBefore += MeshOptimizer::AnalyzeVertexFetch(indices, SubMeshes[i].NumIndices, SubMeshes[i].NumVertices, sizeof(Vertex)).BytesFetched;
+				MeshOptimizer::OptimizeVertexFetch(vertices, indices, SubMeshes[i].NumIndices, SubMeshes[i].NumVertices);
+				bytesAfter += MeshOptimizer::AnalyzeVertexFetch(indices, SubMeshes[i].NumIndices, SubMeshes[i].NumVertices, sizeof(Vertex)).BytesFetched;
+			}
+
+			if (VertexBufferSizeInBytes > 0) {
+				Util::DebugLog("[Mesh] Vertex fetch: overfetch %.3f -> %.3f (%u KB -> %u KB per pass)\n",
+					static_cast<float>(bytesBefore) / VertexBufferSizeInBytes, static_cast<float>(bytesAfter) / VertexBufferSizeInBytes,
+					bytesBefore / 1024, bytesAfter / 1024);
+			}
+		}
+
+		vertexFetchTime = Util::MillisecondsSince(stageStart);
+		stageStart = Util::QueryTimestamp();
+
+		// 包围体，需在顶点重排之后计算，各SubMesh并行
+		ThreadPool::Get().ParallelFor(numSubMeshes, 1, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				SubMesh& submesh = SubMeshes[i];
+				BoundingVolume volume = MeshBounds::Compute(&(VertexBufferCPU.data() + submesh.BaseVertexLocation)->position,
+					submesh.NumVertices, sizeof(Vertex));
+				submesh.Bounds = volume.Box;
+				submesh.Sphere = volume.Sphere;
+				submesh.Quantization = PositionQuantization::FromBounds(submesh.Bounds);
+
+				SubMeshLOD lod;
+				lod.StartIndexLocation = submesh.StartIndexLocation;
+				lod.NumIndices = submesh.NumIndices;
+				submesh.LODs.assign(1, lod);
+			}
+		});
+
+		if (importFlags & LODGeneration) {
+			GenerateLODChain();
+		}
+
+		lodTime = Util::MillisecondsSince(stageStart);
+		stageStart = Util::QueryTimestamp();
+
+		// 创建资源
+		// VertexBufferCPU始终保留全精度的数据，压缩格式与拆分的顶点流只用于上传
+		std::vector<BYTE> vertexStreams;
+		if (importFlags & CompactVertexFormat) {
+			std::vector<CompactVertex> compactVertices = EncodeCompactVertices();
+			vertexStreams = BuildVertexStreams(compactVertices.data());
+			CompactVertices = true;
+		}
+		else {
+			vertexStreams = BuildVertexStreams(VertexBufferCPU.data());
+		}
+
+		std::vector<BYTE> packedIndices = PackIndexBuffer();
+
+		Util::DebugLog("[Mesh] Vertex streams: position %u B + attributes %u B per vertex, Index buffer: %u KB -> %u KB\n",
+			PositionStrideInBytes, AttributeStrideInBytes,
+			static_cast<UINT>(sizeof(UINT) * IndexBufferCPU.size() / 1024), IndexBufferSizeInBytes / 1024);
+
+		// 缓存保存去重之前的完整数据，去重的结果取决于导入时已驻留的SubMesh
+		if (cacheWriter != nullptr) {
+			cacheWriter->SetMesh(vertexStreams.data(), VertexBufferSizeInBytes,
+				PositionStrideInBytes, AttributeStrideInBytes, AttributeOffsetInBytes, CompactVertices,
+				packedIndices.data(), IndexBufferSizeInBytes,
+				NumVertices, NumIndices, SubMeshes);
+		}
+
+		UploadBuffers(vertexStreams.data(), packedIndices.data());
+
+		uploadTime = Util::MillisecondsSince(stageStart);
+
+		Util::DebugLog("[Mesh] %u vertices, %u triangles: convert %.2f ms (%u threads), vertex cache %.2f ms, vertex fetch %.2f ms, LOD %.2f ms, upload %.2f ms\n",
+			NumVertices, NumIndices / 3, convertTime, ThreadPool::Get().ThreadCount(), vertexCacheTime, vertexFetchTime, lodTime, uploadTime);
+	}
+
+	// 从网格缓存恢复，映射的数据直接作为上传的源，不经过Assimp和任何中间拷贝
+	// VertexBufferCPU与IndexBufferCPU保持为空
+	void InitFromCache(const MeshCacheView& cache) {
+		const MeshCacheHeader& header = cache.Header();
+
+		NumVertices = header.NumVertices;
+		NumIndices = header.NumIndices;
+		CompactVertices = header.CompactVertices != 0;
+		PositionStrideInBytes = header.PositionStrideInBytes;
+		AttributeStrideInBytes = header.AttributeStrideInBytes;
+		AttributeOffsetInBytes = header.AttributeOffsetInBytes;
+		VertexBufferSizeInBytes = static_cast<UINT>(header.VertexDataSize);
+		IndexBufferSizeInBytes = static_cast<UINT>(header.IndexDataSize);
+
+		cache.ReadSubMeshes(SubMeshes);
+
+		UploadBuffers(cache.VertexData(), cache.IndexData());
+	}
+
+	// 拆分为Position流与属性流，并记录两者在Vertex Buffer中的布局
+	template <typename VertexType>
+	std::vector<BYTE> BuildVertexStreams(const VertexType* vertices) {
+		using Streams = VertexStreams<VertexType>;
+		PositionStrideInBytes = Streams::PositionStride;
+		AttributeStrideInBytes = Streams::AttributeStride;
+		AttributeOffsetInBytes = Streams::AttributeOffset(NumVertices);
+		VertexBufferSizeInBytes = Streams::SizeInBytes(NumVertices);
+
+		std::vector<BYTE> streams(VertexBufferSizeInBytes);
+		Streams::Split(streams.data(), vertices, NumVertices);
+		return streams;
+	}
+
+	// 按VertexBufferSizeInBytes与IndexBufferSizeInBytes上传到几何Arena
+	// Registry不为空时按内容对SubMesh去重，只上传未命中的SubMesh，
+	// 之后这些SubMesh的BaseVertexLocation与IndexBufferOffsetInBytes相对于实际上传的数据
+	void UploadBuffers(const void* vertexData, const void* indexData);
+
+	// vertexData与indexData中属于该SubMesh的部分，用于去重时的哈希与比较
+	SubMeshContent SubMeshContentOf(const SubMesh& submesh, const void* vertexData, const void* indexData) const;
+
+	// 由vertexData与indexData(上传的格式，压缩的Position在此解码)提取SubMesh的遮挡体
+	// 完整导入与网格缓存导入都经过UploadBuffers，两者得到的遮挡体相同
+	void ExtractOccluder(SubMesh& submesh, const void* vertexData, const void* indexData) const;
 
-			// Vertex Buffer
-			for (unsigned int j = 0, k = SubMeshes[i].BaseVertexLocation; j < SubMeshes[i].NumVertices; ++j, ++k) {
-				VertexBufferCPU[k].position = XMFLOAT3(reinterpret_cast<const float*>(&pAiSubmesh->mVertices[j]));
-				VertexBufferCPU[k].normal = XMFLOAT3(reinterpret_cast<const float*>(&pAiSubmesh->mNormals[j]));
-				VertexBufferCPU[k].tangent = XMFLOAT3(reinterpret_cast<const float*>(&pAiSubmesh->mTangents[j]));
-				VertexBufferCPU[k].textureCoordinate = XMFLOAT2(reinterpret_cast<const float*>(&pAiSubmesh->mTextureCoords[0][j]));
+	// 为未命中去重的SubMesh生成Meshlet并合并到Meshlets，设置各SubMesh的MeshletOffset与MeshletCount
+	void BuildMeshlets(const void* vertexData, const void* indexData);
+	void BuildSubMeshMeshlets(const SubMesh& submesh, const void* vertexData, const void* indexData, MeshletData& data) const;
+
+	// 上传格式的第index个Position，压缩格式按Shader中的方式解码
+	XMFLOAT3 DecodePosition(const SubMesh& submesh, const BYTE* positions, UINT index) const;
+
+	// 归还在几何Arena中占用的范围，之后不能再绘制该Mesh
+	void ReleaseGeometry();
+
+	// Arena中的绝对位置，直接用于DrawIndexedInstanced
+	INT BaseVertexLocation(INT localBaseVertex = 0) const {
+		return static_cast<INT>(Geometry.BaseVertex) + localBaseVertex;
+	}
+
+	UINT StartIndexLocation(UINT indexBufferOffsetInBytes, DXGI_FORMAT format) const {
+		return (Geometry.IndexOffsetInBytes + indexBufferOffsetInBytes) / MeshOptimizer::IndexFormatSizeInBytes(format);
+	}
+
+	static bool IsTriangleOnly(const aiMesh* pAiMesh) {
+		return pAiMesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE;
+	}
+
+	// 各SubMesh在工作线程上生成Tangent，SubMesh内部的三角形与顶点再由TangentSpace并行处理
+	// 纹理镜像接缝处拆分出的顶点追加在各自SubMesh的末尾，之后的SubMesh整体后移
+	void GenerateTangents() {
+		INT64 stageStart = Util::QueryTimestamp();
+		const UINT numSubMeshes = static_cast<UINT>(SubMeshes.size());
+
+		std::vector<std::vector<Vertex>> splitVertices(numSubMeshes);
+		ThreadPool::Get().ParallelFor(numSubMeshes, 1, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				const SubMesh& submesh = SubMeshes[i];
+				TangentSpace::GenerateTangents(VertexBufferCPU.data() + submesh.BaseVertexLocation, submesh.NumVertices,
+					IndexBufferCPU.data() + submesh.StartIndexLocation, submesh.NumIndices, splitVertices[i]);
 			}
+		});
+
+		UINT splitCount = 0;
+		for (const std::vector<Vertex>& split : splitVertices) {
+			splitCount += static_cast<UINT>(split.size());
+		}
 
-			// Index Buffer
-			unsigned int idx = SubMeshes[i].StartIndexLocation;
-			for (UINT j = 0; j < pAiSubmesh->mNumFaces; ++j) {
-				for (UINT k = 0; k < pAiSubmesh->mFaces[j].mNumIndices; ++k) {
-					IndexBufferCPU[idx] = pAiSubmesh->mFaces[j].mIndices[k];
-					idx++;
+		if (splitCount > 0) {
+			std::vector<Vertex> vertices;
+			vertices.reserve(VertexBufferCPU.size() + splitCount);
+			for (UINT i = 0; i < numSubMeshes; ++i) {
+				SubMesh& submesh = SubMeshes[i];
+				const Vertex* source = VertexBufferCPU.data() + submesh.BaseVertexLocation;
+				vertices.insert(vertices.end(), source, source + submesh.NumVertices);
+				vertices.insert(vertices.end(), splitVertices[i].begin(), splitVertices[i].end());
+				submesh.BaseVertexLocation = static_cast<INT>(vertices.size() - submesh.NumVertices - splitVertices[i].size());
+				submesh.NumVertices += static_cast<UINT>(splitVertices[i].size());
+			}
+			VertexBufferCPU = std::move(vertices);
+			NumVertices = static_cast<UINT>(VertexBufferCPU.size());
+			VertexBufferSizeInBytes = sizeof(Vertex) * NumVertices;
+		}
+
+		// 与关闭TangentGeneration时Assimp ReadFile多出的耗时对比
+		Util::DebugLog("[Mesh] Tangent generation: %u submeshes, %u vertices split at UV mirror seams, %.2f ms on %u threads\n",
+			numSubMeshes, splitCount, Util::MillisecondsSince(stageStart), ThreadPool::Get().ThreadCount());
+	}
+
+	// 经过aiProcess_Triangulate之后仍可能残留点和线，它们不会被写入Index Buffer
+	static UINT CountTriangles(const aiMesh* pAiMesh) {
+		if (IsTriangleOnly(pAiMesh)) {
+			return pAiMesh->mNumFaces;
+		}
+
+		UINT count = 0;
+		for (UINT j = 0; j < pAiMesh->mNumFaces; ++j) {
+			count += pAiMesh->mFaces[j].mNumIndices == 3 ? 1 : 0;
+		}
+		return count;
+	}
+
+	// 将[beginFace, endFace)的三角形写入indices，indices为SubMesh的起始位置
+	static void CopyTriangleIndices(UINT* indices, const aiMesh* pAiMesh, UINT beginFace, UINT endFace) {
+		if (IsTriangleOnly(pAiMesh)) {
+			// 每个面恰好3个Index，写入位置可直接由面的序号得到
+			UINT* dst = indices + 3 * beginFace;
+			for (UINT j = beginFace; j < endFace; ++j, dst += 3) {
+				const unsigned int* src = pAiMesh->mFaces[j].mIndices;
+				dst[0] = src[0];
+				dst[1] = src[1];
+				dst[2] = src[2];
+			}
+			return;
+		}
+
+		// 只有在整体处理时才能确定写入位置
+		UINT* dst = indices;
+		for (UINT j = beginFace; j < endFace; ++j) {
+			const aiFace& face = pAiMesh->mFaces[j];
+			if (face.mNumIndices == 3) {
+				dst[0] = face.mIndices[0];
+				dst[1] = face.mIndices[1];
+				dst[2] = face.mIndices[2];
+				dst += 3;
+			}
+		}
+	}
+
+	// 将Assimp分散的顶点流[begin, end)交错写入vertices，vertices为SubMesh的起始位置
+	// 每个属性以一次128位的非对齐读写完成: 多写出的一个float随后会被下一个属性覆盖，
+	// 但读取会越过当前元素4个字节，因此每个流的最后一个元素由标量代码处理
+	// 缺失的Normal、Tangent、TexCoord以0填充
+	static void InterleaveVertices(Vertex* vertices, const aiMesh* pAiMesh, UINT begin, UINT end) {
+		static_assert(sizeof(Vertex) == 11 * sizeof(float), "InterleaveVertices assumes the 44 byte position/normal/tangent/uv layout");
+		static_assert(sizeof(aiVector3D) == 3 * sizeof(float), "aiVector3D must be tightly packed");
+
+		const float* positions = reinterpret_cast<const float*>(pAiMesh->mVertices);
+		const float* normals = pAiMesh->HasNormals() ? reinterpret_cast<const float*>(pAiMesh->mNormals) : nullptr;
+		const float* tangents = pAiMesh->HasTangentsAndBitangents() ? reinterpret_cast<const float*>(pAiMesh->mTangents) : nullptr;
+		const float* texCoords = pAiMesh->HasTextureCoords(0) ? reinterpret_cast<const float*>(pAiMesh->mTextureCoords[0]) : nullptr;
+
+		const __m128 zero = _mm_setzero_ps();
+
+		UINT vectorEnd = (std::min)(end, pAiMesh->mNumVertices - 1);
+		UINT j = begin;
+		for (; j < vectorEnd; ++j) {
+			float* dst = reinterpret_cast<float*>(&vertices[j]);
+			_mm_storeu_ps(dst + 0, _mm_loadu_ps(positions + 3 * j));
+			_mm_storeu_ps(dst + 3, normals ? _mm_loadu_ps(normals + 3 * j) : zero);
+			_mm_storeu_ps(dst + 6, tangents ? _mm_loadu_ps(tangents + 3 * j) : zero);
+			_mm_storel_pi(reinterpret_cast<__m64*>(dst + 9), texCoords ? _mm_loadu_ps(texCoords + 3 * j) : zero);
+		}
+
+		for (; j < end; ++j) {
+			vertices[j].position = XMFLOAT3(positions + 3 * j);
+			vertices[j].normal = normals ? XMFLOAT3(normals + 3 * j) : XMFLOAT3(0.0f, 0.0f, 0.0f);
+			vertices[j].tangent = tangents ? XMFLOAT3(tangents + 3 * j) : XMFLOAT3(0.0f, 0.0f, 0.0f);
+			vertices[j].textureCoordinate = texCoords ? XMFLOAT2(texCoords + 3 * j) : XMFLOAT2(0.0f, 0.0f);
+		}
+	}
+
+	// 每级LOD的目标三角形数为上一级的一半，由上一级LOD继续简化得到
+	// 边界与接缝被锁定导致简化受阻，或误差过大时提前停止，因此LOD数量因SubMesh而异
+	void GenerateLODChain() {
+		// 三角形数少于此值时不再继续简化
+		const size_t minLODIndexCount = 3 * 128;
+		// 单级简化允许的最大误差，以包围球半径为单位
+		const float maxLODError = 0.1f;
+
+		for (SubMesh& submesh : SubMeshes) {
+			float radius = submesh.Sphere.Radius;
+			const XMFLOAT3* positions = &VertexBufferCPU[submesh.BaseVertexLocation].position;
+
+			std::vector<UINT> source(IndexBufferCPU.begin() + submesh.StartIndexLocation,
+				IndexBufferCPU.begin() + submesh.StartIndexLocation + submesh.NumIndices);
+			std::vector<UINT> simplified(source.size());
+			float error = 0.0f;
+
+			while (submesh.LODs.size() < MaxLODCount) {
+				size_t targetIndexCount = source.size() / 6 * 3;
+				if (targetIndexCount < minLODIndexCount) {
+					break;
+				}
+
+				float lodError = 0.0f;
+				size_t indexCount = MeshSimplifier::Simplify(simplified.data(), source.data(), source.size(),
+					positions, submesh.NumVertices, sizeof(Vertex),
+					targetIndexCount, maxLODError * radius, &lodError);
+
+				// 简化效果不明显，不值得多占用一级LOD
+				if (indexCount > source.size() * 3 / 4) {
+					break;
 				}
+
+				MeshOptimizer::OptimizeVertexCache(simplified.data(), indexCount, submesh.NumVertices);
+
+				// 由上一级LOD简化得到，误差累加作为相对于LOD 0的上界
+				error += lodError;
+
+				SubMeshLOD lod;
+				lod.StartIndexLocation = static_cast<UINT>(IndexBufferCPU.size());
+				lod.NumIndices = static_cast<UINT>(indexCount);
+				lod.Error = radius > 0.0f ? error / radius : 0.0f;
+				submesh.LODs.push_back(lod);
+
+				IndexBufferCPU.insert(IndexBufferCPU.end(), simplified.begin(), simplified.begin() + indexCount);
+				source.assign(simplified.begin(), simplified.begin() + indexCount);
 			}
 
+			for (UINT l = 0; l < submesh.LODs.size(); ++l) {
+				Util::DebugLog("[Mesh] SubMesh LOD %u: %u triangles, error %.4f (of bounding radius)\n",
+					l, submesh.LODs[l].NumIndices / 3, submesh.LODs[l].Error);
+			}
 		}
-		
-
-		// Դ
-		Util::UploadResource(mDevice.Get(), mCommandList.Get(),
-			reinterpret_cast<const void*>(VertexBufferCPU.data()),
-			VertexBufferSizeInBytes,
-			VertexBufferGPU,
-			VertexBufferUploader);
-
-		Util::UploadResource(mDevice.Get(), mCommandList.Get(),
-			reinterpret_cast<const void*>(IndexBufferCPU.data()),
-			IndexBufferSizeInBytes,
-			IndexBufferGPU,
-			IndexBufferUploader);
 	}
 
+	// 逐SubMesh选择Index格式并打包，每级LOD的起始位置按其Index大小对齐
+	// 使得StartIndexLocation = IndexBufferOffsetInBytes / Index大小
+	std::vector<BYTE> PackIndexBuffer() {
+		size_t offset = 0;
+		for (SubMesh& submesh : SubMeshes) {
+			submesh.IndexFormat = MeshOptimizer::ChooseIndexFormat(submesh.NumVertices);
+			UINT indexSize = MeshOptimizer::IndexFormatSizeInBytes(submesh.IndexFormat);
+
+			for (SubMeshLOD& lod : submesh.LODs) {
+				offset = (offset + indexSize - 1) / indexSize * indexSize;
+				lod.IndexBufferOffsetInBytes = static_cast<UINT>(offset);
+				offset += lod.NumIndices * indexSize;
+			}
+			submesh.IndexBufferOffsetInBytes = submesh.LODs[0].IndexBufferOffsetInBytes;
+		}
 
-	D3D12_VERTEX_BUFFER_VIEW VertexBufferView() const {
-		D3D12_VERTEX_BUFFER_VIEW vbv;
-		vbv.BufferLocation = VertexBufferGPU->GetGPUVirtualAddress();
-		vbv.SizeInBytes = VertexBufferSizeInBytes;
-		vbv.StrideInBytes = VertexBufferStrideInBytes;
+		// Buffer大小保持4字节对齐
+		std::vector<BYTE> packedIndices((offset + 3) & ~size_t(3));
+		for (const SubMesh& submesh : SubMeshes) {
+			for (const SubMeshLOD& lod : submesh.LODs) {
+				MeshOptimizer::PackIndices(&packedIndices[lod.IndexBufferOffsetInBytes],
+					&IndexBufferCPU[lod.StartIndexLocation], lod.NumIndices, submesh.IndexFormat);
+			}
+		}
 
-		return vbv;
+		IndexBufferSizeInBytes = static_cast<UINT>(packedIndices.size());
+		return packedIndices;
 	}
 
-	D3D12_INDEX_BUFFER_VIEW IndexBufferView() const {
-		D3D12_INDEX_BUFFER_VIEW ibv;
-		ibv.BufferLocation = IndexBufferGPU->GetGPUVirtualAddress();
-		ibv.Format = IndexFormat;
-		ibv.SizeInBytes = IndexBufferSizeInBytes;
+	// 以各SubMesh的包围盒为量化范围编码顶点
+	std::vector<CompactVertex> EncodeCompactVertices() const {
+		std::vector<CompactVertex> compactVertices(NumVertices);
+
+		for (const SubMesh& submesh : SubMeshes) {
+			for (UINT j = 0, k = submesh.BaseVertexLocation; j < submesh.NumVertices; ++j, ++k) {
+				compactVertices[k] = CompactVertex::Encode(VertexBufferCPU[k], submesh.Quantization);
+			}
+		}
+
+#if defined(DEBUG) | defined(_DEBUG)
+		// 解码并统计超出理论误差上界(见CompactVertex::*ErrorBound)的分量，只输出日志:
+		// 导入的数据可能含有NaN、非规格化数或超出半精度范围的UV，不应因此中断导入
+		// 以!(error <= bound)判断，使NaN也计入超限
+		const float directionBound = CompactVertex::DirectionErrorBound();
+		float maxPositionError = 0.0f, maxNormalError = 0.0f, maxTangentError = 0.0f, maxTexCoordError = 0.0f;
+		UINT positionViolations = 0, directionViolations = 0, texCoordViolations = 0;
+		for (const SubMesh& submesh : SubMeshes) {
+			const float* scale = &submesh.Quantization.Scale.x;
+			const float* offset = &submesh.Quantization.Offset.x;
+			float positionBound[3];
+			for (UINT axis = 0; axis < 3; ++axis) {
+				positionBound[axis] = CompactVertex::PositionErrorBound(scale[axis], offset[axis]);
+			}
+			float diagonal = 2.0f * XMVectorGetX(XMVector3Length(XMLoadFloat3(&submesh.Bounds.Extents)));
+
+			for (UINT j = 0, k = submesh.BaseVertexLocation; j < submesh.NumVertices; ++j, ++k) {
+				const Vertex& original = VertexBufferCPU[k];
+				Vertex decoded = CompactVertex::Decode(compactVertices[k], submesh.Quantization);
+
+				for (UINT axis = 0; axis < 3; ++axis) {
+					float error = std::fabs((&decoded.position.x)[axis] - (&original.position.x)[axis]);
+					positionViolations += !(error <= positionBound[axis]);
+					if (diagonal > 0.0f && error <= positionBound[axis]) {
+						maxPositionError = (std::max)(maxPositionError, error / diagonal);
+					}
+				}
 
-		return ibv;
+				// 长度为0或非有限值的方向编码为固定值，不参与检查
+				auto DirectionError = [](const XMFLOAT3& decodedDirection, const XMFLOAT3& originalDirection) {
+					XMVECTOR direction = XMLoadFloat3(&originalDirection);
+					float lengthSq = XMVectorGetX(XMVector3LengthSq(direction));
+					if (!(lengthSq >= 1e-12f) || !std::isfinite(lengthSq)) {
+						return 0.0f;
+					}
+					return XMVectorGetX(XMVector3Length(XMLoadFloat3(&decodedDirection) - XMVector3Normalize(direction)));
+				};
+				float normalError = DirectionError(decoded.normal, original.normal);
+				float tangentError = DirectionError(decoded.tangent, original.tangent);
+				directionViolations += !(normalError <= directionBound);
+				directionViolations += !(tangentError <= directionBound);
+				maxNormalError = (std::max)(maxNormalError, normalError);
+				maxTangentError = (std::max)(maxTangentError, tangentError);
+
+				for (UINT axis = 0; axis < 2; ++axis) {
+					float value = (&original.textureCoordinate.x)[axis];
+					float error = std::fabs((&decoded.textureCoordinate.x)[axis] - value);
+					if (error <= CompactVertex::TexCoordErrorBound(value)) {
+						maxTexCoordError = (std::max)(maxTexCoordError, error);
+					}
+					else {
+						++texCoordViolations;
+					}
+				}
+			}
+		}
+
+		Util::DebugLog("[Mesh] Compact vertex: %u B -> %u B per vertex, max error position %.2e (of bounds diagonal), normal %.3f deg, tangent %.3f deg, uv %.2e\n",
+			static_cast<UINT>(sizeof(Vertex)), static_cast<UINT>(sizeof(CompactVertex)),
+			maxPositionError, XMConvertToDegrees(maxNormalError), XMConvertToDegrees(maxTangentError), maxTexCoordError);
+		if (positionViolations + directionViolations + texCoordViolations > 0) {
+			Util::DebugLog("[Mesh] Error: compact vertex round trip out of bounds: %u position, %u normal/tangent, %u uv components (NaN, denormal or half overflow in source data?)\n",
+				positionViolations, directionViolations, texCoordViolations);
+		}
+#endif
+
+		return compactVertices;
 	}
 
+
 	UINT IndexCount() const {
 		return NumIndices;
 	}
 
-	void GenerateSphere(float radius) {
-		UINT numSubdivision = 6u;
+	// maxAngularError: 细分后每条边相对球心所张的最大角度（弧度），
+	// 细分层级由其反推，而不是固定为某个值
+	void GenerateSphere(float radius, float maxAngularError = XMConvertToRadians(1.0f)) {
+		UINT numSubdivision = SubdivisionLevelForAngularError(maxAngularError);
 
-		// ʮ
+		// 构建正二十面体
 		const float X = 0.525731f;
 		const float Z = 0.850651f;
 
@@ -172,43 +801,61 @@ public:
 			10,1,6, 11,0,9, 2,11,9, 5,2,9,  11,2,7
 		};
 
+		// 共享顶点的细分结果：V = 10 * 4^n + 2, F = 20 * 4^n
+		size_t finalVertexCount = 10 * (size_t(1) << (2 * numSubdivision)) + 2;
+		size_t finalIndexCount = 60 * (size_t(1) << (2 * numSubdivision));
+
+		VertexBufferCPU.clear();
+		VertexBufferCPU.reserve(finalVertexCount);
 		VertexBufferCPU.resize(12);
 		for (UINT i = 0; i < 12; ++i) {
 			VertexBufferCPU[i].position = pos[i];
 		}
+		IndexBufferCPU.reserve(finalIndexCount);
 		IndexBufferCPU.assign(&k[0], &k[60]);
 
-		// ϸ
+		// 细分
 		for (UINT i = 0; i < numSubdivision; ++i) {
 			Subdivide();
 		}
 
-		// ϸֺPosition
+		// 修正细分后的Position
 		for (UINT i = 0; i < VertexBufferCPU.size(); ++i) {
 			XMStoreFloat3(&VertexBufferCPU[i].position, radius * XMVector3Normalize(XMLoadFloat3(&VertexBufferCPU[i].position)));
 		}
 
-		// дԪ
+		// 填写元数据
 		NumVertices = VertexBufferCPU.size();
 		NumIndices = IndexBufferCPU.size();
-		VertexBufferSizeInBytes = sizeof(Vertex) * NumVertices;
-		IndexBufferSizeInBytes = sizeof(UINT) * NumIndices;
+		std::vector<BYTE> vertexStreams = BuildVertexStreams(VertexBufferCPU.data());
+
+		// 整个球体只有一个SubMesh
+		IndexFormat = MeshOptimizer::ChooseIndexFormat(NumVertices);
+		std::vector<BYTE> packedIndices((NumIndices * MeshOptimizer::IndexFormatSizeInBytes(IndexFormat) + 3) & ~size_t(3));
+		MeshOptimizer::PackIndices(packedIndices.data(), IndexBufferCPU.data(), NumIndices, IndexFormat);
+		IndexBufferSizeInBytes = static_cast<UINT>(packedIndices.size());
 
-		// Դ
-		Util::UploadResource(mDevice.Get(), mCommandList.Get(),
-			reinterpret_cast<const void*>(VertexBufferCPU.data()),
-			VertexBufferSizeInBytes,
-			VertexBufferGPU,
-			VertexBufferUploader);
-
-		Util::UploadResource(mDevice.Get(), mCommandList.Get(),
-			reinterpret_cast<const void*>(IndexBufferCPU.data()),
-			IndexBufferSizeInBytes,
-			IndexBufferGPU,
-			IndexBufferUploader);
+		// 创建资源
+		UploadBuffers(vertexStreams.data(), packedIndices.data());
 	}
 
-	// ϸ
+	// 正二十面体的边对球心所张的角为atan(2)，每细分一次约减半，
+	// 取满足误差要求的最小细分层级
+	static UINT SubdivisionLevelForAngularError(float maxAngularError) {
+		const UINT maxSubdivision = 8u;
+		float edgeAngle = std::atan(2.0f);
+
+		UINT level = 0;
+		while (edgeAngle > maxAngularError && level < maxSubdivision) {
+			edgeAngle *= 0.5f;
+			level++;
+		}
+
+		return level;
+	}
+
+	// 曲面细分
+	// 原地进行，利用边中点缓存使相邻三角形共享新生成的顶点
 	void Subdivide() {
 		//       v1
 		//       *
@@ -220,53 +867,69 @@ public:
 		// *-----*-----*
 		// v0    m2     v2
 
-		// һϸǰMeshͬʱյǰMesh
-		Mesh inputCopy = *this;
-		this->VertexBufferCPU.resize(0);
-		this->IndexBufferCPU.resize(0);
+		// 顶点只追加不删除，原有顶点的编号保持不变
+		// 只需替换Index Buffer，避免拷贝整个Mesh
+		std::vector<UINT> inputIndices;
+		inputIndices.swap(IndexBufferCPU);
 
-		// ÿδ
-		UINT numTriangles = inputCopy.IndexBufferCPU.size() / 3;
-		for (UINT i = 0; i < numTriangles; ++i) {
-			Vertex v0 = inputCopy.VertexBufferCPU[inputCopy.IndexBufferCPU[i * 3 + 0]];
-			Vertex v1 = inputCopy.VertexBufferCPU[inputCopy.IndexBufferCPU[i * 3 + 1]];
-			Vertex v2 = inputCopy.VertexBufferCPU[inputCopy.IndexBufferCPU[i * 3 + 2]];
-
-			Vertex m0 = MidPoint(v0, v1);
-			Vertex m1 = MidPoint(v1, v2);
-			Vertex m2 = MidPoint(v0, v2);
-
-			this->VertexBufferCPU.push_back(v0); // 0
-			this->VertexBufferCPU.push_back(v1); // 1
-			this->VertexBufferCPU.push_back(v2); // 2
-			this->VertexBufferCPU.push_back(m0); // 3
-			this->VertexBufferCPU.push_back(m1); // 4
-			this->VertexBufferCPU.push_back(m2); // 5
-
-			// 
-			this->IndexBufferCPU.push_back(i * 6 + 0);
-			this->IndexBufferCPU.push_back(i * 6 + 3);
-			this->IndexBufferCPU.push_back(i * 6 + 5);
-
-			// 
-			this->IndexBufferCPU.push_back(i * 6 + 3);
-			this->IndexBufferCPU.push_back(i * 6 + 1);
-			this->IndexBufferCPU.push_back(i * 6 + 4);
-
-			// 
-			this->IndexBufferCPU.push_back(i * 6 + 5);
-			this->IndexBufferCPU.push_back(i * 6 + 4);
-			this->IndexBufferCPU.push_back(i * 6 + 2);
-
-			// 
-			this->IndexBufferCPU.push_back(i * 6 + 3);
-			this->IndexBufferCPU.push_back(i * 6 + 4);
-			this->IndexBufferCPU.push_back(i * 6 + 5);
+		UINT numTriangles = inputIndices.size() / 3;
+		IndexBufferCPU.reserve(numTriangles * 12);
+
+		// 闭合网格满足 E = 3F / 2
+		std::unordered_map<UINT64, UINT> midPointCache;
+		midPointCache.reserve(numTriangles * 3 / 2);
+
+		auto GetMidPoint = [&](UINT i0, UINT i1) -> UINT {
+			// 以无向边为键
+			UINT64 key = i0 < i1 ? (UINT64(i0) << 32) | i1 : (UINT64(i1) << 32) | i0;
+			auto it = midPointCache.find(key);
+			if (it != midPointCache.end()) {
+				return it->second;
+			}
+
+			UINT index = static_cast<UINT>(VertexBufferCPU.size());
+			// push_back可能导致重新分配，需先拷贝端点
+			Vertex v0 = VertexBufferCPU[i0];
+			Vertex v1 = VertexBufferCPU[i1];
+			VertexBufferCPU.push_back(MidPoint(v0, v1));
+			midPointCache.emplace(key, index);
+
+			return index;
+		};
 
+		// 对每个三角形依次处理
+		for (UINT i = 0; i < numTriangles; ++i) {
+			UINT v0 = inputIndices[i * 3 + 0];
+			UINT v1 = inputIndices[i * 3 + 1];
+			UINT v2 = inputIndices[i * 3 + 2];
+
+			UINT m0 = GetMidPoint(v0, v1);
+			UINT m1 = GetMidPoint(v1, v2);
+			UINT m2 = GetMidPoint(v0, v2);
+
+			// 左下
+			IndexBufferCPU.push_back(v0);
+			IndexBufferCPU.push_back(m0);
+			IndexBufferCPU.push_back(m2);
+
+			// 中上
+			IndexBufferCPU.push_back(m0);
+			IndexBufferCPU.push_back(v1);
+			IndexBufferCPU.push_back(m1);
+
+			// 右下
+			IndexBufferCPU.push_back(m2);
+			IndexBufferCPU.push_back(m1);
+			IndexBufferCPU.push_back(v2);
+
+			// 中下
+			IndexBufferCPU.push_back(m0);
+			IndexBufferCPU.push_back(m1);
+			IndexBufferCPU.push_back(m2);
 		}
 	}
 
-	// еֵ
+	// 中点插值
 	Vertex MidPoint(const Vertex& v0, const Vertex& v1) {
 		XMVECTOR position0 = XMLoadFloat3(&v0.position);
 		XMVECTOR position1 = XMLoadFloat3(&v1.position);
@@ -281,7 +944,7 @@ public:
 		XMVECTOR texCoord1 = XMLoadFloat2(&v1.textureCoordinate);
 
 		Vertex ret;
-		// עⵥλȡƽ֮ģܲΪ1
+		// 注意单位向量取平均之后模长可能不再为1
 		XMStoreFloat3(&ret.position, 0.5 * (position0 + position1));
 		XMStoreFloat3(&ret.normal, XMVector3Normalize(0.5 * (normal0 + normal1)));
 		XMStoreFloat3(&ret.tangent, XMVector3Normalize(0.5 * (tangent0 + tangent1)));
@@ -290,12 +953,12 @@ public:
 		return ret;
 	}
 
-	// 㻺㻺Դ
+	// 顶点缓冲区及顶点缓冲区资源管理
 	std::vector<Vertex> VertexBufferCPU;
 	std::vector<UINT> IndexBufferCPU;
 
-	ComPtr<ID3D12Resource> VertexBufferGPU = nullptr;
-	ComPtr<ID3D12Resource> IndexBufferGPU = nullptr;
+	// GPU端的数据位于MeshManager的几何Arena中
+	GeometryAllocation Geometry;
 
 	ComPtr<ID3D12Resource> VertexBufferUploader = nullptr;
 	ComPtr<ID3D12Resource> IndexBufferUploader = nullptr;
@@ -303,24 +966,34 @@ public:
 	UINT NumVertices = 0;
 	UINT NumIndices = 0;
 
+	// GPU上的顶点拆分为Position流与属性流，见VertexStreams
 	UINT VertexBufferSizeInBytes = 0;
-	UINT VertexBufferStrideInBytes = sizeof(Vertex);
+	UINT PositionStrideInBytes = VertexStreams<Vertex>::PositionStride;
+	UINT AttributeStrideInBytes = VertexStreams<Vertex>::AttributeStride;
+	UINT AttributeOffsetInBytes = 0;
+	bool CompactVertices = false;	// GPU上的顶点是否为CompactVertex格式
 
 	UINT IndexBufferSizeInBytes = 0;
-	DXGI_FORMAT IndexFormat = DXGI_FORMAT_R32_UINT;
+	DXGI_FORMAT IndexFormat = DXGI_FORMAT_R32_UINT;	// 只用于GenerateSphere生成的Mesh，导入的Mesh见SubMesh::IndexFormat
 
 	std::vector<SubMesh> SubMeshes;
 
+	// 各SubMesh的Meshlet合并而成的表，与几何数据一同在UploadBuffers中生成
+	MeshletData Meshlets;
+
+	// 由Scene在导入前设置，Registry为空时不去重；MeshIndex为该Mesh在Scene::mMeshes中的位置
+	SubMeshRegistry* Registry = nullptr;
+	UINT MeshIndex = 0;
+
 	ComPtr<ID3D12Device> mDevice;
 	ComPtr<ID3D12GraphicsCommandList> mCommandList;
+	MeshManager* mMeshManager = nullptr;
 };
 
 
 // Refactoring
+// BaseVertexLocation与IndexBufferOffsetInBytes均为几何Arena中的绝对位置
 struct MeshDescriptor {
-	UINT VertexBufferIndex = 0;
-	UINT IndexBufferIndex = 0;
-
 	UINT VertexCount = 0;
 	UINT IndexCount = 0;
 
@@ -334,25 +1007,67 @@ struct MeshDescriptor {
 	UINT MaterialIndex = 0;
 
 	BoundingBox Bounds;
+	BoundingSphere Sphere;
+
+	// Index格式逐Mesh选择，IndexBufferOffsetInBytes为Index Arena中的位置
+	DXGI_FORMAT IndexFormat = DXGI_FORMAT_R32_UINT;
+	UINT IndexBufferOffsetInBytes = 0;
 };
 
 
+// 拥有全局的几何Arena: 所有模型的顶点与Index都从中分配，一帧内每种顶点格式只需绑定一次Vertex Buffer
 class MeshManager {
 public:
 	using Vertex = VertexPositionNormalTangentTexture;
+	using CompactVertex = VertexPositionNormalTangentTextureCompact;
+
+	// Arena的初始容量，不足时按两倍扩容
+	static const UINT kInitialVertexCapacity = 1u << 18;
+	static const UINT kInitialCompactVertexCapacity = 1u << 18;
+	static const UINT kInitialIndexCapacityInBytes = 16u << 20;
+
 	MeshManager(ComPtr<ID3D12Device> device, ComPtr<ID3D12GraphicsCommandList> cmdList)
 		: mDevice(device),
-		mCommandList(cmdList),
-		//mVertexCount(0),
-		//mVertexBufferStrideInBytes(sizeof(Vertex)),
-		//mVertexBufferSizeInBytes(0),
-		//mIndexCount(0),
-		mIndexFormat(DXGI_FORMAT_R32_UINT)
-		/*mIndexBufferSizeInBytes(0)*/ {
-
+		mCommandList(cmdList) {
+		mVertexArenas[0].Init(device.Get(),
+			{ VertexStreams<Vertex>::PositionStride, VertexStreams<Vertex>::AttributeStride },
+			kInitialVertexCapacity, L"Vertex Arena");
+		mVertexArenas[1].Init(device.Get(),
+			{ VertexStreams<CompactVertex>::PositionStride, VertexStreams<CompactVertex>::AttributeStride },
+			kInitialCompactVertexCapacity, L"Compact Vertex Arena");
+		mIndexArena.Init(device.Get(), { 4 }, kInitialIndexCapacityInBytes / 4, L"Index Arena");
 	}
 
-	void ImportMesh(const aiScene* pAiScene);
+	// 尚未接入导入流程，目前没有调用者: Scene的导入经由Mesh::InitFromAssimp/InitFromObj/InitFromCache与Mesh::FinishImport
+	// 顶点缓存与顶点读取优化、包围体等阶段在两处各有一份，实际生效的是Mesh::FinishImport中的那一份
+	void ImportMesh(const aiScene* pAiScene, MeshImportFlags importFlags = DefaultMeshImportFlags);
+
+	// 分配范围并在Command List上记录拷贝，Upload Buffer需保留到拷贝完成
+	// vertexData为VertexStreams::Split的结果，属性流位于attributeOffsetInBytes处
+	GeometryAllocation UploadGeometry(bool compactVertices,
+		const void* vertexData, UINT attributeOffsetInBytes, UINT vertexCount,
+		const void* indexData, UINT indexSizeInBytes,
+		ComPtr<ID3D12Resource>& vertexUploader, ComPtr<ID3D12Resource>& indexUploader);
+
+	// 范围立即可被再次分配，调用者需保证GPU已不再使用其中的数据
+	void ReleaseGeometry(GeometryAllocation& allocation);
+
+	// 整个Arena的View，Slot 0为Position流，Slot 1为属性流
+	D3D12_VERTEX_BUFFER_VIEW PositionBufferView(bool compactVertices) const;
+	D3D12_VERTEX_BUFFER_VIEW AttributeBufferView(bool compactVertices) const;
+	D3D12_INDEX_BUFFER_VIEW IndexBufferView(DXGI_FORMAT format) const;
+
+	// 几何Arena中Position流第vertex个顶点的地址，vertex为BaseVertexLocation(...)得到的绝对位置
+	D3D12_GPU_VIRTUAL_ADDRESS_AND_STRIDE PositionStreamAddressAndStride(bool compactVertices, UINT vertex) const;
+
+	// Index Arena中offsetInBytes处的地址，offsetInBytes为GeometryAllocation与SubMesh中的字节偏移之和
+	D3D12_GPU_VIRTUAL_ADDRESS IndexArenaAddress(UINT offsetInBytes) const;
+
+	GeometryArenaStats VertexArenaStats(bool compactVertices) const;
+	GeometryArenaStats IndexArenaStats() const;
+
+	// 扩容前的旧Buffer在GPU完成拷贝后释放
+	void ReleaseRetiredBuffers();
 
 	UINT MeshCount() const;
 
@@ -363,38 +1078,34 @@ public:
 	UINT IndexCount(UINT meshIndex) const;
 	DXGI_FORMAT IndexFormat(UINT meshIndex) const;
 
+	// 只包含Position流
 	D3D12_GPU_VIRTUAL_ADDRESS_AND_STRIDE VertexBufferAddressAndStride(UINT meshIndex) const;
 	UINT VertexCount(UINT meshIndex) const;
 	DXGI_FORMAT VertexPositionFormat(UINT meshIndex) const; // For Ray Tracing
 
+
 private:
 	ComPtr<ID3D12Device> mDevice;
 	ComPtr<ID3D12GraphicsCommandList> mCommandList;
 
-	// 㻺㻺Դ
-	// ʱռ
+	// 顶点缓冲区及顶点缓冲区资源管理
+	// 临时缓存空间
 	std::vector<Vertex> mVertexBufferCPU;
 	std::vector<UINT> mIndexBufferCPU;
 
 	ComPtr<ID3D12Resource> mVertexBufferUploader;
 	ComPtr<ID3D12Resource> mIndexBufferUploader;
 
-	// GPU VertexBuffer IndexBuffer
-	std::vector<VertexBuffer<Vertex>> mVertexBuffer;
-	std::vector<IndexBuffer<UINT>> mIndexBuffer;
-
-	//std::vector<ComPtr<ID3D12Resource>> mVertexBufferGPU;
-	//std::vector<ComPtr<ID3D12Resource>> mIndexBufferGPU;
-
-	//UINT mVertexCount;
-	//UINT mVertexBufferStrideInBytes;
-	//UINT mVertexBufferSizeInBytes;
-
-	//UINT mIndexCount;
-	DXGI_FORMAT mIndexFormat;
-	//UINT mIndexBufferSizeInBytes;
+	// GPU端几何Arena
+	// 两种顶点格式各一组，每组含Position流与属性流两块Buffer，以顶点为单位分配
+	GeometryArena mVertexArenas[2];
+	// 各Mesh的Index格式不同，所有格式共用一块Buffer，以4字节为单位分配
+	GeometryArena mIndexArena;
 
 	std::vector<MeshDescriptor> mMeshes;
+	// ImportMesh导入的各批Mesh所占的范围
+	std::vector<GeometryAllocation> mImportAllocations;
+
 };
 
 
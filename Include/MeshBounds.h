@@ -0,0 +1,23 @@
+#pragma once
+#include <windows.h>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+// 同时保存AABB与包围球
+// AABB用于视锥剔除等需要较紧包围的场合，包围球用于LOD选择等只需距离的场合
+struct BoundingVolume {
+	DirectX::BoundingBox Box = DirectX::BoundingBox(DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+	DirectX::BoundingSphere Sphere = DirectX::BoundingSphere(DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f);
+};
+
+namespace MeshBounds {
+	// positions可以是交错存储的顶点，以positionStride为间隔读取
+	// 包围球以AABB中心为球心，半径为到各点的最大距离，不大于AABB的外接球
+	BoundingVolume Compute(const DirectX::XMFLOAT3* positions, size_t count, size_t positionStride);
+
+	// 变换后的AABB为原AABB八个角点变换后的AABB，包围球按最大的缩放系数放大
+	BoundingVolume Transform(const BoundingVolume& volume, DirectX::FXMMATRIX transform);
+
+	// 合并到dst，empty为true时直接覆盖
+	void Merge(BoundingVolume& dst, const BoundingVolume& src, bool empty);
+}
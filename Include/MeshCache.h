@@ -0,0 +1,138 @@
+#pragma once
+#include <windows.h>
+#include <DirectXMath.h>
+#include <string>
+#include <vector>
+
+#include "Material.h"
+
+struct SubMesh;
+
+// 二进制网格缓存
+// 保存在模型文件旁(<模型路径>.ezmesh)，内容为后处理完成、可直接上传的顶点与Index数据，
+// 以及SubMesh表、包围盒和材质引用
+// 以源文件内容的哈希与导入选项作为键，任意一项不同即视为失效
+// 注意只对模型文件本身计算哈希，.mtl等附属文件或纹理被修改时需手动删除缓存
+namespace MeshCache {
+	const UINT32 kMagic = 0x434D5A45;	// "EZMC"
+	// 文件布局或导入流程改变时递增
+	const UINT32 kVersion = 5;
+	// 键中的导入标志额外记录读取器: .obj由ObjLoader读取时置位，与经由Assimp读取的结果(顶点与SubMesh的划分不同)区分
+	// 不与MeshImportFlags的各位重叠
+	const UINT32 kNativeObjLoader = 1u << 31;
+
+	std::string CachePath(const std::string& modelPath);
+
+	// 对整个文件计算FNV-1a 64位哈希，文件无法打开时返回false
+	bool HashFile(const std::string& path, UINT64& hash);
+	UINT64 Hash(const void* data, size_t size, UINT64 hash = 0xcbf29ce484222325ull);
+}
+
+// 只读的内存映射文件
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& path);
+	void Close();
+
+	const BYTE* Data() const { return mData; }
+	UINT64 Size() const { return mSize; }
+
+private:
+	HANDLE mFile = INVALID_HANDLE_VALUE;
+	HANDLE mMapping = nullptr;
+	const BYTE* mData = nullptr;
+	UINT64 mSize = 0;
+};
+
+// 文件头，各段的Offset均相对于文件开头，8字节对齐
+struct MeshCacheHeader {
+	UINT32 Magic;
+	UINT32 Version;
+	UINT64 SourceHash;
+	UINT32 ImportFlags;
+
+	// Mesh
+	UINT32 NumVertices;
+	UINT32 NumIndices;
+	UINT32 CompactVertices;
+
+	// 顶点数据为拆分后的两个流，见VertexStreams
+	UINT32 PositionStrideInBytes;
+	UINT32 AttributeStrideInBytes;
+	UINT32 AttributeOffsetInBytes;
+
+	UINT32 SubMeshCount;
+	UINT32 LODCount;
+	UINT32 MaterialCount;
+	UINT32 TextureRefCount;
+
+	UINT64 VertexDataOffset;
+	UINT64 VertexDataSize;
+	UINT64 IndexDataOffset;
+	UINT64 IndexDataSize;
+	UINT64 SubMeshOffset;
+	UINT64 LODOffset;
+	UINT64 MaterialOffset;
+	UINT64 TextureRefOffset;
+	UINT64 StringOffset;
+	UINT64 StringSize;
+};
+
+// 收集导入结果并写出缓存
+// 先写入临时文件再替换，写入中途失败不会留下看似有效的缓存
+class MeshCacheWriter {
+public:
+	// vertexData与indexData为上传到GPU的格式，调用后即可释放
+	void SetMesh(const void* vertexData, UINT vertexDataSize,
+		UINT positionStride, UINT attributeStride, UINT attributeOffset, bool compactVertices,
+		const void* indexData, UINT indexDataSize,
+		UINT numVertices, UINT numIndices, const std::vector<SubMesh>& submeshes);
+
+	void SetMaterials(const std::vector<MaterialDesc>& materials);
+
+	bool Write(const std::string& path, UINT64 sourceHash, UINT32 importFlags) const;
+
+private:
+	std::vector<BYTE> mVertexData;
+	std::vector<BYTE> mIndexData;
+	UINT mPositionStride = 0;
+	UINT mAttributeStride = 0;
+	UINT mAttributeOffset = 0;
+	bool mCompactVertices = false;
+	UINT mNumVertices = 0;
+	UINT mNumIndices = 0;
+
+	std::vector<BYTE> mSubMeshes;
+	std::vector<BYTE> mLODs;
+	UINT mSubMeshCount = 0;
+	UINT mLODCount = 0;
+
+	std::vector<MaterialDesc> mMaterials;
+};
+
+// 映射后的缓存文件，顶点与Index数据直接指向映射的内存
+class MeshCacheView {
+public:
+	// 文件不存在、版本不符或键不匹配时返回false
+	bool Open(const std::string& path, UINT64 sourceHash, UINT32 importFlags);
+
+	const MeshCacheHeader& Header() const { return *mHeader; }
+
+	const void* VertexData() const { return mFile.Data() + mHeader->VertexDataOffset; }
+	const void* IndexData() const { return mFile.Data() + mHeader->IndexDataOffset; }
+
+	void ReadSubMeshes(std::vector<SubMesh>& submeshes) const;
+	void ReadMaterials(std::vector<MaterialDesc>& materials) const;
+
+private:
+	bool ValidateSection(UINT64 offset, UINT64 size) const;
+
+	MappedFile mFile;
+	const MeshCacheHeader* mHeader = nullptr;
+};
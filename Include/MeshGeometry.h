@@ -17,8 +17,8 @@
 using namespace DirectX;
 using namespace Microsoft::WRL;
 
-// MeshGeometryԽݴһ㻺һУ
-// ÿSubMeshGeometryָʾ
+// MeshGeometry可以将多个几何体数据打包到一个顶点缓冲区和一个索引缓冲区中，
+// 每个几何体由SubMeshGeometry来指示
 struct SubMeshGeometry {
 	UINT IndexCount = 0;
 	UINT StartIndexLocation = 0;
@@ -30,7 +30,7 @@ struct SubMeshGeometry {
 struct MeshGeometry {
 	std::string Name;
 
-	// 㻺㻺Դ
+	// 顶点缓冲区及顶点缓冲区资源管理
 	ComPtr<ID3DBlob> VertexBufferCPU = nullptr;
 	ComPtr<ID3DBlob> IndexBufferCPU = nullptr;
 
@@ -66,18 +66,18 @@ struct MeshGeometry {
 		return ibv;
 	}
 
-	// 赼DeviceCommand Listв
+	// 还需导入Device和Command List进行操作
 	void UploadResource(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList,
 		const void* initData, UINT64 byteSize, 
 		ComPtr<ID3D12Resource>& defaultBuffer,
 		ComPtr<ID3D12Resource>& uploadBuffer) {
 
-		// Դز
+		// 资源创建相关参数
 		D3D12_HEAP_PROPERTIES defaultHeapProp = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
 		D3D12_HEAP_PROPERTIES uploadHeapProp = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
 		D3D12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
 
-		// Default BufferԴ
+		// 创建Default Buffer资源
 		ThrowIfFailed(device->CreateCommittedResource(
 			&defaultHeapProp,
 			D3D12_HEAP_FLAG_NONE,
@@ -87,7 +87,7 @@ struct MeshGeometry {
 			IID_PPV_ARGS(defaultBuffer.GetAddressOf())
 		));
 
-		// Upload BufferԴ
+		// 创建Upload Buffer资源
 		ThrowIfFailed(device->CreateCommittedResource(
 			&uploadHeapProp,
 			D3D12_HEAP_FLAG_NONE,
@@ -97,14 +97,14 @@ struct MeshGeometry {
 			IID_PPV_ARGS(uploadBuffer.GetAddressOf())
 		));
 
-		// Դ
+		// 描述待拷贝的资源
 		D3D12_SUBRESOURCE_DATA subResourceData;
 		subResourceData.pData = initData;
 		subResourceData.RowPitch = byteSize;
 		subResourceData.SlicePitch = subResourceData.RowPitch;
 
-		// Upload BufferΪнԴϴ
-		// һҪDefault Buffer״̬ת
+		// 利用Upload Buffer作为中介进行资源上传
+		// 这一过程中需要对Default Buffer的状态做转换
 		D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
 			defaultBuffer.Get(),
 			D3D12_RESOURCE_STATE_COMMON,
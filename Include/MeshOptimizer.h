@@ -0,0 +1,64 @@
+#pragma once
+#include <windows.h>
+#include <dxgiformat.h>
+#include <vector>
+
+// 导入阶段对网格数据进行的离线优化
+// 所有函数只处理单个SubMesh，Index均相对于SubMesh的BaseVertexLocation
+namespace MeshOptimizer {
+	// 后变换顶点缓存(Post-transform Vertex Cache)的统计数据
+	struct VertexCacheStats {
+		UINT TriangleCount = 0;
+		UINT VertexCount = 0;
+		UINT VerticesTransformed = 0;	// 缓存未命中次数，即VS的实际调用次数
+
+		float ACMR = 0.0f;	// Average Cache Miss Ratio: 平均每个三角形的未命中次数，取值范围[0.5, 3]
+		float ATVR = 0.0f;	// Average Transformed Vertex Ratio: 变换次数与顶点数之比，理想值为1
+	};
+
+	// 顶点读取(Vertex Fetch)的统计数据
+	struct VertexFetchStats {
+		UINT BytesFetched = 0;	// 以Cache Line为单位从显存读入的字节数
+		float Overfetch = 0.0f;	// 读入字节数与被引用顶点总字节数之比，理想值为1
+	};
+
+	// 以FIFO缓存模拟GPU的后变换顶点缓存
+	VertexCacheStats AnalyzeVertexCache(const UINT* indices, size_t indexCount, size_t vertexCount, UINT cacheSize = 16);
+
+	// Tom Forsyth, Linear-Speed Vertex Cache Optimisation
+	// 原地重排三角形的顺序，不改变顶点数据
+	void OptimizeVertexCache(UINT* indices, size_t indexCount, size_t vertexCount);
+
+	// 以少量64字节Cache Line组成的FIFO缓存模拟顶点读取
+	VertexFetchStats AnalyzeVertexFetch(const UINT* indices, size_t indexCount, size_t vertexCount, size_t vertexSize);
+
+	// 按首次使用的顺序为顶点重新编号，remap[旧编号] = 新编号
+	// 未被引用的顶点保持原有相对顺序排在最后，因此remap始终是一个排列
+	void BuildVertexFetchRemap(UINT* remap, const UINT* indices, size_t indexCount, size_t vertexCount);
+
+	void RemapIndexBuffer(UINT* indices, size_t indexCount, const UINT* remap);
+
+	// Index相对于BaseVertexLocation，顶点数不超过65536时即可使用16位Index
+	DXGI_FORMAT ChooseIndexFormat(size_t vertexCount);
+	UINT IndexFormatSizeInBytes(DXGI_FORMAT format);
+
+	// 以format格式将Index写入dst，返回写入的字节数
+	size_t PackIndices(void* dst, const UINT* indices, size_t indexCount, DXGI_FORMAT format);
+
+	template <typename Vertex>
+	void RemapVertexBuffer(Vertex* vertices, size_t vertexCount, const UINT* remap) {
+		std::vector<Vertex> source(vertices, vertices + vertexCount);
+		for (size_t i = 0; i < vertexCount; ++i) {
+			vertices[remap[i]] = source[i];
+		}
+	}
+
+	// 应在OptimizeVertexCache之后调用，此时Index的顺序已经确定
+	template <typename Vertex>
+	void OptimizeVertexFetch(Vertex* vertices, UINT* indices, size_t indexCount, size_t vertexCount) {
+		std::vector<UINT> remap(vertexCount);
+		BuildVertexFetchRemap(remap.data(), indices, indexCount, vertexCount);
+		RemapIndexBuffer(indices, indexCount, remap.data());
+		RemapVertexBuffer(vertices, vertexCount, remap.data());
+	}
+}
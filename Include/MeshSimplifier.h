@@ -0,0 +1,18 @@
+#pragma once
+#include <windows.h>
+#include <DirectXMath.h>
+#include <vector>
+
+// 基于二次误差度量(Quadric Error Metrics)的网格简化
+// Michael Garland, Paul Heckbert, Surface Simplification Using Quadric Error Metrics
+namespace MeshSimplifier {
+	// 只生成新的Index，顶点数据保持不变，因此各级LOD可以共用同一段Vertex Buffer
+	// 边坍缩时顶点移动到边的另一个端点(Half-edge Collapse)，而不是求解最优位置
+	// 开放边界上的顶点以及接缝处(位置相同、属性不同)的顶点被锁定，不参与坍缩，以保持轮廓与UV接缝
+	// targetError: 允许的最大误差，为模型空间中的距离
+	// resultError: 实际的最大误差
+	// 返回写入destination的Index数量，destination的大小至少为indexCount
+	size_t Simplify(UINT* destination, const UINT* indices, size_t indexCount,
+		const DirectX::XMFLOAT3* positions, size_t vertexCount, size_t positionStride,
+		size_t targetIndexCount, float targetError, float* resultError = nullptr);
+}
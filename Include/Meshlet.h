@@ -0,0 +1,53 @@
+#pragma once
+#include <windows.h>
+#include <DirectXMath.h>
+#include <vector>
+
+// Meshlet(Cluster): 顶点数与三角形数都有上限的一小块网格
+// 用于在比RenderItem更细的粒度上进行视锥剔除与背面剔除
+struct Meshlet {
+	UINT VertexOffset = 0;		// MeshletData::VertexIndices中的起始位置
+	UINT TriangleOffset = 0;	// MeshletData::TriangleIndices中的起始位置(字节)，4字节对齐
+	UINT VertexCount = 0;
+	UINT TriangleCount = 0;
+};
+
+// 均位于Mesh的局部空间
+struct MeshletBounds {
+	// 包围球
+	DirectX::XMFLOAT3 Center = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	float Radius = 0.0f;
+
+	// 法线锥: 所有三角形的法线与ConeAxis的夹角都不超过锥的半角
+	// ConeCutoff = sin(半角)，法线锥张开超过半球时为1，即无法进行背面剔除
+	DirectX::XMFLOAT3 ConeApex = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	float ConeCutoff = 1.0f;
+	DirectX::XMFLOAT3 ConeAxis = DirectX::XMFLOAT3(0.0f, 0.0f, 1.0f);
+};
+
+// 多个Mesh的Meshlet可以存放在同一张表中
+struct MeshletData {
+	std::vector<Meshlet> Meshlets;
+	std::vector<MeshletBounds> Bounds;
+
+	std::vector<UINT> VertexIndices;		// Meshlet内的顶点 -> Mesh内的顶点(相对于BaseVertexLocation)
+	std::vector<UINT8> TriangleIndices;		// 每三个字节为一个三角形，是Meshlet内的局部编号
+};
+
+namespace MeshletBuilder {
+	const UINT kMaxVertices = 64;
+	const UINT kMaxTriangles = 124;
+
+	// 按Index的顺序贪心地将三角形加入当前Meshlet，超出上限时开始新的Meshlet
+	// Index应已经过顶点缓存优化，此时相邻三角形大多共享顶点
+	// 结果追加到data的末尾，返回新生成的Meshlet数量
+	UINT BuildMeshlets(MeshletData& data,
+		const UINT* indices, size_t indexCount,
+		const DirectX::XMFLOAT3* positions, size_t vertexCount, size_t positionStride);
+
+	MeshletBounds ComputeBounds(const MeshletData& data, const Meshlet& meshlet,
+		const DirectX::XMFLOAT3* positions, size_t positionStride);
+
+	// cameraPosition需与bounds位于同一空间
+	bool IsBackFacing(const MeshletBounds& bounds, const DirectX::XMFLOAT3& cameraPosition);
+}
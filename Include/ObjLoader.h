@@ -0,0 +1,34 @@
+#pragma once
+#include <windows.h>
+#include <string>
+#include <vector>
+
+#include "VertexType.h"
+#include "Material.h"
+
+// 一段使用同一材质的面，Index相对于BaseVertexLocation
+struct ObjSubMesh {
+	UINT BaseVertexLocation = 0;
+	UINT NumVertices = 0;
+	UINT StartIndexLocation = 0;
+	UINT NumIndices = 0;
+	UINT MaterialIndex = 0;		// ObjModel::Materials中的位置
+};
+
+struct ObjModel {
+	std::vector<VertexPositionNormalTangentTexture> Vertices;
+	std::vector<UINT> Indices;
+	std::vector<ObjSubMesh> SubMeshes;
+	std::vector<MaterialDesc> Materials;
+};
+
+// 不经过Assimp的OBJ/MTL读取器
+// 文件映射到内存后按行切分为若干块并行解析，再逐SubMesh并行地合并相同顶点并计算Tangent
+// 结果的约定与Scene::ImportAssimp使用的后处理一致: 左手坐标系(z取反、三角形反向)，纹理坐标v翻转
+// 文件中没有法线的顶点由相邻三角形的面法线按面积加权得到
+namespace ObjLoader {
+	bool Load(const std::string& path, ObjModel& model);
+
+	// 将材质追加到materials，names为对应的材质名
+	bool LoadMaterialLibrary(const std::string& path, std::vector<MaterialDesc>& materials, std::vector<std::string>& names);
+}
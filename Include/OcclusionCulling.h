@@ -0,0 +1,70 @@
+#pragma once
+#include <windows.h>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <vector>
+
+// 一个遮挡体: 局部空间的三角形与本帧的World * ViewProj(行向量约定，未转置)
+struct OccluderDesc {
+	const DirectX::XMFLOAT3* Positions = nullptr;
+	UINT VertexCount = 0;
+	const UINT* Indices = nullptr;
+	UINT IndexCount = 0;
+	DirectX::XMFLOAT4X4 WorldViewProj;
+};
+
+// 软件遮挡剔除使用的低分辨率深度缓冲，深度为D3D的z/w，越小越近
+// 遮挡体的三角形在CPU上光栅化，一次处理一行中的4个像素(DirectXMath的SIMD向量)
+// 屏幕按Tile行划分为条带，各条带由线程池并行光栅化，并在结束时生成Tile的最大深度(HiZ)
+// 测试时先比较AABB的最近深度与Tile的最大深度，不能确定时再逐像素比较
+class OcclusionBuffer {
+public:
+	static const UINT TileSize = 8;
+
+	// width与height需为TileSize的倍数
+	OcclusionBuffer(UINT width = 256, UINT height = 128);
+
+	UINT Width() const { return mWidth; }
+	UINT Height() const { return mHeight; }
+
+	// 清空深度并设置本帧的ViewProj(未转置)
+	void Clear(DirectX::FXMMATRIX viewProj);
+
+	// 依次光栅化occluders，start起经过budgetMs后不再开始新的遮挡体，返回完成光栅化的遮挡体数量
+	// 未光栅化的遮挡体只会使遮挡变少，结果仍是保守的
+	// 跨越近平面的三角形被跳过；不做背面剔除，单面的墙从背后看同样遮挡
+	UINT Rasterize(const OccluderDesc* occluders, size_t count, INT64 start, double budgetMs);
+
+	// 世界空间的AABB在屏幕上覆盖的像素数的估计(投影矩形的面积)，跨越近平面时返回整个屏幕的面积
+	float ScreenArea(const DirectX::BoundingBox& box) const;
+
+	// AABB完全位于已光栅化的遮挡体之后时返回true；跨越近平面或位于屏幕之外时返回false
+	// 只读取深度，可由多个线程同时调用
+	bool IsOccluded(const DirectX::BoundingBox& box) const;
+
+private:
+	// 投影后的屏幕矩形与最近深度；跨越近平面时返回false
+	bool ProjectBox(const DirectX::BoundingBox& box, float& minX, float& minY, float& maxX, float& maxY, float& minZ) const;
+
+	// 光栅化与Tile行[firstTileRow, endTileRow)相交的部分，并生成这些Tile的最大深度
+	void RasterizeBand(UINT firstTileRow, UINT endTileRow, INT64 start, double budgetMs);
+	void RasterizeTriangle(const DirectX::XMFLOAT4& v0, const DirectX::XMFLOAT4& v1, const DirectX::XMFLOAT4& v2, UINT minRow, UINT endRow);
+
+	UINT mWidth;
+	UINT mHeight;
+	UINT mTilesX;
+	UINT mTilesY;
+
+	DirectX::XMFLOAT4X4 mViewProj;
+
+	std::vector<float> mDepth;			// 逐像素，初始为1
+	std::vector<float> mTileMaxDepth;	// 逐Tile，Tile中像素深度的最大值
+
+	// Rasterize使用: 各遮挡体变换到屏幕空间的顶点(x, y为像素坐标，z为深度，w < 0表示位于近平面与摄像机之间或之后)
+	// 各遮挡体的顶点在其中的起始位置，以及每个Tile行完成光栅化的遮挡体数量
+	const OccluderDesc* mOccluders = nullptr;
+	size_t mOccluderCount = 0;
+	std::vector<DirectX::XMFLOAT4> mScreenVertices;
+	std::vector<size_t> mVertexOffsets;
+	std::vector<UINT> mRowOccluders;
+};
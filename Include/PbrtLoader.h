@@ -0,0 +1,31 @@
+#pragma once
+#include <windows.h>
+#include <DirectXMath.h>
+#include <string>
+#include <vector>
+
+#include "ObjLoader.h"
+
+// 场景中的一个Shape: 引用一个SubMesh，带有各自的材质与变换
+struct PbrtShapeInstance {
+	UINT SubMeshIndex = 0;				// PbrtScene::Geometry.SubMeshes中的位置
+	UINT MaterialIndex = 0;				// PbrtScene::Geometry.Materials中的位置
+	DirectX::XMFLOAT4X4 World;			// 行向量约定，未转置
+};
+
+struct PbrtScene {
+	// 每个不重复的几何体为一个SubMesh，格式与ObjLoader的输出相同
+	// SubMesh的MaterialIndex为第一个引用它的Shape所用的材质
+	ObjModel Geometry;
+	std::vector<PbrtShapeInstance> Instances;
+};
+
+// PBRT-v4场景读取器
+// 词法分析直接在映射到内存的文件上进行，不会把整个文件读入字符串；Include/Import的文件同样如此
+// 支持的Shape为plymesh与trianglemesh，同一PLY文件只读取一次，不同的PLY文件并行读取
+// ObjectBegin/ObjectInstance定义的实例共用SubMesh，只增加PbrtShapeInstance
+// 忽略摄像机、光源与介质；材质只保留漫反射颜色、Fresnel R0、粗糙度与图片纹理
+// PBRT本身即为左手坐标系，坐标不做转换；纹理坐标v翻转，三角形绕序按法线方向调整为正面朝外
+namespace PbrtLoader {
+	bool Load(const std::string& path, PbrtScene& scene);
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <windows.h>
+#include <DirectXMath.h>
+#include <string>
+#include <vector>
+
+// 三角形网格的原始数据，保持文件中的坐标系与绕序
+struct PlyMesh {
+	std::vector<DirectX::XMFLOAT3> Positions;
+	std::vector<DirectX::XMFLOAT3> Normals;		// 文件中没有时为空
+	std::vector<DirectX::XMFLOAT2> TexCoords;	// 同上
+	std::vector<UINT> Indices;					// 多边形以第一个顶点为中心扇形三角化
+};
+
+// PLY读取器，支持binary_little_endian、binary_big_endian与ascii
+// 文件映射到内存后直接读取；二进制文件中的顶点每行长度固定，由多个线程并行转换
+// 读取x/y/z、nx/ny/nz、u/v(或s/t、texture_u/texture_v)以及面的vertex_indices，其余属性与元素跳过
+namespace PlyLoader {
+	bool Load(const std::string& path, PlyMesh& mesh);
+}
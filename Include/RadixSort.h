@@ -0,0 +1,15 @@
+#pragma once
+#include <windows.h>
+#include <vector>
+
+// 64位键的LSD基数排序，每趟处理8位，共8趟
+// 所有键在某一字节上都相同时跳过该趟；每趟按块并行地统计直方图与分散，块的顺序保证排序是稳定的
+namespace RadixSort {
+	struct KeyValue {
+		UINT64 Key;
+		UINT Value;
+	};
+
+	// 按Key升序稳定地排序items，scratch为临时空间，大小随之调整
+	void Sort(std::vector<KeyValue>& items, std::vector<KeyValue>& scratch);
+}
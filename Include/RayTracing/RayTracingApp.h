@@ -4,7 +4,7 @@
 #include "RayTracing/ShaderTable.h"
 #include "RayTracing/RayTracingHLSLCompat.h"
 
-// enum classǿתnamespace
+// enum class需强制类型转换，不如namespace方便
 namespace GlobalRootParameter {
 	enum Value {
 		OutputView = 0,
@@ -49,6 +49,8 @@ struct AccelerationStructureBuffers
 	UINT64                 ResultDataMaxSizeInBytes;
 };
 
+// RayTracingApp.cpp目前没有加入EngineZeroOne.vcxproj，不参与编译，对它的修改无法由构建检查
+// BLAS的几何数据来自Scene::GeometryCount、IndexBufferAddress、VertexBufferAddressAndStride等接口，这些接口随Scene.cpp编译
 class RayTracingApp : public D3D12App {
 public:
 	void CheckRayTracingSupport();
@@ -74,6 +76,7 @@ public:
 private:
 	// RayTracing Support
 	bool bSupportRayTracing;
+	D3D12_RAYTRACING_TIER mRayTracingTier = D3D12_RAYTRACING_TIER_NOT_SUPPORTED;
 
 	// Descriptor Heap
 	// Shared by SRVs and UAVs
@@ -96,6 +99,9 @@ private:
 	ComPtr<ID3D12Resource> mBottomLevelAccelerationStructure;
 	ComPtr<ID3D12Resource> mTopLevelAccelerationStructure;
 
+	// 各几何的Transform3x4，压缩顶点由此解码，需存活至BLAS构建完成
+	std::unique_ptr<UploadBuffer<XMFLOAT3X4>> mGeometryTransforms;
+
 	// Shader Tables
 	ComPtr<ID3D12Resource> mRayGenerationShaderTable;
 	ComPtr<ID3D12Resource> mHitGroupShaderTable;
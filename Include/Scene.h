@@ -8,18 +8,114 @@
 
 #include "D3D12App.h"
 #include "Mesh.h"
+#include "PbrtLoader.h"
 #include "Texture.h"
 #include "Material.h"
 #include "ConstantBuffer.h"
 #include "FrameResource.h"
 #include "UploadBuffer.h"
+#include "DescriptorHeap.h"
+#include "TransformArray.h"
+#include "FrustumCulling.h"
+#include "LooseOctree.h"
+#include "OcclusionCulling.h"
+#include "RadixSort.h"
 
+#include <climits>
 
-	
 
-// SceneǰʾĳǿԲϵ򳡾ʲ
-// ǽгл
-// SceneԴMeshTexture
+// 代数句柄: Index为槽位，槽位中的对象被移除时Generation增加，此前发出的句柄随之失效
+struct ModelHandle {
+	UINT Index = UINT_MAX;
+	UINT Generation = 0;
+
+	bool operator==(const ModelHandle& rhs) const { return Index == rhs.Index && Generation == rhs.Generation; }
+	bool operator!=(const ModelHandle& rhs) const { return !(*this == rhs); }
+};
+
+// Index即RenderItemIndex
+struct RenderItemHandle {
+	UINT Index = UINT_MAX;
+	UINT Generation = 0;
+
+	bool operator==(const RenderItemHandle& rhs) const { return Index == rhs.Index && Generation == rhs.Generation; }
+	bool operator!=(const RenderItemHandle& rhs) const { return !(*this == rhs); }
+};
+
+// 模型的Render Item能否作为软件遮挡剔除的遮挡体
+namespace OccluderMode {
+	enum Value {
+		Auto = 0,	// 带有遮挡体数据时参与，按屏幕面积挑选
+		Always,		// 带有遮挡体数据时总是优先选择(例如墙壁、地形)
+		Never		// 不作为遮挡体(例如镂空或半透明的物体)，仍会被其他遮挡体剔除
+	};
+}
+
+// 一个导入的模型，Scene::mModels中的一个槽位
+struct SceneModel {
+	std::string Name;				// 由文件名解析，只用于调试查找
+	UINT Generation = 0;
+	bool Alive = false;
+
+	std::vector<UINT> RenderItems;	// RenderItemIndex
+	std::vector<UINT> Meshes;		// 导入时创建的Mesh在mMeshes中的位置
+
+	// 最近一次SetProperties设置的SRT，旋转为四元数
+	XMFLOAT3 Scale;
+	XMFLOAT4 Rotation;
+	XMFLOAT3 Translation;
+	bool HasTransform = false;
+
+	// 所有Render Item世界空间包围体的并集，Render Item的变换改变后在FlushTransforms中更新
+	BoundingVolume Bounds;
+	bool BoundsDirty = false;
+
+	OccluderMode::Value Occluder = OccluderMode::Auto;
+};
+
+// Render Item在mRenderItems中的位置
+struct RenderItemLocation {
+	TextureFlags Type = 0;
+	UINT Position = 0;
+};
+
+// 进行视锥剔除的视角，各自拥有一份实例化绘制列表
+namespace CullingView {
+	enum Value {
+		Main = 0,	// 摄像机
+		Shadow,		// ShadowMap的光源摄像机
+		Count
+	};
+}
+
+// 一个视角的剔除结果与绘制列表
+struct ViewDrawList {
+	// 以RenderItemIndex为索引，可见时为1
+	std::vector<UINT8> Visible;
+	// 按排序键排列的实例化绘制列表，只包含可见的Render Item，见Scene::BuildViewDraws
+	std::vector<InstancedDraw> Draws;
+	// 可见性或ViewProj改变后需重建绘制列表
+	bool Changed = true;
+	// 上一次剔除使用的ViewProj(未转置)，排序键中的深度由其计算
+	XMFLOAT4X4 ViewProj = Identity4X4();
+
+	// 上一次剔除的统计，不包括天空球
+	UINT VisibleItems = 0;
+	UINT CulledItems = 0;
+	double CullMs = 0.0;
+
+	// 遮挡剔除的统计，OccludedItems包括在CulledItems中
+	UINT OccludedItems = 0;
+	UINT OccluderCount = 0;
+	double OcclusionMs = 0.0;
+
+	// 上一次重建绘制列表时排序键的生成与排序耗时
+	double SortMs = 0.0;
+};
+
+// Scene代表当前显示的场景，我们可以不断地向场景中添加资产，
+// 或是进行场景切换，
+// Scene的资源交由Mesh和Texture管理
 class Scene {
 public:
 	Scene() {
@@ -30,57 +126,206 @@ public:
 
 	void Init(ComPtr<ID3D12Device> device,
 		ComPtr<ID3D12GraphicsCommandList> cmdList,
-		ComPtr<ID3D12DescriptorHeap> srvHeap, UINT srvHeapOffset);
+		DescriptorHeap* srvHeap, UINT srvHeapOffset);
 
-	bool ImportModel(const std::string& path);
+	// 导入失败时返回的句柄无效
+	ModelHandle ImportModel(const std::string& path, MeshImportFlags importFlags = DefaultMeshImportFlags);
 	bool LoadCubeMap(const std::string& path);
 
-	void SetProperties(const std::string& name,
+	// 移除模型的所有Render Item，并归还其在几何Arena中的范围
+	// 调用者需保证GPU已执行完引用这些数据的命令
+	// 模型及其Render Item的句柄随之失效；Render Item的Constant Buffer槽位与材质暂不回收
+	bool UnloadModel(ModelHandle model);
+
+	bool IsValid(ModelHandle model) const;
+	bool IsValid(RenderItemHandle item) const;
+
+	// 按名称查找模型，名称可能重复，只用于调试
+	ModelHandle FindModel(const std::string& name) const;
+
+	// 模型的Render Item，i < RenderItemCount(model)
+	UINT RenderItemCount(ModelHandle model) const;
+	RenderItemHandle GetRenderItem(ModelHandle model, UINT i) const;
+
+	// 上传命令执行完毕后调用，释放Upload Buffer以及扩容前的旧Arena、旧Constant Buffer与旧SRV Heap
+	void ReleaseUploadBuffers();
+
+	// 设置模型的SRT变换，与上次设置的相同时直接返回
+	// 改变时写入模型所有Render Item的SRT并将其标记为Dirty，World Matrix由FlushTransforms统一计算
+	// 句柄失效时返回false，以下同
+	bool SetProperties(ModelHandle model,
 		XMFLOAT3 scale,
 		float rotationAngle, XMFLOAT3 rotationAxis,
 		XMFLOAT3 pos = XMFLOAT3(0.0f, 0.0f, 0.0f));
 
-	// Mesh MetaData Getters
-	UINT MeshCount() const;
+	// 单独设置一个Render Item的SRT(例如逐物体的动画)，直到所属模型下一次SetProperties
+	bool SetProperties(RenderItemHandle item, const XMFLOAT3& scale, const XMFLOAT4& rotationQuaternion, const XMFLOAT3& pos);
+
+	// 设置Render Item在模型内部的变换(未转置)，先于SRT作用
+	bool SetTransform(RenderItemHandle item, const XMFLOAT4X4& transform);
+
+	// materialIndex为绝对的MaterialIndex；纹理组合不同时Render Item移入对应PSO的列表
+	bool SetMaterial(RenderItemHandle item, UINT materialIndex);
+
+	// 设置模型的Render Item能否作为遮挡体，见OccluderMode
+	bool SetOccluderMode(ModelHandle model, OccluderMode::Value mode);
+
+	// 批量计算Dirty的Render Item的World Matrix与包围体，并按RenderItemIndex的顺序写入mWorldMatrixGPU
+	// 数量较多时分配到线程池上，每帧在绘制前调用一次
+	void FlushTransforms();
+
+	// 根据SubMesh包围球在屏幕上的投影大小为每个Render Item选择LOD
+	// pixelsPerUnit: 距离为1处单位长度在屏幕上的像素数，即Proj._22 * 屏幕高度 / 2
+	void UpdateLODs(const XMFLOAT3& cameraPos, float pixelsPerUnit);
+
+	// 以viewProj(未转置)的视锥测试所有Render Item世界空间的AABB，结果记录在mViews[view]中
+	// mUseOctreeCulling时经由mOctree层次地查询，否则逐个测试mPackedBounds
+	// occlusion且mUseOcclusionCulling时，视锥内的Render Item再以mOcclusionBuffer测试
+	// 每帧在FlushTransforms之后调用
+	void CullView(CullingView::Value view, FXMMATRIX viewProj, bool occlusion = false);
 
-	D3D12_GPU_VIRTUAL_ADDRESS IndexBufferAddress(UINT meshIndex) const;
-	UINT IndexCount(UINT meshIndex) const;
-	DXGI_FORMAT IndexFormat(UINT meshIndex) const;
+	// 将几何(包括当前LOD)与材质相同的可见Render Item合并为一次实例化绘制，每帧在UpdateLODs与CullView之后调用
+	// 每个视角的实例在mInstanceItemsGPU中占用mItemCapacity个位置，天空球位于最后
+	// 状态键只在LOD、材质改变或Render Item增删之后重新生成，视角的列表只在其可见性或ViewProj改变之后重新排序
+	void BuildInstancedDraws();
 
-	D3D12_GPU_VIRTUAL_ADDRESS_AND_STRIDE VertexBufferAddressAndStride(UINT meshIndex) const;
-	UINT VertexCount(UINT meshIndex) const;
-	DXGI_FORMAT VertexPositionFormat(UINT meshIndex) const; // For Ray Tracing
+	// 所有Mesh的顶点与Index数据所在的几何Arena
+	const MeshManager& GetMeshManager() const { return *mMeshManager; }
+
+	// 光线追踪BLAS的几何，以geometryIndex编号，见mGeometries
+	UINT GeometryCount() const;
+
+	// LOD 0的Index在Index Arena中的地址，格式逐SubMesh选择
+	D3D12_GPU_VIRTUAL_ADDRESS IndexBufferAddress(UINT geometryIndex) const;
+	UINT IndexCount(UINT geometryIndex) const;
+	DXGI_FORMAT IndexFormat(UINT geometryIndex) const;
+
+	// 几何Arena中SubMesh顶点的Position流，压缩格式为R16G16B16A16_UNORM(需DXR Tier 1.1)，由GeometryTransform还原到局部空间
+	D3D12_GPU_VIRTUAL_ADDRESS_AND_STRIDE VertexBufferAddressAndStride(UINT geometryIndex) const;
+	UINT VertexCount(UINT geometryIndex) const;
+	DXGI_FORMAT VertexPositionFormat(UINT geometryIndex) const; // For Ray Tracing
+	// 行主序的3x4矩阵，即PositionQuantization的Scale与Offset；全精度顶点为单位矩阵
+	XMFLOAT3X4 GeometryTransform(UINT geometryIndex) const;
 
 public:
-	// Դб
+	// 资源列表
 	std::vector<Mesh> mMeshes;
 	std::vector<Texture> mTextures;
 	std::vector<Material> mMaterials;
 
-	// 
-	// SRV HeapĹⲿ
-	ComPtr<ID3D12DescriptorHeap> mSrvHeap;
+	// SRV Heap由外部类创建，纹理的SRV从mSrvHeapOffset起依次写入，容量不足时由DescriptorHeap扩容
+	DescriptorHeap* mSrvHeap = nullptr;
 	UINT mSrvHeapOffset = 0;
 
-	static const UINT mMaxTextureNum = 128;
 	UINT mTextureNum = 0;
 
-	// Render Item
-	// ΪPSOлʹͬShaderRender Itemһ
+	// Render Item管理
+	// 为减少PSO切换次数，使用相同Shader的Render Item将被放在一起
 	std::unordered_map<TextureFlags, std::vector<RenderItem>> mRenderItems;
-	std::unordered_map<std::string, std::vector<UINT>> mNameIndexMap;
 
-	// Ŀǰֻܾ̬ȷԴɴС̬ܶظı
-	static const UINT mMaximumItemNum = 512;
+	// 模型槽位，被卸载的槽位放入mFreeModelSlots供之后的模型使用
+	std::vector<SceneModel> mModels;
+	std::vector<UINT> mFreeModelSlots;
+	// 调试用的名称查找，同名的模型只保留最后导入的一个
+	std::unordered_map<std::string, ModelHandle> mModelNames;
+
+	// 天空球作为一个模型，SetProperties使其中心跟随摄像机
+	ModelHandle mSkyModel;
+
+	// 以RenderItemIndex为索引: 句柄的Generation、所属模型的槽位与在mRenderItems中的位置
+	std::vector<UINT> mItemGenerations;
+	std::vector<UINT> mItemModels;
+	std::vector<RenderItemLocation> mItemLocations;
+
+	// 每个视角的剔除结果与实例化绘制列表，由CullView与BuildInstancedDraws生成
+	ViewDrawList mViews[CullingView::Count];
+	// 天空球在mInstanceItemsGPU中的位置
+	UINT mSkyInstanceBase = 0;
+
+	// 内容相同的SubMesh共用几何Arena中的数据，见Mesh::UploadBuffers
+	SubMeshRegistry mSubMeshRegistry;
+
+	// 导入的模型中占用几何Arena的SubMesh(不含IsShared与天空球)，即光线追踪BLAS的几何列表
+	// 导入时追加，卸载时移除，因此geometryIndex在模型增删之后会改变
+	std::vector<SubMeshRef> mGeometries;
+
+	// mObjectCBGPU、mWorldMatrixGPU与mMaterialCBGPU可容纳的元素数，导入时按块增长，见ReserveItems与ReserveMaterials
+	// RenderItemIndex不回收，mRenderItemNum即Render Item数量的最高水位
+	static const UINT mCapacityChunk = 1024;
+	UINT mItemCapacity = 0;
+	UINT mMaterialCapacity = 0;
+	// 扩容次数
+	UINT mCapacityGrowths = 0;
 	UINT mRenderItemNum = 0;
 	UINT mModelNum = 0;
 
-	// GPUConstant Buffer
-	// RenderItemData: а
+	// Render Item在模型内部的变换，以RenderItemIndex为索引，未转置
+	// 只有PBRT场景中的Shape带有变换，其余为单位矩阵
+	std::vector<XMFLOAT4X4> mItemTransforms;
+
+	// Render Item的SRT，以RenderItemIndex为索引；World = mItemTransforms * SRT
+	TransformArray mTransforms;
+	// mItemTransforms不为单位矩阵
+	std::vector<UINT8> mHasItemTransform;
+
+	// World Matrix在CPU侧的副本，以RenderItemIndex为索引，未转置
+	std::vector<XMFLOAT4X4> mWorldMatrices;
+
+	// 上一次FlushTransforms的统计
+	UINT mTransformsUpdated = 0;
+	double mTransformUpdateMs = 0.0;
+
+	// 以RenderItemIndex为索引的Dirty位，以及等待FlushTransforms上传的Render Item
+	std::vector<UINT8> mItemDirty;
+	std::vector<UINT> mDirtyItems;
+
+	// 实例列表需要重建，UpdateLODs与Render Item的增删会将其置位
+	bool mInstancesDirty = true;
+
+	// 写入Upload Buffer(mObjectCBGPU与mInstanceItemsGPU)的字节数，由调用者在每帧开始时清零
+	UINT64 mUploadedBytes = 0;
+
+	// 以RenderItemIndex为索引，局部空间与世界空间的包围体
+	// 世界空间的包围体随World Matrix在FlushTransforms中更新
+	std::vector<BoundingVolume> mLocalBounds;
+	std::vector<BoundingVolume> mWorldBounds;
+	// 世界空间AABB的SoA副本，供CullView批量测试
+	PackedBoxArray mPackedBounds;
+
+	// 场景中Render Item(不包括天空球)世界空间AABB的松散八叉树，随FlushTransforms增量更新
+	// 根格子边长2048，最深5层(格子半长32)；更深时节点过多，查询反而变慢，见LooseOctree::Benchmark
+	LooseOctree mOctree = LooseOctree(XMFLOAT3(0.0f, 0.0f, 0.0f), 1024.0f, 5);
+	// 物体较少时两者耗时都可忽略，约1万个以上时八叉树更快
+	bool mUseOctreeCulling = true;
+
+	// 软件遮挡剔除: 每帧挑选屏幕面积最大的mMaxOccluders个遮挡体光栅化到mOcclusionBuffer，再测试其余Render Item的AABB
+	// 光栅化与测试合计不超过mOcclusionBudgetMs，超出时剩余的遮挡体不再光栅化、剩余的Render Item视为可见
+	OcclusionBuffer mOcclusionBuffer;
+	bool mUseOcclusionCulling = true;
+	UINT mMaxOccluders = 16;
+	float mOcclusionBudgetMs = 1.0f;
+
+	// LOD误差投影到屏幕上允许的最大像素数
+	float mLODErrorThreshold = 1.0f;
+	// 切换到更粗糙的LOD时误差需低于 mLODErrorThreshold * mLODHysteresis，防止在阈值附近来回切换
+	float mLODHysteresis = 0.75f;
+
+	// 导入时是否读写网格缓存，见MeshCache.h
+	bool mUseMeshCache = true;
+
+	// .obj是否使用ObjLoader读取，关闭时经由Assimp，便于比较两者的导入耗时
+	bool mUseNativeObjLoader = true;
+
+	// GPU侧的Constant Buffer
+	// RenderItemData: 以RenderItemIndex为索引，作为Structured Buffer绑定
 	std::unique_ptr<UploadBuffer<RenderItemData>> mObjectCBGPU;
+	// World Matrix(转置)单独存放，每帧更新的部分在内存中连续
+	std::unique_ptr<UploadBuffer<XMFLOAT4X4>> mWorldMatrixGPU;
 	std::unique_ptr<UploadBuffer<MaterialData>> mMaterialCBGPU;
+	// 实例列表: 每个实例的RenderItemIndex，Shader中以gInstanceBase + SV_InstanceID读取
+	std::unique_ptr<UploadBuffer<UINT>> mInstanceItemsGPU;
 
-	// 
+	// 天空球
 	RenderItem mSkySphere;
 
 private:
@@ -88,16 +333,89 @@ private:
 
 	void GenerateSkySphere();
 
-	bool ImportAssimp(const std::string& path);
+	// 网格缓存命中时直接由缓存导入并返回true；sourceHash与hashed供之后写出缓存使用
+	// cacheFlags为缓存键中的导入标志: importFlags，ObjLoader读取时再加上MeshCache::kNativeObjLoader
+	bool TryImportFromCache(const std::string& path, UINT32 cacheFlags, UINT64& sourceHash, bool& hashed);
+
+	bool ImportAssimp(const std::string& path, MeshImportFlags importFlags);
+
+	bool ImportObj(const std::string& path, MeshImportFlags importFlags);
+
+	bool ImportPBRT(const std::string& path, MeshImportFlags importFlags);
+
+	// cacheWriter不为空时，导入完成后写出网格缓存
+	bool InitFromAiScene(const aiScene* pAiScene, const std::string& path, MeshImportFlags importFlags, MeshCacheWriter* cacheWriter = nullptr);
 
-	bool InitFromAiScene(const aiScene* pAiScene, const std::string& path);
+	bool InitFromCache(const MeshCacheView& cache, const std::string& path);
+
+	// 创建将被放入mMeshes末尾的Mesh，上传时参与SubMesh去重
+	Mesh CreateMesh();
+
+	static std::vector<MaterialDesc> ExtractMaterials(const aiScene* pAiScene);
+
+	// 加载纹理并创建材质，返回第一个材质的绝对MaterialIndex
+	UINT CreateMaterials(const std::vector<MaterialDesc>& materials, const std::string& directory);
+
+	// 占用一个模型槽位并登记名称
+	ModelHandle CreateModel(const std::string& name);
+
+	// 为mMeshes.back()的每个SubMesh创建Render Item
+	// 创建的模型记录在mImportedModel中，本次导入创建的Mesh(mImportMeshBegin之后)归其所有
+	void CreateRenderItems(const std::string& name, UINT baseMaterialIndex);
+
+	// 为每个实例创建引用mMeshes.back()中SubMesh的Render Item
+	void CreateRenderItems(const std::string& name, UINT baseMaterialIndex, const std::vector<PbrtShapeInstance>& instances);
+
+	// materialIndex为绝对的MaterialIndex，transform为Render Item在模型内部的变换
+	void CreateRenderItem(UINT modelSlot, UINT submeshIndex, UINT materialIndex, const XMFLOAT4X4& transform);
+
+	void MarkTransformDirty(UINT itemIndex);
+
+	const SubMesh& GeometrySubMesh(UINT geometryIndex) const;
+
+	void UpdateModelBounds(UINT modelSlot);
+
+	// 以mOcclusionBuffer剔除mCullScratch中被遮挡的Render Item，统计记录在viewList中
+	void CullOccluded(ViewDrawList& viewList, FXMMATRIX viewProj);
+
+	// 由排好序的Render Item生成一个视角的绘制列表，实例写入mInstanceItemsGPU中instanceBase起的位置
+	void BuildViewDraws(ViewDrawList& viewList, UINT instanceBase);
 
 	void CreateShaderResourceView(ID3D12Resource* tex, UINT srvHeapOffset, D3D12_SRV_DIMENSION viewDimension = D3D12_SRV_DIMENSION_TEXTURE2D);
 
+	// 保证GPU侧的Buffer至少能容纳count个Render Item或材质，不足时按块扩容并保留原有内容
+	// Render Item扩容时实例列表的布局随之改变，需要重建
+	void ReserveItems(UINT count);
+	void ReserveMaterials(UINT count);
+
 	ComPtr<ID3D12Device> mDevice;
 	ComPtr<ID3D12GraphicsCommandList> mCommandList;
 	Assimp::Importer mAiImporter;
 
-	// Դб2.0
+	// 资源列表2.0
 	std::unique_ptr<MeshManager> mMeshManager;
+
+	// 扩容前的Upload Buffer，已提交的命令可能仍在读取，在ReleaseUploadBuffers中释放
+	std::vector<ComPtr<ID3D12Resource>> mRetiredBuffers;
+
+	// FlushTransforms使用: 按mDirtyItems顺序的SRT矩阵，以及包围体需要重新合并的模型
+	std::vector<XMFLOAT4X4> mTransformScratch;
+	std::vector<UINT> mDirtyModels;
+
+	// BuildInstancedDraws使用: 以RenderItemIndex为索引的排序键中除深度以外的部分(Pass、PSO、材质与几何)
+	std::vector<UINT64> mItemStateKeys;
+	// BuildViewDraws使用: 可见Render Item的(排序键, RenderItemIndex)与基数排序的临时空间
+	std::vector<RadixSort::KeyValue> mSortKeys;
+	std::vector<RadixSort::KeyValue> mSortScratch;
+	// CullView使用: 本次剔除的结果，与视角上一次的结果比较后交换
+	std::vector<UINT8> mCullScratch;
+	std::vector<UINT> mOctreeResults;
+	// CullOccluded使用: 候选遮挡体(屏幕面积, RenderItemIndex)与本帧的遮挡体
+	std::vector<std::pair<float, UINT>> mOccluderCandidates;
+	std::vector<OccluderDesc> mOccluders;
+	std::vector<UINT> mOcclusionTests;
+
+	// ImportModel期间有效
+	ModelHandle mImportedModel;
+	size_t mImportMeshBegin = 0;
 };
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "UploadBuffer.h"
 #include "VertexType.h"
 #include "ShadowMap.h"
+#include "ClusteredLighting.h"
 
 #include <DirectXTK12/BufferHelpers.h>
 using namespace DirectX;
@@ -16,13 +17,19 @@ enum PIPE_STATE_FLAG_TYPE {
 	ShadowMapping		= 1 << 29,
 };
 
-// ÷DirectX Samplesָһڴвͬ
+// 该方法出自DirectX Samples，可用于清晰地指明一块连续的内存中不同区域代表的内容
 namespace RootSignatureParameter {
 	enum Value {
-		PerObjectCB = 0,
+		DrawConstants = 0,	// Root Constants: 本次绘制的实例在实例列表中的起始位置
 		PerPassCB,
 		MaterialCB,
 		TextureTable,
+		RenderItemData,		// 以RenderItemIndex为索引的物体数据
+		InstanceItems,		// 实例列表
+		WorldMatrices,		// 以RenderItemIndex为索引的World Matrix
+		ClusterLights,		// Clustered Lighting的光源
+		LightClusters,		// 每个Cluster的(起始位置, 数量)
+		LightIndices,		// 各Cluster的光源索引
 		ParameterCount
 	};
 }
@@ -36,9 +43,20 @@ public:
 
 	bool Init() override;
 
-	void LoadModel(const std::string& path);
+	ModelHandle LoadModel(const std::string& path, MeshImportFlags importFlags = DefaultMeshImportFlags);
+	// 移除模型的Render Item并归还其几何Arena中的范围
+	void UnloadModel(ModelHandle model);
 	void LoadCubeMap(const std::string& path);
 
+	// 设置模型的SRT变换，只在加载后或变换改变时调用，见Scene::SetProperties
+	void SetProperties(ModelHandle model,
+		XMFLOAT3 scale,
+		float rotationAngle, XMFLOAT3 rotationAxis,
+		XMFLOAT3 pos = XMFLOAT3(0.0f, 0.0f, 0.0f));
+
+	// 设置模型能否作为遮挡体，见OccluderMode
+	void SetOccluderMode(ModelHandle model, OccluderMode::Value mode);
+
 private:
 	void ConfigLights();
 
@@ -50,6 +68,9 @@ private:
 	void BuildShaders(PipelineStateFlags pipelineStateFlags);
 	void BuildPSO(PipelineStateFlags pipelineStateFlags);
 
+	// Shadow Pass(无Mask纹理时)与天空球只读取Position，只需绑定Position流
+	static bool UsesPositionStreamOnly(PipelineStateFlags pipelineStateFlags);
+
 	void OnResize() override;
 	void Update(const GameTimer& gt) override;
 	void UpdateRenderItemCB(const GameTimer& gt);
@@ -62,7 +83,8 @@ private:
 	void DrawShadowMap(const GameTimer& gt); // Pass 0
 	void DrawScene(const GameTimer& gt); // Pass 1
 	
-	void DrawRenderItems(const GameTimer& gt, PipelineStateFlags pipelineStateFlags);
+	// 绘制view中可见的Render Item
+	void DrawRenderItems(const GameTimer& gt, PipelineStateFlags pipelineStateFlags, CullingView::Value view);
 	void DrawEnvironmentMap(const GameTimer& gt, PipelineStateFlags pipelineStateFlags);
 
 	void OnMouseDown(WPARAM btnState, int x, int y) override;
@@ -71,21 +93,21 @@ private:
 	void OnKeyDown(UINT key) override;
 
 
-	// RootSignaturePSO
+	// RootSignature与PSO
 	ComPtr<ID3D12RootSignature> mRootSignature;
 	std::unordered_map<PipelineStateFlags, ComPtr<ID3D12PipelineState>> mPSOs; // Multiple PSOs
 
-	// SRV Heap ų干õShadowMapCubeMap
-	// еmSceneSRV Heap
-	ComPtr<ID3D12DescriptorHeap> mSrvHeap;
+	// SRV Heap 存放场景中所有物体共用的纹理，如ShadowMap和CubeMap
+	// 物体独有的纹理由mScene写入其后，容量不足时扩容，因此每帧重新绑定
+	std::unique_ptr<DescriptorHeap> mSrvHeap;
 
-	// CPUConstant Buffer
+	// CPU侧的Constant Buffer
 	PassData mPassCBCPU;
-	// GPUConstant Buffer
+	// GPU侧的Constant Buffer
 	std::unique_ptr<UploadBuffer<PassData>> mPassCBGPU;
 
-	// Shaders
-	// unordered_map װ
+	// Shaders代码
+	// unordered_map 封装
 	std::unordered_map<PipelineStateFlags, ComPtr<ID3DBlob>> mVsByteCode;
 	std::unordered_map<PipelineStateFlags, ComPtr<ID3DBlob>> mPsByteCode;
 
@@ -93,14 +115,25 @@ private:
 	Camera mCamera;
 	POINT mLastMousePos;
 
-	// 
+	// 场景
 	Scene mScene;
 
-	// ƹ
+	// 灯光
+	// mLights只包括方向光与Cluster的常量，点光源、聚光灯与面光源由mClusteredLighting管理
 	Light mLights;
 	XMFLOAT4	mAmbientLightStrength;
+	std::unique_ptr<ClusteredLighting> mClusteredLighting;
 
 	// ShadowMap
-	// ĿǰٶԴΪ1ΪԴ
+	// 目前假定光源数量为1且为面光源，该面光源同时加入mClusteredLighting
+	RectLight mShadowLight;
 	std::unique_ptr<ShadowMap<RectLight>> mShadowMap;
+
+	// 统计信息，包括所有Pass
+	UINT mTrianglesDrawn = 0;
+	UINT mDrawCalls = 0;
+	UINT mInstancesDrawn = 0;
+	UINT mPipelineStateChanges = 0;
+	// 每帧写入Upload Buffer的字节数，包括Pass Constant Buffer
+	UINT64 mUploadedBytes = 0;
 };
\ No newline at end of file
@@ -68,12 +68,12 @@ public:
 		return mSrvHeap->GetGPUDescriptorHandleForHeapStart();
 	}
 
-	// Shadow Map任
+	// Shadow Map纹理变换矩阵
 	XMMATRIX ShadowTransformMatrix() {
 		XMMATRIX V = mCamera.ViewMatrix();
 		XMMATRIX P = mCamera.ProjectionMatrix();
 
-		// 任
+		// 纹理坐标变换矩阵
 		const XMMATRIX T(
 			0.5f, 0.0f, 0.0f, 0.0f,
 			0.0f, -0.5f, 0.0f, 0.0f,
@@ -125,9 +125,9 @@ private:
 		shadowMapDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
 		shadowMapDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
 
-		// Shadow Map
+		// 创建Shadow Map
 		D3D12_HEAP_PROPERTIES heapProp = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-		// ָOptimized Clear Value
+		// 指定Optimized Clear Value
 		D3D12_CLEAR_VALUE optimizedClearValue = { DXGI_FORMAT_D24_UNORM_S8_UINT, { 1.0f, 0 } };
 		ThrowIfFailed(mDevice->CreateCommittedResource(
 			&heapProp,
@@ -141,7 +141,7 @@ private:
 
 	void BuildDescriptors() {
 		// DSV
-		// ԴΪTYPELESSʱṩD3D12_DEPTH_STENCIL_VIEW_DESC
+		// 当资源的类型为TYPELESS时，必须提供D3D12_DEPTH_STENCIL_VIEW_DESC
 		D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
 		dsvDesc.Flags = D3D12_DSV_FLAG_NONE;
 		dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
@@ -157,22 +157,22 @@ private:
 
 	ID3D12Device* mDevice;
 
-	// ShadowMapʽ
+	// ShadowMap格式
 	UINT mWidth;
 	UINT mHeight;
 	DXGI_FORMAT mFormat = DXGI_FORMAT_R24G8_TYPELESS;
 
-	// Shadow MapصLight
+	// 与此Shadow Map相关的Light
 	LightType* mLight;
 
-	// ǶһCamera
+	// 内嵌一个Camera
 	Camera mCamera;
 
 	// Rasterizer State
 	D3D12_VIEWPORT mViewPort;
 	D3D12_RECT mScissorRect;
 
-	// Դ
+	// 资源管理
 	ComPtr<ID3D12Resource> mShadowMap;
 	ComPtr<ID3D12DescriptorHeap> mSrvHeap;
 	ComPtr<ID3D12DescriptorHeap> mDsvHeap;
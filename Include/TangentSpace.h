@@ -0,0 +1,20 @@
+#pragma once
+#include <windows.h>
+#include <vector>
+
+#include "VertexType.h"
+
+// 由Index Buffer描述的三角形列表生成顶点的法线与Tangent
+// Index相对于vertices，绕序与Scene中的约定一致(左手坐标系下顺时针为正面)
+namespace TangentSpace {
+	// 法线为零向量的顶点取相邻三角形的面法线按面积加权的平均，之后将所有法线归一化
+	void GenerateNormals(VertexPositionNormalTangentTexture* vertices, size_t vertexCount, const UINT* indices, size_t indexCount);
+
+	// Tangent沿纹理坐标u增大的方向，计算方式与MikkTSpace一致:
+	// 每个三角形的Tangent先归一化并投影到各顶点法线的切平面上，再以角的张角为权重平均
+	// 纹理坐标绕向相反的三角形(镜像UV)不参与同一顶点的平均；顶点格式不含副切线的符号，
+	// 因此两种绕向共用的顶点被拆分，新顶点追加到splitVertices，Index为vertexCount + 在本次调用中追加的序号
+	// 三角形与顶点的计算在线程池上并行；法线需已归一化，纹理坐标退化时任取一个与法线垂直的方向
+	void GenerateTangents(VertexPositionNormalTangentTexture* vertices, size_t vertexCount, UINT* indices, size_t indexCount,
+		std::vector<VertexPositionNormalTangentTexture>& splitVertices);
+}
@@ -36,7 +36,7 @@ public:
 		: mDevice(device),
 		mCommandList(cmdList) {
 
-		// WICFactory
+		// 创建WICFactory
 		ThrowIfFailed(CoCreateInstance(
 			CLSID_WICImagingFactory, 
 			nullptr, 
@@ -47,7 +47,7 @@ public:
 
 
 	ID3D12Resource* LoadTexture(const std::string& path) {
-		// ˴עScratchImageĹ
+		// 此处需注释ScratchImage的构成
 		ScratchImage baseImage;
 		std::wstring wpath(path.begin(), path.end());
 
@@ -95,7 +95,7 @@ public:
 		}
 
 		ScratchImage mipChain;
-		// DDSʽԴmipmap
+		// DDS格式自带mipmap
 		if (path.find(".dds") == std::string::npos) {
 			ThrowIfFailed(GenerateMipMaps(baseImage.GetImages(), baseImage.GetImageCount(), baseImage.GetMetadata(),
 				TEX_FILTER_DEFAULT, 0, mipChain));
@@ -154,9 +154,9 @@ private:
 // Old Version
 //ID3D12Resource* LoadTexture(const std::string& path, ID3D12Device* device, ID3D12GraphicsCommandList* cmdList) {
 //	// Decoder
-//	// path2Ҫ
-//	// 1. pathҪǾ·Ҳļ
-//	// 2. pathתwstring
+//	// 对path有2点要求：
+//	// 1. path需要是绝对路径，否则会找不到文件
+//	// 2. path需转换成wstring
 //	std::wstring wpath(path.begin(), path.end());
 //	ThrowIfFailed(pIWICFactory->CreateDecoderFromFilename(
 //		(LPCWSTR)(wpath.c_str()),
@@ -166,58 +166,58 @@ private:
 //		&pIWICDecoder
 //	));
 //
-//	// ȡһ֡ͼƬ(ΪGIFȸʽļܻж֡ͼƬĸʽһֻһ֡ͼƬ)
-//	// ʵʽλͼʽ
+//	// 获取第一帧图片(因为GIF等格式文件可能会有多帧图片，其他的格式一般只有一帧图片)
+//	// 实际解析出来的往往是位图格式数据
 //	ThrowIfFailed(pIWICDecoder->GetFrame(0, &pIWICFrame));
 //
 //	WICPixelFormatGUID wpf = {};
-//	// ȡWICͼƬʽ
+//	// 获取WIC图片格式
 //	ThrowIfFailed(pIWICFrame->GetPixelFormat(&wpf));
 //	GUID tgFormat = {};
 //
-//	// ͨһת֮ȡDXGIĵȼ۸ʽ
+//	// 通过第一道转换之后获取DXGI的等价格式
 //	if (Util::GetTargetPixelFormat(&wpf, &tgFormat))
 //	{
 //		mFormat = Util::GetDXGIFormatFromPixelFormat(&tgFormat);
 //	}
 //
-//	// ֵ֧ͼƬʽ
+//	// 不支持的图片格式
 //	if (mFormat == DXGI_FORMAT_UNKNOWN) {
 //		throw;
 //	}
 //
-//	// һλͼʽͼƬݶӿ
+//	// 定义一个位图格式的图片数据对象接口
 //	ComPtr<IWICBitmapSource> pIBMP;
 //
 //	if (!InlineIsEqualGUID(wpf, tgFormat))
-//	{// жϺҪԭWICʽֱתΪDXGIʽͼƬʱ
-//		// ҪľתͼƬʽΪֱܹӶӦDXGIʽʽ
-//		//ͼƬʽת
+//	{// 这个判断很重要，如果原WIC格式不是直接能转换为DXGI格式的图片时
+//		// 我们需要做的就是转换图片格式为能够直接对应DXGI格式的形式
+//		//创建图片格式转换器
 //		ComPtr<IWICFormatConverter> pIConverter;
 //		ThrowIfFailed(pIWICFactory->CreateFormatConverter(&pIConverter));
 //
-//		//ʼһͼƬתʵҲǽͼƬݽ˸ʽת
+//		//初始化一个图片转换器，实际也就是将图片数据进行了格式转换
 //		ThrowIfFailed(pIConverter->Initialize(
-//			pIWICFrame.Get(),                // ԭͼƬ
-//			tgFormat,						 // ָתĿʽ
-//			WICBitmapDitherTypeNone,         // ָλͼǷеɫ壬ִλͼõɫ壬ΪNone
-//			NULL,                            // ָɫָ
-//			0.f,                             // ָAlphaֵ
-//			WICBitmapPaletteTypeCustom       // ɫͣʵûʹãָΪCustom
+//			pIWICFrame.Get(),                // 输入原图片数据
+//			tgFormat,						 // 指定待转换的目标格式
+//			WICBitmapDitherTypeNone,         // 指定位图是否有调色板，现代都是真彩位图，不用调色板，所以为None
+//			NULL,                            // 指定调色板指针
+//			0.f,                             // 指定Alpha阀值
+//			WICBitmapPaletteTypeCustom       // 调色板类型，实际没有使用，所以指定为Custom
 //		));
-//		// QueryInterfaceöλͼԴӿ
+//		// 调用QueryInterface方法获得对象的位图数据源接口
 //		ThrowIfFailed(pIConverter.As(&pIBMP));
 //	}
 //	else
 //	{
-//		//ͼƬݸʽҪתֱӻȡλͼԴӿ
+//		//图片数据格式不需要转换，直接获取其位图数据源接口
 //		ThrowIfFailed(pIWICFrame.As(&pIBMP));
 //	}
 //
-//	// ͼƬСλأ
+//	// 获得图片大小（单位：像素）
 //	ThrowIfFailed(pIBMP->GetSize(&mWidth, &mHeight));
 //
-//	//ȡͼƬصλСBPPBits Per PixelϢԼͼƬݵʵСλֽڣ
+//	//获取图片像素的位大小的BPP（Bits Per Pixel）信息，用以计算图片行数据的真实大小（单位：字节）
 //	ComPtr<IWICComponentInfo> pIWICmntinfo;
 //	ThrowIfFailed(pIWICFactory->CreateComponentInfo(tgFormat, pIWICmntinfo.GetAddressOf()));
 //
@@ -232,27 +232,27 @@ private:
 //	ComPtr<IWICPixelFormatInfo> pIWICPixelinfo;
 //	ThrowIfFailed(pIWICmntinfo.As(&pIWICPixelinfo));
 //
-//	// ڿԵõBPPˣҲҿıȽѪĵطΪBPPȻô໷
+//	// 到这里终于可以得到BPP了，这也是我看的比较吐血的地方，为了BPP居然绕了这么多环节
 //	ThrowIfFailed(pIWICPixelinfo->GetBitsPerPixel(&mBPP));
 //
-//	// ͼƬʵʵдСλֽڣ
+//	// 计算图片实际的行大小（单位：字节）
 //	mRowPitch = (uint64_t(mWidth) * uint64_t(mBPP) + 7u) / 8u;
 //
-//	// һƬڴеĿռ׼洢ͼƬ
+//	// 开辟一片内存中的空间准备存储图片
 //	ThrowIfFailed(D3DCreateBlob(
 //		mRowPitch * mHeight,
 //		&mTextureCPU
 //	));
 //
-//	// ͼƬڴռ
+//	// 将图片拷贝到内存空间中
 //	ThrowIfFailed(pIBMP->CopyPixels(
-//		nullptr, // ͼƬΪnullptr
+//		nullptr, // 拷贝整张图片，设为nullptr
 //		mRowPitch,
 //		mTextureCPU->GetBufferSize(),
 //		reinterpret_cast<BYTE*>(mTextureCPU->GetBufferPointer())
 //	));
 //
-//	// ϴԴ
+//	// 上传资源
 //	D3D12_SUBRESOURCE_FOOTPRINT footPrint = { mFormat, mWidth, mHeight, 1, mRowPitch };
 //	Util::UploadTexture2DResource(device, cmdList,
 //		mTextureCPU->GetBufferPointer(),
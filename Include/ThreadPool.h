@@ -0,0 +1,44 @@
+#pragma once
+#include <windows.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 常驻的工作线程池，用于模型导入与每帧的批量计算
+class ThreadPool {
+public:
+	// 默认保留一个核心给调用线程
+	explicit ThreadPool(UINT workerCount = DefaultWorkerCount());
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// 全局共享的线程池
+	static ThreadPool& Get();
+
+	static UINT DefaultWorkerCount();
+
+	// 参与ParallelFor的线程数，包括调用线程
+	UINT ThreadCount() const;
+
+	// 将[0, count)切分为长度不小于grainSize的区间，并行地执行func(begin, end)
+	// 调用线程同样参与执行，返回时所有区间均已完成
+	// 可以在任务中嵌套调用: 空闲的线程不足时由调用线程完成剩余的区间
+	void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& func);
+
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> mWorkers;
+
+	std::deque<std::function<void()>> mTasks;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	bool mStopping = false;
+};
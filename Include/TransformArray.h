@@ -0,0 +1,31 @@
+#pragma once
+#include <windows.h>
+#include <DirectXMath.h>
+#include <vector>
+
+// 以结构数组(SoA)保存的缩放、旋转(四元数)与平移，每个分量各占一段连续的float
+// 批量计算矩阵时一次处理8个变换(AVX2)，CPU不支持AVX2时逐个以DirectXMath计算
+class TransformArray {
+public:
+	// 新增的变换为单位变换
+	void Resize(size_t count);
+	size_t Size() const { return mScaleX.size(); }
+
+	void Set(size_t i, const DirectX::XMFLOAT3& scale, const DirectX::XMFLOAT4& rotation, const DirectX::XMFLOAT3& translation);
+
+	// 计算indices所指变换的矩阵 S * R * T(行向量约定，未转置)，按indices的顺序写入matrices
+	// indices不要求有序，可以重复
+	// 只读取成员，可由多个线程对不同的区间同时调用
+	void ComputeMatrices(const UINT* indices, size_t count, DirectX::XMFLOAT4X4* matrices) const;
+
+	// 运行时检测CPU与操作系统是否支持AVX2，结果只计算一次
+	static bool SupportsAVX2();
+
+private:
+	void ComputeMatrix(UINT index, DirectX::XMFLOAT4X4& matrix) const;
+	void ComputeMatricesAVX2(const UINT* indices, size_t count, DirectX::XMFLOAT4X4* matrices) const;
+
+	std::vector<float> mScaleX, mScaleY, mScaleZ;
+	std::vector<float> mRotationX, mRotationY, mRotationZ, mRotationW;
+	std::vector<float> mTranslationX, mTranslationY, mTranslationZ;
+};
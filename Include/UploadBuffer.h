@@ -1,6 +1,8 @@
 #pragma once
 #include "D3D12App.h"
 
+#include <vector>
+
 template <typename T>
 class UploadBuffer {
 public:
@@ -13,27 +15,13 @@ public:
 			mElementByteSize = (mElementByteSize + alignedSize - 1) & ~(alignedSize - 1);
 		}
 
-		D3D12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-		D3D12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(elementCount * mElementByteSize);
-
-		// UploadBufferԴ
-		ThrowIfFailed(device->CreateCommittedResource(
-			&heapProperties,
-			D3D12_HEAP_FLAG_NONE,
-			&resourceDesc,
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&mUploadBuffer)
-		));
-
-		// ڴӳ
-		mUploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mMappedBuffer));
+		CreateBuffer(device);
 	}
 
 	UploadBuffer(const UploadBuffer& rhs) = delete;
 	UploadBuffer& operator=(const UploadBuffer& rhs) = delete;
 	~UploadBuffer() {
-		// ͷӳڴ
+		// 释放映射内存
 		if (mUploadBuffer != nullptr) {
 			mUploadBuffer->Unmap(0, nullptr);
 		}
@@ -50,6 +38,17 @@ public:
 		std::memcpy(&mMappedBuffer[elementIndex * mElementByteSize], &data, sizeof(Type));
 	}
 
+	// 只覆盖元素中的一部分，offsetInBytes相对于元素的开头
+	template<typename Type>
+	void Copydata(int elementIndex, UINT offsetInBytes, const Type& data) {
+		std::memcpy(&mMappedBuffer[elementIndex * mElementByteSize + offsetInBytes], &data, sizeof(Type));
+	}
+
+	// 映射的内存，元素之间间隔GetElementSizeInBytes()
+	BYTE* MappedData() {
+		return mMappedBuffer;
+	}
+
 	UINT GetElementSizeInBytes() const {
 		return mElementByteSize;
 	}
@@ -62,7 +61,53 @@ public:
 		return mElementByteSize * mElementCount;
 	}
 
+	UINT ElementCount() const {
+		return mElementCount;
+	}
+
+	// 容量小于elementCount时重新创建资源，返回是否重新创建；之后Resource与MappedData都会改变
+	// preserveContents为true时拷贝原有的元素。Upload Heap为写合并内存，读取很慢，只应在导入等非每帧的路径上扩容
+	// 已提交的命令可能仍在读取旧资源，旧资源放入retired，由调用者在GPU执行完毕后释放
+	bool Grow(ID3D12Device* device, UINT elementCount, bool preserveContents, std::vector<ComPtr<ID3D12Resource>>& retired) {
+		if (elementCount <= mElementCount) {
+			return false;
+		}
+
+		ComPtr<ID3D12Resource> oldBuffer = mUploadBuffer;
+		BYTE* oldMappedBuffer = mMappedBuffer;
+		const UINT oldSize = GetBufferSize();
+
+		mElementCount = elementCount;
+		CreateBuffer(device);
+
+		if (preserveContents) {
+			std::memcpy(mMappedBuffer, oldMappedBuffer, oldSize);
+		}
+
+		oldBuffer->Unmap(0, nullptr);
+		retired.push_back(std::move(oldBuffer));
+		return true;
+	}
+
 private:
+	void CreateBuffer(ID3D12Device* device) {
+		D3D12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+		D3D12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(static_cast<UINT64>(mElementCount) * mElementByteSize);
+
+		// 创建UploadBuffer资源
+		ThrowIfFailed(device->CreateCommittedResource(
+			&heapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&resourceDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&mUploadBuffer)
+		));
+
+		// 进行内存映射
+		mUploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mMappedBuffer));
+	}
+
 	ComPtr<ID3D12Resource> mUploadBuffer;
 	BYTE* mMappedBuffer = nullptr;
 	UINT mElementCount = 0;
@@ -18,14 +18,19 @@
 
 using Microsoft::WRL::ComPtr;
 
-// 赼DeviceCommand Listв
+// 还需导入Device和Command List进行操作
 namespace Util {
-	// Դϴ
+	// 资源上传
 	void UploadResource(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList,
 		const void* initData, UINT64 byteSize,
 		ComPtr<ID3D12Resource>& defaultBuffer,
 		ComPtr<ID3D12Resource>& uploadBuffer);
 
+	// 只创建Upload Buffer并写入数据，由调用者记录拷贝命令
+	void CreateUploadBuffer(ID3D12Device* device,
+		const void* initData, UINT64 byteSize,
+		ComPtr<ID3D12Resource>& uploadBuffer);
+
 	void UploadTexture2DResource(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList,
 		const ScratchImage* scratchImage,
 		ComPtr<ID3D12Resource>& defaultBuffer,
@@ -36,13 +41,20 @@ namespace Util {
 		ComPtr<ID3D12Resource>& defaultBuffer,
 		ComPtr<ID3D12Resource>& uploadBuffer);
 
-	// Դ
+	// 调试输出，格式同printf
+	void DebugLog(const char* format, ...);
+
+	// 高精度计时，用于统计导入等一次性操作的耗时
+	INT64 QueryTimestamp();
+	double MillisecondsSince(INT64 timestamp);
+
+	// 资源分配
 	void AllocateUAVBuffer(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList,
 		UINT64 byteSize,
 		D3D12_RESOURCE_STATES initialState,
 		ComPtr<ID3D12Resource>& defaultBuffer);
 
-	// 
+	// 纹理加载
 	struct WICTranslate
 	{
 		GUID wic;
@@ -50,7 +62,7 @@ namespace Util {
 	};
 
 	static WICTranslate g_WICFormats[] =
-	{//WICʽDXGIظʽĶӦñеĸʽΪֵ֧ĸʽ
+	{//WIC格式与DXGI像素格式的对应表，该表中的格式为被支持的格式
 		{ GUID_WICPixelFormat128bppRGBAFloat,       DXGI_FORMAT_R32G32B32A32_FLOAT },
 
 		{ GUID_WICPixelFormat64bppRGBAHalf,         DXGI_FORMAT_R16G16B16A16_FLOAT },
@@ -74,7 +86,7 @@ namespace Util {
 		{ GUID_WICPixelFormat8bppAlpha,             DXGI_FORMAT_A8_UNORM },
 	};
 
-	// WIC ظʽת.
+	// WIC 像素格式转换表.
 	struct WICConvert
 	{
 		GUID source;
@@ -83,7 +95,7 @@ namespace Util {
 
 	static WICConvert g_WICConvert[] =
 	{
-		// Ŀʽһӽıֵ֧ĸʽ
+		// 目标格式一定是最接近的被支持的格式
 		{ GUID_WICPixelFormatBlackWhite,            GUID_WICPixelFormat8bppGray }, // DXGI_FORMAT_R8_UNORM
 
 		{ GUID_WICPixelFormat1bppIndexed,           GUID_WICPixelFormat32bppRGBA }, // DXGI_FORMAT_R8G8B8A8_UNORM
@@ -137,7 +149,7 @@ namespace Util {
 	};
 
 	inline bool GetTargetPixelFormat(const GUID* pSourceFormat, GUID* pTargetFormat)
-	{//ȷݵӽʽĸ
+	{//查表确定兼容的最接近格式是哪个
 		*pTargetFormat = *pSourceFormat;
 		for (size_t i = 0; i < _countof(g_WICConvert); ++i)
 		{
@@ -151,7 +163,7 @@ namespace Util {
 	}
 
 	inline DXGI_FORMAT GetDXGIFormatFromPixelFormat(const GUID* pPixelFormat)
-	{//ȷնӦDXGIʽһ
+	{//查表确定最终对应的DXGI格式是哪一个
 		for (size_t i = 0; i < _countof(g_WICFormats); ++i)
 		{
 			if (InlineIsEqualGUID(g_WICFormats[i].wic, *pPixelFormat))
@@ -7,6 +7,12 @@
 
 #include "DirectXTK12/VertexTypes.h"
 
+#include <DirectXPackedVector.h>
+#include <DirectXCollision.h>
+
+#include <cstddef>
+#include <cstring>
+
 
 struct VertexPositionNormalTangentTexture {
 	VertexPositionNormalTangentTexture() = default;
@@ -48,12 +54,106 @@ struct VertexPositionNormalTangentTexture {
 
 	static const D3D12_INPUT_LAYOUT_DESC InputLayout;
 
+	// 拆分顶点流的布局(见VertexStreams)，Position位于Slot 0，其余属性位于Slot 1
+	static const D3D12_INPUT_LAYOUT_DESC SplitInputLayout;
+	// 只读取Slot 0中的Position
+	static const D3D12_INPUT_LAYOUT_DESC PositionOnlyInputLayout;
+
 private:
 	static constexpr unsigned int InputElementCount = 4;
 	static const D3D12_INPUT_ELEMENT_DESC InputElements[InputElementCount];
+	static const D3D12_INPUT_ELEMENT_DESC SplitInputElements[InputElementCount];
 };
 
 
+// Position的量化参数，解码公式为 position = quantized * Scale + Offset
+struct PositionQuantization {
+	DirectX::XMFLOAT3 Scale = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f);
+	DirectX::XMFLOAT3 Offset = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+	// 以包围盒为量化范围
+	static PositionQuantization FromBounds(const DirectX::BoundingBox& bounds);
+};
+
+// 压缩的顶点格式，共20字节
+// Position: 相对于SubMesh包围盒量化的16位UNORM，w分量未使用
+// Normal/Tangent: 八面体映射(Octahedral Encoding)后的16位SNORM
+// TextureCoordinate: 半精度浮点数
+struct VertexPositionNormalTangentTextureCompact {
+	VertexPositionNormalTangentTextureCompact() = default;
+
+	VertexPositionNormalTangentTextureCompact(const VertexPositionNormalTangentTextureCompact&) = default;
+	VertexPositionNormalTangentTextureCompact& operator=(const VertexPositionNormalTangentTextureCompact&) = default;
+
+	VertexPositionNormalTangentTextureCompact(VertexPositionNormalTangentTextureCompact&&) = default;
+	VertexPositionNormalTangentTextureCompact& operator=(VertexPositionNormalTangentTextureCompact&&) = default;
+
+	static VertexPositionNormalTangentTextureCompact Encode(const VertexPositionNormalTangentTexture& vertex, const PositionQuantization& quantization);
+	static VertexPositionNormalTangentTexture Decode(const VertexPositionNormalTangentTextureCompact& vertex, const PositionQuantization& quantization);
+
+	// 单位向量 <-> 八面体映射坐标，坐标范围为[-1, 1]^2
+	static DirectX::XMFLOAT2 OctahedralEncode(const DirectX::XMFLOAT3& direction);
+	static DirectX::XMFLOAT3 OctahedralDecode(const DirectX::XMFLOAT2& encoded);
+
+	// 编码-解码往返误差的理论上界，导入时的检查与单元测试共用
+	// Position: 每个维度半个量化步长，即Scale / 65535 / 2，另加单精度运算的舍入误差
+	static float PositionErrorBound(float scale, float offset);
+	// Normal/Tangent: 以单位向量之差(弦长)度量
+	static float DirectionErrorBound();
+	// TextureCoordinate: 半精度浮点数的半个ULP，|value| >= 65520时溢出为无穷大，不满足此上界
+	static float TexCoordErrorBound(float value);
+
+	DirectX::PackedVector::XMUSHORTN4 position;
+	DirectX::PackedVector::XMSHORTN2 normal;
+	DirectX::PackedVector::XMSHORTN2 tangent;
+	DirectX::PackedVector::XMHALF2 textureCoordinate;
+
+	static const D3D12_INPUT_LAYOUT_DESC InputLayout;
+
+	// 拆分顶点流的布局(见VertexStreams)，Position位于Slot 0，其余属性位于Slot 1
+	static const D3D12_INPUT_LAYOUT_DESC SplitInputLayout;
+	// 只读取Slot 0中的Position
+	static const D3D12_INPUT_LAYOUT_DESC PositionOnlyInputLayout;
+
+private:
+	static constexpr unsigned int InputElementCount = 4;
+	static const D3D12_INPUT_ELEMENT_DESC InputElements[InputElementCount];
+	static const D3D12_INPUT_ELEMENT_DESC SplitInputElements[InputElementCount];
+};
+
+
+// 上传到GPU的顶点被拆分为两个流，依次存放在同一块Buffer中:
+// [Position * count][对齐][其余属性 * count]
+// Shadow Pass、天空球与光线追踪的BLAS只需要绑定紧密排列的Position流
+template <typename VertexType>
+struct VertexStreams {
+	static constexpr UINT PositionStride = sizeof(VertexType::position);
+	static constexpr UINT AttributeStride = sizeof(VertexType) - PositionStride;
+
+	static UINT AttributeOffset(UINT count) {
+		return (count * PositionStride + 15) & ~15u;
+	}
+
+	static UINT SizeInBytes(UINT count) {
+		return AttributeOffset(count) + count * AttributeStride;
+	}
+
+	// dst需至少有SizeInBytes(count)字节
+	static void Split(void* dst, const VertexType* vertices, UINT count) {
+		static_assert(offsetof(VertexType, position) == 0, "position must be the first member");
+
+		BYTE* positions = reinterpret_cast<BYTE*>(dst);
+		BYTE* attributes = positions + AttributeOffset(count);
+		std::memset(positions + count * PositionStride, 0, AttributeOffset(count) - count * PositionStride);
+
+		for (UINT i = 0; i < count; ++i) {
+			const BYTE* vertex = reinterpret_cast<const BYTE*>(&vertices[i]);
+			std::memcpy(positions + i * PositionStride, vertex, PositionStride);
+			std::memcpy(attributes + i * AttributeStride, vertex + PositionStride, AttributeStride);
+		}
+	}
+};
+
 template <typename VertexType>
 class VertexBuffer {
 public:
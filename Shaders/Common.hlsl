@@ -5,17 +5,32 @@
 
 
 // Constant Buffer
-ConstantBuffer<RenderItemData>  gRenderItemData : register(b0);
+cbuffer DrawConstants : register(b0)
+{
+    uint gInstanceBase; // 本次绘制的实例在gInstanceItems中的起始位置
+};
 ConstantBuffer<PassData>        gPassData : register(b1);
 
 // Texture
 TextureCube gCubeMap : register(t0);
 Texture2D   gShadowMap : register(t1);
-Texture2D   gTextures[128] : register(t2);
+// 无界数组，数量随场景中的纹理增长
+Texture2D   gTextures[] : register(t2);
 
 // MaterialData
 StructuredBuffer<MaterialData> gMaterialData : register(t0, space1);
 
+// RenderItemData与World Matrix: 以RenderItemIndex为索引
+// 实例列表: 每个实例的RenderItemIndex，同一次绘制的实例连续存放
+StructuredBuffer<RenderItemData> gRenderItemData : register(t1, space1);
+StructuredBuffer<uint>           gInstanceItems : register(t2, space1);
+StructuredBuffer<float4x4>       gWorldMatrices : register(t3, space1);
+
+// Clustered Lighting: 光源，每个Cluster的(起始位置, 数量)，以及各Cluster的光源索引
+StructuredBuffer<ClusterLight>   gClusterLights : register(t4, space1);
+StructuredBuffer<uint2>          gLightClusters : register(t5, space1);
+StructuredBuffer<uint>           gLightIndices : register(t6, space1);
+
 // Static Samplers
 SamplerState gSamPointWrap : register(s0);
 SamplerState gSamPointClamp : register(s1);
@@ -26,6 +41,41 @@ SamplerState gSamAnisotropicClamp : register(s5);
 SamplerComparisonState gSamShadow : register(s6);
 
 
+// Compact Vertex Decoding Helper
+// 与VertexPositionNormalTangentTextureCompact::OctahedralDecode相同
+float3 OctahedralDecode(float2 encoded)
+{
+    float3 direction = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+    
+    // 下半球的点沿对角线翻折回中心
+    float t = saturate(-direction.z);
+    direction.xy += (direction.xy >= 0.0f) ? -t : t;
+    
+    return normalize(direction);
+}
+
+// Instancing Helper
+uint GetRenderItemIndex(uint instanceID)
+{
+    return gInstanceItems[gInstanceBase + instanceID];
+}
+
+// Clustered Lighting Helper
+// 与ClusteredLighting的划分相同: 屏幕均分为CLUSTER_COUNT_X * CLUSTER_COUNT_Y个Tile，深度按对数均分
+uint GetClusterIndex(float2 pixel, float viewZ)
+{
+    uint2 tile = min(uint2(pixel * float2(CLUSTER_COUNT_X, CLUSTER_COUNT_Y) * gPassData.InvRenderTargetSize),
+        uint2(CLUSTER_COUNT_X - 1, CLUSTER_COUNT_Y - 1));
+    float slice = log(max(viewZ, gPassData.NearZ)) * gPassData.Lights.ClusterDepthScale + gPassData.Lights.ClusterDepthBias;
+    uint z = min((uint) max(slice, 0.0f), CLUSTER_COUNT_Z - 1);
+    return (z * CLUSTER_COUNT_Y + tile.y) * CLUSTER_COUNT_X + tile.x;
+}
+
+float3 DequantizePosition(float3 quantized, RenderItemData itemData)
+{
+    return quantized * itemData.PositionScale + itemData.PositionOffset;
+}
+
 // Normal Texture Sampling Helper
 float3 NormalSampleToWorldSpace(float3 normalTextureSample, float3 unitNormalW, float3 tangentW)
 {
@@ -12,14 +12,16 @@ struct VertexOut
     float4 PosH : SV_POSITION;
 };
 
-VertexOut VS( VertexIn vin )
+VertexOut VS( VertexIn vin, uint instanceID : SV_InstanceID )
 {
     VertexOut vout;
     vout.PosL = vin.PosL;
     
-    float4 posW = mul(float4(vin.PosL, 1.0f), gRenderItemData.World);
+    uint itemIndex = GetRenderItemIndex(instanceID);
+    float4x4 world = gWorldMatrices[itemIndex];
+    float4 posW = mul(float4(vin.PosL, 1.0f), world);
     
-    // ʼλԶƽ
+    // 令天空球始终位于远平面
     vout.PosH = mul(posW, gPassData.ViewProj).xyww;
     
 	return vout;
@@ -4,9 +4,15 @@
 // Vertex Shader Input/Output Format
 struct VertexIn
 {
+#ifdef COMPACT_VERTEX
+    float4 PosL     : SV_POSITION;
+    float2 NormalL  : NORMAL;
+    float2 TangentU : TANGENT;
+#else
     float3 PosL     : SV_POSITION;
     float3 NormalL  : NORMAL;
     float3 TangentU : TANGENT;
+#endif
     float2 TexCoord : TEXCOORD;
 };
 
@@ -18,32 +24,47 @@ struct VertexOut
     float3 TangentW : TANGENT;
     float2 TexCoord : TEXCOORD0;
     float4 ShadowMapTexCoord : TEXCOORD1;
+    nointerpolation uint MaterialIndex : MATERIAL;
 };
 
 // Vertex Shader
-VertexOut VS( VertexIn vin )
+VertexOut VS( VertexIn vin, uint instanceID : SV_InstanceID )
 {
     VertexOut vout;
     
-    MaterialData matData = gMaterialData[gRenderItemData.MaterialIndex];
+    uint itemIndex = GetRenderItemIndex(instanceID);
+    RenderItemData itemData = gRenderItemData[itemIndex];
+    float4x4 world = gWorldMatrices[itemIndex];
+    MaterialData matData = gMaterialData[itemData.MaterialIndex];
+    vout.MaterialIndex = itemData.MaterialIndex;
+    
+#ifdef COMPACT_VERTEX
+    float3 posL = DequantizePosition(vin.PosL.xyz, itemData);
+    float3 normalL = OctahedralDecode(vin.NormalL);
+    float3 tangentU = OctahedralDecode(vin.TangentU);
+#else
+    float3 posL = vin.PosL;
+    float3 normalL = vin.NormalL;
+    float3 tangentU = vin.TangentU;
+#endif
     
     // World Matrix Transformation
-    float4 posW = mul(float4(vin.PosL, 1.0f), gRenderItemData.World);
+    float4 posW = mul(float4(posL, 1.0f), world);
     vout.PosW = posW.xyz;
     
     // Shadow Mapping
     vout.ShadowMapTexCoord = mul(float4(vout.PosW, 1.0f), gPassData.ShadowTransform);
     
     // Normal Transformation
-    vout.NormalW = mul(vin.NormalL, (float3x3) gRenderItemData.World);
+    vout.NormalW = mul(normalL, (float3x3) world);
     // Tangent Transformation
-    vout.TangentW = mul(vin.TangentU, (float3x3) gRenderItemData.World);
+    vout.TangentW = mul(tangentU, (float3x3) world);
     
     // Homogeneous
     vout.PosH = mul(posW, gPassData.ViewProj);
     
     // Texture Transformation
-    float4 texC = mul(float4(vin.TexCoord, 0.0f, 1.0f), gRenderItemData.TexTransform);
+    float4 texC = mul(float4(vin.TexCoord, 0.0f, 1.0f), itemData.TexTransform);
     vout.TexCoord = mul(texC, matData.MatTransform).xy;
     
     return vout;
@@ -56,7 +77,7 @@ float4 PS(VertexOut pin) : SV_TARGET
     pin.NormalW = normalize(pin.NormalW);
     
     // Get Material
-    MaterialData matData = gMaterialData[gRenderItemData.MaterialIndex];
+    MaterialData matData = gMaterialData[pin.MaterialIndex];
     
     // Sampling
     // Early Clipping
@@ -115,7 +136,7 @@ float4 PS(VertexOut pin) : SV_TARGET
 #endif
     
 #ifdef HAS_SPECULAR_TEXTURE
-    // sponzaеspecularͼΪҶͼһӦΪrgbͼ
+    // sponza场景中的specular贴图为灰度图，一般应为rgb图
     float3 specularTextureSample = gTextures[matData.SpecularTextureIndex].Sample(gSamLinearWrap, pin.TexCoord).xxx;
     float3 fresnelR0 = specularTextureSample;
 #else
@@ -132,9 +153,17 @@ float4 PS(VertexOut pin) : SV_TARGET
         gPassData.Lights,
         mat,
         bumpedNormalW,
-        pin.PosW,
         toCamera,
         shadowFactor);
+    
+    // 像素所在Cluster中的点光源、聚光灯与面光源
+    float viewZ = mul(float4(pin.PosW, 1.0f), gPassData.View).z;
+    uint2 cluster = gLightClusters[GetClusterIndex(pin.PosH.xy, viewZ)];
+    for (uint i = 0; i < cluster.y; ++i)
+    {
+        ClusterLight light = gClusterLights[gLightIndices[cluster.x + i]];
+        directLight.rgb += ComputeClusterLight(light, mat, bumpedNormalW, pin.PosW, toCamera, shadowFactor);
+    }
     float4 ambientLight = gPassData.AmbientLightStrength * diffuseAlbedo;
 
     float4 litColor = directLight + ambientLight;
@@ -10,7 +10,7 @@ struct Material {
 
 // Helper Functions
 float AttenuationFactor(float distance, float AttenuationRange) {
-	// ƽ˥
+	// 平方衰减
     return saturate(1 - distance * distance / (AttenuationRange * AttenuationRange));
 }
 
@@ -132,7 +132,7 @@ float3 ComputePointLight(PointLight light,
     return BlinnPhong(lightStrength, mat, normal, toLight, toCamera);
 }
 
-// ԴģԴ
+// 点光源模拟面光源
 float3 ComputeRectLight(RectLight light,
 	Material mat,
 	float3 normal,
@@ -173,16 +173,54 @@ float3 ComputeSpotLight(SpotLight light,
     return BlinnPhong(lightStrength, mat, normal, toLight, toCamera);
 }
 	
+// Clustered Light: 按类型调用对应的光照函数
+// 面光源作为ShadowMap的光源，乘以阴影系数
+float3 ComputeClusterLight(ClusterLight light,
+    Material mat,
+    float3 normal,
+    float3 pos,
+    float3 toCamera,
+    float3 shadowFactor)
+{
+    if (light.Type == CLUSTER_LIGHT_SPOT)
+    {
+        SpotLight spotLight = (SpotLight) 0;
+        spotLight.Strength = light.Strength;
+        spotLight.AttenuationRange = light.AttenuationRange;
+        spotLight.Direction = light.Direction;
+        spotLight.MaxAngle = light.MaxAngle;
+        spotLight.Position = light.Position;
+        return ComputeSpotLight(spotLight, mat, normal, pos, toCamera);
+    }
+    
+    if (light.Type == CLUSTER_LIGHT_RECT)
+    {
+        RectLight rectLight = (RectLight) 0;
+        rectLight.Strength = light.Strength;
+        rectLight.AttenuationRange = light.AttenuationRange;
+        rectLight.Direction = light.Direction;
+        rectLight.Position = light.Position;
+        rectLight.Rect = light.Rect;
+        return shadowFactor * ComputeRectLight(rectLight, mat, normal, pos, toCamera);
+    }
+    
+    PointLight pointLight = (PointLight) 0;
+    pointLight.Strength = light.Strength;
+    pointLight.AttenuationRange = light.AttenuationRange;
+    pointLight.Position = light.Position;
+    return ComputePointLight(pointLight, mat, normal, pos, toCamera);
+}
+	
 // Lighting
+// 只包括方向光，点光源、聚光灯与面光源按Cluster计算，见Light.hlsl
 float4 ComputeLighting(
     Light lights,
     Material mat,
     float3 normal,
-    float3 pos,
     float3 toCamera,
     float3 shadowFactor)
 {
-// Shadow FactorShadow mapping
+// Shadow Factor用于Shadow mapping
     float3 result = 0.0f;
     
 // Directional Light
@@ -190,24 +228,6 @@ float4 ComputeLighting(
     {
         result += shadowFactor * ComputeDirectionalLight(lights.DirectionalLights[directionalLightIndex], mat, normal, toCamera);
     }
-    
-// Point Light
-    for (uint pointLightIndex = 0; pointLightIndex < lights.NumPointLights; ++pointLightIndex)
-    {
-        result += ComputePointLight(lights.PointLights[pointLightIndex], mat, normal, pos, toCamera);
-    }
-
-// Rect Light
-    for (uint rectLightIndex = 0; rectLightIndex < lights.NumRectLights; ++rectLightIndex)
-    {
-        result += shadowFactor * ComputeRectLight(lights.RectLights[rectLightIndex], mat, normal, pos, toCamera);
-    }
-    
-// Spot Light
-    for (uint i = 0; i < lights.NumSpotLights; ++i)
-    {
-        result += ComputeSpotLight(lights.SpotLights[i], mat, normal, pos, toCamera);
-    }
 
     return float4(result, 0.0f);
 }
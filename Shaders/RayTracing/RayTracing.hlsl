@@ -15,7 +15,7 @@ StructuredBuffer<Vertex> gVertices : register(t2, space0);
 
 float4 TraceRadianceRay(Ray ray, uint currentRecursionDepth)
 {
-    // ݹ
+    // 递归深度限制
     if (currentRecursionDepth >= MAX_RAY_RECURSION_DEPTH)
     {
         return float4(0.0f, 0.0f, 0.0f, 0.0f);
@@ -2,41 +2,59 @@
 #include "Common.hlsl"
 
 
-// ֻʹһVertex Bufferе
+// 只绑定Position流，Alpha Test需要的TexCoord来自属性流
 struct VertexIn
 {
+#ifdef COMPACT_VERTEX
+    float4 PosL : SV_POSITION;
+#else
     float3 PosL : SV_POSITION;
+#endif
+#ifdef HAS_MASK_TEXTURE
     float2 TexCoord : TEXCOORD;
+#endif
 };
 
 struct VertexOut
 {
     float4 PosH : SV_POSITION;
     float2 TexCoord : TEXCOORD;
+    nointerpolation uint MaterialIndex : MATERIAL;
 };
 
-VertexOut VS(VertexIn vin)
+VertexOut VS(VertexIn vin, uint instanceID : SV_InstanceID)
 {
     VertexOut vout = (VertexOut) 0.0f;
 
-    MaterialData matData = gMaterialData[gRenderItemData.MaterialIndex];
+    uint itemIndex = GetRenderItemIndex(instanceID);
+    RenderItemData itemData = gRenderItemData[itemIndex];
+    float4x4 world = gWorldMatrices[itemIndex];
+    MaterialData matData = gMaterialData[itemData.MaterialIndex];
+    vout.MaterialIndex = itemData.MaterialIndex;
 	
     // Transform to world space.
-    float4 posW = mul(float4(vin.PosL, 1.0f), gRenderItemData.World);
+#ifdef COMPACT_VERTEX
+    float3 posL = DequantizePosition(vin.PosL.xyz, itemData);
+#else
+    float3 posL = vin.PosL;
+#endif
+    float4 posW = mul(float4(posL, 1.0f), world);
 
     // Transform to homogeneous clip space.
     vout.PosH = mul(posW, gPassData.ViewProj);
 	
+#ifdef HAS_MASK_TEXTURE
 	// Output vertex attributes for interpolation across triangle.
-    float4 texC = mul(float4(vin.TexCoord, 0.0f, 1.0f), gRenderItemData.TexTransform);
+    float4 texC = mul(float4(vin.TexCoord, 0.0f, 1.0f), itemData.TexTransform);
     vout.TexCoord = mul(texC, matData.MatTransform).xy;
+#endif
 	
     return vout;
 }
 
 void PS(VertexOut pin)
 {
-    MaterialData matData = gMaterialData[gRenderItemData.MaterialIndex];
+    MaterialData matData = gMaterialData[pin.MaterialIndex];
 #ifdef HAS_MASK_TEXTURE
     float alpha = gTextures[matData.MaskTextureIndex].Sample(gSamPointWrap, pin.TexCoord).r;
     clip(alpha - 0.1);
@@ -39,11 +39,11 @@ void BoxApp::BuildBoxGeometry() {
 	*           /|      /|              |   > z
 	*		   1-------2 |              |  /
 	*          | 4-----|-7              | /
-	*          |/      |/               0-------> x ϵ
-	*          0-------3                ֯ʱעⷨ
+	*          |/      |/               0-------> x 左手坐标系
+	*          0-------3                组织三角面时注意法向量朝向
 	*/
 
-	// vertexindex
+	// 创建vertex与index
 	std::array<Vertex, 8> vertices = {
 		Vertex{ XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT4(Colors::White) },
 		Vertex{ XMFLOAT3(-1.0f, +1.0f, -1.0f), XMFLOAT4(Colors::Black) },
@@ -81,7 +81,7 @@ void BoxApp::BuildBoxGeometry() {
 		0, 7, 4
 	};
 
-	// Vertex BufferIndex Buffer
+	// 设置Vertex Buffer与Index Buffer
 	const UINT vbSizeInBytes = (UINT)vertices.size() * sizeof(Vertex);
 	const UINT ibSizeInBytes = (UINT)indices.size() * sizeof(std::uint16_t);
 
@@ -119,7 +119,7 @@ void BoxApp::BuildBoxGeometry() {
 }
 
 void BoxApp::BuildConstantBuffer() {
-	// CBV
+	// 创建CBV描述符堆
 	D3D12_DESCRIPTOR_HEAP_DESC cbvHeapDesc;
 	cbvHeapDesc.NumDescriptors = 1;
 	cbvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
@@ -128,11 +128,11 @@ void BoxApp::BuildConstantBuffer() {
 
 	ThrowIfFailed(mDevice->CreateDescriptorHeap(&cbvHeapDesc, IID_PPV_ARGS(&mCbvHeap)));
 
-	// Constant BufferԴ
+	// 创建Constant Buffer资源
 	mObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(mDevice.Get(), 1, true);
 
 
-	// Constant Buffer
+	// 创建Constant Buffer描述符，并将其加入描述符堆
 	D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc;
 	cbvDesc.BufferLocation = mObjectCB->GetBufferPointer();
 	cbvDesc.SizeInBytes = mObjectCB->GetBufferSize();
@@ -175,15 +175,15 @@ void BoxApp::BuildShadersAndInputLayout() {
 }
 
 void BoxApp::BuildRootSignature() {
-	// б
+	// 创建根参数列表
 	CD3DX12_ROOT_PARAMETER slotRootParameter[1];
 
-	// 
+	// 将描述符表填入根参数
 	CD3DX12_DESCRIPTOR_RANGE cbvTable;
 	cbvTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0);
 	slotRootParameter[0].InitAsDescriptorTable(1, &cbvTable);
 
-	// л
+	// 序列化根参数
 	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(1, slotRootParameter,
 		0, nullptr,
 		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
@@ -197,7 +197,7 @@ void BoxApp::BuildRootSignature() {
 		errorBlob.GetAddressOf()
 	));
 
-	// ǩ
+	// 创建根签名
 	ThrowIfFailed(mDevice->CreateRootSignature(
 		0,
 		serializedRootSig->GetBufferPointer(),
@@ -238,13 +238,13 @@ void BoxApp::BuildPSO() {
 	psoDesc.RTVFormats[0] = mBackBufferFormat;
 	psoDesc.DSVFormat = mDepthStencilFormat;
 
-	// PSO
+	// 创建PSO
 	ThrowIfFailed(mDevice->CreateGraphicsPipelineState(
 		&psoDesc,
 		IID_PPV_ARGS(&mPSOs["Solid"])
 	));
 
-	// WireFrame PSO
+	// 创建WireFrame PSO
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC wireFramePsoDesc = psoDesc;
 	wireFramePsoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
 	ThrowIfFailed(mDevice->CreateGraphicsPipelineState(
@@ -266,7 +266,7 @@ void BoxApp::OnResize() {
 }
 
 void BoxApp::Update(const GameTimer& gt) {
-	// MVP
+	// 设置MVP
 	XMMATRIX model = XMLoadFloat4x4(&mModel);
 	XMMATRIX view = XMLoadFloat4x4(&mView);
 	XMMATRIX proj = XMLoadFloat4x4(&mProj);
@@ -305,7 +305,7 @@ void BoxApp::Draw(const GameTimer& gt) {
 	mCommandList->RSSetViewports(1, &mViewPort);
 	mCommandList->RSSetScissorRects(1, &mScissorRect);
 
-	// Եǰ̨״̬ת
+	// 对当前后台缓冲区的状态做转换
 	D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
 		CurrentBackBuffer(),
 		D3D12_RESOURCE_STATE_PRESENT,
@@ -313,7 +313,7 @@ void BoxApp::Draw(const GameTimer& gt) {
 	);
 	mCommandList->ResourceBarrier(1, &barrier);
 
-	// ڻǰ
+	// 在绘制前进行清空
 	mCommandList->ClearRenderTargetView(
 		CurrentBackBufferView(), 
 		Colors::LightSteelBlue, 
@@ -327,7 +327,7 @@ void BoxApp::Draw(const GameTimer& gt) {
 		0, 
 		nullptr);
 
-	// Output Merge׶ε
+	// 设置Output Merge阶段的输出缓冲区
 	D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = CurrentBackBufferView();
 	D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = DepthStencilView();
 	mCommandList->OMSetRenderTargets(
@@ -337,11 +337,11 @@ void BoxApp::Draw(const GameTimer& gt) {
 		&dsvHandle
 	);
 
-	// Shader-visible
+	// 绑定Shader-visible的描述符堆
 	ID3D12DescriptorHeap* descriptorHeaps[] = { mCbvHeap.Get() };
 	mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 
-	// Vertex BufferIndex BufferPrimitive Topology
+	// 设置Vertex Buffer、Index Buffer、Primitive Topology
 	D3D12_VERTEX_BUFFER_VIEW vbv = mBoxGeo->VertexBufferView();
 	mCommandList->IASetVertexBuffers(0, 1, &vbv);
 
@@ -350,12 +350,12 @@ void BoxApp::Draw(const GameTimer& gt) {
 
 	mCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-	// øǩԴ
+	// 设置根签名并绑定资源
 	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
 
 	mCommandList->SetGraphicsRootDescriptorTable(0, mCbvHeap->GetGPUDescriptorHandleForHeapStart());
 
-	// ƣ
+	// 绘制！
 	mCommandList->DrawIndexedInstanced(mBoxGeo->DrawArgs["box"].IndexCount, 1, 0, 0, 0);
 	//mCommandList->DrawInstanced(8, 1, 0, 0);
 
@@ -365,7 +365,7 @@ void BoxApp::Draw(const GameTimer& gt) {
 	ImDrawData* a = ImGui::GetDrawData();
 	ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), mCommandList.Get());
 
-	// Եǰ̨״̬ת 
+	// 对当前后台缓冲区的状态做转换 
 	D3D12_RESOURCE_BARRIER barrier2 = CD3DX12_RESOURCE_BARRIER::Transition(
 		CurrentBackBuffer(),
 		D3D12_RESOURCE_STATE_RENDER_TARGET,
@@ -396,7 +396,7 @@ void BoxApp::OnMouseUp(WPARAM btnState, int x, int y) {
 }
 
 void BoxApp::OnMouseMove(WPARAM btnState, int x, int y) {
-	// ת
+	// 左键旋转
 	if ((btnState & MK_LBUTTON) != 0) {
 		//float rotScale = 0.25f;
 		//float dTheta = XMConvertToRadians(rotScale * static_cast<float>(y - mLastMousePos.y));
@@ -405,7 +405,7 @@ void BoxApp::OnMouseMove(WPARAM btnState, int x, int y) {
 		//mCamera.Update(dTheta, dPhi);
 		//mView = mCamera.ViewMatrix();
 	}
-	// Ҽ
+	// 右键放缩
 	else if ((btnState & MK_RBUTTON) != 0) {
 		//float magScale = 0.005f;
 		//float dx = magScale * static_cast<float>(x - mLastMousePos.x);
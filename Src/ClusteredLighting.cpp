@@ -0,0 +1,344 @@
+#include "ClusteredLighting.h"
+#include "ThreadPool.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+static_assert(CLUSTER_COUNT_X % 4 == 0, "a row of clusters is tested 4 at a time");
+
+namespace {
+	// 按1.5倍扩容，至少满足required
+	inline UINT GrowCapacity(UINT capacity, UINT required) {
+		return (std::max)(required, capacity + capacity / 2);
+	}
+}
+
+ClusteredLighting::ClusteredLighting(ID3D12Device* device)
+	: mDevice(device) {
+	mLightsGPU = std::make_unique<UploadBuffer<ClusterLight>>(device, InitialLightCapacity, false);
+	mClustersGPU = std::make_unique<UploadBuffer<XMUINT2>>(device, ClusterCount, false);
+	mLightIndicesGPU = std::make_unique<UploadBuffer<UINT>>(device, InitialLightIndexCapacity, false);
+
+	mClusterOffsets.resize(ClusterCount);
+	mClusterRanges.resize(ClusterCount);
+
+	XMStoreFloat4x4(&mProj, XMMatrixIdentity());
+	XMStoreFloat4x4(&mView, XMMatrixIdentity());
+}
+
+UINT ClusteredLighting::AddLight(const ClusterLight& light) {
+	mLights.push_back(light);
+	mLightsDirty = true;
+	return static_cast<UINT>(mLights.size() - 1);
+}
+
+UINT ClusteredLighting::AddPointLight(const PointLight& light) {
+	ClusterLight clusterLight = {};
+	clusterLight.Strength = light.Strength;
+	clusterLight.AttenuationRange = light.AttenuationRange;
+	clusterLight.Position = light.Position;
+	clusterLight.Type = CLUSTER_LIGHT_POINT;
+	return AddLight(clusterLight);
+}
+
+UINT ClusteredLighting::AddSpotLight(const SpotLight& light) {
+	ClusterLight clusterLight = {};
+	clusterLight.Strength = light.Strength;
+	clusterLight.AttenuationRange = light.AttenuationRange;
+	clusterLight.Position = light.Position;
+	clusterLight.Type = CLUSTER_LIGHT_SPOT;
+	clusterLight.Direction = light.Direction;
+	clusterLight.MaxAngle = light.MaxAngle;
+	return AddLight(clusterLight);
+}
+
+UINT ClusteredLighting::AddRectLight(const RectLight& light) {
+	ClusterLight clusterLight = {};
+	clusterLight.Strength = light.Strength;
+	clusterLight.AttenuationRange = light.AttenuationRange;
+	clusterLight.Position = light.Position;
+	clusterLight.Type = CLUSTER_LIGHT_RECT;
+	clusterLight.Direction = light.Direction;
+	clusterLight.Rect = light.Rect;
+	return AddLight(clusterLight);
+}
+
+void ClusteredLighting::WriteConstants(Light& lights) const {
+	lights.ClusterDepthScale = mDepthScale;
+	lights.ClusterDepthBias = mDepthBias;
+	lights.NumClusterLights = LightCount();
+}
+
+void ClusteredLighting::BuildClusterBounds(CXMMATRIX proj, float nearZ, float farZ) {
+	XMStoreFloat4x4(&mProj, proj);
+	mNearZ = nearZ;
+	mFarZ = farZ;
+	mHasProjection = true;
+
+	// 切片k的深度范围为[near * (far / near)^(k / Z), near * (far / near)^((k + 1) / Z)]
+	const float logRatio = std::log(farZ / nearZ);
+	mDepthScale = CLUSTER_COUNT_Z / logRatio;
+	mDepthBias = -CLUSTER_COUNT_Z * std::log(nearZ) / logRatio;
+	for (UINT z = 0; z < CLUSTER_COUNT_Z; ++z) {
+		mSliceNear[z] = nearZ * std::pow(farZ / nearZ, static_cast<float>(z) / CLUSTER_COUNT_Z);
+		mSliceFar[z] = nearZ * std::pow(farZ / nearZ, static_cast<float>(z + 1) / CLUSTER_COUNT_Z);
+	}
+	mSliceFar[CLUSTER_COUNT_Z - 1] = farZ;
+
+	for (std::vector<float>* component : { &mMinX, &mMinY, &mMinZ, &mMaxX, &mMaxY, &mMaxZ, &mCenterX, &mCenterY, &mCenterZ, &mRadius }) {
+		component->resize(ClusterCount);
+	}
+
+	// 透视投影下深度z处的NDC x为x * _11 / z，Tile在深度z处的范围为ndc * z / _11
+	const float invP00 = 1.0f / mProj._11;
+	const float invP11 = 1.0f / mProj._22;
+	for (UINT z = 0; z < CLUSTER_COUNT_Z; ++z) {
+		const float z0 = mSliceNear[z], z1 = mSliceFar[z];
+		for (UINT y = 0; y < CLUSTER_COUNT_Y; ++y) {
+			// Tile的行自屏幕顶端开始，NDC y向上
+			const float ndcTop = 1.0f - 2.0f * y / CLUSTER_COUNT_Y;
+			const float ndcBottom = 1.0f - 2.0f * (y + 1) / CLUSTER_COUNT_Y;
+			for (UINT x = 0; x < CLUSTER_COUNT_X; ++x) {
+				const float ndcLeft = -1.0f + 2.0f * x / CLUSTER_COUNT_X;
+				const float ndcRight = -1.0f + 2.0f * (x + 1) / CLUSTER_COUNT_X;
+
+				const UINT i = (z * CLUSTER_COUNT_Y + y) * CLUSTER_COUNT_X + x;
+				mMinX[i] = (std::min)(ndcLeft * z0, ndcLeft * z1) * invP00;
+				mMaxX[i] = (std::max)(ndcRight * z0, ndcRight * z1) * invP00;
+				mMinY[i] = (std::min)(ndcBottom * z0, ndcBottom * z1) * invP11;
+				mMaxY[i] = (std::max)(ndcTop * z0, ndcTop * z1) * invP11;
+				mMinZ[i] = z0;
+				mMaxZ[i] = z1;
+
+				// 聚光灯的圆锥以Cluster的包围球测试
+				const float extentX = 0.5f * (mMaxX[i] - mMinX[i]);
+				const float extentY = 0.5f * (mMaxY[i] - mMinY[i]);
+				const float extentZ = 0.5f * (z1 - z0);
+				mCenterX[i] = mMinX[i] + extentX;
+				mCenterY[i] = mMinY[i] + extentY;
+				mCenterZ[i] = z0 + extentZ;
+				mRadius[i] = std::sqrt(extentX * extentX + extentY * extentY + extentZ * extentZ);
+			}
+		}
+	}
+}
+
+UINT ClusteredLighting::DepthSlice(float viewZ) const {
+	if (viewZ <= mNearZ) {
+		return 0;
+	}
+	const float slice = std::floor(std::log(viewZ) * mDepthScale + mDepthBias);
+	return static_cast<UINT>(std::clamp(slice, 0.0f, static_cast<float>(CLUSTER_COUNT_Z - 1)));
+}
+
+void ClusteredLighting::BinLight(UINT lightIndex, FXMMATRIX view, std::vector<ClusterLightPair>& pairs) const {
+	const ClusterLight& light = mLights[lightIndex];
+	const float range = light.AttenuationRange;
+
+	XMVECTOR position = XMVector3TransformCoord(XMLoadFloat3(&light.Position), view);
+
+	// 影响范围的包围球: 点光源与面光源(Shader中视为点光源)为以Range为半径的球
+	// 张角不超过90°的聚光灯取圆锥的包围球，并在Cluster中再做圆锥测试
+	XMVECTOR center = position;
+	float radius = range;
+	bool isCone = light.Type == CLUSTER_LIGHT_SPOT && light.MaxAngle < XM_PIDIV2;
+	XMVECTOR direction = XMVectorZero();
+	float sinAngle = 0.0f, cosAngle = 1.0f;
+	if (isCone) {
+		direction = XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&light.Direction), view));
+		XMScalarSinCos(&sinAngle, &cosAngle, light.MaxAngle);
+		if (light.MaxAngle > XM_PIDIV4) {
+			center = XMVectorMultiplyAdd(direction, XMVectorReplicate(cosAngle * range), position);
+			radius = sinAngle * range;
+		}
+		else {
+			radius = range / (2.0f * cosAngle);
+			center = XMVectorMultiplyAdd(direction, XMVectorReplicate(radius), position);
+		}
+	}
+
+	XMFLOAT3 c;
+	XMStoreFloat3(&c, center);
+	if (c.z + radius <= mNearZ || c.z - radius >= mFarZ) {
+		return;
+	}
+
+	const XMVECTOR centerX = XMVectorReplicate(c.x);
+	const XMVECTOR centerY = XMVectorReplicate(c.y);
+	const XMVECTOR centerZ = XMVectorReplicate(c.z);
+	const XMVECTOR radiusSq = XMVectorReplicate(radius * radius);
+	const XMVECTOR zero = XMVectorZero();
+
+	XMFLOAT3 apex;
+	XMStoreFloat3(&apex, position);
+	XMFLOAT3 axis;
+	XMStoreFloat3(&axis, direction);
+
+	const UINT firstSlice = DepthSlice((std::max)(c.z - radius, mNearZ));
+	const UINT lastSlice = DepthSlice((std::min)(c.z + radius, mFarZ));
+	for (UINT z = firstSlice; z <= lastSlice; ++z) {
+		// 球在该切片中的深度范围，其x、y范围投影后取端点的最值即为保守的Tile范围
+		const float z0 = (std::max)(mSliceNear[z], c.z - radius);
+		const float z1 = (std::min)(mSliceFar[z], c.z + radius);
+		const float ndcMinX = (std::min)((c.x - radius) / z0, (c.x - radius) / z1) * mProj._11;
+		const float ndcMaxX = (std::max)((c.x + radius) / z0, (c.x + radius) / z1) * mProj._11;
+		const float ndcMinY = (std::min)((c.y - radius) / z0, (c.y - radius) / z1) * mProj._22;
+		const float ndcMaxY = (std::max)((c.y + radius) / z0, (c.y + radius) / z1) * mProj._22;
+		if (ndcMaxX < -1.0f || ndcMinX > 1.0f || ndcMaxY < -1.0f || ndcMinY > 1.0f) {
+			continue;
+		}
+
+		auto TileIndex = [](float t, UINT count) {
+			return static_cast<UINT>(std::clamp(std::floor(t * count), 0.0f, static_cast<float>(count - 1)));
+		};
+		const UINT firstX = TileIndex(0.5f * ndcMinX + 0.5f, CLUSTER_COUNT_X);
+		const UINT lastX = TileIndex(0.5f * ndcMaxX + 0.5f, CLUSTER_COUNT_X);
+		const UINT firstY = TileIndex(0.5f - 0.5f * ndcMaxY, CLUSTER_COUNT_Y);
+		const UINT lastY = TileIndex(0.5f - 0.5f * ndcMinY, CLUSTER_COUNT_Y);
+
+		for (UINT y = firstY; y <= lastY; ++y) {
+			const UINT rowBase = (z * CLUSTER_COUNT_Y + y) * CLUSTER_COUNT_X;
+			for (UINT x = firstX & ~3u; x <= lastX; x += 4) {
+				const UINT i = rowBase + x;
+
+				// 球与AABB: 各轴上球心到AABB的距离
+				XMVECTOR dx = XMVectorMax(XMVectorMax(XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mMinX[i])), centerX),
+					XMVectorSubtract(centerX, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mMaxX[i])))), zero);
+				XMVECTOR dy = XMVectorMax(XMVectorMax(XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mMinY[i])), centerY),
+					XMVectorSubtract(centerY, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mMaxY[i])))), zero);
+				XMVECTOR dz = XMVectorMax(XMVectorMax(XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mMinZ[i])), centerZ),
+					XMVectorSubtract(centerZ, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mMaxZ[i])))), zero);
+				XMVECTOR distanceSq = XMVectorMultiplyAdd(dx, dx, XMVectorMultiplyAdd(dy, dy, XMVectorMultiply(dz, dz)));
+				XMVECTOR inside = XMVectorLessOrEqual(distanceSq, radiusSq);
+
+				if (isCone) {
+					// 圆锥与Cluster的包围球: 球心到圆锥侧面的距离，以及沿轴向位于顶点之后或Range之外
+					XMVECTOR clusterRadius = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mRadius[i]));
+					XMVECTOR vx = XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mCenterX[i])), XMVectorReplicate(apex.x));
+					XMVECTOR vy = XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mCenterY[i])), XMVectorReplicate(apex.y));
+					XMVECTOR vz = XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mCenterZ[i])), XMVectorReplicate(apex.z));
+					XMVECTOR lengthSq = XMVectorMultiplyAdd(vx, vx, XMVectorMultiplyAdd(vy, vy, XMVectorMultiply(vz, vz)));
+					XMVECTOR axial = XMVectorMultiplyAdd(vx, XMVectorReplicate(axis.x),
+						XMVectorMultiplyAdd(vy, XMVectorReplicate(axis.y), XMVectorMultiply(vz, XMVectorReplicate(axis.z))));
+					XMVECTOR lateral = XMVectorSqrt(XMVectorMax(XMVectorSubtract(lengthSq, XMVectorMultiply(axial, axial)), zero));
+					XMVECTOR closest = XMVectorSubtract(XMVectorMultiply(lateral, XMVectorReplicate(cosAngle)),
+						XMVectorMultiply(axial, XMVectorReplicate(sinAngle)));
+
+					inside = XMVectorAndInt(inside, XMVectorLessOrEqual(closest, clusterRadius));
+					inside = XMVectorAndInt(inside, XMVectorLessOrEqual(axial, XMVectorAdd(clusterRadius, XMVectorReplicate(range))));
+					inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(axial, XMVectorNegate(clusterRadius)));
+				}
+
+				XMUINT4 mask;
+				XMStoreUInt4(&mask, inside);
+				const UINT lanes[4] = { mask.x, mask.y, mask.z, mask.w };
+				for (UINT lane = 0; lane < 4; ++lane) {
+					if (lanes[lane] != 0 && x + lane >= firstX && x + lane <= lastX) {
+						pairs.push_back({ i + lane, lightIndex });
+					}
+				}
+			}
+		}
+	}
+}
+
+void ClusteredLighting::Update(FXMMATRIX view, CXMMATRIX proj, float nearZ, float farZ) {
+	const INT64 start = Util::QueryTimestamp();
+	mUploadedBytes = 0;
+
+	XMFLOAT4X4 newView, newProj;
+	XMStoreFloat4x4(&newView, view);
+	XMStoreFloat4x4(&newProj, proj);
+
+	const bool projectionChanged = !mHasProjection || nearZ != mNearZ || farZ != mFarZ ||
+		std::memcmp(&newProj, &mProj, sizeof(XMFLOAT4X4)) != 0;
+	const bool viewChanged = std::memcmp(&newView, &mView, sizeof(XMFLOAT4X4)) != 0;
+	if (!projectionChanged && !viewChanged && !mLightsDirty) {
+		mUpdateMs = Util::MillisecondsSince(start);
+		return;
+	}
+	if (projectionChanged) {
+		BuildClusterBounds(proj, nearZ, farZ);
+	}
+	mView = newView;
+
+	// 光源只在增加后上传，每次都写入全部光源，扩容时不必保留原有内容
+	if (mLightsDirty) {
+		mLightsDirty = false;
+		if (mLightsGPU->Grow(mDevice, GrowCapacity(mLightsGPU->ElementCount(), LightCount()), false, mRetiredBuffers)) {
+			Util::DebugLog("[ClusteredLighting] Light capacity: %u\n", mLightsGPU->ElementCount());
+			mCapacityGrowths++;
+		}
+		std::memcpy(mLightsGPU->MappedData(), mLights.data(), mLights.size() * sizeof(ClusterLight));
+		mUploadedBytes += mLights.size() * sizeof(ClusterLight);
+	}
+
+	// 1. 光源按组并行分配，每组的结果按光源的顺序排列
+	const UINT groupSize = 64;
+	const UINT groupCount = (LightCount() + groupSize - 1) / groupSize;
+	mGroupPairs.resize(groupCount);
+	ThreadPool::Get().ParallelFor(groupCount, 1, [&](size_t begin, size_t end) {
+		for (size_t group = begin; group < end; ++group) {
+			std::vector<ClusterLightPair>& pairs = mGroupPairs[group];
+			pairs.clear();
+			const UINT lastLight = (std::min)(static_cast<UINT>((group + 1) * groupSize), LightCount());
+			for (UINT lightIndex = static_cast<UINT>(group * groupSize); lightIndex < lastLight; ++lightIndex) {
+				BinLight(lightIndex, view, pairs);
+			}
+		}
+	});
+
+	// 2. 按Cluster计数并求前缀和，再按组的顺序分散，各Cluster中的光源索引保持升序
+	std::fill(mClusterOffsets.begin(), mClusterOffsets.end(), 0);
+	for (const std::vector<ClusterLightPair>& pairs : mGroupPairs) {
+		for (const ClusterLightPair& pair : pairs) {
+			mClusterOffsets[pair.Cluster]++;
+		}
+	}
+
+	UINT offset = 0;
+	mMaxClusterLights = 0;
+	for (UINT cluster = 0; cluster < ClusterCount; ++cluster) {
+		const UINT count = mClusterOffsets[cluster];
+		mMaxClusterLights = (std::max)(mMaxClusterLights, count);
+		mClusterOffsets[cluster] = offset;
+		mClusterRanges[cluster] = XMUINT2(offset, count);
+		offset += count;
+	}
+	mLightIndexCount = offset;
+
+	mLightIndices.resize(mLightIndexCount);
+	for (const std::vector<ClusterLightPair>& pairs : mGroupPairs) {
+		for (const ClusterLightPair& pair : pairs) {
+			mLightIndices[mClusterOffsets[pair.Cluster]++] = pair.Light;
+		}
+	}
+
+	// 3. 超出MaxLightIndices的部分舍弃，位于末尾(较远)的Cluster先被截断；未超出时按需扩容
+	mDroppedIndices = 0;
+	const UINT requiredIndices = (std::min)(mLightIndexCount, MaxLightIndices);
+	if (mLightIndicesGPU->Grow(mDevice, GrowCapacity(mLightIndicesGPU->ElementCount(), requiredIndices), false, mRetiredBuffers)) {
+		Util::DebugLog("[ClusteredLighting] Light index capacity: %u\n", mLightIndicesGPU->ElementCount());
+		mCapacityGrowths++;
+	}
+	if (mLightIndexCount > MaxLightIndices) {
+		for (XMUINT2& range : mClusterRanges) {
+			const UINT kept = range.x >= MaxLightIndices ? 0 : (std::min)(range.y, MaxLightIndices - range.x);
+			mDroppedIndices += range.y - kept;
+			range.y = kept;
+		}
+		Util::DebugLog("[ClusteredLighting] %u light indices exceed the limit (%u), %u dropped\n",
+			mLightIndexCount, MaxLightIndices, mDroppedIndices);
+	}
+
+	const UINT uploadedIndices = mLightIndexCount - mDroppedIndices;
+	std::memcpy(mClustersGPU->MappedData(), mClusterRanges.data(), ClusterCount * sizeof(XMUINT2));
+	std::memcpy(mLightIndicesGPU->MappedData(), mLightIndices.data(), uploadedIndices * sizeof(UINT));
+	mUploadedBytes += ClusterCount * sizeof(XMUINT2) + uploadedIndices * sizeof(UINT);
+
+	mUpdateMs = Util::MillisecondsSince(start);
+}
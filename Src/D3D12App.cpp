@@ -9,7 +9,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 }
 
 
-// ڡϢ
+// “关于”框的消息处理程序。
 INT_PTR CALLBACK About(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam)
 {
 	UNREFERENCED_PARAMETER(lParam);
@@ -55,11 +55,11 @@ D3D12App* D3D12App::GetApp() {
 	return mApp;
 }
 
-// Ϣѭ
+// 消息循环
 int D3D12App::Run() {
 	MSG msg = { 0 };
 
-	// Ϣѭʱüʱ
+	// 进入消息循环时，重置计时器
 	mTimer.Reset();
 
 	while (msg.message != WM_QUIT) {
@@ -105,7 +105,7 @@ LRESULT D3D12App::MsgProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 
 	switch (msg)
 	{
-	// ȡʱ
+	// 激活或取消激活时
 	case WM_ACTIVATE: { 
 		if (LOWORD(wParam) == WA_INACTIVE) {
 			//mAppPaused = true;
@@ -117,7 +117,7 @@ LRESULT D3D12App::MsgProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 		}
 	}
 	break;
-	// ڳߴ
+	// 窗口尺寸调整
 	case WM_ENTERSIZEMOVE: {
 		mAppPaused = true;
 		mResizing = true;
@@ -164,7 +164,7 @@ LRESULT D3D12App::MsgProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 		}
 	}
 	break;
-	// ƶ
+	// 鼠标移动处理
 	case WM_LBUTTONDOWN:
 	case WM_MBUTTONDOWN:
 	case WM_RBUTTONDOWN:
@@ -178,7 +178,7 @@ LRESULT D3D12App::MsgProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 	case WM_MOUSEMOVE:
 		OnMouseMove(wParam, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
 		break;
-	// 봦
+	// 键盘输入处理
 	case WM_KEYDOWN:
 		OnKeyDown(static_cast<UINT>(wParam));
 		break;
@@ -192,7 +192,7 @@ LRESULT D3D12App::MsgProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 	case WM_COMMAND:
 	{
 		int wmId = LOWORD(wParam);
-		// ˵ѡ:
+		// 分析菜单选择:
 		switch (wmId)
 		{
 		case IDM_ABOUT:
@@ -210,7 +210,7 @@ LRESULT D3D12App::MsgProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 	{
 		PAINTSTRUCT ps;
 		HDC hdc = BeginPaint(hWnd, &ps);
-		// TODO: ڴ˴ʹ hdc κλͼ...
+		// TODO: 在此处添加使用 hdc 的任何绘图代码...
 		EndPaint(hWnd, &ps);
 	}
 	break;
@@ -248,9 +248,9 @@ bool D3D12App::InitMainWindow() {
 	}
 	
 	// Creation
-	// ӦóʹõķΧС㴰ڴС
+	// 根据应用程序使用的范围大小计算窗口大小
 	RECT R = { 0, 0, mClientWidth, mClientHeight };
-	AdjustWindowRect(&R, WS_OVERLAPPEDWINDOW, false); // һΪǷӵв˵
+	AdjustWindowRect(&R, WS_OVERLAPPEDWINDOW, false); // 最后一个参数为是否拥有菜单栏
 	int width = R.right - R.left, height = R.bottom - R.top;
 
 	mhMainWindow = CreateWindowW(
@@ -330,19 +330,19 @@ void D3D12App::OnResize() {
 	assert(mDevice);
 	assert(mSwapChain);
 	assert(mCommandAllocator);
-	// ڸıǰȵȴCommandQueueеִ
+	// 在改变配置前先等待CommandQueue中的命令执行完毕
 	FlushCommandQueue();
 
-	// ִExecuteCommandListsResetڴ棬עʱCommandList봦Close״̬
+	// 已执行ExecuteCommandLists，Reset复用内存，注意调用这条命令时CommandList必须处于Close状态
 	ThrowIfFailed(mCommandList->Reset(mCommandAllocator.Get(), nullptr));
 
-	// ͷ֮ǰĻԴ
+	// 释放之前的缓冲区资源
 	for (int i = 0; i < swapChainBufferCount; ++i) {
 		mSwapChainBuffer[i].Reset();
 	}
 	mDepthStencilBuffer.Reset();
 
-	// BackBufferС
+	// 调整BackBuffer大小
 	ThrowIfFailed(mSwapChain->ResizeBuffers(
 		swapChainBufferCount,
 		mClientWidth,
@@ -357,23 +357,23 @@ void D3D12App::OnResize() {
 	CreateDepthStencilView();
 	CreateMsaaRenderTargetView();
 
-	// رCommandListCommandQueue
+	// 关闭CommandList，送入CommandQueue
 	ThrowIfFailed(mCommandList->Close());
 	ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
 	mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
 
 	FlushCommandQueue();
 
-	// µӿںͲü 
+	// 设置新的视口和裁剪矩形 
 	SetViewPortAndScissorRect();
 }
 
 void D3D12App::CalculateFrameStats() {
-	// ÿͳһFPS
+	// 每秒统计一次FPS
 	static int frameCount = 0;
 	static float timeElapsed = 0.0f;
 
-	// ÿһλƣͻ˺
+	// 每进行一次绘制，就会进入此函数
 	frameCount++;
 
 	if (mTimer.TotalTime() - timeElapsed >= 1.0f) {
@@ -426,11 +426,11 @@ void D3D12App::CreateDevice() {
 		IID_PPV_ARGS(&mdxgiFactory)
 	));
 
-	// ʾԿϢ
+	// 显示本机显卡信息
 	LogAdapters();
 
-	// IDXGIFactory6ṩEnumAdapterByGpuPreference,
-	// ԸѡʵԿ
+	// IDXGIFactory6提供了EnumAdapterByGpuPreference方法,
+	// 可以根据需求选择合适的显卡
 	ComPtr<IDXGIAdapter> pAdapter = nullptr;
 	ThrowIfFailed(mdxgiFactory->EnumAdapterByGpuPreference(
 		0,
@@ -449,7 +449,7 @@ void D3D12App::CreateDevice() {
 void D3D12App::CreateFence() {
 	ThrowIfFailed(mDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mFence)));
 
-	// descriptorС
+	// 设置descriptor大小
 	mRtvDescriptorSize = mDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
 	mDsvDescriptorSize = mDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
 	mCbvSrvUavDescriptorSize = mDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
@@ -492,12 +492,12 @@ void D3D12App::CreateCommandQueueAndList() {
 		IID_PPV_ARGS(&mCommandList)
 	));
 
-	// 뱣֤CommandList֮䴦Close״̬ܵReset
+	// 必须保证创建完CommandList之后其处于Close状态，这样才能调用Reset方法
 	ThrowIfFailed(mCommandList->Close());
 }
 
 void D3D12App::CreateSwapChain() {
-	// ڴ½ǰپɵĽ
+	// 在创建新交换链前，先销毁旧的交换链
 	mSwapChain.Reset();
 
 	DXGI_SWAP_CHAIN_DESC swapChainDesc;
@@ -509,7 +509,7 @@ void D3D12App::CreateSwapChain() {
 	swapChainDesc.BufferDesc.ScanlineOrdering = DXGI_MODE_SCANLINE_ORDER_UNSPECIFIED;
 	swapChainDesc.BufferDesc.Scaling = DXGI_MODE_SCALING_UNSPECIFIED;
 
-	// DirectX 12֧MSAA˴CountΪ1
+	// DirectX 12不支持MSAA交换链，此处Count必须设为1
 	swapChainDesc.SampleDesc.Count = 1;
 	swapChainDesc.SampleDesc.Quality = 0;
 	swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
@@ -584,7 +584,7 @@ void D3D12App::CreateMsaaRenderTargetView() {
 		&heapProp,
 		D3D12_HEAP_FLAG_NONE,
 		&msaaRtvDesc,
-		D3D12_RESOURCE_STATE_RESOLVE_SOURCE, // ʼ״̬ΪRESOLVE_SOURCE
+		D3D12_RESOURCE_STATE_RESOLVE_SOURCE, // 初始状态必须设为RESOLVE_SOURCE
 		&optimizedClearValue,
 		IID_PPV_ARGS(&mMsaaRenderTarget)
 	));
@@ -647,9 +647,9 @@ void D3D12App::CreateDepthStencilView() {
 	depthStencilDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
 	depthStencilDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
 
-	// ȻԴ
+	// 创建深度缓冲区资源
 	D3D12_HEAP_PROPERTIES heapProp = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-	// ָOptimized Clear Value
+	// 指定Optimized Clear Value
 	D3D12_CLEAR_VALUE optimizedClearValue = { mDepthStencilFormat, { 1.0f, 0 } };
 	ThrowIfFailed(mDevice->CreateCommittedResource(
 		&heapProp,
@@ -660,7 +660,7 @@ void D3D12App::CreateDepthStencilView() {
 		IID_PPV_ARGS(&mDepthStencilBuffer)
 	));
 
-	// Ȼ
+	// 创建深度缓冲区描述符
 	CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHeapHandle(mDsvHeap->GetCPUDescriptorHandleForHeapStart());
 	mDevice->CreateDepthStencilView(
 		mDepthStencilBuffer.Get(), 
@@ -668,7 +668,7 @@ void D3D12App::CreateDepthStencilView() {
 		dsvHeapHandle
 	);
 
-	// ԴתΪд״̬
+	// 将资源转换为可写状态
 	D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
 		mDepthStencilBuffer.Get(),
 		D3D12_RESOURCE_STATE_COMMON,
@@ -0,0 +1,78 @@
+#include "DescriptorHeap.h"
+#include "Util.h"
+
+#include <algorithm>
+
+DescriptorHeap::DescriptorHeap(ID3D12Device* device, UINT capacity)
+	: mDevice(device) {
+	mDescriptorSize = mDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	mCapacity = std::max(capacity, 1u);
+	mHeap = CreateHeap(mCapacity, true);
+	mStagingHeap = CreateHeap(mCapacity, false);
+}
+
+void DescriptorHeap::CreateShaderResourceView(UINT index, ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc) {
+	Reserve(index + 1);
+
+	CD3DX12_CPU_DESCRIPTOR_HANDLE stagingHandle(mStagingHeap->GetCPUDescriptorHandleForHeapStart(), index, mDescriptorSize);
+	CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mHeap->GetCPUDescriptorHandleForHeapStart(), index, mDescriptorSize);
+
+	// 副本供扩容时拷贝；直接写入Shader可见的Heap比从副本拷贝少一次往返
+	mDevice->CreateShaderResourceView(resource, desc, stagingHandle);
+	mDevice->CreateShaderResourceView(resource, desc, handle);
+
+	mUsedCount = std::max(mUsedCount, index + 1);
+}
+
+bool DescriptorHeap::Reserve(UINT count) {
+	if (count <= mCapacity) {
+		return false;
+	}
+
+	// 至少增长一半，向上取整到GrowthChunk
+	UINT capacity = std::max(count, mCapacity + mCapacity / 2);
+	capacity = (capacity + GrowthChunk - 1) / GrowthChunk * GrowthChunk;
+
+	ComPtr<ID3D12DescriptorHeap> heap = CreateHeap(capacity, true);
+	ComPtr<ID3D12DescriptorHeap> stagingHeap = CreateHeap(capacity, false);
+
+	if (mUsedCount > 0) {
+		mDevice->CopyDescriptorsSimple(mUsedCount, stagingHeap->GetCPUDescriptorHandleForHeapStart(),
+			mStagingHeap->GetCPUDescriptorHandleForHeapStart(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		mDevice->CopyDescriptorsSimple(mUsedCount, heap->GetCPUDescriptorHandleForHeapStart(),
+			mStagingHeap->GetCPUDescriptorHandleForHeapStart(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	}
+
+	Util::DebugLog("[DescriptorHeap] %u -> %u descriptors\n", mCapacity, capacity);
+
+	// 副本不被GPU使用，可以直接替换
+	mRetiredHeaps.push_back(std::move(mHeap));
+	mHeap = std::move(heap);
+	mStagingHeap = std::move(stagingHeap);
+	mCapacity = capacity;
+	mGrowthCount++;
+	return true;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE DescriptorHeap::GpuHandle(UINT index) const {
+	return CD3DX12_GPU_DESCRIPTOR_HANDLE(mHeap->GetGPUDescriptorHandleForHeapStart(), index, mDescriptorSize);
+}
+
+void DescriptorHeap::ReleaseRetiredHeaps() {
+	mRetiredHeaps.clear();
+}
+
+ComPtr<ID3D12DescriptorHeap> DescriptorHeap::CreateHeap(UINT capacity, bool shaderVisible) const {
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc;
+	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	heapDesc.NumDescriptors = capacity;
+	heapDesc.Flags = shaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+	heapDesc.NodeMask = 0;
+
+	ComPtr<ID3D12DescriptorHeap> heap;
+	ThrowIfFailed(mDevice->CreateDescriptorHeap(
+		&heapDesc,
+		IID_PPV_ARGS(&heap)
+	));
+	return heap;
+}
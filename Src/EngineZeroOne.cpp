@@ -56,10 +56,25 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance, PSTR cmdLine, in
         const std::string sponzaPath = "C:\\Users\\Lenovo\\Desktop\\EngineZeroOne\\Models\\sponza\\sponza.obj";
         const std::string environmentPath = "C:\\Users\\Lenovo\\Desktop\\EngineZeroOne\\Models\\CubeMap\\snowcube1024.dds";
 
-        app.LoadModel(bustPath);
-        app.LoadModel(tablePath);
+        ModelHandle bust = app.LoadModel(bustPath, DefaultMeshImportFlags | CompactVertexFormat);
+        ModelHandle table = app.LoadModel(tablePath);
+
+        //ModelHandle sponza = app.LoadModel(sponzaPath);
+
+        // 静态模型的变换只需设置一次
+        app.SetProperties(bust,
+            XMFLOAT3(1.0f, 1.0f, 1.0f),
+            XM_PIDIV2, XMFLOAT3(1.0f, 0.0f, 0.0f),
+            XMFLOAT3(0.0f, 1.02f, 0.0f));
+
+        app.SetProperties(table,
+            XMFLOAT3(1.0f, 1.0f, 1.0f),
+            XM_PIDIV2, XMFLOAT3(1.0f, 0.0f, 0.0f));
+
+        //app.SetProperties(sponza,
+        //    XMFLOAT3(0.01f, 0.01f, 0.01f),
+        //    0, XMFLOAT3(1.0f, 0.0f, 0.0f));
 
-        //app.LoadModel(sponzaPath);
         app.LoadCubeMap(environmentPath);
 
         //app.LoadModel(floorPath);
@@ -0,0 +1,101 @@
+#include "FrustumCulling.h"
+
+#include <cmath>
+
+using namespace DirectX;
+
+void PackedBoxArray::Resize(size_t count) {
+	mCenterX.resize(count, 0.0f);
+	mCenterY.resize(count, 0.0f);
+	mCenterZ.resize(count, 0.0f);
+	mExtentX.resize(count, 0.0f);
+	mExtentY.resize(count, 0.0f);
+	mExtentZ.resize(count, 0.0f);
+}
+
+void PackedBoxArray::Set(size_t i, const BoundingBox& box) {
+	mCenterX[i] = box.Center.x;
+	mCenterY[i] = box.Center.y;
+	mCenterZ[i] = box.Center.z;
+	mExtentX[i] = box.Extents.x;
+	mExtentY[i] = box.Extents.y;
+	mExtentZ[i] = box.Extents.z;
+}
+
+UINT PackedBoxArray::Cull(const FrustumPlanes& frustum, size_t begin, size_t end, UINT8* visible) const {
+	// AABB到平面的有符号距离为 dot(n, center) + d，在法线方向上的投影半径为 dot(|n|, extents)
+	// 两者之和小于0时AABB完全位于平面外侧
+	XMVECTOR planeX[6], planeY[6], planeZ[6], planeD[6];
+	XMVECTOR absX[6], absY[6], absZ[6];
+	for (int p = 0; p < 6; ++p) {
+		const XMFLOAT4& plane = frustum.Planes[p];
+		planeX[p] = XMVectorReplicate(plane.x);
+		planeY[p] = XMVectorReplicate(plane.y);
+		planeZ[p] = XMVectorReplicate(plane.z);
+		planeD[p] = XMVectorReplicate(plane.w);
+		absX[p] = XMVectorAbs(planeX[p]);
+		absY[p] = XMVectorAbs(planeY[p]);
+		absZ[p] = XMVectorAbs(planeZ[p]);
+	}
+
+	UINT visibleCount = 0;
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4) {
+		XMVECTOR cx = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mCenterX[i]));
+		XMVECTOR cy = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mCenterY[i]));
+		XMVECTOR cz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mCenterZ[i]));
+		XMVECTOR ex = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mExtentX[i]));
+		XMVECTOR ey = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mExtentY[i]));
+		XMVECTOR ez = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mExtentZ[i]));
+
+		XMVECTOR outside = XMVectorFalseInt();
+		for (int p = 0; p < 6; ++p) {
+			XMVECTOR distance = XMVectorMultiplyAdd(cx, planeX[p], XMVectorMultiplyAdd(cy, planeY[p], XMVectorMultiplyAdd(cz, planeZ[p], planeD[p])));
+			XMVECTOR radius = XMVectorMultiplyAdd(ex, absX[p], XMVectorMultiplyAdd(ey, absY[p], XMVectorMultiply(ez, absZ[p])));
+			outside = XMVectorOrInt(outside, XMVectorLess(XMVectorAdd(distance, radius), XMVectorZero()));
+		}
+
+		XMUINT4 mask;
+		XMStoreUInt4(&mask, outside);
+		visible[i - begin + 0] = mask.x == 0 ? 1 : 0;
+		visible[i - begin + 1] = mask.y == 0 ? 1 : 0;
+		visible[i - begin + 2] = mask.z == 0 ? 1 : 0;
+		visible[i - begin + 3] = mask.w == 0 ? 1 : 0;
+		visibleCount += visible[i - begin + 0] + visible[i - begin + 1] + visible[i - begin + 2] + visible[i - begin + 3];
+	}
+
+	for (; i < end; ++i) {
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; ++p) {
+			const XMFLOAT4& plane = frustum.Planes[p];
+			float distance = mCenterX[i] * plane.x + (mCenterY[i] * plane.y + (mCenterZ[i] * plane.z + plane.w));
+			float radius = mExtentX[i] * fabsf(plane.x) + (mExtentY[i] * fabsf(plane.y) + mExtentZ[i] * fabsf(plane.z));
+			inside = distance + radius >= 0.0f;
+		}
+		visible[i - begin] = inside ? 1 : 0;
+		visibleCount += visible[i - begin];
+	}
+
+	return visibleCount;
+}
+
+FrustumPlanes FrustumCulling::ExtractPlanes(FXMMATRIX viewProj) {
+	// 行向量约定下裁剪坐标的各分量为位置与ViewProj各列的点积
+	// 可见的条件为 -w <= x <= w, -w <= y <= w, 0 <= z <= w
+	XMMATRIX columns = XMMatrixTranspose(viewProj);
+
+	XMVECTOR planes[6] = {
+		XMVectorAdd(columns.r[3], columns.r[0]),		// 左
+		XMVectorSubtract(columns.r[3], columns.r[0]),	// 右
+		XMVectorAdd(columns.r[3], columns.r[1]),		// 下
+		XMVectorSubtract(columns.r[3], columns.r[1]),	// 上
+		columns.r[2],									// 近
+		XMVectorSubtract(columns.r[3], columns.r[2]),	// 远
+	};
+
+	FrustumPlanes frustum;
+	for (int p = 0; p < 6; ++p) {
+		XMStoreFloat4(&frustum.Planes[p], XMPlaneNormalize(planes[p]));
+	}
+	return frustum;
+}
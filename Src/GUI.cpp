@@ -35,7 +35,7 @@ ContentBrowserPanel::ContentBrowserPanel()
 
 }
 
-// 
+// 启动
 void ContentBrowserPanel::OnImGuiRender(bool* pOpen) {
 	if (!ImGui::Begin("Content Browser", pOpen))
 	{
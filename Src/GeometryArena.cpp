@@ -0,0 +1,228 @@
+#include "GeometryArena.h"
+#include "Util.h"
+
+#include <algorithm>
+
+// ----------------------------------- RangeAllocator -----------------------------------
+
+RangeAllocator::RangeAllocator(UINT64 capacity) {
+	Grow(capacity);
+}
+
+UINT64 RangeAllocator::Allocate(UINT64 count) {
+	if (count == 0) {
+		return kInvalidOffset;
+	}
+
+	auto bySize = mFreeBySize.lower_bound(count);
+	if (bySize == mFreeBySize.end()) {
+		return kInvalidOffset;
+	}
+
+	UINT64 offset = bySize->second;
+	UINT64 blockCount = bySize->first;
+	EraseFreeBlock(mFreeByOffset.find(offset));
+
+	// 剩余部分仍为空闲块
+	if (blockCount > count) {
+		InsertFreeBlock(offset + count, blockCount - count);
+	}
+
+	mUsed += count;
+	return offset;
+}
+
+void RangeAllocator::Free(UINT64 offset, UINT64 count) {
+	if (count == 0 || offset == kInvalidOffset) {
+		return;
+	}
+
+	mUsed -= count;
+
+	// 与后一个空闲块合并
+	auto next = mFreeByOffset.lower_bound(offset);
+	if (next != mFreeByOffset.end() && next->first == offset + count) {
+		count += next->second;
+		EraseFreeBlock(next);
+	}
+
+	// 与前一个空闲块合并
+	auto prev = mFreeByOffset.lower_bound(offset);
+	if (prev != mFreeByOffset.begin()) {
+		--prev;
+		if (prev->first + prev->second == offset) {
+			offset = prev->first;
+			count += prev->second;
+			EraseFreeBlock(prev);
+		}
+	}
+
+	InsertFreeBlock(offset, count);
+}
+
+void RangeAllocator::Grow(UINT64 newCapacity) {
+	if (newCapacity <= mCapacity) {
+		return;
+	}
+
+	UINT64 oldCapacity = mCapacity;
+	mCapacity = newCapacity;
+
+	// 当作释放了一段已占用的空间，借此与末尾的空闲块合并
+	mUsed += newCapacity - oldCapacity;
+	Free(oldCapacity, newCapacity - oldCapacity);
+}
+
+UINT64 RangeAllocator::LargestFreeBlock() const {
+	return mFreeBySize.empty() ? 0 : mFreeBySize.rbegin()->first;
+}
+
+void RangeAllocator::InsertFreeBlock(UINT64 offset, UINT64 count) {
+	mFreeByOffset.emplace(offset, count);
+	mFreeBySize.emplace(count, offset);
+}
+
+void RangeAllocator::EraseFreeBlock(std::map<UINT64, UINT64>::iterator it) {
+	auto range = mFreeBySize.equal_range(it->second);
+	for (auto bySize = range.first; bySize != range.second; ++bySize) {
+		if (bySize->second == it->first) {
+			mFreeBySize.erase(bySize);
+			break;
+		}
+	}
+	mFreeByOffset.erase(it);
+}
+
+// ----------------------------------- GeometryArena -----------------------------------
+
+void GeometryArena::Init(ID3D12Device* device, const std::vector<UINT>& elementSizes, UINT64 initialCapacity, const std::wstring& name) {
+	mDevice = device;
+	mElementSizes = elementSizes;
+	mName = name;
+	mBuffers.assign(elementSizes.size(), nullptr);
+	mRetiredBuffers.clear();
+
+	// Buffer在首次分配时创建
+	mAllocator = RangeAllocator();
+	mInitialCapacity = initialCapacity;
+}
+
+UINT64 GeometryArena::Allocate(ID3D12GraphicsCommandList* cmdList, UINT64 count) {
+	UINT64 first = mAllocator.Allocate(count);
+	if (first == RangeAllocator::kInvalidOffset && count > 0) {
+		// 至少翻倍，减少扩容次数
+		UINT64 capacity = mAllocator.Capacity();
+		Grow(cmdList, (std::max)({ mInitialCapacity, 2 * capacity, capacity + count }));
+		first = mAllocator.Allocate(count);
+	}
+
+	return first;
+}
+
+void GeometryArena::Free(UINT64 first, UINT64 count) {
+	mAllocator.Free(first, count);
+}
+
+void GeometryArena::Upload(ID3D12GraphicsCommandList* cmdList, UINT bufferIndex, UINT64 first, UINT64 count,
+	ID3D12Resource* uploadBuffer, UINT64 srcOffset) {
+	if (count == 0) {
+		return;
+	}
+
+	ID3D12Resource* buffer = mBuffers[bufferIndex].Get();
+
+	D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
+		buffer,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		D3D12_RESOURCE_STATE_COPY_DEST
+	);
+	cmdList->ResourceBarrier(1, &barrier);
+
+	cmdList->CopyBufferRegion(buffer, first * mElementSizes[bufferIndex],
+		uploadBuffer, srcOffset, count * mElementSizes[bufferIndex]);
+
+	D3D12_RESOURCE_BARRIER barrier2 = CD3DX12_RESOURCE_BARRIER::Transition(
+		buffer,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		D3D12_RESOURCE_STATE_GENERIC_READ
+	);
+	cmdList->ResourceBarrier(1, &barrier2);
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS GeometryArena::Address(UINT bufferIndex, UINT64 element) const {
+	return mBuffers[bufferIndex] != nullptr ? mBuffers[bufferIndex]->GetGPUVirtualAddress() + element * mElementSizes[bufferIndex] : 0;
+}
+
+UINT64 GeometryArena::SizeInBytes(UINT bufferIndex) const {
+	return mAllocator.Capacity() * mElementSizes[bufferIndex];
+}
+
+GeometryArenaStats GeometryArena::Stats() const {
+	UINT64 elementSize = 0;
+	for (UINT size : mElementSizes) {
+		elementSize += size;
+	}
+
+	GeometryArenaStats stats;
+	stats.CapacityInBytes = mAllocator.Capacity() * elementSize;
+	stats.UsedInBytes = mAllocator.UsedCount() * elementSize;
+	stats.FreeBlockCount = mAllocator.FreeBlockCount();
+	stats.LargestFreeBlockInBytes = mAllocator.LargestFreeBlock() * elementSize;
+	return stats;
+}
+
+void GeometryArena::ReleaseRetiredBuffers() {
+	mRetiredBuffers.clear();
+}
+
+void GeometryArena::Grow(ID3D12GraphicsCommandList* cmdList, UINT64 newCapacity) {
+	UINT64 oldCapacity = mAllocator.Capacity();
+	D3D12_HEAP_PROPERTIES defaultHeapProp = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+
+	for (UINT i = 0; i < mBuffers.size(); ++i) {
+		ComPtr<ID3D12Resource> buffer;
+		D3D12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(newCapacity * mElementSizes[i]);
+		ThrowIfFailed(mDevice->CreateCommittedResource(
+			&defaultHeapProp,
+			D3D12_HEAP_FLAG_NONE,
+			&bufferDesc,
+			D3D12_RESOURCE_STATE_COMMON,
+			nullptr,
+			IID_PPV_ARGS(buffer.GetAddressOf())
+		));
+		buffer->SetName((mName + L" " + std::to_wstring(i)).c_str());
+
+		D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
+			buffer.Get(),
+			D3D12_RESOURCE_STATE_COMMON,
+			D3D12_RESOURCE_STATE_COPY_DEST
+		);
+		cmdList->ResourceBarrier(1, &barrier);
+
+		// 拷贝已有的数据，已分配的范围保持不变
+		if (mBuffers[i] != nullptr) {
+			D3D12_RESOURCE_BARRIER toSource = CD3DX12_RESOURCE_BARRIER::Transition(
+				mBuffers[i].Get(),
+				D3D12_RESOURCE_STATE_GENERIC_READ,
+				D3D12_RESOURCE_STATE_COPY_SOURCE
+			);
+			cmdList->ResourceBarrier(1, &toSource);
+
+			cmdList->CopyBufferRegion(buffer.Get(), 0, mBuffers[i].Get(), 0, oldCapacity * mElementSizes[i]);
+			mRetiredBuffers.push_back(mBuffers[i]);
+		}
+
+		D3D12_RESOURCE_BARRIER barrier2 = CD3DX12_RESOURCE_BARRIER::Transition(
+			buffer.Get(),
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			D3D12_RESOURCE_STATE_GENERIC_READ
+		);
+		cmdList->ResourceBarrier(1, &barrier2);
+
+		mBuffers[i] = buffer;
+	}
+
+	mAllocator.Grow(newCapacity);
+
+	Util::DebugLog("[GeometryArena] %ls: %llu -> %llu elements\n", mName.c_str(), oldCapacity, newCapacity);
+}
@@ -0,0 +1,378 @@
+#include "LooseOctree.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+namespace {
+	const UINT AllPlanes = (1u << 6) - 1;
+
+	// 节点键: 高4位为层号，其下依次为各20位的x、y、z格子坐标
+	const UINT KeyLevelBits = 4;
+	const UINT KeyCoordBits = 20;
+	const UINT64 KeyCoordMask = (1ull << KeyCoordBits) - 1;
+	static_assert(KeyLevelBits + 3 * KeyCoordBits == 64, "node key layout must fill 64 bits");
+	static_assert(LooseOctree::MaxDepthLimit < (1u << KeyLevelBits), "deepest level must fit in the level field, or it collides with the root");
+	static_assert(LooseOctree::MaxDepthLimit <= KeyCoordBits, "cell coordinates (< 2^level) must fit in the coordinate fields");
+
+	inline UINT64 MakeKey(UINT level, UINT x, UINT y, UINT z) {
+		return (static_cast<UINT64>(level) << (3 * KeyCoordBits)) |
+			(static_cast<UINT64>(x) << (2 * KeyCoordBits)) | (static_cast<UINT64>(y) << KeyCoordBits) | z;
+	}
+
+	// AABB与平面: 完全在外侧时返回-1，完全在内侧时返回1，相交返回0
+	inline int ClassifyBox(const XMFLOAT4& plane, const XMFLOAT3& center, const XMFLOAT3& extents) {
+		// 运算顺序与PackedBoxArray::Cull相同，两者对同一AABB的结果一致
+		float distance = center.x * plane.x + (center.y * plane.y + (center.z * plane.z + plane.w));
+		float radius = extents.x * fabsf(plane.x) + (extents.y * fabsf(plane.y) + extents.z * fabsf(plane.z));
+		if (distance + radius < 0.0f) {
+			return -1;
+		}
+		return distance - radius >= 0.0f ? 1 : 0;
+	}
+
+	// 点到AABB距离的平方
+	inline float DistanceSquared(const XMFLOAT3& point, const XMFLOAT3& center, const XMFLOAT3& extents) {
+		float dx = (std::max)(fabsf(point.x - center.x) - extents.x, 0.0f);
+		float dy = (std::max)(fabsf(point.y - center.y) - extents.y, 0.0f);
+		float dz = (std::max)(fabsf(point.z - center.z) - extents.z, 0.0f);
+		return dx * dx + dy * dy + dz * dz;
+	}
+}
+
+LooseOctree::LooseOctree(const XMFLOAT3& center, float halfSize, UINT maxDepth)
+	: mCenter(center),
+	mHalfSize(halfSize),
+	mMaxDepth((std::min)(maxDepth, MaxDepthLimit)) {
+
+	// 根节点始终存在，位于mNodes[0]
+	AcquireNode(MakeKey(0, 0, 0, 0));
+}
+
+UINT64 LooseOctree::NodeKey(const BoundingBox& box) const {
+	const float offsetX = box.Center.x - (mCenter.x - mHalfSize);
+	const float offsetY = box.Center.y - (mCenter.y - mHalfSize);
+	const float offsetZ = box.Center.z - (mCenter.z - mHalfSize);
+	const float rootSize = 2.0f * mHalfSize;
+	if (!(offsetX >= 0.0f && offsetX < rootSize && offsetY >= 0.0f && offsetY < rootSize && offsetZ >= 0.0f && offsetZ < rootSize)) {
+		return MakeKey(0, 0, 0, 0);
+	}
+
+	// 物体的最大半长不超过格子的半长时，中心所在格子的松散包围盒必然包含物体
+	const float extent = (std::max)((std::max)(box.Extents.x, box.Extents.y), box.Extents.z);
+	UINT level = 0;
+	float halfSize = mHalfSize;
+	while (level < mMaxDepth && halfSize * 0.5f >= extent) {
+		halfSize *= 0.5f;
+		level++;
+	}
+
+	const UINT cells = 1u << level;
+	const float invCellSize = 0.5f / halfSize;
+	UINT x = (std::min)(static_cast<UINT>(offsetX * invCellSize), cells - 1);
+	UINT y = (std::min)(static_cast<UINT>(offsetY * invCellSize), cells - 1);
+	UINT z = (std::min)(static_cast<UINT>(offsetZ * invCellSize), cells - 1);
+	return MakeKey(level, x, y, z);
+}
+
+UINT LooseOctree::AcquireNode(UINT64 key) {
+	auto it = mNodeLookup.find(key);
+	if (it != mNodeLookup.end()) {
+		return it->second;
+	}
+
+	const UINT level = static_cast<UINT>(key >> (3 * KeyCoordBits));
+	const UINT x = static_cast<UINT>((key >> (2 * KeyCoordBits)) & KeyCoordMask);
+	const UINT y = static_cast<UINT>((key >> KeyCoordBits) & KeyCoordMask);
+	const UINT z = static_cast<UINT>(key & KeyCoordMask);
+
+	// 先创建父节点，mNodes可能因此扩容
+	UINT parent = UINT_MAX;
+	if (level > 0) {
+		parent = AcquireNode(MakeKey(level - 1, x >> 1, y >> 1, z >> 1));
+	}
+
+	UINT nodeIndex;
+	if (!mFreeNodes.empty()) {
+		nodeIndex = mFreeNodes.back();
+		mFreeNodes.pop_back();
+	}
+	else {
+		nodeIndex = static_cast<UINT>(mNodes.size());
+		mNodes.emplace_back();
+	}
+
+	Node& node = mNodes[nodeIndex];
+	node.HalfSize = mHalfSize / static_cast<float>(1u << level);
+	node.Center = XMFLOAT3(
+		mCenter.x - mHalfSize + (2.0f * x + 1.0f) * node.HalfSize,
+		mCenter.y - mHalfSize + (2.0f * y + 1.0f) * node.HalfSize,
+		mCenter.z - mHalfSize + (2.0f * z + 1.0f) * node.HalfSize);
+	node.Key = key;
+	node.Parent = parent;
+	std::fill(std::begin(node.Children), std::end(node.Children), UINT_MAX);
+	node.Items.clear();
+	node.SubtreeItemCount = 0;
+
+	if (parent != UINT_MAX) {
+		mNodes[parent].Children[(x & 1) | ((y & 1) << 1) | ((z & 1) << 2)] = nodeIndex;
+	}
+	mNodeLookup[key] = nodeIndex;
+	return nodeIndex;
+}
+
+void LooseOctree::ReleaseEmptyNodes(UINT nodeIndex) {
+	// 根节点不回收
+	while (mNodes[nodeIndex].Parent != UINT_MAX && mNodes[nodeIndex].SubtreeItemCount == 0) {
+		Node& node = mNodes[nodeIndex];
+		Node& parent = mNodes[node.Parent];
+		for (UINT& child : parent.Children) {
+			if (child == nodeIndex) {
+				child = UINT_MAX;
+			}
+		}
+		mNodeLookup.erase(node.Key);
+		mFreeNodes.push_back(nodeIndex);
+		nodeIndex = node.Parent;
+	}
+}
+
+void LooseOctree::Link(UINT id, UINT nodeIndex) {
+	ItemSlot& item = mItems[id];
+	item.Node = nodeIndex;
+	item.Position = static_cast<UINT>(mNodes[nodeIndex].Items.size());
+	mNodes[nodeIndex].Items.push_back(id);
+
+	for (UINT n = nodeIndex; n != UINT_MAX; n = mNodes[n].Parent) {
+		mNodes[n].SubtreeItemCount++;
+	}
+}
+
+void LooseOctree::Unlink(UINT id) {
+	ItemSlot& item = mItems[id];
+	const UINT nodeIndex = item.Node;
+	std::vector<UINT>& items = mNodes[nodeIndex].Items;
+
+	// 与最后一个交换后移除
+	items[item.Position] = items.back();
+	mItems[items.back()].Position = item.Position;
+	items.pop_back();
+	item.Node = UINT_MAX;
+
+	for (UINT n = nodeIndex; n != UINT_MAX; n = mNodes[n].Parent) {
+		mNodes[n].SubtreeItemCount--;
+	}
+	ReleaseEmptyNodes(nodeIndex);
+}
+
+void LooseOctree::Insert(UINT id, const BoundingBox& box) {
+	if (Contains(id)) {
+		Update(id, box);
+		return;
+	}
+	if (id >= mItems.size()) {
+		mItems.resize(id + 1);
+	}
+
+	mItems[id].Box = box;
+	Link(id, AcquireNode(NodeKey(box)));
+	mItemCount++;
+}
+
+void LooseOctree::Update(UINT id, const BoundingBox& box) {
+	if (!Contains(id)) {
+		Insert(id, box);
+		return;
+	}
+
+	mItems[id].Box = box;
+	const UINT64 key = NodeKey(box);
+	if (mNodes[mItems[id].Node].Key == key) {
+		return;
+	}
+
+	// 先移出原节点，空的祖先节点可能被回收，之后再查找新的节点
+	Unlink(id);
+	Link(id, AcquireNode(key));
+}
+
+void LooseOctree::Remove(UINT id) {
+	if (!Contains(id)) {
+		return;
+	}
+	Unlink(id);
+	mItemCount--;
+}
+
+bool LooseOctree::Contains(UINT id) const {
+	return id < mItems.size() && mItems[id].Node != UINT_MAX;
+}
+
+void LooseOctree::CollectSubtree(UINT nodeIndex, std::vector<UINT>& results) const {
+	const Node& node = mNodes[nodeIndex];
+	results.insert(results.end(), node.Items.begin(), node.Items.end());
+	for (UINT child : node.Children) {
+		if (child != UINT_MAX) {
+			CollectSubtree(child, results);
+		}
+	}
+}
+
+void LooseOctree::QueryFrustum(const FrustumPlanes& frustum, std::vector<UINT>& results) const {
+	QueryFrustum(0, frustum, AllPlanes, results);
+}
+
+void LooseOctree::QueryFrustum(UINT nodeIndex, const FrustumPlanes& frustum, UINT planeMask, std::vector<UINT>& results) const {
+	const Node& node = mNodes[nodeIndex];
+	if (node.SubtreeItemCount == 0) {
+		return;
+	}
+
+	// 根节点包含根格子之外的物体，没有有限的包围盒，只逐个测试
+	// 其余节点完全位于某个平面内侧时，子树中不再测试该平面
+	if (node.Parent != UINT_MAX) {
+		const float looseSize = 2.0f * node.HalfSize;
+		const XMFLOAT3 looseExtents(looseSize, looseSize, looseSize);
+
+		for (UINT p = 0; p < 6; ++p) {
+			if ((planeMask & (1u << p)) == 0) {
+				continue;
+			}
+			int side = ClassifyBox(frustum.Planes[p], node.Center, looseExtents);
+			if (side < 0) {
+				return;
+			}
+			if (side > 0) {
+				planeMask &= ~(1u << p);
+			}
+		}
+		if (planeMask == 0) {
+			CollectSubtree(nodeIndex, results);
+			return;
+		}
+	}
+
+	for (UINT id : node.Items) {
+		const BoundingBox& box = mItems[id].Box;
+		bool visible = true;
+		for (UINT p = 0; p < 6 && visible; ++p) {
+			visible = (planeMask & (1u << p)) == 0 || ClassifyBox(frustum.Planes[p], box.Center, box.Extents) >= 0;
+		}
+		if (visible) {
+			results.push_back(id);
+		}
+	}
+
+	for (UINT child : node.Children) {
+		if (child != UINT_MAX) {
+			QueryFrustum(child, frustum, planeMask, results);
+		}
+	}
+}
+
+void LooseOctree::QuerySphere(const BoundingSphere& sphere, std::vector<UINT>& results) const {
+	QuerySphere(0, XMLoadFloat3(&sphere.Center), sphere.Radius, results);
+}
+
+void LooseOctree::QuerySphere(UINT nodeIndex, FXMVECTOR center, float radius, std::vector<UINT>& results) const {
+	const Node& node = mNodes[nodeIndex];
+	if (node.SubtreeItemCount == 0) {
+		return;
+	}
+
+	XMFLOAT3 point;
+	XMStoreFloat3(&point, center);
+	const float radiusSquared = radius * radius;
+
+	if (node.Parent != UINT_MAX) {
+		const float looseSize = 2.0f * node.HalfSize;
+		if (DistanceSquared(point, node.Center, XMFLOAT3(looseSize, looseSize, looseSize)) > radiusSquared) {
+			return;
+		}
+	}
+
+	for (UINT id : node.Items) {
+		const BoundingBox& box = mItems[id].Box;
+		if (DistanceSquared(point, box.Center, box.Extents) <= radiusSquared) {
+			results.push_back(id);
+		}
+	}
+
+	for (UINT child : node.Children) {
+		if (child != UINT_MAX) {
+			QuerySphere(child, center, radius, results);
+		}
+	}
+}
+
+void LooseOctree::Benchmark(const FrustumPlanes& frustum) const {
+	const size_t itemCounts[] = { 1000, 10000, 100000 };
+	const int queryRepeats = 20;
+
+	std::mt19937 rng(1);
+	// 物体分布在根格子中心的一半范围内，大小与常见的家具、道具相当
+	std::uniform_real_distribution<float> position(-0.5f * mHalfSize, 0.5f * mHalfSize);
+	std::uniform_real_distribution<float> extent(0.05f, 2.0f);
+	std::uniform_real_distribution<float> movement(-1.0f, 1.0f);
+
+	for (size_t count : itemCounts) {
+		std::vector<BoundingBox> boxes(count);
+		for (BoundingBox& box : boxes) {
+			box.Center = XMFLOAT3(mCenter.x + position(rng), mCenter.y + position(rng), mCenter.z + position(rng));
+			box.Extents = XMFLOAT3(extent(rng), extent(rng), extent(rng));
+		}
+
+		// 构建
+		INT64 start = Util::QueryTimestamp();
+		LooseOctree octree(mCenter, mHalfSize, mMaxDepth);
+		for (size_t i = 0; i < count; ++i) {
+			octree.Insert(static_cast<UINT>(i), boxes[i]);
+		}
+		const double buildMs = Util::MillisecondsSince(start);
+
+		// 所有物体各移动一小段距离，相当于每个Render Item都调用了SetProperties
+		for (BoundingBox& box : boxes) {
+			box.Center.x += movement(rng);
+			box.Center.y += movement(rng);
+			box.Center.z += movement(rng);
+		}
+		start = Util::QueryTimestamp();
+		for (size_t i = 0; i < count; ++i) {
+			octree.Update(static_cast<UINT>(i), boxes[i]);
+		}
+		const double moveMs = Util::MillisecondsSince(start);
+
+		// 逐个测试，单线程
+		PackedBoxArray packed;
+		packed.Resize(count);
+		for (size_t i = 0; i < count; ++i) {
+			packed.Set(i, boxes[i]);
+		}
+		std::vector<UINT8> visible(count);
+		UINT bruteForceVisible = 0;
+		start = Util::QueryTimestamp();
+		for (int r = 0; r < queryRepeats; ++r) {
+			bruteForceVisible = packed.Cull(frustum, 0, count, visible.data());
+		}
+		const double bruteForceMs = Util::MillisecondsSince(start) / queryRepeats;
+
+		std::vector<UINT> results;
+		start = Util::QueryTimestamp();
+		for (int r = 0; r < queryRepeats; ++r) {
+			results.clear();
+			octree.QueryFrustum(frustum, results);
+		}
+		const double octreeMs = Util::MillisecondsSince(start) / queryRepeats;
+
+		bool match = results.size() == bruteForceVisible;
+		for (UINT id : results) {
+			match = match && visible[id] != 0;
+		}
+
+		Util::DebugLog("[Octree] %zu items: build %.3f ms, move %.3f ms, brute force %.3f ms, octree %.3f ms (%zu visible, %zu nodes)%s\n",
+			count, buildMs, moveMs, bruteForceMs, octreeMs, results.size(), octree.NodeCount(), match ? "" : " MISMATCH");
+	}
+}
@@ -1,7 +1,380 @@
 #include "Mesh.h"
 
-void MeshManager::ImportMesh(const aiScene* pAiScene) {
-	// ȷС
+UINT64 SubMeshContent::Hash() const {
+	UINT64 hash = MeshCache::Hash(&CompactVertices, sizeof(CompactVertices));
+	hash = MeshCache::Hash(&Quantization, sizeof(Quantization), hash);
+	hash = MeshCache::Hash(&PrimitiveTopology, sizeof(PrimitiveTopology), hash);
+	hash = MeshCache::Hash(&IndexFormat, sizeof(IndexFormat), hash);
+
+	hash = MeshCache::Hash(Positions, NumVertices * PositionStrideInBytes, hash);
+	hash = MeshCache::Hash(Attributes, NumVertices * AttributeStrideInBytes, hash);
+
+	const UINT indexSize = MeshOptimizer::IndexFormatSizeInBytes(IndexFormat);
+	for (size_t lod = 0; lod < Indices.size(); ++lod) {
+		hash = MeshCache::Hash(&NumIndices[lod], sizeof(NumIndices[lod]), hash);
+		hash = MeshCache::Hash(Indices[lod], NumIndices[lod] * indexSize, hash);
+	}
+	return hash;
+}
+
+bool SubMeshContent::Equals(const SubMeshContent& other) const {
+	if (CompactVertices != other.CompactVertices ||
+		std::memcmp(&Quantization, &other.Quantization, sizeof(Quantization)) != 0 ||
+		PrimitiveTopology != other.PrimitiveTopology ||
+		IndexFormat != other.IndexFormat ||
+		NumVertices != other.NumVertices ||
+		PositionStrideInBytes != other.PositionStrideInBytes ||
+		AttributeStrideInBytes != other.AttributeStrideInBytes ||
+		NumIndices != other.NumIndices) {
+		return false;
+	}
+
+	if (std::memcmp(Positions, other.Positions, NumVertices * PositionStrideInBytes) != 0 ||
+		std::memcmp(Attributes, other.Attributes, NumVertices * AttributeStrideInBytes) != 0) {
+		return false;
+	}
+
+	const UINT indexSize = MeshOptimizer::IndexFormatSizeInBytes(IndexFormat);
+	for (size_t lod = 0; lod < Indices.size(); ++lod) {
+		if (std::memcmp(Indices[lod], other.Indices[lod], NumIndices[lod] * indexSize) != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+SubMeshContent SubMeshContent::CopyTo(std::vector<BYTE>& storage) const {
+	const size_t positionSize = NumVertices * PositionStrideInBytes;
+	const size_t attributeSize = NumVertices * AttributeStrideInBytes;
+	const UINT indexSize = MeshOptimizer::IndexFormatSizeInBytes(IndexFormat);
+	size_t totalSize = positionSize + attributeSize;
+	for (UINT count : NumIndices) {
+		totalSize += count * indexSize;
+	}
+	storage.resize(totalSize);
+
+	SubMeshContent copy = *this;
+	BYTE* destination = storage.data();
+	auto Append = [&](const BYTE* source, size_t size) {
+		std::memcpy(destination, source, size);
+		destination += size;
+		return destination - size;
+	};
+	copy.Positions = Append(Positions, positionSize);
+	copy.Attributes = Append(Attributes, attributeSize);
+	for (size_t lod = 0; lod < Indices.size(); ++lod) {
+		copy.Indices[lod] = Append(Indices[lod], NumIndices[lod] * indexSize);
+	}
+	return copy;
+}
+
+bool SubMeshRegistry::Find(UINT64 contentHash, const SubMeshContent& content, SubMeshRef& ref) const {
+	auto range = mSubMeshes.equal_range(contentHash);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second.Content.Equals(content)) {
+			ref = it->second.Ref;
+			return true;
+		}
+	}
+	if (range.first != range.second) {
+		Util::DebugLog("[Mesh] Content hash collision: %016llx, submesh uploaded separately\n", contentHash);
+	}
+	return false;
+}
+
+void SubMeshRegistry::Add(UINT64 contentHash, const SubMeshContent& content, const SubMeshRef& ref) {
+	// 节点插入后位置不变，Content可以指向节点内的Storage
+	Entry& entry = mSubMeshes.emplace(contentHash, Entry())->second;
+	entry.Ref = ref;
+	entry.Content = content.CopyTo(entry.Storage);
+}
+
+void SubMeshRegistry::RemoveMesh(UINT meshIndex) {
+	for (auto it = mSubMeshes.begin(); it != mSubMeshes.end();) {
+		it = it->second.Ref.MeshIndex == meshIndex ? mSubMeshes.erase(it) : std::next(it);
+	}
+}
+
+SubMeshContent Mesh::SubMeshContentOf(const SubMesh& submesh, const void* vertexData, const void* indexData) const {
+	const BYTE* positions = static_cast<const BYTE*>(vertexData);
+	const BYTE* attributes = positions + AttributeOffsetInBytes;
+	const BYTE* indices = static_cast<const BYTE*>(indexData);
+
+	SubMeshContent content;
+	content.CompactVertices = CompactVertices;
+	content.Quantization = submesh.Quantization;
+	content.PrimitiveTopology = submesh.PrimitiveTopology;
+	content.IndexFormat = submesh.IndexFormat;
+
+	content.NumVertices = submesh.NumVertices;
+	content.PositionStrideInBytes = PositionStrideInBytes;
+	content.AttributeStrideInBytes = AttributeStrideInBytes;
+	content.Positions = positions + submesh.BaseVertexLocation * PositionStrideInBytes;
+	content.Attributes = attributes + submesh.BaseVertexLocation * AttributeStrideInBytes;
+
+	// Index相对于SubMesh的BaseVertexLocation，与位置无关
+	if (submesh.LODs.empty()) {
+		content.NumIndices.push_back(submesh.NumIndices);
+		content.Indices.push_back(indices + submesh.IndexBufferOffsetInBytes);
+	}
+	for (const SubMeshLOD& lod : submesh.LODs) {
+		content.NumIndices.push_back(lod.NumIndices);
+		content.Indices.push_back(indices + lod.IndexBufferOffsetInBytes);
+	}
+	return content;
+}
+
+void Mesh::ExtractOccluder(SubMesh& submesh, const void* vertexData, const void* indexData) const {
+	submesh.OccluderPositions.clear();
+	submesh.OccluderIndices.clear();
+
+	UINT indexOffsetInBytes = submesh.IndexBufferOffsetInBytes;
+	UINT numIndices = submesh.NumIndices;
+	if (!submesh.LODs.empty()) {
+		indexOffsetInBytes = submesh.LODs.back().IndexBufferOffsetInBytes;
+		numIndices = submesh.LODs.back().NumIndices;
+	}
+	if (submesh.PrimitiveTopology != D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST || numIndices == 0 || numIndices / 3 > MaxOccluderTriangles) {
+		return;
+	}
+
+	const BYTE* positions = static_cast<const BYTE*>(vertexData) + submesh.BaseVertexLocation * PositionStrideInBytes;
+	const BYTE* indices = static_cast<const BYTE*>(indexData) + indexOffsetInBytes;
+
+	// 只保留最粗糙的LOD引用到的顶点
+	std::vector<UINT> remap(submesh.NumVertices, UINT_MAX);
+	submesh.OccluderIndices.resize(numIndices);
+	for (UINT i = 0; i < numIndices; ++i) {
+		UINT index = submesh.IndexFormat == DXGI_FORMAT_R16_UINT
+			? reinterpret_cast<const UINT16*>(indices)[i]
+			: reinterpret_cast<const UINT*>(indices)[i];
+		if (index >= submesh.NumVertices) {
+			submesh.OccluderPositions.clear();
+			submesh.OccluderIndices.clear();
+			return;
+		}
+
+		if (remap[index] == UINT_MAX) {
+			remap[index] = static_cast<UINT>(submesh.OccluderPositions.size());
+
+			submesh.OccluderPositions.push_back(DecodePosition(submesh, positions, index));
+		}
+		submesh.OccluderIndices[i] = remap[index];
+	}
+}
+
+XMFLOAT3 Mesh::DecodePosition(const SubMesh& submesh, const BYTE* positions, UINT index) const {
+	XMFLOAT3 position;
+	if (CompactVertices) {
+		// 与Shader中的解码相同: UNORM * Scale + Offset
+		XMVECTOR encoded = PackedVector::XMLoadUShortN4(reinterpret_cast<const PackedVector::XMUSHORTN4*>(positions + index * PositionStrideInBytes));
+		XMStoreFloat3(&position, XMVectorMultiplyAdd(encoded,
+			XMLoadFloat3(&submesh.Quantization.Scale), XMLoadFloat3(&submesh.Quantization.Offset)));
+	}
+	else {
+		std::memcpy(&position, positions + index * PositionStrideInBytes, sizeof(XMFLOAT3));
+	}
+	return position;
+}
+
+void Mesh::BuildSubMeshMeshlets(const SubMesh& submesh, const void* vertexData, const void* indexData, MeshletData& data) const {
+	if (submesh.PrimitiveTopology != D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST || submesh.NumIndices < 3) {
+		return;
+	}
+
+	const BYTE* positions = static_cast<const BYTE*>(vertexData) + submesh.BaseVertexLocation * PositionStrideInBytes;
+	const BYTE* indices = static_cast<const BYTE*>(indexData) + submesh.IndexBufferOffsetInBytes;
+
+	// MeshletBuilder需要32位Index与float3的Position，其他格式先展开
+	std::vector<UINT> unpackedIndices;
+	const UINT* meshletIndices = reinterpret_cast<const UINT*>(indices);
+	if (submesh.IndexFormat == DXGI_FORMAT_R16_UINT) {
+		const UINT16* source = reinterpret_cast<const UINT16*>(indices);
+		unpackedIndices.assign(source, source + submesh.NumIndices);
+		meshletIndices = unpackedIndices.data();
+	}
+	for (UINT i = 0; i < submesh.NumIndices; ++i) {
+		if (meshletIndices[i] >= submesh.NumVertices) {
+			return;
+		}
+	}
+
+	std::vector<XMFLOAT3> decodedPositions;
+	const XMFLOAT3* meshletPositions = reinterpret_cast<const XMFLOAT3*>(positions);
+	size_t positionStride = PositionStrideInBytes;
+	if (CompactVertices) {
+		decodedPositions.resize(submesh.NumVertices);
+		for (UINT v = 0; v < submesh.NumVertices; ++v) {
+			decodedPositions[v] = DecodePosition(submesh, positions, v);
+		}
+		meshletPositions = decodedPositions.data();
+		positionStride = sizeof(XMFLOAT3);
+	}
+
+	MeshletBuilder::BuildMeshlets(data, meshletIndices, submesh.NumIndices,
+		meshletPositions, submesh.NumVertices, positionStride);
+}
+
+void Mesh::BuildMeshlets(const void* vertexData, const void* indexData) {
+	const UINT numSubMeshes = static_cast<UINT>(SubMeshes.size());
+	INT64 stageStart = Util::QueryTimestamp();
+
+	// 各SubMesh生成到各自的表中，Meshlet只引用SubMesh内的相对编号，之后的重新打包不影响结果
+	std::vector<MeshletData> submeshMeshlets(numSubMeshes);
+	ThreadPool::Get().ParallelFor(numSubMeshes, 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			if (!SubMeshes[i].IsShared) {
+				BuildSubMeshMeshlets(SubMeshes[i], vertexData, indexData, submeshMeshlets[i]);
+			}
+		}
+	});
+
+	// 按SubMesh的顺序合并，TriangleIndices在每个表中都按4字节对齐，合并后仍然对齐
+	Meshlets = MeshletData();
+	UINT triangleCount = 0;
+	for (UINT i = 0; i < numSubMeshes; ++i) {
+		SubMesh& submesh = SubMeshes[i];
+		const MeshletData& source = submeshMeshlets[i];
+		const UINT vertexBase = static_cast<UINT>(Meshlets.VertexIndices.size());
+		const UINT triangleBase = static_cast<UINT>(Meshlets.TriangleIndices.size());
+
+		submesh.MeshletOffset = static_cast<UINT>(Meshlets.Meshlets.size());
+		submesh.MeshletCount = static_cast<UINT>(source.Meshlets.size());
+		for (Meshlet meshlet : source.Meshlets) {
+			meshlet.VertexOffset += vertexBase;
+			meshlet.TriangleOffset += triangleBase;
+			triangleCount += meshlet.TriangleCount;
+			Meshlets.Meshlets.push_back(meshlet);
+		}
+		Meshlets.Bounds.insert(Meshlets.Bounds.end(), source.Bounds.begin(), source.Bounds.end());
+		Meshlets.VertexIndices.insert(Meshlets.VertexIndices.end(), source.VertexIndices.begin(), source.VertexIndices.end());
+		Meshlets.TriangleIndices.insert(Meshlets.TriangleIndices.end(), source.TriangleIndices.begin(), source.TriangleIndices.end());
+	}
+
+	double meshletTime = Util::MillisecondsSince(stageStart);
+	const UINT meshletCount = static_cast<UINT>(Meshlets.Meshlets.size());
+	if (meshletCount > 0) {
+		Util::DebugLog("[Mesh] Built %u meshlets (%.1f triangles each) in %.2f ms, %.2f M triangles/s\n",
+			meshletCount, static_cast<float>(triangleCount) / meshletCount,
+			meshletTime, meshletTime > 0.0 ? triangleCount / meshletTime / 1000.0 : 0.0);
+	}
+}
+
+void Mesh::UploadBuffers(const void* vertexData, const void* indexData) {
+	const UINT numSubMeshes = static_cast<UINT>(SubMeshes.size());
+
+	// 0. 遮挡体在去重与重新打包之前提取，此时各SubMesh的偏移仍指向vertexData与indexData
+	ThreadPool::Get().ParallelFor(numSubMeshes, 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			ExtractOccluder(SubMeshes[i], vertexData, indexData);
+		}
+	});
+
+	UINT sharedCount = 0, keptVertices = 0;
+	UINT64 sharedBytes = 0;
+
+	// 1. 哈希各自独立，并行计算；查询与注册按顺序进行，同一Mesh内重复的SubMesh引用第一次出现的那个
+	if (Registry != nullptr) {
+		std::vector<SubMeshContent> contents(numSubMeshes);
+		ThreadPool::Get().ParallelFor(numSubMeshes, 1, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				contents[i] = SubMeshContentOf(SubMeshes[i], vertexData, indexData);
+				SubMeshes[i].ContentHash = contents[i].Hash();
+			}
+		});
+
+		for (UINT i = 0; i < numSubMeshes; ++i) {
+			SubMesh& submesh = SubMeshes[i];
+			if (Registry->Find(submesh.ContentHash, contents[i], submesh.SharedWith)) {
+				submesh.IsShared = true;
+				// 绘制与遮挡都使用SharedWith
+				submesh.OccluderPositions.clear();
+				submesh.OccluderPositions.shrink_to_fit();
+				submesh.OccluderIndices.clear();
+				submesh.OccluderIndices.shrink_to_fit();
+				sharedCount++;
+				sharedBytes += submesh.NumVertices * (PositionStrideInBytes + AttributeStrideInBytes);
+				for (const SubMeshLOD& lod : submesh.LODs) {
+					sharedBytes += lod.NumIndices * MeshOptimizer::IndexFormatSizeInBytes(submesh.IndexFormat);
+				}
+			}
+			else {
+				Registry->Add(submesh.ContentHash, contents[i], { MeshIndex, i });
+				keptVertices += submesh.NumVertices;
+			}
+		}
+	}
+
+	// 2. Meshlet只为实际上传的SubMesh生成，偏移仍指向vertexData与indexData
+	BuildMeshlets(vertexData, indexData);
+
+	if (sharedCount == 0) {
+		Geometry = mMeshManager->UploadGeometry(CompactVertices,
+			vertexData, AttributeOffsetInBytes, NumVertices,
+			indexData, IndexBufferSizeInBytes,
+			VertexBufferUploader, IndexBufferUploader);
+		return;
+	}
+
+	// 3. 只打包未命中的SubMesh，布局与VertexStreams相同
+	const BYTE* positions = static_cast<const BYTE*>(vertexData);
+	const BYTE* attributes = positions + AttributeOffsetInBytes;
+	const BYTE* indices = static_cast<const BYTE*>(indexData);
+
+	const UINT attributeOffset = (keptVertices * PositionStrideInBytes + 15) & ~15u;
+	std::vector<BYTE> keptVertexData(attributeOffset + keptVertices * AttributeStrideInBytes);
+	std::vector<BYTE> keptIndexData;
+
+	UINT baseVertex = 0;
+	for (SubMesh& submesh : SubMeshes) {
+		if (submesh.IsShared) {
+			continue;
+		}
+
+		std::memcpy(&keptVertexData[baseVertex * PositionStrideInBytes],
+			positions + submesh.BaseVertexLocation * PositionStrideInBytes, submesh.NumVertices * PositionStrideInBytes);
+		std::memcpy(&keptVertexData[attributeOffset + baseVertex * AttributeStrideInBytes],
+			attributes + submesh.BaseVertexLocation * AttributeStrideInBytes, submesh.NumVertices * AttributeStrideInBytes);
+		submesh.BaseVertexLocation = static_cast<INT>(baseVertex);
+		baseVertex += submesh.NumVertices;
+
+		// 各级LOD在PackIndexBuffer中连续存放，整体拷贝到4字节对齐的位置即可保持各自的对齐
+		const UINT indexSize = MeshOptimizer::IndexFormatSizeInBytes(submesh.IndexFormat);
+		UINT first = submesh.IndexBufferOffsetInBytes;
+		UINT last = first + submesh.NumIndices * indexSize;
+		for (const SubMeshLOD& lod : submesh.LODs) {
+			last = (std::max)(last, lod.IndexBufferOffsetInBytes + lod.NumIndices * indexSize);
+		}
+
+		UINT destination = static_cast<UINT>((keptIndexData.size() + 3) & ~size_t(3));
+		keptIndexData.resize(destination + (last - first));
+		std::memcpy(&keptIndexData[destination], indices + first, last - first);
+
+		for (SubMeshLOD& lod : submesh.LODs) {
+			lod.IndexBufferOffsetInBytes = lod.IndexBufferOffsetInBytes - first + destination;
+		}
+		submesh.IndexBufferOffsetInBytes = destination;
+	}
+	keptIndexData.resize((keptIndexData.size() + 3) & ~size_t(3));
+
+	Geometry = mMeshManager->UploadGeometry(CompactVertices,
+		keptVertexData.data(), attributeOffset, keptVertices,
+		keptIndexData.data(), static_cast<UINT>(keptIndexData.size()),
+		VertexBufferUploader, IndexBufferUploader);
+
+	Util::DebugLog("[Mesh] Deduplication: %u of %u submeshes already resident, %llu KB not uploaded\n",
+		sharedCount, numSubMeshes, sharedBytes / 1024);
+}
+
+void Mesh::ReleaseGeometry() {
+	mMeshManager->ReleaseGeometry(Geometry);
+	Meshlets = MeshletData();
+	VertexBufferUploader = nullptr;
+	IndexBufferUploader = nullptr;
+}
+
+void MeshManager::ImportMesh(const aiScene* pAiScene, MeshImportFlags importFlags) {
+	// 确定大小
 	UINT meshCountBefore = mMeshes.size();
 	UINT meshCountIncrement = pAiScene->mNumMeshes;
 	UINT meshCountAfter = meshCountBefore + meshCountIncrement;
@@ -13,14 +386,11 @@ void MeshManager::ImportMesh(const aiScene* pAiScene) {
 	const aiMesh* pAiMesh = nullptr;
 	// First Loop, construct metadata
 	for (UINT i = meshCountBefore; i < meshCountAfter; ++i) {
-		pAiMesh = pAiScene->mMeshes[i];
-
-		// дSubMeshes
-		mMeshes[i].VertexBufferIndex = mVertexBuffer.size();
-		mMeshes[i].IndexBufferIndex = mIndexBuffer.size();
+		pAiMesh = pAiScene->mMeshes[i - meshCountBefore];
 
+		// 写入SubMeshes描述符
 		mMeshes[i].VertexCount = pAiMesh->mNumVertices;
-		mMeshes[i].IndexCount = pAiMesh->mFaces->mNumIndices * pAiMesh->mNumFaces;
+		mMeshes[i].IndexCount = 3 * Mesh::CountTriangles(pAiMesh);
 
 		mMeshes[i].BaseVertexLocation = totalVertexCount;
 		mMeshes[i].StartIndexLocation = totalIndexCount;
@@ -31,58 +401,191 @@ void MeshManager::ImportMesh(const aiScene* pAiScene) {
 
 		mMeshes[i].MaterialIndex = pAiMesh->mMaterialIndex;
 
-		// ܼVertexIndex
+		// 总计Vertex和Index数量
 		totalVertexCount += mMeshes[i].VertexCount;
 		totalIndexCount += mMeshes[i].IndexCount;
 	}
 
-	// Buffer
-	VertexBuffer<Vertex> vertexBuffer(totalVertexCount);
-	IndexBuffer<UINT> indexBuffer(totalIndexCount, mIndexFormat);
-
 	mVertexBufferCPU.resize(totalVertexCount);
 	mIndexBufferCPU.resize(totalIndexCount);
 
 	// Second Loop, copy data
 	for (UINT i = meshCountBefore; i < meshCountAfter; ++i) {
-		pAiMesh = pAiScene->mMeshes[i];
-
-		// Vertex Buffer
-		for (unsigned int j = 0, k = mMeshes[i].BaseVertexLocation; j < mMeshes[i].VertexCount; ++j, ++k) {
-			mVertexBufferCPU[k].position = XMFLOAT3(reinterpret_cast<const float*>(&pAiMesh->mVertices[j]));
-			mVertexBufferCPU[k].normal = XMFLOAT3(reinterpret_cast<const float*>(&pAiMesh->mNormals[j]));
-			mVertexBufferCPU[k].tangent = XMFLOAT3(reinterpret_cast<const float*>(&pAiMesh->mTangents[j]));
-			mVertexBufferCPU[k].textureCoordinate = XMFLOAT2(reinterpret_cast<const float*>(&pAiMesh->mTextureCoords[0][j]));
-		}
-
-		// Index Buffer
-		unsigned int idx = mMeshes[i].StartIndexLocation;
-		for (UINT j = 0; j < pAiMesh->mNumFaces; ++j) {
-			for (UINT k = 0; k < pAiMesh->mFaces[j].mNumIndices; ++k) {
-				mIndexBufferCPU[idx] = pAiMesh->mFaces[j].mIndices[k];
-				idx++;
-			}
+		pAiMesh = pAiScene->mMeshes[i - meshCountBefore];
+
+		// 与Mesh::InitFromAssimp共用转换函数
+		Mesh::InterleaveVertices(mVertexBufferCPU.data() + mMeshes[i].BaseVertexLocation, pAiMesh, 0, pAiMesh->mNumVertices);
+		Mesh::CopyTriangleIndices(mIndexBufferCPU.data() + mMeshes[i].StartIndexLocation, pAiMesh, 0, pAiMesh->mNumFaces);
+
+		// 与Mesh::InitFromAssimp相同的优化流程: 先确定Index顺序，再据此重排Vertex
+		Vertex* vertices = &mVertexBufferCPU[mMeshes[i].BaseVertexLocation];
+		UINT* indices = &mIndexBufferCPU[mMeshes[i].StartIndexLocation];
+
+		if (importFlags & VertexCacheOptimization) {
+			MeshOptimizer::OptimizeVertexCache(indices, mMeshes[i].IndexCount, mMeshes[i].VertexCount);
 		}
 
+		if (importFlags & VertexFetchOptimization) {
+			MeshOptimizer::VertexFetchStats before = MeshOptimizer::AnalyzeVertexFetch(indices, mMeshes[i].IndexCount, mMeshes[i].VertexCount, sizeof(Vertex));
+			MeshOptimizer::OptimizeVertexFetch(vertices, indices, mMeshes[i].IndexCount, mMeshes[i].VertexCount);
+			MeshOptimizer::VertexFetchStats after = MeshOptimizer::AnalyzeVertexFetch(indices, mMeshes[i].IndexCount, mMeshes[i].VertexCount, sizeof(Vertex));
+
+			Util::DebugLog("[MeshManager] Mesh %u vertex fetch: overfetch %.3f -> %.3f\n", i, before.Overfetch, after.Overfetch);
+		}
 	}
 
+	// 包围体，各Mesh并行
+	ThreadPool::Get().ParallelFor(meshCountIncrement, 1, [&](size_t begin, size_t end) {
+		for (size_t i = meshCountBefore + begin; i < meshCountBefore + end; ++i) {
+			BoundingVolume volume = MeshBounds::Compute(&(mVertexBufferCPU.data() + mMeshes[i].BaseVertexLocation)->position,
+				mMeshes[i].VertexCount, sizeof(Vertex));
+			mMeshes[i].Bounds = volume.Box;
+			mMeshes[i].Sphere = volume.Sphere;
+		}
+	});
+
+	// 逐Mesh选择Index格式，每个Mesh的起始位置按其Index大小对齐
+	size_t indexBufferSizeInBytes = 0;
+	for (UINT i = meshCountBefore; i < meshCountAfter; ++i) {
+		mMeshes[i].IndexFormat = MeshOptimizer::ChooseIndexFormat(mMeshes[i].VertexCount);
+		UINT indexSize = MeshOptimizer::IndexFormatSizeInBytes(mMeshes[i].IndexFormat);
 
-	// Դ
+		indexBufferSizeInBytes = (indexBufferSizeInBytes + indexSize - 1) / indexSize * indexSize;
+		mMeshes[i].IndexBufferOffsetInBytes = static_cast<UINT>(indexBufferSizeInBytes);
+		indexBufferSizeInBytes += mMeshes[i].IndexCount * indexSize;
+	}
+	indexBufferSizeInBytes = (indexBufferSizeInBytes + 3) & ~size_t(3);
+
+	std::vector<BYTE> packedIndices(indexBufferSizeInBytes);
+	for (UINT i = meshCountBefore; i < meshCountAfter; ++i) {
+		MeshOptimizer::PackIndices(&packedIndices[mMeshes[i].IndexBufferOffsetInBytes],
+			&mIndexBufferCPU[mMeshes[i].StartIndexLocation], mMeshes[i].IndexCount, mMeshes[i].IndexFormat);
+	}
+
+	Util::DebugLog("[MeshManager] Index buffer: %u KB -> %u KB\n",
+		static_cast<UINT>(sizeof(UINT) * totalIndexCount / 1024), static_cast<UINT>(indexBufferSizeInBytes / 1024));
+
+	// 拆分为Position流与属性流，BLAS只读取紧密排列的Position
+	using Streams = VertexStreams<Vertex>;
+	std::vector<BYTE> vertexStreams(Streams::SizeInBytes(totalVertexCount));
+	Streams::Split(vertexStreams.data(), mVertexBufferCPU.data(), totalVertexCount);
+
+	// 上传到几何Arena，描述符中的位置改为Arena中的绝对位置
 	// TODO WaitFor
-	Util::UploadResource(mDevice.Get(), mCommandList.Get(),
-		reinterpret_cast<const void*>(mVertexBufferCPU.data()),
-		vertexBuffer.SizeInBytes(),
-		vertexBuffer.GetBuffer(),
-		mVertexBufferUploader);
+	GeometryAllocation allocation = UploadGeometry(false,
+		vertexStreams.data(), Streams::AttributeOffset(totalVertexCount), totalVertexCount,
+		packedIndices.data(), static_cast<UINT>(indexBufferSizeInBytes),
+		mVertexBufferUploader, mIndexBufferUploader);
 
-	Util::UploadResource(mDevice.Get(), mCommandList.Get(),
-		reinterpret_cast<const void*>(mIndexBufferCPU.data()),
-		indexBuffer.SizeInBytes(),
-		indexBuffer.GetBuffer(),
-		mIndexBufferUploader);
+	for (UINT i = meshCountBefore; i < meshCountAfter; ++i) {
+		mMeshes[i].BaseVertexLocation += allocation.BaseVertex;
+		mMeshes[i].IndexBufferOffsetInBytes += allocation.IndexOffsetInBytes;
+	}
 
-	mVertexBuffer.emplace_back(vertexBuffer);
-	mIndexBuffer.emplace_back(indexBuffer);
+	mImportAllocations.push_back(allocation);
+}
+
+GeometryAllocation MeshManager::UploadGeometry(bool compactVertices,
+	const void* vertexData, UINT attributeOffsetInBytes, UINT vertexCount,
+	const void* indexData, UINT indexSizeInBytes,
+	ComPtr<ID3D12Resource>& vertexUploader, ComPtr<ID3D12Resource>& indexUploader) {
+	GeometryAllocation allocation;
+	allocation.CompactVertices = compactVertices;
+
+	GeometryArena& vertexArena = mVertexArenas[compactVertices ? 1 : 0];
+	if (vertexCount > 0) {
+		UINT attributeSizeInBytes = vertexCount * vertexArena.ElementSize(1);
+
+		allocation.BaseVertex = static_cast<UINT>(vertexArena.Allocate(mCommandList.Get(), vertexCount));
+		allocation.VertexCount = vertexCount;
+
+		// 两个流共用一块Upload Buffer
+		Util::CreateUploadBuffer(mDevice.Get(), vertexData, attributeOffsetInBytes + attributeSizeInBytes, vertexUploader);
+		vertexArena.Upload(mCommandList.Get(), 0, allocation.BaseVertex, vertexCount, vertexUploader.Get(), 0);
+		vertexArena.Upload(mCommandList.Get(), 1, allocation.BaseVertex, vertexCount, vertexUploader.Get(), attributeOffsetInBytes);
+	}
+
+	if (indexSizeInBytes > 0) {
+		// Index数据在打包时已补齐到4字节
+		UINT indexUnits = indexSizeInBytes / 4;
+
+		allocation.IndexOffsetInBytes = static_cast<UINT>(mIndexArena.Allocate(mCommandList.Get(), indexUnits) * 4);
+		allocation.IndexSizeInBytes = indexSizeInBytes;
+
+		Util::CreateUploadBuffer(mDevice.Get(), indexData, indexSizeInBytes, indexUploader);
+		mIndexArena.Upload(mCommandList.Get(), 0, allocation.IndexOffsetInBytes / 4, indexUnits, indexUploader.Get(), 0);
+	}
+
+	return allocation;
+}
+
+void MeshManager::ReleaseGeometry(GeometryAllocation& allocation) {
+	if (!allocation.IsValid()) {
+		return;
+	}
+
+	mVertexArenas[allocation.CompactVertices ? 1 : 0].Free(allocation.BaseVertex, allocation.VertexCount);
+	mIndexArena.Free(allocation.IndexOffsetInBytes / 4, allocation.IndexSizeInBytes / 4);
+
+	allocation = GeometryAllocation();
+}
+
+D3D12_VERTEX_BUFFER_VIEW MeshManager::PositionBufferView(bool compactVertices) const {
+	const GeometryArena& arena = mVertexArenas[compactVertices ? 1 : 0];
+
+	D3D12_VERTEX_BUFFER_VIEW vbv;
+	vbv.BufferLocation = arena.Address(0);
+	vbv.SizeInBytes = static_cast<UINT>(arena.SizeInBytes(0));
+	vbv.StrideInBytes = arena.ElementSize(0);
+
+	return vbv;
+}
+
+D3D12_VERTEX_BUFFER_VIEW MeshManager::AttributeBufferView(bool compactVertices) const {
+	const GeometryArena& arena = mVertexArenas[compactVertices ? 1 : 0];
+
+	D3D12_VERTEX_BUFFER_VIEW vbv;
+	vbv.BufferLocation = arena.Address(1);
+	vbv.SizeInBytes = static_cast<UINT>(arena.SizeInBytes(1));
+	vbv.StrideInBytes = arena.ElementSize(1);
+
+	return vbv;
+}
+
+D3D12_INDEX_BUFFER_VIEW MeshManager::IndexBufferView(DXGI_FORMAT format) const {
+	D3D12_INDEX_BUFFER_VIEW ibv;
+	ibv.BufferLocation = mIndexArena.Address(0);
+	ibv.Format = format;
+	ibv.SizeInBytes = static_cast<UINT>(mIndexArena.SizeInBytes(0));
+
+	return ibv;
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS_AND_STRIDE MeshManager::PositionStreamAddressAndStride(bool compactVertices, UINT vertex) const {
+	const GeometryArena& arena = mVertexArenas[compactVertices ? 1 : 0];
+
+	D3D12_GPU_VIRTUAL_ADDRESS_AND_STRIDE ret = {};
+	ret.StartAddress = arena.Address(0, vertex);
+	ret.StrideInBytes = arena.ElementSize(0);
+	return ret;
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS MeshManager::IndexArenaAddress(UINT offsetInBytes) const {
+	return mIndexArena.Address(0) + offsetInBytes;
+}
+
+GeometryArenaStats MeshManager::VertexArenaStats(bool compactVertices) const {
+	return mVertexArenas[compactVertices ? 1 : 0].Stats();
+}
+
+GeometryArenaStats MeshManager::IndexArenaStats() const {
+	return mIndexArena.Stats();
+}
+
+void MeshManager::ReleaseRetiredBuffers() {
+	mVertexArenas[0].ReleaseRetiredBuffers();
+	mVertexArenas[1].ReleaseRetiredBuffers();
+	mIndexArena.ReleaseRetiredBuffers();
 }
 
 UINT MeshManager::MeshCount() const {
@@ -108,8 +611,7 @@ UINT MeshManager::MeshCount() const {
 //}
 
 D3D12_GPU_VIRTUAL_ADDRESS MeshManager::IndexBufferAddress(UINT meshIndex) const {
-	D3D12_INDEX_BUFFER_VIEW ibv = mIndexBuffer[mMeshes[meshIndex].IndexBufferIndex].IndexBufferView();
-	return ibv.BufferLocation + mMeshes[meshIndex].StartIndexLocation * sizeof(UINT);
+	return mIndexArena.Address(0) + mMeshes[meshIndex].IndexBufferOffsetInBytes;
 }
 
 UINT MeshManager::IndexCount(UINT meshIndex) const {
@@ -117,15 +619,13 @@ UINT MeshManager::IndexCount(UINT meshIndex) const {
 }
 
 DXGI_FORMAT MeshManager::IndexFormat(UINT meshIndex) const {
-	return mIndexFormat;
+	return mMeshes[meshIndex].IndexFormat;
 }
 
 D3D12_GPU_VIRTUAL_ADDRESS_AND_STRIDE MeshManager::VertexBufferAddressAndStride(UINT meshIndex) const {
 	D3D12_GPU_VIRTUAL_ADDRESS_AND_STRIDE ret = {};
-	D3D12_VERTEX_BUFFER_VIEW vbv = mVertexBuffer[mMeshes[meshIndex].VertexBufferIndex].VertexBufferView();
-
-	ret.StartAddress = vbv.BufferLocation + mMeshes[meshIndex].BaseVertexLocation * sizeof(Vertex);
-	ret.StrideInBytes = sizeof(Vertex);
+	ret.StartAddress = mVertexArenas[0].Address(0, mMeshes[meshIndex].BaseVertexLocation);
+	ret.StrideInBytes = mVertexArenas[0].ElementSize(0);
 
 	return ret;
 }
@@ -135,5 +635,6 @@ UINT MeshManager::VertexCount(UINT meshIndex) const {
 }
 
 DXGI_FORMAT MeshManager::VertexPositionFormat(UINT meshIndex) const {
-	return DXGI_FORMAT_R32G32B32A32_FLOAT;
+	return DXGI_FORMAT_R32G32B32_FLOAT;
 }
+
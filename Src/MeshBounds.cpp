@@ -0,0 +1,95 @@
+#include "MeshBounds.h"
+
+using namespace DirectX;
+
+namespace {
+	inline XMVECTOR LoadPosition(const BYTE* base, size_t index, size_t positionStride) {
+		return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(base + index * positionStride));
+	}
+}
+
+BoundingVolume MeshBounds::Compute(const XMFLOAT3* positions, size_t count, size_t positionStride) {
+	BoundingVolume volume;
+	if (count == 0) {
+		return volume;
+	}
+
+	const BYTE* base = reinterpret_cast<const BYTE*>(positions);
+
+	// 第一遍: AABB
+	// 四组独立的累加器，减少Min/Max之间的依赖
+	XMVECTOR min0 = LoadPosition(base, 0, positionStride);
+	XMVECTOR max0 = min0;
+	XMVECTOR min1 = min0, max1 = min0;
+	XMVECTOR min2 = min0, max2 = min0;
+	XMVECTOR min3 = min0, max3 = min0;
+
+	size_t i = 1;
+	for (; i + 4 <= count; i += 4) {
+		XMVECTOR p0 = LoadPosition(base, i + 0, positionStride);
+		XMVECTOR p1 = LoadPosition(base, i + 1, positionStride);
+		XMVECTOR p2 = LoadPosition(base, i + 2, positionStride);
+		XMVECTOR p3 = LoadPosition(base, i + 3, positionStride);
+
+		min0 = XMVectorMin(min0, p0); max0 = XMVectorMax(max0, p0);
+		min1 = XMVectorMin(min1, p1); max1 = XMVectorMax(max1, p1);
+		min2 = XMVectorMin(min2, p2); max2 = XMVectorMax(max2, p2);
+		min3 = XMVectorMin(min3, p3); max3 = XMVectorMax(max3, p3);
+	}
+	for (; i < count; ++i) {
+		XMVECTOR p = LoadPosition(base, i, positionStride);
+		min0 = XMVectorMin(min0, p);
+		max0 = XMVectorMax(max0, p);
+	}
+
+	XMVECTOR minimum = XMVectorMin(XMVectorMin(min0, min1), XMVectorMin(min2, min3));
+	XMVECTOR maximum = XMVectorMax(XMVectorMax(max0, max1), XMVectorMax(max2, max3));
+
+	XMVECTOR center = 0.5f * (minimum + maximum);
+	XMStoreFloat3(&volume.Box.Center, center);
+	XMStoreFloat3(&volume.Box.Extents, 0.5f * (maximum - minimum));
+
+	// 第二遍: 到AABB中心的最大距离
+	XMVECTOR r0 = XMVectorZero(), r1 = XMVectorZero(), r2 = XMVectorZero(), r3 = XMVectorZero();
+	i = 0;
+	for (; i + 4 <= count; i += 4) {
+		r0 = XMVectorMax(r0, XMVector3LengthSq(LoadPosition(base, i + 0, positionStride) - center));
+		r1 = XMVectorMax(r1, XMVector3LengthSq(LoadPosition(base, i + 1, positionStride) - center));
+		r2 = XMVectorMax(r2, XMVector3LengthSq(LoadPosition(base, i + 2, positionStride) - center));
+		r3 = XMVectorMax(r3, XMVector3LengthSq(LoadPosition(base, i + 3, positionStride) - center));
+	}
+	for (; i < count; ++i) {
+		r0 = XMVectorMax(r0, XMVector3LengthSq(LoadPosition(base, i, positionStride) - center));
+	}
+
+	XMVECTOR radiusSq = XMVectorMax(XMVectorMax(r0, r1), XMVectorMax(r2, r3));
+	volume.Sphere.Center = volume.Box.Center;
+	volume.Sphere.Radius = XMVectorGetX(XMVectorSqrt(radiusSq));
+
+	return volume;
+}
+
+BoundingVolume MeshBounds::Transform(const BoundingVolume& volume, FXMMATRIX transform) {
+	BoundingVolume result;
+
+	// 中心直接变换，半长为原半长与矩阵各元素绝对值的乘积之和，与变换8个角点后取AABB的结果相同
+	XMVECTOR extents = XMLoadFloat3(&volume.Box.Extents);
+	XMVECTOR newExtents = XMVectorAbs(transform.r[0]) * XMVectorSplatX(extents);
+	newExtents = XMVectorMultiplyAdd(XMVectorAbs(transform.r[1]), XMVectorSplatY(extents), newExtents);
+	newExtents = XMVectorMultiplyAdd(XMVectorAbs(transform.r[2]), XMVectorSplatZ(extents), newExtents);
+	XMStoreFloat3(&result.Box.Center, XMVector3Transform(XMLoadFloat3(&volume.Box.Center), transform));
+	XMStoreFloat3(&result.Box.Extents, newExtents);
+
+	volume.Sphere.Transform(result.Sphere, transform);
+	return result;
+}
+
+void MeshBounds::Merge(BoundingVolume& dst, const BoundingVolume& src, bool empty) {
+	if (empty) {
+		dst = src;
+		return;
+	}
+
+	BoundingBox::CreateMerged(dst.Box, BoundingBox(dst.Box), src.Box);
+	BoundingSphere::CreateMerged(dst.Sphere, BoundingSphere(dst.Sphere), src.Sphere);
+}
@@ -0,0 +1,379 @@
+#include "MeshCache.h"
+#include "Mesh.h"
+
+#include <fstream>
+
+namespace {
+	// 磁盘上的SubMesh，与内存中的结构分开定义以固定布局
+	struct CachedSubMesh {
+		UINT NumVertices;
+		UINT NumIndices;
+		INT BaseVertexLocation;
+		UINT StartIndexLocation;
+		UINT PrimitiveTopology;
+		UINT MaterialIndex;
+
+		XMFLOAT3 BoundsCenter;
+		XMFLOAT3 BoundsExtents;
+		XMFLOAT3 SphereCenter;
+		float SphereRadius;
+		XMFLOAT3 QuantizationScale;
+		XMFLOAT3 QuantizationOffset;
+
+		UINT IndexFormat;
+		UINT IndexBufferOffsetInBytes;
+		UINT FirstLOD;
+		UINT LODCount;
+	};
+
+	struct CachedMaterial {
+		XMFLOAT4 DiffuseAlbedo;
+		XMFLOAT3 FresnelR0;
+		float Roughness;
+		UINT FirstTextureRef;
+		UINT TextureRefCount;
+	};
+
+	struct CachedTextureRef {
+		UINT Slot;
+		UINT PathOffset;	// 字符串段中的位置
+		UINT PathLength;
+	};
+
+	static_assert(sizeof(SubMeshLOD) == 16, "SubMeshLOD is written to the cache as is");
+
+	UINT64 AlignUp(UINT64 value) {
+		return (value + 7) & ~UINT64(7);
+	}
+
+	void AppendBytes(std::vector<BYTE>& dst, const void* src, size_t size) {
+		const BYTE* bytes = reinterpret_cast<const BYTE*>(src);
+		dst.insert(dst.end(), bytes, bytes + size);
+	}
+}
+
+std::string MeshCache::CachePath(const std::string& modelPath) {
+	return modelPath + ".ezmesh";
+}
+
+UINT64 MeshCache::Hash(const void* data, size_t size, UINT64 hash) {
+	const BYTE* bytes = reinterpret_cast<const BYTE*>(data);
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+bool MeshCache::HashFile(const std::string& path, UINT64& hash) {
+	MappedFile file;
+	if (!file.Open(path)) {
+		return false;
+	}
+
+	hash = Hash(file.Data(), static_cast<size_t>(file.Size()));
+	return true;
+}
+
+// ----------------------------------- MappedFile -----------------------------------
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+bool MappedFile::Open(const std::string& path) {
+	Close();
+
+	mFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (mFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(mFile, &size) || size.QuadPart == 0) {
+		Close();
+		return false;
+	}
+	mSize = static_cast<UINT64>(size.QuadPart);
+
+	mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mMapping == nullptr) {
+		Close();
+		return false;
+	}
+
+	mData = reinterpret_cast<const BYTE*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+	if (mData == nullptr) {
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close() {
+	if (mData != nullptr) {
+		UnmapViewOfFile(mData);
+		mData = nullptr;
+	}
+	if (mMapping != nullptr) {
+		CloseHandle(mMapping);
+		mMapping = nullptr;
+	}
+	if (mFile != INVALID_HANDLE_VALUE) {
+		CloseHandle(mFile);
+		mFile = INVALID_HANDLE_VALUE;
+	}
+	mSize = 0;
+}
+
+// ----------------------------------- MeshCacheWriter -----------------------------------
+
+void MeshCacheWriter::SetMesh(const void* vertexData, UINT vertexDataSize,
+	UINT positionStride, UINT attributeStride, UINT attributeOffset, bool compactVertices,
+	const void* indexData, UINT indexDataSize,
+	UINT numVertices, UINT numIndices, const std::vector<SubMesh>& submeshes) {
+	mVertexData.clear();
+	mIndexData.clear();
+	AppendBytes(mVertexData, vertexData, vertexDataSize);
+	AppendBytes(mIndexData, indexData, indexDataSize);
+
+	mPositionStride = positionStride;
+	mAttributeStride = attributeStride;
+	mAttributeOffset = attributeOffset;
+	mCompactVertices = compactVertices;
+	mNumVertices = numVertices;
+	mNumIndices = numIndices;
+
+	mSubMeshes.clear();
+	mLODs.clear();
+	mSubMeshCount = static_cast<UINT>(submeshes.size());
+	mLODCount = 0;
+
+	for (const SubMesh& submesh : submeshes) {
+		CachedSubMesh cached = {};
+		cached.NumVertices = submesh.NumVertices;
+		cached.NumIndices = submesh.NumIndices;
+		cached.BaseVertexLocation = submesh.BaseVertexLocation;
+		cached.StartIndexLocation = submesh.StartIndexLocation;
+		cached.PrimitiveTopology = static_cast<UINT>(submesh.PrimitiveTopology);
+		cached.MaterialIndex = submesh.MaterialIndex;
+		cached.BoundsCenter = submesh.Bounds.Center;
+		cached.BoundsExtents = submesh.Bounds.Extents;
+		cached.SphereCenter = submesh.Sphere.Center;
+		cached.SphereRadius = submesh.Sphere.Radius;
+		cached.QuantizationScale = submesh.Quantization.Scale;
+		cached.QuantizationOffset = submesh.Quantization.Offset;
+		cached.IndexFormat = static_cast<UINT>(submesh.IndexFormat);
+		cached.IndexBufferOffsetInBytes = submesh.IndexBufferOffsetInBytes;
+		cached.FirstLOD = mLODCount;
+		cached.LODCount = static_cast<UINT>(submesh.LODs.size());
+
+		AppendBytes(mSubMeshes, &cached, sizeof(cached));
+		AppendBytes(mLODs, submesh.LODs.data(), sizeof(SubMeshLOD) * submesh.LODs.size());
+		mLODCount += cached.LODCount;
+	}
+}
+
+void MeshCacheWriter::SetMaterials(const std::vector<MaterialDesc>& materials) {
+	mMaterials = materials;
+}
+
+bool MeshCacheWriter::Write(const std::string& path, UINT64 sourceHash, UINT32 importFlags) const {
+	std::vector<BYTE> materials, textureRefs, strings;
+	UINT textureRefCount = 0;
+	for (const MaterialDesc& desc : mMaterials) {
+		CachedMaterial cached = {};
+		cached.DiffuseAlbedo = desc.DiffuseAlbedo;
+		cached.FresnelR0 = desc.FresnelR0;
+		cached.Roughness = desc.Roughness;
+		cached.FirstTextureRef = textureRefCount;
+		cached.TextureRefCount = static_cast<UINT>(desc.Textures.size());
+		AppendBytes(materials, &cached, sizeof(cached));
+
+		for (const MaterialTextureRef& texture : desc.Textures) {
+			CachedTextureRef ref = {};
+			ref.Slot = static_cast<UINT>(texture.Slot);
+			ref.PathOffset = static_cast<UINT>(strings.size());
+			ref.PathLength = static_cast<UINT>(texture.RelativePath.size());
+			AppendBytes(textureRefs, &ref, sizeof(ref));
+			AppendBytes(strings, texture.RelativePath.data(), texture.RelativePath.size());
+			textureRefCount++;
+		}
+	}
+
+	MeshCacheHeader header = {};
+	header.Magic = MeshCache::kMagic;
+	header.Version = MeshCache::kVersion;
+	header.SourceHash = sourceHash;
+	header.ImportFlags = importFlags;
+	header.NumVertices = mNumVertices;
+	header.NumIndices = mNumIndices;
+	header.PositionStrideInBytes = mPositionStride;
+	header.AttributeStrideInBytes = mAttributeStride;
+	header.AttributeOffsetInBytes = mAttributeOffset;
+	header.CompactVertices = mCompactVertices ? 1 : 0;
+	header.SubMeshCount = mSubMeshCount;
+	header.LODCount = mLODCount;
+	header.MaterialCount = static_cast<UINT32>(mMaterials.size());
+	header.TextureRefCount = textureRefCount;
+
+	// 依次排列各段
+	UINT64 offset = AlignUp(sizeof(MeshCacheHeader));
+	auto Place = [&offset](UINT64& sectionOffset, UINT64 size) {
+		sectionOffset = offset;
+		offset = AlignUp(offset + size);
+	};
+	header.VertexDataSize = mVertexData.size();
+	header.IndexDataSize = mIndexData.size();
+	header.StringSize = strings.size();
+	Place(header.VertexDataOffset, header.VertexDataSize);
+	Place(header.IndexDataOffset, header.IndexDataSize);
+	Place(header.SubMeshOffset, mSubMeshes.size());
+	Place(header.LODOffset, mLODs.size());
+	Place(header.MaterialOffset, materials.size());
+	Place(header.TextureRefOffset, textureRefs.size());
+	Place(header.StringOffset, strings.size());
+
+	const std::string tempPath = path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file) {
+			return false;
+		}
+
+		auto WriteSection = [&file](UINT64 sectionOffset, const void* data, size_t size) {
+			const char zeros[8] = {};
+			UINT64 position = static_cast<UINT64>(file.tellp());
+			file.write(zeros, static_cast<std::streamsize>(sectionOffset - position));
+			file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+		};
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		WriteSection(header.VertexDataOffset, mVertexData.data(), mVertexData.size());
+		WriteSection(header.IndexDataOffset, mIndexData.data(), mIndexData.size());
+		WriteSection(header.SubMeshOffset, mSubMeshes.data(), mSubMeshes.size());
+		WriteSection(header.LODOffset, mLODs.data(), mLODs.size());
+		WriteSection(header.MaterialOffset, materials.data(), materials.size());
+		WriteSection(header.TextureRefOffset, textureRefs.data(), textureRefs.size());
+		WriteSection(header.StringOffset, strings.data(), strings.size());
+
+		if (!file) {
+			return false;
+		}
+	}
+
+	return MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+// ----------------------------------- MeshCacheView -----------------------------------
+
+bool MeshCacheView::ValidateSection(UINT64 offset, UINT64 size) const {
+	return offset <= mFile.Size() && size <= mFile.Size() - offset;
+}
+
+bool MeshCacheView::Open(const std::string& path, UINT64 sourceHash, UINT32 importFlags) {
+	mHeader = nullptr;
+	if (!mFile.Open(path)) {
+		return false;
+	}
+
+	if (mFile.Size() < sizeof(MeshCacheHeader)) {
+		Util::DebugLog("[MeshCache] %s: truncated\n", path.c_str());
+		return false;
+	}
+
+	const MeshCacheHeader* header = reinterpret_cast<const MeshCacheHeader*>(mFile.Data());
+	if (header->Magic != MeshCache::kMagic || header->Version != MeshCache::kVersion) {
+		Util::DebugLog("[MeshCache] %s: version %u, expected %u\n", path.c_str(), header->Version, MeshCache::kVersion);
+		return false;
+	}
+	if (header->SourceHash != sourceHash || header->ImportFlags != importFlags) {
+		Util::DebugLog("[MeshCache] %s: stale (source or import flags changed)\n", path.c_str());
+		return false;
+	}
+
+	mHeader = header;
+	bool valid =
+		ValidateSection(header->VertexDataOffset, header->VertexDataSize) &&
+		ValidateSection(header->IndexDataOffset, header->IndexDataSize) &&
+		ValidateSection(header->SubMeshOffset, UINT64(header->SubMeshCount) * sizeof(CachedSubMesh)) &&
+		ValidateSection(header->LODOffset, UINT64(header->LODCount) * sizeof(SubMeshLOD)) &&
+		ValidateSection(header->MaterialOffset, UINT64(header->MaterialCount) * sizeof(CachedMaterial)) &&
+		ValidateSection(header->TextureRefOffset, UINT64(header->TextureRefCount) * sizeof(CachedTextureRef)) &&
+		ValidateSection(header->StringOffset, header->StringSize) &&
+		UINT64(header->NumVertices) * header->PositionStrideInBytes <= header->AttributeOffsetInBytes &&
+		header->VertexDataSize == header->AttributeOffsetInBytes + UINT64(header->NumVertices) * header->AttributeStrideInBytes;
+
+	if (!valid) {
+		Util::DebugLog("[MeshCache] %s: corrupted\n", path.c_str());
+		mHeader = nullptr;
+	}
+	return valid;
+}
+
+void MeshCacheView::ReadSubMeshes(std::vector<SubMesh>& submeshes) const {
+	const CachedSubMesh* cached = reinterpret_cast<const CachedSubMesh*>(mFile.Data() + mHeader->SubMeshOffset);
+	const SubMeshLOD* lods = reinterpret_cast<const SubMeshLOD*>(mFile.Data() + mHeader->LODOffset);
+
+	submeshes.resize(mHeader->SubMeshCount);
+	for (UINT i = 0; i < mHeader->SubMeshCount; ++i) {
+		SubMesh& submesh = submeshes[i];
+		submesh.NumVertices = cached[i].NumVertices;
+		submesh.NumIndices = cached[i].NumIndices;
+		submesh.BaseVertexLocation = cached[i].BaseVertexLocation;
+		submesh.StartIndexLocation = cached[i].StartIndexLocation;
+		submesh.PrimitiveTopology = static_cast<D3D_PRIMITIVE_TOPOLOGY>(cached[i].PrimitiveTopology);
+		submesh.MaterialIndex = cached[i].MaterialIndex;
+		submesh.Bounds = BoundingBox(cached[i].BoundsCenter, cached[i].BoundsExtents);
+		submesh.Sphere = BoundingSphere(cached[i].SphereCenter, cached[i].SphereRadius);
+		submesh.Quantization.Scale = cached[i].QuantizationScale;
+		submesh.Quantization.Offset = cached[i].QuantizationOffset;
+		submesh.IndexFormat = static_cast<DXGI_FORMAT>(cached[i].IndexFormat);
+		submesh.IndexBufferOffsetInBytes = cached[i].IndexBufferOffsetInBytes;
+
+		// 越界的LOD表视为没有LOD，只保留LOD 0
+		if (UINT64(cached[i].FirstLOD) + cached[i].LODCount <= mHeader->LODCount && cached[i].LODCount > 0) {
+			submesh.LODs.assign(lods + cached[i].FirstLOD, lods + cached[i].FirstLOD + cached[i].LODCount);
+		}
+		else {
+			SubMeshLOD lod;
+			lod.StartIndexLocation = submesh.StartIndexLocation;
+			lod.NumIndices = submesh.NumIndices;
+			lod.IndexBufferOffsetInBytes = submesh.IndexBufferOffsetInBytes;
+			submesh.LODs.assign(1, lod);
+		}
+	}
+}
+
+void MeshCacheView::ReadMaterials(std::vector<MaterialDesc>& materials) const {
+	const CachedMaterial* cached = reinterpret_cast<const CachedMaterial*>(mFile.Data() + mHeader->MaterialOffset);
+	const CachedTextureRef* refs = reinterpret_cast<const CachedTextureRef*>(mFile.Data() + mHeader->TextureRefOffset);
+	const char* strings = reinterpret_cast<const char*>(mFile.Data() + mHeader->StringOffset);
+
+	materials.resize(mHeader->MaterialCount);
+	for (UINT i = 0; i < mHeader->MaterialCount; ++i) {
+		materials[i].DiffuseAlbedo = cached[i].DiffuseAlbedo;
+		materials[i].FresnelR0 = cached[i].FresnelR0;
+		materials[i].Roughness = cached[i].Roughness;
+		materials[i].Textures.clear();
+
+		for (UINT j = 0; j < cached[i].TextureRefCount; ++j) {
+			UINT64 refIndex = UINT64(cached[i].FirstTextureRef) + j;
+			if (refIndex >= mHeader->TextureRefCount) {
+				break;
+			}
+
+			const CachedTextureRef& ref = refs[refIndex];
+			if (UINT64(ref.PathOffset) + ref.PathLength > mHeader->StringSize) {
+				continue;
+			}
+
+			MaterialTextureRef texture;
+			texture.Slot = static_cast<TextureType>(ref.Slot);
+			texture.RelativePath.assign(strings + ref.PathOffset, ref.PathLength);
+			materials[i].Textures.push_back(std::move(texture));
+		}
+	}
+}
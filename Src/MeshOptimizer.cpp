@@ -0,0 +1,303 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+	// Forsyth算法中模拟的缓存大小，与硬件的实际大小无关
+	const UINT kMaxCacheSize = 32;
+	const UINT kMaxValence = 32;
+
+	const float kCacheDecayPower = 1.5f;
+	const float kLastTriangleScore = 0.75f;
+	const float kValenceBoostScale = 2.0f;
+	const float kValenceBoostPower = 0.5f;
+
+	struct VertexScoreTable {
+		VertexScoreTable() {
+			for (UINT i = 0; i < kMaxCacheSize; ++i) {
+				// 刚使用过的三个顶点属于上一个三角形，给予固定分数，防止总是选择相邻三角形导致条带过长
+				if (i < 3) {
+					Cache[i] = kLastTriangleScore;
+				}
+				else {
+					const float scaler = 1.0f / (kMaxCacheSize - 3);
+					Cache[i] = std::pow(1.0f - (i - 3) * scaler, kCacheDecayPower);
+				}
+			}
+
+			// 剩余价(Valence)越少的顶点越应尽快处理，以便将其移出缓存
+			Valence[0] = 0.0f;
+			for (UINT i = 1; i <= kMaxValence; ++i) {
+				Valence[i] = kValenceBoostScale * std::pow(static_cast<float>(i), -kValenceBoostPower);
+			}
+		}
+
+		float Cache[kMaxCacheSize];
+		float Valence[kMaxValence + 1];
+	};
+
+	const VertexScoreTable gScoreTable;
+
+	float VertexScore(int cachePosition, UINT remainingValence) {
+		if (remainingValence == 0) {
+			return -1.0f;
+		}
+
+		float score = cachePosition >= 0 ? gScoreTable.Cache[cachePosition] : 0.0f;
+		if (remainingValence <= kMaxValence) {
+			score += gScoreTable.Valence[remainingValence];
+		}
+		else {
+			score += kValenceBoostScale * std::pow(static_cast<float>(remainingValence), -kValenceBoostPower);
+		}
+
+		return score;
+	}
+}
+
+MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const UINT* indices, size_t indexCount, size_t vertexCount, UINT cacheSize) {
+	VertexCacheStats stats;
+	stats.TriangleCount = static_cast<UINT>(indexCount / 3);
+
+	// 以时间戳实现FIFO: 顶点进入缓存的时间距今超过cacheSize即视为已被挤出
+	std::vector<UINT> timestamps(vertexCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+	UINT time = cacheSize + 1;
+
+	for (size_t i = 0; i < indexCount; ++i) {
+		UINT index = indices[i];
+		if (time - timestamps[index] > cacheSize) {
+			timestamps[index] = time++;
+			stats.VerticesTransformed++;
+		}
+
+		if (!referenced[index]) {
+			referenced[index] = true;
+			stats.VertexCount++;
+		}
+	}
+
+	stats.ACMR = stats.TriangleCount > 0 ? static_cast<float>(stats.VerticesTransformed) / stats.TriangleCount : 0.0f;
+	stats.ATVR = stats.VertexCount > 0 ? static_cast<float>(stats.VerticesTransformed) / stats.VertexCount : 0.0f;
+
+	return stats;
+}
+
+void MeshOptimizer::OptimizeVertexCache(UINT* indices, size_t indexCount, size_t vertexCount) {
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || vertexCount == 0) {
+		return;
+	}
+
+	// 1. 构建顶点 -> 三角形的邻接表(CSR格式)
+	std::vector<UINT> remainingValence(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; ++i) {
+		remainingValence[indices[i]]++;
+	}
+
+	std::vector<UINT> adjacencyOffset(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; ++v) {
+		adjacencyOffset[v + 1] = adjacencyOffset[v] + remainingValence[v];
+	}
+
+	std::vector<UINT> adjacency(triangleCount * 3);
+	{
+		std::vector<UINT> cursor(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+		for (size_t t = 0; t < triangleCount; ++t) {
+			for (UINT k = 0; k < 3; ++k) {
+				adjacency[cursor[indices[t * 3 + k]]++] = static_cast<UINT>(t);
+			}
+		}
+	}
+
+	// 2. 初始分数
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v) {
+		vertexScore[v] = VertexScore(-1, remainingValence[v]);
+	}
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; ++t) {
+		triangleScore[t] = vertexScore[indices[t * 3 + 0]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+	}
+
+	// 3. 贪心地选择分数最高的三角形
+	std::vector<UINT> output;
+	output.reserve(triangleCount * 3);
+
+	UINT cache[kMaxCacheSize + 3];
+	UINT cacheCount = 0;
+
+	size_t scanCursor = 0;
+	INT64 bestTriangle = -1;
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+		// 缓存中没有可用的三角形时，按原顺序取下一个未输出的三角形
+		if (bestTriangle < 0) {
+			while (emitted[scanCursor]) {
+				scanCursor++;
+			}
+			bestTriangle = static_cast<INT64>(scanCursor);
+		}
+
+		const UINT* tri = &indices[bestTriangle * 3];
+		emitted[bestTriangle] = true;
+
+		UINT newCache[kMaxCacheSize + 3];
+		UINT newCacheCount = 0;
+
+		for (UINT k = 0; k < 3; ++k) {
+			UINT v = tri[k];
+			output.push_back(v);
+
+			// 从邻接表中移除该三角形: 与未处理部分的末尾交换
+			UINT* begin = &adjacency[adjacencyOffset[v]];
+			UINT* end = begin + remainingValence[v];
+			for (UINT* it = begin; it != end; ++it) {
+				if (*it == static_cast<UINT>(bestTriangle)) {
+					std::swap(*it, *(end - 1));
+					break;
+				}
+			}
+			remainingValence[v]--;
+
+			// 退化三角形中重复的顶点只进入缓存一次
+			bool duplicated = false;
+			for (UINT c = 0; c < newCacheCount; ++c) {
+				duplicated |= newCache[c] == v;
+			}
+			if (!duplicated) {
+				newCache[newCacheCount++] = v;
+			}
+		}
+
+		// 新三角形的顶点移至缓存头部，其余顶点依次后移
+		for (UINT c = 0; c < cacheCount; ++c) {
+			UINT v = cache[c];
+			if (v != tri[0] && v != tri[1] && v != tri[2]) {
+				newCache[newCacheCount++] = v;
+			}
+		}
+
+		// 更新缓存中(及刚被挤出缓存)顶点的分数，并将分数变化量累加到相邻三角形上
+		for (UINT c = 0; c < newCacheCount; ++c) {
+			UINT v = newCache[c];
+			cachePosition[v] = c < kMaxCacheSize ? static_cast<int>(c) : -1;
+
+			float score = VertexScore(cachePosition[v], remainingValence[v]);
+			float delta = score - vertexScore[v];
+			vertexScore[v] = score;
+
+			const UINT* adjBegin = &adjacency[adjacencyOffset[v]];
+			for (UINT a = 0; a < remainingValence[v]; ++a) {
+				triangleScore[adjBegin[a]] += delta;
+			}
+		}
+
+		cacheCount = newCacheCount < kMaxCacheSize ? newCacheCount : kMaxCacheSize;
+		std::memcpy(cache, newCache, cacheCount * sizeof(UINT));
+
+		// 只在缓存中顶点的相邻三角形中寻找下一个三角形
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (UINT c = 0; c < cacheCount; ++c) {
+			UINT v = cache[c];
+			const UINT* adjBegin = &adjacency[adjacencyOffset[v]];
+			for (UINT a = 0; a < remainingValence[v]; ++a) {
+				UINT t = adjBegin[a];
+				if (triangleScore[t] > bestScore) {
+					bestScore = triangleScore[t];
+					bestTriangle = t;
+				}
+			}
+		}
+	}
+
+	std::memcpy(indices, output.data(), output.size() * sizeof(UINT));
+}
+
+MeshOptimizer::VertexFetchStats MeshOptimizer::AnalyzeVertexFetch(const UINT* indices, size_t indexCount, size_t vertexCount, size_t vertexSize) {
+	const size_t kCacheLineSize = 64;
+	const UINT kCacheLineCount = 64;
+
+	VertexFetchStats stats;
+
+	// 与AnalyzeVertexCache相同，以时间戳实现FIFO
+	size_t lineCount = (vertexCount * vertexSize + kCacheLineSize - 1) / kCacheLineSize;
+	std::vector<UINT> timestamps(lineCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+	UINT time = kCacheLineCount + 1;
+	size_t referencedCount = 0;
+
+	for (size_t i = 0; i < indexCount; ++i) {
+		UINT index = indices[i];
+		if (!referenced[index]) {
+			referenced[index] = true;
+			referencedCount++;
+		}
+
+		// 一个顶点可能跨越两条Cache Line
+		size_t startLine = index * vertexSize / kCacheLineSize;
+		size_t endLine = ((index + 1) * vertexSize - 1) / kCacheLineSize;
+		for (size_t line = startLine; line <= endLine; ++line) {
+			if (time - timestamps[line] > kCacheLineCount) {
+				timestamps[line] = time++;
+				stats.BytesFetched += kCacheLineSize;
+			}
+		}
+	}
+
+	stats.Overfetch = referencedCount > 0 ? static_cast<float>(stats.BytesFetched) / (referencedCount * vertexSize) : 0.0f;
+
+	return stats;
+}
+
+void MeshOptimizer::BuildVertexFetchRemap(UINT* remap, const UINT* indices, size_t indexCount, size_t vertexCount) {
+	const UINT kUnassigned = ~0u;
+	std::fill(remap, remap + vertexCount, kUnassigned);
+
+	UINT next = 0;
+	for (size_t i = 0; i < indexCount; ++i) {
+		UINT index = indices[i];
+		if (remap[index] == kUnassigned) {
+			remap[index] = next++;
+		}
+	}
+
+	for (size_t v = 0; v < vertexCount; ++v) {
+		if (remap[v] == kUnassigned) {
+			remap[v] = next++;
+		}
+	}
+}
+
+void MeshOptimizer::RemapIndexBuffer(UINT* indices, size_t indexCount, const UINT* remap) {
+	for (size_t i = 0; i < indexCount; ++i) {
+		indices[i] = remap[indices[i]];
+	}
+}
+
+DXGI_FORMAT MeshOptimizer::ChooseIndexFormat(size_t vertexCount) {
+	return vertexCount <= 65536 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+}
+
+UINT MeshOptimizer::IndexFormatSizeInBytes(DXGI_FORMAT format) {
+	return format == DXGI_FORMAT_R16_UINT ? sizeof(UINT16) : sizeof(UINT);
+}
+
+size_t MeshOptimizer::PackIndices(void* dst, const UINT* indices, size_t indexCount, DXGI_FORMAT format) {
+	if (format == DXGI_FORMAT_R16_UINT) {
+		UINT16* dst16 = static_cast<UINT16*>(dst);
+		for (size_t i = 0; i < indexCount; ++i) {
+			dst16[i] = static_cast<UINT16>(indices[i]);
+		}
+		return indexCount * sizeof(UINT16);
+	}
+
+	std::memcpy(dst, indices, indexCount * sizeof(UINT));
+	return indexCount * sizeof(UINT);
+}
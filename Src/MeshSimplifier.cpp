@@ -0,0 +1,295 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+using DirectX::XMFLOAT3;
+
+namespace {
+	// 对称矩阵 A = n * n^T 的上三角、b = d * n、c = d^2，以及累加的面积权重
+	struct Quadric {
+		double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+		double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+		double c = 0.0;
+		double w = 0.0;
+
+		void Add(const Quadric& q) {
+			a00 += q.a00; a01 += q.a01; a02 += q.a02;
+			a11 += q.a11; a12 += q.a12; a22 += q.a22;
+			b0 += q.b0; b1 += q.b1; b2 += q.b2;
+			c += q.c;
+			w += q.w;
+		}
+
+		// 平面 n·p + d = 0 上的误差乘以weight
+		static Quadric FromPlane(double nx, double ny, double nz, double d, double weight) {
+			Quadric q;
+			q.a00 = weight * nx * nx; q.a01 = weight * nx * ny; q.a02 = weight * nx * nz;
+			q.a11 = weight * ny * ny; q.a12 = weight * ny * nz; q.a22 = weight * nz * nz;
+			q.b0 = weight * nx * d; q.b1 = weight * ny * d; q.b2 = weight * nz * d;
+			q.c = weight * d * d;
+			q.w = weight;
+			return q;
+		}
+
+		// 到各平面距离平方的加权平均
+		double Evaluate(const XMFLOAT3& p) const {
+			double x = p.x, y = p.y, z = p.z;
+			double error =
+				a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z +
+				a11 * y * y + 2.0 * a12 * y * z + a22 * z * z +
+				2.0 * (b0 * x + b1 * y + b2 * z) + c;
+
+			return w > 0.0 ? (std::max)(error, 0.0) / w : 0.0;
+		}
+	};
+
+	struct Collapse {
+		UINT From;
+		UINT To;
+		double Error;
+	};
+
+	const XMFLOAT3& PositionAt(const XMFLOAT3* positions, size_t positionStride, UINT index) {
+		return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const BYTE*>(positions) + index * positionStride);
+	}
+
+	// 三角形法线，未归一化
+	void TriangleNormal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2, double n[3]) {
+		double e1[3] = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+		double e2[3] = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+		n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+	}
+
+	UINT64 EdgeKey(UINT a, UINT b) {
+		return (UINT64(a) << 32) | b;
+	}
+}
+
+size_t MeshSimplifier::Simplify(UINT* destination, const UINT* indices, size_t indexCount,
+	const XMFLOAT3* positions, size_t vertexCount, size_t positionStride,
+	size_t targetIndexCount, float targetError, float* resultError) {
+	std::vector<UINT> result(indices, indices + indexCount);
+	double maxError = 0.0;
+
+	// 1. 位置相同的顶点视为同一个点，接缝两侧的顶点需锁定
+	std::vector<UINT> positionRemap(vertexCount);
+	std::vector<bool> locked(vertexCount, false);
+	{
+		struct PositionHash {
+			size_t operator()(const XMFLOAT3& p) const {
+				UINT h[3];
+				std::memcpy(h, &p, sizeof(h));
+				return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+			}
+		};
+		struct PositionEqual {
+			bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const {
+				return a.x == b.x && a.y == b.y && a.z == b.z;
+			}
+		};
+
+		std::unordered_map<XMFLOAT3, UINT, PositionHash, PositionEqual> firstVertex;
+		firstVertex.reserve(vertexCount);
+		for (UINT v = 0; v < vertexCount; ++v) {
+			auto [it, inserted] = firstVertex.emplace(PositionAt(positions, positionStride, v), v);
+			positionRemap[v] = it->second;
+			if (!inserted) {
+				locked[v] = true;
+				locked[it->second] = true;
+			}
+		}
+	}
+
+	// 2. 开放边界: 有向边(a, b)没有对应的反向边(b, a)
+	{
+		std::unordered_map<UINT64, UINT> directedEdges;
+		directedEdges.reserve(indexCount);
+		for (size_t i = 0; i < indexCount; i += 3) {
+			for (UINT k = 0; k < 3; ++k) {
+				UINT a = positionRemap[indices[i + k]];
+				UINT b = positionRemap[indices[i + (k + 1) % 3]];
+				directedEdges[EdgeKey(a, b)]++;
+			}
+		}
+
+		for (size_t i = 0; i < indexCount; i += 3) {
+			for (UINT k = 0; k < 3; ++k) {
+				UINT a = indices[i + k];
+				UINT b = indices[i + (k + 1) % 3];
+				if (directedEdges.count(EdgeKey(positionRemap[b], positionRemap[a])) == 0) {
+					locked[a] = true;
+					locked[b] = true;
+				}
+			}
+		}
+	}
+
+	// 3. 每个顶点的误差二次型为相邻三角形所在平面的面积加权和
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < indexCount; i += 3) {
+		const XMFLOAT3& p0 = PositionAt(positions, positionStride, indices[i + 0]);
+		const XMFLOAT3& p1 = PositionAt(positions, positionStride, indices[i + 1]);
+		const XMFLOAT3& p2 = PositionAt(positions, positionStride, indices[i + 2]);
+
+		double n[3];
+		TriangleNormal(p0, p1, p2, n);
+		double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (length == 0.0) {
+			continue;
+		}
+		n[0] /= length; n[1] /= length; n[2] /= length;
+		double d = -(n[0] * p0.x + n[1] * p0.y + n[2] * p0.z);
+
+		Quadric q = Quadric::FromPlane(n[0], n[1], n[2], d, 0.5 * length);
+		for (UINT k = 0; k < 3; ++k) {
+			quadrics[indices[i + k]].Add(q);
+		}
+	}
+
+	// 4. 多轮坍缩，每轮中一个顶点的一环邻域内至多发生一次坍缩，使邻接关系在本轮内保持有效
+	std::vector<UINT> adjacencyOffset(vertexCount + 1);
+	std::vector<UINT> adjacency;
+	std::vector<UINT> remap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	std::vector<Collapse> collapses;
+
+	while (result.size() > targetIndexCount) {
+		size_t triangleCount = result.size() / 3;
+
+		// 顶点 -> 三角形
+		std::fill(adjacencyOffset.begin(), adjacencyOffset.end(), 0);
+		for (UINT index : result) {
+			adjacencyOffset[index + 1]++;
+		}
+		for (size_t v = 0; v < vertexCount; ++v) {
+			adjacencyOffset[v + 1] += adjacencyOffset[v];
+		}
+		adjacency.resize(result.size());
+		{
+			std::vector<UINT> cursor(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+			for (size_t t = 0; t < triangleCount; ++t) {
+				for (UINT k = 0; k < 3; ++k) {
+					adjacency[cursor[result[t * 3 + k]]++] = static_cast<UINT>(t);
+				}
+			}
+		}
+
+		// 候选的坍缩: 每条边的两个方向
+		collapses.clear();
+		for (size_t t = 0; t < triangleCount; ++t) {
+			for (UINT k = 0; k < 3; ++k) {
+				UINT a = result[t * 3 + k];
+				UINT b = result[t * 3 + (k + 1) % 3];
+				const XMFLOAT3& pa = PositionAt(positions, positionStride, a);
+				const XMFLOAT3& pb = PositionAt(positions, positionStride, b);
+
+				if (!locked[a]) {
+					Quadric q = quadrics[a];
+					q.Add(quadrics[b]);
+					collapses.push_back({ a, b, q.Evaluate(pb) });
+				}
+				if (!locked[b]) {
+					Quadric q = quadrics[b];
+					q.Add(quadrics[a]);
+					collapses.push_back({ b, a, q.Evaluate(pa) });
+				}
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) {
+			return lhs.Error < rhs.Error;
+		});
+
+		for (UINT v = 0; v < vertexCount; ++v) {
+			remap[v] = v;
+		}
+		std::fill(touched.begin(), touched.end(), false);
+
+		// 每次坍缩约减少两个三角形
+		size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+		size_t trianglesRemoved = 0;
+		UINT collapseCount = 0;
+
+		for (const Collapse& collapse : collapses) {
+			if (trianglesRemoved >= trianglesToRemove) {
+				break;
+			}
+			if (std::sqrt(collapse.Error) > targetError) {
+				break;
+			}
+			if (touched[collapse.From] || touched[collapse.To]) {
+				continue;
+			}
+
+			// 拒绝导致三角形翻转的坍缩
+			const XMFLOAT3& target = PositionAt(positions, positionStride, collapse.To);
+			bool flipped = false;
+			size_t removed = 0;
+			for (UINT a = adjacencyOffset[collapse.From]; a < adjacencyOffset[collapse.From + 1] && !flipped; ++a) {
+				const UINT* tri = &result[adjacency[a] * 3];
+				if (tri[0] == collapse.To || tri[1] == collapse.To || tri[2] == collapse.To) {
+					removed++;
+					continue;
+				}
+
+				XMFLOAT3 p[3];
+				XMFLOAT3 q[3];
+				for (UINT k = 0; k < 3; ++k) {
+					p[k] = PositionAt(positions, positionStride, tri[k]);
+					q[k] = tri[k] == collapse.From ? target : p[k];
+				}
+
+				double before[3], after[3];
+				TriangleNormal(p[0], p[1], p[2], before);
+				TriangleNormal(q[0], q[1], q[2], after);
+				flipped = before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0;
+			}
+			if (flipped) {
+				continue;
+			}
+
+			// 锁定From的一环邻域
+			for (UINT a = adjacencyOffset[collapse.From]; a < adjacencyOffset[collapse.From + 1]; ++a) {
+				const UINT* tri = &result[adjacency[a] * 3];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = true;
+			}
+
+			remap[collapse.From] = collapse.To;
+			quadrics[collapse.To].Add(quadrics[collapse.From]);
+			maxError = (std::max)(maxError, collapse.Error);
+
+			trianglesRemoved += removed;
+			collapseCount++;
+		}
+
+		if (collapseCount == 0) {
+			break;
+		}
+
+		// 应用坍缩并移除退化的三角形
+		size_t writeIndex = 0;
+		for (size_t t = 0; t < triangleCount; ++t) {
+			UINT a = remap[result[t * 3 + 0]];
+			UINT b = remap[result[t * 3 + 1]];
+			UINT c = remap[result[t * 3 + 2]];
+			if (a != b && b != c && a != c) {
+				result[writeIndex++] = a;
+				result[writeIndex++] = b;
+				result[writeIndex++] = c;
+			}
+		}
+		result.resize(writeIndex);
+	}
+
+	if (resultError) {
+		*resultError = static_cast<float>(std::sqrt(maxError));
+	}
+
+	std::memcpy(destination, result.data(), result.size() * sizeof(UINT));
+	return result.size();
+}
@@ -0,0 +1,216 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+
+using DirectX::XMFLOAT3;
+
+namespace {
+	const UINT8 kUnassigned = 0xFF;
+
+	const XMFLOAT3& PositionAt(const XMFLOAT3* positions, size_t positionStride, UINT index) {
+		return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const BYTE*>(positions) + index * positionStride);
+	}
+
+	XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b) {
+		return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	float Dot(const XMFLOAT3& a, const XMFLOAT3& b) {
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b) {
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	float Length(const XMFLOAT3& v) {
+		return std::sqrt(Dot(v, v));
+	}
+
+	// Ritter包围球: 先以坐标轴方向上相距最远的一对极值点为直径，再逐点扩张
+	void ComputeBoundingSphere(const std::vector<XMFLOAT3>& points, XMFLOAT3& center, float& radius) {
+		UINT minIndex[3] = { 0, 0, 0 };
+		UINT maxIndex[3] = { 0, 0, 0 };
+		for (UINT i = 0; i < points.size(); ++i) {
+			const float* p = &points[i].x;
+			for (UINT axis = 0; axis < 3; ++axis) {
+				if (p[axis] < (&points[minIndex[axis]].x)[axis]) minIndex[axis] = i;
+				if (p[axis] > (&points[maxIndex[axis]].x)[axis]) maxIndex[axis] = i;
+			}
+		}
+
+		UINT bestAxis = 0;
+		float bestDistance = -1.0f;
+		for (UINT axis = 0; axis < 3; ++axis) {
+			float distance = Length(Subtract(points[maxIndex[axis]], points[minIndex[axis]]));
+			if (distance > bestDistance) {
+				bestDistance = distance;
+				bestAxis = axis;
+			}
+		}
+
+		const XMFLOAT3& p0 = points[minIndex[bestAxis]];
+		const XMFLOAT3& p1 = points[maxIndex[bestAxis]];
+		center = XMFLOAT3(0.5f * (p0.x + p1.x), 0.5f * (p0.y + p1.y), 0.5f * (p0.z + p1.z));
+		radius = 0.5f * bestDistance;
+
+		for (const XMFLOAT3& p : points) {
+			XMFLOAT3 d = Subtract(p, center);
+			float distance = Length(d);
+			if (distance > radius) {
+				// 新球恰好包含旧球与该点
+				float newRadius = 0.5f * (radius + distance);
+				float t = (newRadius - radius) / distance;
+				center = XMFLOAT3(center.x + d.x * t, center.y + d.y * t, center.z + d.z * t);
+				radius = newRadius;
+			}
+		}
+	}
+}
+
+UINT MeshletBuilder::BuildMeshlets(MeshletData& data,
+	const UINT* indices, size_t indexCount,
+	const XMFLOAT3* positions, size_t vertexCount, size_t positionStride) {
+	size_t meshletCountBefore = data.Meshlets.size();
+	size_t triangleCount = indexCount / 3;
+
+	// Mesh内的顶点 -> 当前Meshlet内的局部编号
+	std::vector<UINT8> localIndex(vertexCount, kUnassigned);
+
+	Meshlet current;
+	current.VertexOffset = static_cast<UINT>(data.VertexIndices.size());
+	current.TriangleOffset = static_cast<UINT>(data.TriangleIndices.size());
+
+	auto Flush = [&]() {
+		if (current.TriangleCount == 0) {
+			return;
+		}
+
+		for (UINT v = 0; v < current.VertexCount; ++v) {
+			localIndex[data.VertexIndices[current.VertexOffset + v]] = kUnassigned;
+		}
+
+		data.Meshlets.push_back(current);
+		data.Bounds.push_back(ComputeBounds(data, current, positions, positionStride));
+
+		// 下一个Meshlet的三角形数据保持4字节对齐
+		data.TriangleIndices.resize((data.TriangleIndices.size() + 3) & ~size_t(3), 0);
+
+		current = Meshlet();
+		current.VertexOffset = static_cast<UINT>(data.VertexIndices.size());
+		current.TriangleOffset = static_cast<UINT>(data.TriangleIndices.size());
+	};
+
+	for (size_t t = 0; t < triangleCount; ++t) {
+		const UINT* tri = &indices[t * 3];
+
+		UINT newVertices = 0;
+		for (UINT k = 0; k < 3; ++k) {
+			bool duplicated = (k > 0 && tri[k] == tri[0]) || (k > 1 && tri[k] == tri[1]);
+			if (localIndex[tri[k]] == kUnassigned && !duplicated) {
+				newVertices++;
+			}
+		}
+
+		if (current.VertexCount + newVertices > kMaxVertices || current.TriangleCount + 1 > kMaxTriangles) {
+			Flush();
+		}
+
+		for (UINT k = 0; k < 3; ++k) {
+			UINT v = tri[k];
+			if (localIndex[v] == kUnassigned) {
+				localIndex[v] = static_cast<UINT8>(current.VertexCount++);
+				data.VertexIndices.push_back(v);
+			}
+			data.TriangleIndices.push_back(localIndex[v]);
+		}
+		current.TriangleCount++;
+	}
+
+	Flush();
+
+	return static_cast<UINT>(data.Meshlets.size() - meshletCountBefore);
+}
+
+MeshletBounds MeshletBuilder::ComputeBounds(const MeshletData& data, const Meshlet& meshlet,
+	const XMFLOAT3* positions, size_t positionStride) {
+	MeshletBounds bounds;
+
+	std::vector<XMFLOAT3> points(meshlet.VertexCount);
+	for (UINT v = 0; v < meshlet.VertexCount; ++v) {
+		points[v] = PositionAt(positions, positionStride, data.VertexIndices[meshlet.VertexOffset + v]);
+	}
+	ComputeBoundingSphere(points, bounds.Center, bounds.Radius);
+
+	// 法线锥的轴取各三角形单位法线的平均
+	std::vector<XMFLOAT3> normals;
+	normals.reserve(meshlet.TriangleCount);
+	XMFLOAT3 axis(0.0f, 0.0f, 0.0f);
+	const UINT8* tris = &data.TriangleIndices[meshlet.TriangleOffset];
+	for (UINT t = 0; t < meshlet.TriangleCount; ++t) {
+		const XMFLOAT3& p0 = points[tris[t * 3 + 0]];
+		const XMFLOAT3& p1 = points[tris[t * 3 + 1]];
+		const XMFLOAT3& p2 = points[tris[t * 3 + 2]];
+
+		// 顺时针为正面，与D3D的默认设置一致
+		XMFLOAT3 normal = Cross(Subtract(p1, p0), Subtract(p2, p0));
+		float length = Length(normal);
+		if (length == 0.0f) {
+			// 退化三角形不影响背面剔除
+			normals.push_back(XMFLOAT3(0.0f, 0.0f, 0.0f));
+			continue;
+		}
+
+		normal = XMFLOAT3(normal.x / length, normal.y / length, normal.z / length);
+		normals.push_back(normal);
+		axis = XMFLOAT3(axis.x + normal.x, axis.y + normal.y, axis.z + normal.z);
+	}
+
+	float axisLength = Length(axis);
+	if (axisLength == 0.0f) {
+		return bounds;
+	}
+	axis = XMFLOAT3(axis.x / axisLength, axis.y / axisLength, axis.z / axisLength);
+
+	float minDot = 1.0f;
+	for (const XMFLOAT3& normal : normals) {
+		if (normal.x != 0.0f || normal.y != 0.0f || normal.z != 0.0f) {
+			minDot = (std::min)(minDot, Dot(normal, axis));
+		}
+	}
+
+	// 法线锥张开超过半球
+	if (minDot <= 0.0f) {
+		return bounds;
+	}
+
+	// 锥顶沿轴向后移动，使所有三角形都位于以锥顶为起点的法线锥内
+	float maxT = 0.0f;
+	for (UINT t = 0; t < meshlet.TriangleCount; ++t) {
+		const XMFLOAT3& normal = normals[t];
+		if (normal.x == 0.0f && normal.y == 0.0f && normal.z == 0.0f) {
+			continue;
+		}
+
+		const XMFLOAT3& p0 = points[tris[t * 3 + 0]];
+		float distance = Dot(Subtract(bounds.Center, p0), normal);
+		maxT = (std::max)(maxT, distance / Dot(axis, normal));
+	}
+
+	bounds.ConeAxis = axis;
+	bounds.ConeApex = XMFLOAT3(bounds.Center.x - axis.x * maxT, bounds.Center.y - axis.y * maxT, bounds.Center.z - axis.z * maxT);
+	bounds.ConeCutoff = std::sqrt(1.0f - minDot * minDot);
+
+	return bounds;
+}
+
+bool MeshletBuilder::IsBackFacing(const MeshletBounds& bounds, const XMFLOAT3& cameraPosition) {
+	XMFLOAT3 view = Subtract(bounds.ConeApex, cameraPosition);
+	float length = Length(view);
+	if (length == 0.0f) {
+		return false;
+	}
+
+	return Dot(view, bounds.ConeAxis) > bounds.ConeCutoff * length;
+}
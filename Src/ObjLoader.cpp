@@ -0,0 +1,715 @@
+#include "ObjLoader.h"
+#include "MeshCache.h"
+#include "TangentSpace.h"
+#include "ThreadPool.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace {
+	using ObjVertex = VertexPositionNormalTangentTexture;
+
+	// 面的一个角，Index[k]依次为Position、TexCoord、Normal的序号(从0开始)
+	// 文件中的负数序号相对于当前已读取的元素数，解析时只知道块内的数量，因此先记为块内的序号，合并时再加上块的起点
+	struct ObjCorner {
+		INT32 Index[3];
+		UINT8 PresentMask;		// 第k位表示Index[k]存在
+		UINT8 RelativeMask;		// 第k位表示Index[k]相对于块的开头
+	};
+
+	enum ObjEventType {
+		UseMaterial,
+		MaterialLibrary,
+	};
+
+	struct ObjEvent {
+		UINT FaceIndex;		// 事件之后的第一个面在块中的序号
+		ObjEventType Type;
+		std::string Name;
+	};
+
+	// 一个按行对齐的块及其解析结果
+	struct ObjChunk {
+		const char* Begin = nullptr;
+		const char* End = nullptr;
+
+		std::vector<XMFLOAT3> Positions;
+		std::vector<XMFLOAT2> TexCoords;
+		std::vector<XMFLOAT3> Normals;
+
+		std::vector<ObjCorner> Corners;
+		std::vector<UINT> FaceOffsets;		// 每个面在Corners中的起始位置，末尾额外存放Corners.size()
+		std::vector<ObjEvent> Events;
+
+		// 之前所有块中的元素数
+		INT32 Base[3] = { 0, 0, 0 };
+
+		UINT InvalidLines = 0;
+	};
+
+	struct FaceRange {
+		UINT Chunk;
+		UINT Begin;
+		UINT End;
+	};
+
+	// 一段使用同一材质的面，对应一个SubMesh
+	struct ObjRun {
+		std::string Material;
+		std::vector<FaceRange> Faces;
+
+		// 合并相同顶点之后的结果，Index相对于这段的第一个顶点
+		std::vector<ObjVertex> Vertices;
+		std::vector<UINT> Indices;
+		UINT InvalidFaces = 0;
+	};
+
+	// 顶点由Position、TexCoord、Normal三者的序号唯一确定，缺失的分量为-1
+	struct ObjVertexKey {
+		INT32 Index[3];
+
+		bool operator==(const ObjVertexKey& rhs) const {
+			return Index[0] == rhs.Index[0] && Index[1] == rhs.Index[1] && Index[2] == rhs.Index[2];
+		}
+	};
+
+	inline size_t HashKey(const ObjVertexKey& key) {
+		UINT64 h = static_cast<UINT32>(key.Index[0]) * 0x9E3779B97F4A7C15ull;
+		h ^= static_cast<UINT32>(key.Index[1]) * 0xC2B2AE3D27D4EB4Full + (h >> 29);
+		h ^= static_cast<UINT32>(key.Index[2]) * 0x165667B19E3779F9ull + (h >> 32);
+		return static_cast<size_t>(h ^ (h >> 31));
+	}
+
+	inline bool IsSpace(char c) {
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	inline const char* SkipSpaces(const char* p, const char* end) {
+		while (p < end && IsSpace(*p)) {
+			++p;
+		}
+		return p;
+	}
+
+	inline const char* SkipToken(const char* p, const char* end) {
+		while (p < end && !IsSpace(*p)) {
+			++p;
+		}
+		return p;
+	}
+
+	// 失败时value保持不变
+	inline const char* ParseFloat(const char* p, const char* end, float& value, bool& ok) {
+		p = SkipSpaces(p, end);
+		if (p < end && *p == '+') {
+			++p;
+		}
+
+		auto result = std::from_chars(p, end, value);
+		if (result.ec != std::errc()) {
+			ok = false;
+			return SkipToken(p, end);
+		}
+		return result.ptr;
+	}
+
+	// MTL的颜色: "r g b"，只给出r时g与b等于r；spectral与xyz形式不支持，返回false
+	bool ParseColor(const char* p, const char* end, XMFLOAT3& color) {
+		bool ok = true;
+		float r = 0.0f;
+		p = ParseFloat(p, end, r, ok);
+		if (!ok) {
+			return false;
+		}
+
+		float g = r, b = r;
+		if (SkipSpaces(p, end) < end) {
+			p = ParseFloat(p, end, g, ok);
+			p = ParseFloat(p, end, b, ok);
+		}
+		if (ok) {
+			color = XMFLOAT3(r, g, b);
+		}
+		return ok;
+	}
+
+	// Phong高光指数 -> 粗糙度: Ns与Beckmann分布的alpha满足alpha = sqrt(2 / (Ns + 2))
+	// Roughness与PbrtLoader中remaproughness为false时一样取alpha的平方根
+	inline float ShininessToRoughness(float shininess) {
+		float alpha = std::sqrt(2.0f / ((std::max)(shininess, 0.0f) + 2.0f));
+		return std::sqrt(alpha);
+	}
+
+	// 去掉首尾空白后的剩余部分
+	inline std::string RestOfLine(const char* p, const char* end) {
+		p = SkipSpaces(p, end);
+		while (end > p && IsSpace(end[-1])) {
+			--end;
+		}
+		return std::string(p, end);
+	}
+
+	// v、v/vt、v//vn、v/vt/vn
+	bool ParseCorner(const char*& p, const char* end, const INT32 counts[3], ObjCorner& corner) {
+		corner = {};
+
+		for (int k = 0; k < 3; ++k) {
+			if (k > 0) {
+				if (p >= end || *p != '/') {
+					break;
+				}
+				++p;
+			}
+
+			INT32 value = 0;
+			auto result = std::from_chars(p, end, value);
+			if (result.ec != std::errc() || value == 0) {
+				// 只有Position不能省略
+				if (k == 0) {
+					return false;
+				}
+				continue;
+			}
+			p = result.ptr;
+
+			if (value > 0) {
+				corner.Index[k] = value - 1;
+			}
+			else {
+				corner.Index[k] = counts[k] + value;
+				corner.RelativeMask |= 1 << k;
+			}
+			corner.PresentMask |= 1 << k;
+		}
+
+		return true;
+	}
+
+	void ParseLine(ObjChunk& chunk, const char* p, const char* end, INT32 counts[3]) {
+		const char* keywordEnd = SkipToken(p, end);
+		const size_t keywordLength = keywordEnd - p;
+		auto Is = [&](const char* keyword) {
+			return keywordLength == strlen(keyword) && memcmp(p, keyword, keywordLength) == 0;
+		};
+
+		bool ok = true;
+		const char* q = keywordEnd;
+
+		if (Is("v")) {
+			// 即使解析失败也要追加，以保持之后的序号正确
+			XMFLOAT3 v(0.0f, 0.0f, 0.0f);
+			q = ParseFloat(q, end, v.x, ok);
+			q = ParseFloat(q, end, v.y, ok);
+			q = ParseFloat(q, end, v.z, ok);
+			chunk.Positions.push_back(v);
+			counts[0]++;
+		}
+		else if (Is("vt")) {
+			XMFLOAT2 vt(0.0f, 0.0f);
+			q = ParseFloat(q, end, vt.x, ok);
+			// v可以省略
+			if (SkipSpaces(q, end) < end) {
+				q = ParseFloat(q, end, vt.y, ok);
+			}
+			chunk.TexCoords.push_back(vt);
+			counts[1]++;
+		}
+		else if (Is("vn")) {
+			XMFLOAT3 vn(0.0f, 0.0f, 0.0f);
+			q = ParseFloat(q, end, vn.x, ok);
+			q = ParseFloat(q, end, vn.y, ok);
+			q = ParseFloat(q, end, vn.z, ok);
+			chunk.Normals.push_back(vn);
+			counts[2]++;
+		}
+		else if (Is("f")) {
+			const UINT faceStart = static_cast<UINT>(chunk.Corners.size());
+			while ((q = SkipSpaces(q, end)) < end) {
+				ObjCorner corner;
+				if (!ParseCorner(q, end, counts, corner)) {
+					ok = false;
+					break;
+				}
+				chunk.Corners.push_back(corner);
+				q = SkipToken(q, end);
+			}
+
+			// 点和线不会被写入Index Buffer
+			if (ok && chunk.Corners.size() - faceStart >= 3) {
+				chunk.FaceOffsets.push_back(faceStart);
+			}
+			else {
+				chunk.Corners.resize(faceStart);
+			}
+		}
+		else if (Is("usemtl")) {
+			chunk.Events.push_back({ static_cast<UINT>(chunk.FaceOffsets.size()), UseMaterial, RestOfLine(q, end) });
+		}
+		else if (Is("mtllib")) {
+			chunk.Events.push_back({ static_cast<UINT>(chunk.FaceOffsets.size()), MaterialLibrary, RestOfLine(q, end) });
+		}
+		// 其余(#、g、o、s等)忽略
+
+		if (!ok) {
+			chunk.InvalidLines++;
+		}
+	}
+
+	void ParseChunk(ObjChunk& chunk) {
+		// 块内已读取的元素数，用于负数序号
+		INT32 counts[3] = { 0, 0, 0 };
+
+		const char* p = chunk.Begin;
+		while (p < chunk.End) {
+			const char* lineEnd = static_cast<const char*>(memchr(p, '\n', chunk.End - p));
+			if (lineEnd == nullptr) {
+				lineEnd = chunk.End;
+			}
+
+			const char* q = SkipSpaces(p, lineEnd);
+			if (q < lineEnd) {
+				ParseLine(chunk, q, lineEnd, counts);
+			}
+			p = lineEnd + 1;
+		}
+
+		chunk.FaceOffsets.push_back(static_cast<UINT>(chunk.Corners.size()));
+	}
+
+	inline XMFLOAT3 ToLeftHanded(const XMFLOAT3& v) {
+		return XMFLOAT3(v.x, v.y, -v.z);
+	}
+
+	// 合并相同的顶点并三角化，之后补全法线并计算Tangent
+	void BuildRun(ObjRun& run, const std::vector<ObjChunk>& chunks,
+		const std::vector<XMFLOAT3>& positions, const std::vector<XMFLOAT2>& texCoords, const std::vector<XMFLOAT3>& normals) {
+		const INT32 counts[3] = {
+			static_cast<INT32>(positions.size()),
+			static_cast<INT32>(texCoords.size()),
+			static_cast<INT32>(normals.size())
+		};
+
+		size_t cornerCount = 0;
+		size_t triangleCount = 0;
+		for (const FaceRange& range : run.Faces) {
+			const ObjChunk& chunk = chunks[range.Chunk];
+			cornerCount += chunk.FaceOffsets[range.End] - chunk.FaceOffsets[range.Begin];
+			triangleCount += chunk.FaceOffsets[range.End] - chunk.FaceOffsets[range.Begin] - 2 * (range.End - range.Begin);
+		}
+
+		// 开放寻址的哈希表，存放顶点序号，装载率不超过1/2
+		size_t tableSize = 16;
+		while (tableSize < 2 * cornerCount) {
+			tableSize *= 2;
+		}
+		const size_t mask = tableSize - 1;
+		std::vector<UINT> table(tableSize, UINT_MAX);
+
+		std::vector<ObjVertexKey> keys;
+		keys.reserve(cornerCount / 2);
+		run.Indices.reserve(3 * triangleCount);
+
+		auto FindOrAdd = [&](const ObjVertexKey& key) {
+			size_t slot = HashKey(key) & mask;
+			while (true) {
+				UINT index = table[slot];
+				if (index == UINT_MAX) {
+					index = static_cast<UINT>(keys.size());
+					table[slot] = index;
+					keys.push_back(key);
+					return index;
+				}
+				if (keys[index] == key) {
+					return index;
+				}
+				slot = (slot + 1) & mask;
+			}
+		};
+
+		std::vector<UINT> faceVertices;
+		for (const FaceRange& range : run.Faces) {
+			const ObjChunk& chunk = chunks[range.Chunk];
+			for (UINT f = range.Begin; f < range.End; ++f) {
+				faceVertices.clear();
+
+				bool valid = true;
+				for (UINT c = chunk.FaceOffsets[f]; c < chunk.FaceOffsets[f + 1]; ++c) {
+					const ObjCorner& corner = chunk.Corners[c];
+
+					ObjVertexKey key;
+					for (int k = 0; k < 3; ++k) {
+						INT32 index = corner.Index[k] + ((corner.RelativeMask >> k) & 1 ? chunk.Base[k] : 0);
+						bool present = (corner.PresentMask >> k) & 1;
+						key.Index[k] = present && index >= 0 && index < counts[k] ? index : -1;
+					}
+
+					if (key.Index[0] < 0) {
+						valid = false;
+						break;
+					}
+					faceVertices.push_back(FindOrAdd(key));
+				}
+
+				if (!valid) {
+					run.InvalidFaces++;
+					continue;
+				}
+
+				// 以第一个顶点为中心扇形三角化，同时反转绕序
+				for (size_t i = 1; i + 1 < faceVertices.size(); ++i) {
+					run.Indices.push_back(faceVertices[0]);
+					run.Indices.push_back(faceVertices[i + 1]);
+					run.Indices.push_back(faceVertices[i]);
+				}
+			}
+		}
+
+		// 转换到左手坐标系，纹理坐标v翻转
+		// 文件中没有法线的顶点先置零，由TangentSpace补全
+		run.Vertices.resize(keys.size());
+		for (size_t i = 0; i < keys.size(); ++i) {
+			const ObjVertexKey& key = keys[i];
+			ObjVertex& vertex = run.Vertices[i];
+
+			vertex.position = ToLeftHanded(positions[key.Index[0]]);
+			vertex.normal = key.Index[2] >= 0 ? ToLeftHanded(normals[key.Index[2]]) : XMFLOAT3(0.0f, 0.0f, 0.0f);
+			vertex.tangent = XMFLOAT3(0.0f, 0.0f, 0.0f);
+			vertex.textureCoordinate = key.Index[1] >= 0 ?
+				XMFLOAT2(texCoords[key.Index[1]].x, 1.0f - texCoords[key.Index[1]].y) : XMFLOAT2(0.0f, 0.0f);
+		}
+
+		TangentSpace::GenerateNormals(run.Vertices.data(), run.Vertices.size(), run.Indices.data(), run.Indices.size());
+		std::vector<ObjVertex> splitVertices;
+		TangentSpace::GenerateTangents(run.Vertices.data(), run.Vertices.size(), run.Indices.data(), run.Indices.size(), splitVertices);
+		run.Vertices.insert(run.Vertices.end(), splitVertices.begin(), splitVertices.end());
+	}
+
+	// 纹理选项的参数个数，-o、-s、-t的参数为1到3个数
+	int TextureOptionArgumentCount(const std::string& option) {
+		if (option == "-o" || option == "-s" || option == "-t") {
+			return -3;
+		}
+		if (option == "-mm") {
+			return 2;
+		}
+		if (option == "-blendu" || option == "-blendv" || option == "-bm" || option == "-boost" || option == "-cc" ||
+			option == "-clamp" || option == "-imfchan" || option == "-texres" || option == "-type") {
+			return 1;
+		}
+		return 0;
+	}
+
+	// 跳过纹理选项，剩余部分为文件名(可能含空格)
+	std::string ParseTexturePath(const char* p, const char* end) {
+		while ((p = SkipSpaces(p, end)) < end && *p == '-') {
+			const char* optionEnd = SkipToken(p, end);
+			int argumentCount = TextureOptionArgumentCount(std::string(p, optionEnd));
+			p = optionEnd;
+
+			if (argumentCount >= 0) {
+				for (int i = 0; i < argumentCount; ++i) {
+					p = SkipToken(SkipSpaces(p, end), end);
+				}
+			}
+			else {
+				// 可选的参数，只跳过数字
+				for (int i = 0; i < -argumentCount; ++i) {
+					const char* q = SkipSpaces(p, end);
+					float value;
+					if (q >= end || std::from_chars(q, end, value).ec != std::errc()) {
+						break;
+					}
+					p = SkipToken(q, end);
+				}
+			}
+		}
+
+		return RestOfLine(p, end);
+	}
+}
+
+bool ObjLoader::LoadMaterialLibrary(const std::string& path, std::vector<MaterialDesc>& materials, std::vector<std::string>& names) {
+	MappedFile file;
+	if (!file.Open(path)) {
+		Util::DebugLog("[ObjLoader] Failed to open material library %s\n", path.c_str());
+		return false;
+	}
+
+	// 与Scene::ExtractMaterials中Assimp的纹理类型对应
+	// Kd -> DiffuseAlbedo的rgb，d(或1 - Tr) -> DiffuseAlbedo.a，Ks -> FresnelR0，Pr或Ns -> Roughness
+	const std::pair<const char*, TextureType> textureSlots[] = {
+		{ "map_Kd",		TextureType::DiffuseTexture },
+		{ "norm",		TextureType::NormalTexture },
+		{ "map_Kn",		TextureType::NormalTexture },
+		{ "map_bump",	TextureType::BumpTexture },
+		{ "map_Bump",	TextureType::BumpTexture },
+		{ "bump",		TextureType::BumpTexture },
+		{ "map_Pr",		TextureType::RoughnessTexture },
+		{ "map_Ns",		TextureType::RoughnessTexture },
+		{ "map_ns",		TextureType::RoughnessTexture },
+		{ "map_Ks",		TextureType::SpecularTexture },
+		{ "map_d",		TextureType::MaskTexture },
+	};
+
+	const char* p = reinterpret_cast<const char*>(file.Data());
+	const char* end = p + file.Size();
+	MaterialDesc* current = nullptr;
+	bool hasPbrRoughness = false;	// Pr优先于Ns，与两者的先后顺序无关
+
+	while (p < end) {
+		const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+		if (lineEnd == nullptr) {
+			lineEnd = end;
+		}
+
+		const char* q = SkipSpaces(p, lineEnd);
+		const char* keywordEnd = SkipToken(q, lineEnd);
+		const std::string keyword(q, keywordEnd);
+
+		if (keyword == "newmtl") {
+			names.push_back(RestOfLine(keywordEnd, lineEnd));
+			materials.emplace_back();
+			current = &materials.back();
+			hasPbrRoughness = false;
+		}
+		else if (current != nullptr && (keyword == "Kd" || keyword == "Ks")) {
+			XMFLOAT3 color;
+			if (ParseColor(keywordEnd, lineEnd, color)) {
+				if (keyword == "Kd") {
+					current->DiffuseAlbedo = XMFLOAT4(color.x, color.y, color.z, current->DiffuseAlbedo.w);
+				}
+				else {
+					current->FresnelR0 = color;
+				}
+			}
+		}
+		else if (current != nullptr && (keyword == "Ns" || keyword == "Pr" || keyword == "d" || keyword == "Tr")) {
+			bool ok = true;
+			float value = 0.0f;
+			ParseFloat(keywordEnd, lineEnd, value, ok);
+
+			// 无法解析的行保持默认值
+			if (ok && keyword == "Pr") {
+				current->Roughness = std::clamp(value, 0.0f, 1.0f);
+				hasPbrRoughness = true;
+			}
+			else if (ok && keyword == "Ns" && !hasPbrRoughness) {
+				current->Roughness = ShininessToRoughness(value);
+			}
+			else if (ok && (keyword == "d" || keyword == "Tr")) {
+				current->DiffuseAlbedo.w = std::clamp(keyword == "d" ? value : 1.0f - value, 0.0f, 1.0f);
+			}
+		}
+		else if (current != nullptr) {
+			for (const auto& [name, slot] : textureSlots) {
+				if (keyword != name) {
+					continue;
+				}
+
+				// 每种纹理只取第一张
+				bool exists = std::any_of(current->Textures.begin(), current->Textures.end(),
+					[slot = slot](const MaterialTextureRef& ref) { return ref.Slot == slot; });
+				std::string texturePath = ParseTexturePath(keywordEnd, lineEnd);
+				if (!exists && !texturePath.empty()) {
+					current->Textures.push_back({ slot, texturePath });
+				}
+				break;
+			}
+		}
+
+		p = lineEnd + 1;
+	}
+
+	return true;
+}
+
+bool ObjLoader::Load(const std::string& path, ObjModel& model) {
+	INT64 stageStart = Util::QueryTimestamp();
+
+	MappedFile file;
+	if (!file.Open(path)) {
+		Util::DebugLog("[ObjLoader] Failed to open %s\n", path.c_str());
+		return false;
+	}
+
+	const char* data = reinterpret_cast<const char*>(file.Data());
+	const size_t size = static_cast<size_t>(file.Size());
+
+	// 按行切分，块数多于线程数以平衡负载
+	const size_t minChunkSize = 256 * 1024;
+	const size_t chunkCount = (std::max)(size_t(1), (std::min)(size_t(4 * ThreadPool::Get().ThreadCount()), size / minChunkSize));
+
+	std::vector<ObjChunk> chunks(chunkCount);
+	const char* chunkBegin = data;
+	for (size_t i = 0; i < chunkCount; ++i) {
+		const char* chunkEnd = i + 1 == chunkCount ? data + size : (std::max)(chunkBegin, data + size * (i + 1) / chunkCount);
+		if (chunkEnd < data + size) {
+			const char* newline = static_cast<const char*>(memchr(chunkEnd, '\n', data + size - chunkEnd));
+			chunkEnd = newline != nullptr ? newline + 1 : data + size;
+		}
+
+		chunks[i].Begin = chunkBegin;
+		chunks[i].End = chunkEnd;
+		chunkBegin = chunkEnd;
+	}
+
+	ThreadPool::Get().ParallelFor(chunkCount, 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			ParseChunk(chunks[i]);
+		}
+	});
+
+	const double parseTime = Util::MillisecondsSince(stageStart);
+	stageStart = Util::QueryTimestamp();
+
+	// 合并各块的顶点属性
+	UINT invalidLines = 0;
+	INT32 totals[3] = { 0, 0, 0 };
+	for (ObjChunk& chunk : chunks) {
+		for (int k = 0; k < 3; ++k) {
+			chunk.Base[k] = totals[k];
+		}
+		totals[0] += static_cast<INT32>(chunk.Positions.size());
+		totals[1] += static_cast<INT32>(chunk.TexCoords.size());
+		totals[2] += static_cast<INT32>(chunk.Normals.size());
+		invalidLines += chunk.InvalidLines;
+	}
+
+	std::vector<XMFLOAT3> positions(totals[0]);
+	std::vector<XMFLOAT2> texCoords(totals[1]);
+	std::vector<XMFLOAT3> normals(totals[2]);
+	ThreadPool::Get().ParallelFor(chunkCount, 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			const ObjChunk& chunk = chunks[i];
+			std::copy(chunk.Positions.begin(), chunk.Positions.end(), positions.begin() + chunk.Base[0]);
+			std::copy(chunk.TexCoords.begin(), chunk.TexCoords.end(), texCoords.begin() + chunk.Base[1]);
+			std::copy(chunk.Normals.begin(), chunk.Normals.end(), normals.begin() + chunk.Base[2]);
+		}
+	});
+
+	// 按usemtl划分SubMesh，连续使用同一材质的面合为一段
+	std::vector<std::string> libraries;
+	std::vector<ObjRun> runs(1);
+	for (UINT c = 0; c < chunkCount; ++c) {
+		const ObjChunk& chunk = chunks[c];
+		const UINT faceCount = static_cast<UINT>(chunk.FaceOffsets.size()) - 1;
+
+		UINT faceCursor = 0;
+		for (const ObjEvent& e : chunk.Events) {
+			if (e.FaceIndex > faceCursor) {
+				runs.back().Faces.push_back({ c, faceCursor, e.FaceIndex });
+				faceCursor = e.FaceIndex;
+			}
+
+			if (e.Type == MaterialLibrary) {
+				libraries.push_back(e.Name);
+			}
+			else if (e.Name != runs.back().Material) {
+				if (!runs.back().Faces.empty()) {
+					runs.emplace_back();
+				}
+				runs.back().Material = e.Name;
+			}
+		}
+
+		if (faceCount > faceCursor) {
+			runs.back().Faces.push_back({ c, faceCursor, faceCount });
+		}
+	}
+	runs.erase(std::remove_if(runs.begin(), runs.end(), [](const ObjRun& run) { return run.Faces.empty(); }), runs.end());
+
+	// 各段并行地合并顶点，较大的段先开始
+	std::vector<UINT> order(runs.size());
+	for (UINT i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	auto CornerCount = [&](const ObjRun& run) {
+		size_t count = 0;
+		for (const FaceRange& range : run.Faces) {
+			count += chunks[range.Chunk].FaceOffsets[range.End] - chunks[range.Chunk].FaceOffsets[range.Begin];
+		}
+		return count;
+	};
+	std::vector<size_t> cornerCounts(runs.size());
+	for (size_t i = 0; i < runs.size(); ++i) {
+		cornerCounts[i] = CornerCount(runs[i]);
+	}
+	std::sort(order.begin(), order.end(), [&](UINT a, UINT b) { return cornerCounts[a] > cornerCounts[b]; });
+
+	ThreadPool::Get().ParallelFor(runs.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			BuildRun(runs[order[i]], chunks, positions, texCoords, normals);
+		}
+	});
+
+	const double buildTime = Util::MillisecondsSince(stageStart);
+	stageStart = Util::QueryTimestamp();
+
+	// 材质，目录与Scene中的约定相同
+	model.Materials.clear();
+	std::vector<std::string> materialNames;
+	const std::string directory = path.substr(0, path.find_last_of("\\/") + 1);
+	for (size_t i = 0; i < libraries.size(); ++i) {
+		if (std::find(libraries.begin(), libraries.begin() + i, libraries[i]) == libraries.begin() + i) {
+			LoadMaterialLibrary(directory + libraries[i], model.Materials, materialNames);
+		}
+	}
+
+	// 找不到的材质使用默认材质
+	UINT defaultMaterialIndex = UINT_MAX;
+	auto MaterialIndex = [&](const std::string& name) {
+		auto it = std::find(materialNames.begin(), materialNames.end(), name);
+		if (it != materialNames.end()) {
+			return static_cast<UINT>(it - materialNames.begin());
+		}
+		if (defaultMaterialIndex == UINT_MAX) {
+			defaultMaterialIndex = static_cast<UINT>(model.Materials.size());
+			model.Materials.emplace_back();
+		}
+		return defaultMaterialIndex;
+	};
+
+	// 拼接各段
+	UINT invalidFaces = 0;
+	size_t totalVertices = 0, totalIndices = 0;
+	model.SubMeshes.resize(runs.size());
+	for (size_t i = 0; i < runs.size(); ++i) {
+		ObjSubMesh& submesh = model.SubMeshes[i];
+		submesh.BaseVertexLocation = static_cast<UINT>(totalVertices);
+		submesh.NumVertices = static_cast<UINT>(runs[i].Vertices.size());
+		submesh.StartIndexLocation = static_cast<UINT>(totalIndices);
+		submesh.NumIndices = static_cast<UINT>(runs[i].Indices.size());
+		submesh.MaterialIndex = MaterialIndex(runs[i].Material);
+
+		totalVertices += submesh.NumVertices;
+		totalIndices += submesh.NumIndices;
+		invalidFaces += runs[i].InvalidFaces;
+	}
+
+	model.Vertices.resize(totalVertices);
+	model.Indices.resize(totalIndices);
+	ThreadPool::Get().ParallelFor(runs.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			std::copy(runs[i].Vertices.begin(), runs[i].Vertices.end(), model.Vertices.begin() + model.SubMeshes[i].BaseVertexLocation);
+			std::copy(runs[i].Indices.begin(), runs[i].Indices.end(), model.Indices.begin() + model.SubMeshes[i].StartIndexLocation);
+		}
+	});
+
+	const double assembleTime = Util::MillisecondsSince(stageStart);
+
+	if (invalidLines > 0 || invalidFaces > 0) {
+		Util::DebugLog("[ObjLoader] %s: skipped %u malformed lines and %u faces with invalid indices\n", path.c_str(), invalidLines, invalidFaces);
+	}
+	Util::DebugLog("[ObjLoader] %s: %zu chunks, %u positions, %zu vertices, %zu triangles, %zu submeshes, %zu materials: "
+		"parse %.2f ms, weld %.2f ms, materials + assemble %.2f ms\n",
+		path.c_str(), chunkCount, totals[0], totalVertices, totalIndices / 3, runs.size(), model.Materials.size(),
+		parseTime, buildTime, assembleTime);
+
+	return !model.SubMeshes.empty();
+}
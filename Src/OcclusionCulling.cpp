@@ -0,0 +1,271 @@
+#include "OcclusionCulling.h"
+#include "ThreadPool.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+OcclusionBuffer::OcclusionBuffer(UINT width, UINT height)
+	: mWidth(width),
+	mHeight(height),
+	mTilesX(width / TileSize),
+	mTilesY(height / TileSize),
+	mDepth(width * height, 1.0f),
+	mTileMaxDepth((width / TileSize) * (height / TileSize), 1.0f) {
+
+	XMStoreFloat4x4(&mViewProj, XMMatrixIdentity());
+}
+
+void OcclusionBuffer::Clear(FXMMATRIX viewProj) {
+	XMStoreFloat4x4(&mViewProj, viewProj);
+	std::fill(mDepth.begin(), mDepth.end(), 1.0f);
+	std::fill(mTileMaxDepth.begin(), mTileMaxDepth.end(), 1.0f);
+}
+
+UINT OcclusionBuffer::Rasterize(const OccluderDesc* occluders, size_t count, INT64 start, double budgetMs) {
+	mOccluders = occluders;
+	mOccluderCount = count;
+
+	mVertexOffsets.resize(count + 1);
+	size_t vertexCount = 0;
+	for (size_t i = 0; i < count; ++i) {
+		mVertexOffsets[i] = vertexCount;
+		vertexCount += occluders[i].VertexCount;
+	}
+	mVertexOffsets[count] = vertexCount;
+	mScreenVertices.resize(vertexCount);
+
+	// 1. 各遮挡体的顶点变换到屏幕空间
+	const float halfWidth = 0.5f * mWidth;
+	const float halfHeight = 0.5f * mHeight;
+	ThreadPool::Get().ParallelFor(count, 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			const OccluderDesc& occluder = occluders[i];
+			XMMATRIX worldViewProj = XMLoadFloat4x4(&occluder.WorldViewProj);
+			XMFLOAT4* screen = &mScreenVertices[mVertexOffsets[i]];
+
+			for (UINT v = 0; v < occluder.VertexCount; ++v) {
+				XMFLOAT4 clip;
+				XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(&occluder.Positions[v]), worldViewProj));
+				if (clip.z < 0.0f || clip.w <= 0.0f) {
+					screen[v] = XMFLOAT4(0.0f, 0.0f, 0.0f, -1.0f);
+					continue;
+				}
+				const float invW = 1.0f / clip.w;
+				screen[v] = XMFLOAT4(
+					(clip.x * invW + 1.0f) * halfWidth,
+					(1.0f - clip.y * invW) * halfHeight,
+					clip.z * invW,
+					1.0f);
+			}
+		}
+	});
+
+	// 2. 各条带独立光栅化，互不写入对方的像素
+	mRowOccluders.assign(mTilesY, 0);
+	ThreadPool::Get().ParallelFor(mTilesY, 1, [&](size_t begin, size_t end) {
+		RasterizeBand(static_cast<UINT>(begin), static_cast<UINT>(end), start, budgetMs);
+	});
+
+	return *std::min_element(mRowOccluders.begin(), mRowOccluders.end());
+}
+
+void OcclusionBuffer::RasterizeBand(UINT firstTileRow, UINT endTileRow, INT64 start, double budgetMs) {
+	const UINT minRow = firstTileRow * TileSize;
+	const UINT endRow = endTileRow * TileSize;
+	const float minY = static_cast<float>(minRow);
+	const float maxY = static_cast<float>(endRow);
+
+	UINT rasterized = 0;
+	for (size_t i = 0; i < mOccluderCount; ++i) {
+		if (Util::MillisecondsSince(start) > budgetMs) {
+			break;
+		}
+
+		const OccluderDesc& occluder = mOccluders[i];
+		const XMFLOAT4* screen = &mScreenVertices[mVertexOffsets[i]];
+		for (UINT t = 0; t + 2 < occluder.IndexCount; t += 3) {
+			const XMFLOAT4& v0 = screen[occluder.Indices[t + 0]];
+			const XMFLOAT4& v1 = screen[occluder.Indices[t + 1]];
+			const XMFLOAT4& v2 = screen[occluder.Indices[t + 2]];
+			if (v0.w < 0.0f || v1.w < 0.0f || v2.w < 0.0f) {
+				continue;
+			}
+			if ((std::max)((std::max)(v0.y, v1.y), v2.y) < minY || (std::min)((std::min)(v0.y, v1.y), v2.y) >= maxY) {
+				continue;
+			}
+			RasterizeTriangle(v0, v1, v2, minRow, endRow);
+		}
+		rasterized++;
+	}
+
+	for (UINT tileRow = firstTileRow; tileRow < endTileRow; ++tileRow) {
+		mRowOccluders[tileRow] = rasterized;
+
+		// HiZ: Tile中最远的遮挡体深度，AABB的最近深度比它更远时在该Tile中一定被遮挡
+		for (UINT tileX = 0; tileX < mTilesX; ++tileX) {
+			XMVECTOR maxDepth = XMVectorZero();
+			for (UINT y = tileRow * TileSize; y < (tileRow + 1) * TileSize; ++y) {
+				const float* row = &mDepth[y * mWidth + tileX * TileSize];
+				for (UINT x = 0; x < TileSize; x += 4) {
+					maxDepth = XMVectorMax(maxDepth, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(row + x)));
+				}
+			}
+			XMFLOAT4 m;
+			XMStoreFloat4(&m, maxDepth);
+			mTileMaxDepth[tileRow * mTilesX + tileX] = (std::max)((std::max)(m.x, m.y), (std::max)(m.z, m.w));
+		}
+	}
+}
+
+void OcclusionBuffer::RasterizeTriangle(const XMFLOAT4& v0, const XMFLOAT4& in1, const XMFLOAT4& in2, UINT minRow, UINT endRow) {
+	float area = (in1.x - v0.x) * (in2.y - v0.y) - (in2.x - v0.x) * (in1.y - v0.y);
+	if (fabsf(area) < 1e-6f) {
+		return;
+	}
+	// 统一为正的面积，三条边的边函数在三角形内部均不小于0
+	const XMFLOAT4& v1 = area > 0.0f ? in1 : in2;
+	const XMFLOAT4& v2 = area > 0.0f ? in2 : in1;
+	area = fabsf(area);
+
+	// 包围矩形，x对齐到4个像素
+	const float minX = (std::max)((std::min)((std::min)(v0.x, v1.x), v2.x), 0.0f);
+	const float maxX = (std::min)((std::max)((std::max)(v0.x, v1.x), v2.x), static_cast<float>(mWidth));
+	const float minY = (std::max)((std::min)((std::min)(v0.y, v1.y), v2.y), static_cast<float>(minRow));
+	const float maxY = (std::min)((std::max)((std::max)(v0.y, v1.y), v2.y), static_cast<float>(endRow));
+	if (minX >= maxX || minY >= maxY) {
+		return;
+	}
+	const UINT x0 = static_cast<UINT>(minX) & ~3u;
+	const UINT x1 = (std::min)(static_cast<UINT>(ceilf(maxX)), mWidth);
+	const UINT y0 = static_cast<UINT>(minY);
+	const UINT y1 = (std::min)(static_cast<UINT>(ceilf(maxY)), endRow);
+
+	// 边函数 E(p) = A * p.x + B * p.y + C，对边ab: A = a.y - b.y, B = b.x - a.x
+	// C减去0.5 * (|A| + |B|)后，在像素中心的值不小于0等价于整个像素位于边的内侧
+	// 只写入完全被覆盖的像素，遮挡体边缘露出的部分不会被误判为遮挡
+	auto EdgeA = [](const XMFLOAT4& a, const XMFLOAT4& b) { return a.y - b.y; };
+	auto EdgeB = [](const XMFLOAT4& a, const XMFLOAT4& b) { return b.x - a.x; };
+	auto EdgeC = [](const XMFLOAT4& a, const XMFLOAT4& b) {
+		return (b.y - a.y) * a.x - (b.x - a.x) * a.y - 0.5f * (fabsf(a.y - b.y) + fabsf(b.x - a.x));
+	};
+	const float a0 = EdgeA(v1, v2), b0 = EdgeB(v1, v2), c0 = EdgeC(v1, v2);
+	const float a1 = EdgeA(v2, v0), b1 = EdgeB(v2, v0), c1 = EdgeC(v2, v0);
+	const float a2 = EdgeA(v0, v1), b2 = EdgeB(v0, v1), c2 = EdgeC(v0, v1);
+
+	// 深度在屏幕空间线性: z = z0 + dzdx * (x - x0) + dzdy * (y - y0)
+	// 写入的是像素范围内最远的深度，倾斜的遮挡体同样是保守的
+	const float dz1 = v1.z - v0.z, dz2 = v2.z - v0.z;
+	const float dzdx = (dz1 * (v2.y - v0.y) - (v1.y - v0.y) * dz2) / area;
+	const float dzdy = ((v1.x - v0.x) * dz2 - dz1 * (v2.x - v0.x)) / area;
+	const float depthBias = 0.5f * (fabsf(dzdx) + fabsf(dzdy));
+
+	const XMVECTOR pixelOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR edgeStep0 = XMVectorReplicate(4.0f * a0);
+	const XMVECTOR edgeStep1 = XMVectorReplicate(4.0f * a1);
+	const XMVECTOR edgeStep2 = XMVectorReplicate(4.0f * a2);
+	const XMVECTOR depthStep = XMVectorReplicate(4.0f * dzdx);
+
+	for (UINT y = y0; y < y1; ++y) {
+		const float py = y + 0.5f;
+		XMVECTOR px = XMVectorAdd(XMVectorReplicate(static_cast<float>(x0)), pixelOffsets);
+
+		XMVECTOR e0 = XMVectorMultiplyAdd(px, XMVectorReplicate(a0), XMVectorReplicate(b0 * py + c0));
+		XMVECTOR e1 = XMVectorMultiplyAdd(px, XMVectorReplicate(a1), XMVectorReplicate(b1 * py + c1));
+		XMVECTOR e2 = XMVectorMultiplyAdd(px, XMVectorReplicate(a2), XMVectorReplicate(b2 * py + c2));
+		XMVECTOR z = XMVectorMultiplyAdd(px, XMVectorReplicate(dzdx), XMVectorReplicate(v0.z - dzdx * v0.x + dzdy * (py - v0.y) + depthBias));
+
+		float* row = &mDepth[y * mWidth];
+		for (UINT x = x0; x < x1; x += 4) {
+			XMVECTOR inside = XMVectorAndInt(XMVectorGreaterOrEqual(e0, zero),
+				XMVectorAndInt(XMVectorGreaterOrEqual(e1, zero), XMVectorGreaterOrEqual(e2, zero)));
+
+			XMFLOAT4* pixels = reinterpret_cast<XMFLOAT4*>(row + x);
+			XMVECTOR depth = XMLoadFloat4(pixels);
+			XMStoreFloat4(pixels, XMVectorSelect(depth, XMVectorMin(depth, z), inside));
+
+			e0 = XMVectorAdd(e0, edgeStep0);
+			e1 = XMVectorAdd(e1, edgeStep1);
+			e2 = XMVectorAdd(e2, edgeStep2);
+			z = XMVectorAdd(z, depthStep);
+		}
+	}
+}
+
+bool OcclusionBuffer::ProjectBox(const BoundingBox& box, float& minX, float& minY, float& maxX, float& maxY, float& minZ) const {
+	XMMATRIX viewProj = XMLoadFloat4x4(&mViewProj);
+	XMVECTOR center = XMLoadFloat3(&box.Center);
+	XMVECTOR extents = XMLoadFloat3(&box.Extents);
+
+	minX = minY = minZ = FLT_MAX;
+	maxX = maxY = -FLT_MAX;
+	for (UINT i = 0; i < 8; ++i) {
+		XMVECTOR sign = XMVectorSet((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f, 0.0f);
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector3Transform(XMVectorMultiplyAdd(extents, sign, center), viewProj));
+		if (clip.z < 0.0f || clip.w <= 0.0f) {
+			return false;
+		}
+
+		const float invW = 1.0f / clip.w;
+		const float x = (clip.x * invW + 1.0f) * 0.5f * mWidth;
+		const float y = (1.0f - clip.y * invW) * 0.5f * mHeight;
+		minX = (std::min)(minX, x);
+		maxX = (std::max)(maxX, x);
+		minY = (std::min)(minY, y);
+		maxY = (std::max)(maxY, y);
+		minZ = (std::min)(minZ, clip.z * invW);
+	}
+	return true;
+}
+
+float OcclusionBuffer::ScreenArea(const BoundingBox& box) const {
+	float minX, minY, maxX, maxY, minZ;
+	if (!ProjectBox(box, minX, minY, maxX, maxY, minZ)) {
+		return static_cast<float>(mWidth * mHeight);
+	}
+	const float width = (std::min)(maxX, static_cast<float>(mWidth)) - (std::max)(minX, 0.0f);
+	const float height = (std::min)(maxY, static_cast<float>(mHeight)) - (std::max)(minY, 0.0f);
+	return width > 0.0f && height > 0.0f ? width * height : 0.0f;
+}
+
+bool OcclusionBuffer::IsOccluded(const BoundingBox& box) const {
+	float minX, minY, maxX, maxY, minZ;
+	if (!ProjectBox(box, minX, minY, maxX, maxY, minZ)) {
+		return false;
+	}
+	// 屏幕之外的物体交由视锥剔除
+	if (maxX <= 0.0f || maxY <= 0.0f || minX >= mWidth || minY >= mHeight) {
+		return false;
+	}
+
+	// 矩形接触到的所有像素(闭区间)
+	const UINT px0 = static_cast<UINT>((std::max)(minX, 0.0f));
+	const UINT py0 = static_cast<UINT>((std::max)(minY, 0.0f));
+	const UINT px1 = (std::min)(static_cast<UINT>(maxX), mWidth - 1);
+	const UINT py1 = (std::min)(static_cast<UINT>(maxY), mHeight - 1);
+
+	for (UINT tileY = py0 / TileSize; tileY <= py1 / TileSize; ++tileY) {
+		for (UINT tileX = px0 / TileSize; tileX <= px1 / TileSize; ++tileX) {
+			if (minZ > mTileMaxDepth[tileY * mTilesX + tileX]) {
+				continue;
+			}
+
+			// Tile中有更远的像素，逐像素比较矩形覆盖的部分
+			const UINT y0 = (std::max)(py0, tileY * TileSize), y1 = (std::min)(py1, tileY * TileSize + TileSize - 1);
+			const UINT x0 = (std::max)(px0, tileX * TileSize), x1 = (std::min)(px1, tileX * TileSize + TileSize - 1);
+			for (UINT y = y0; y <= y1; ++y) {
+				for (UINT x = x0; x <= x1; ++x) {
+					if (mDepth[y * mWidth + x] >= minZ) {
+						return false;
+					}
+				}
+			}
+		}
+	}
+	return true;
+}
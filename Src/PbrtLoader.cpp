@@ -0,0 +1,942 @@
+#include "PbrtLoader.h"
+#include "PlyLoader.h"
+#include "MeshCache.h"
+#include "TangentSpace.h"
+#include "ThreadPool.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace {
+	using PbrtVertex = VertexPositionNormalTangentTexture;
+
+	// 在映射到内存的文件上逐个返回Token，Token直接指向文件内容
+	// Token为'['、']'、带引号的字符串(包含引号)或不含空白的单词(指令名、数字、true/false)
+	class PbrtTokenizer {
+	public:
+		bool Open(const std::string& path) {
+			mPath = path;
+			if (!mFile.Open(path)) {
+				return false;
+			}
+			mPos = reinterpret_cast<const char*>(mFile.Data());
+			mEnd = mPos + mFile.Size();
+			return true;
+		}
+
+		const std::string& Path() const { return mPath; }
+
+		// 文件结束时返回false
+		bool Next(std::string_view& token) {
+			while (mPos < mEnd) {
+				if (*mPos == '#') {
+					const char* lineEnd = static_cast<const char*>(memchr(mPos, '\n', mEnd - mPos));
+					mPos = lineEnd != nullptr ? lineEnd : mEnd;
+				}
+				else if (IsSpace(*mPos)) {
+					++mPos;
+				}
+				else {
+					break;
+				}
+			}
+			if (mPos >= mEnd) {
+				return false;
+			}
+
+			const char* start = mPos;
+			if (*mPos == '[' || *mPos == ']') {
+				++mPos;
+			}
+			else if (*mPos == '"') {
+				++mPos;
+				while (mPos < mEnd && *mPos != '"' && *mPos != '\n') {
+					mPos += *mPos == '\\' && mPos + 1 < mEnd ? 2 : 1;
+				}
+				if (mPos < mEnd && *mPos == '"') {
+					++mPos;
+				}
+			}
+			else {
+				while (mPos < mEnd && !IsSpace(*mPos) && *mPos != '[' && *mPos != ']' && *mPos != '"' && *mPos != '#') {
+					++mPos;
+				}
+			}
+
+			token = std::string_view(start, mPos - start);
+			return true;
+		}
+
+	private:
+		static bool IsSpace(char c) {
+			return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+		}
+
+		std::string mPath;
+		MappedFile mFile;
+		const char* mPos = nullptr;
+		const char* mEnd = nullptr;
+	};
+
+	inline bool IsQuoted(std::string_view token) {
+		return token.size() >= 2 && token.front() == '"' && token.back() == '"';
+	}
+
+	inline std::string Unquote(std::string_view token) {
+		return IsQuoted(token) ? std::string(token.substr(1, token.size() - 2)) : std::string(token);
+	}
+
+	// 指令名以大写字母开头，参数中的bool为小写
+	inline bool IsDirective(std::string_view token) {
+		return !token.empty() && token.front() >= 'A' && token.front() <= 'Z';
+	}
+
+	struct PbrtParam {
+		std::string Type;
+		std::string Name;
+		std::vector<double> Numbers;
+		std::vector<std::string> Strings;	// 字符串与bool
+	};
+
+	using PbrtParamList = std::vector<PbrtParam>;
+
+	const PbrtParam* FindParam(const PbrtParamList& params, const char* name) {
+		for (const PbrtParam& param : params) {
+			if (param.Name == name) {
+				return &param;
+			}
+		}
+		return nullptr;
+	}
+
+	double FindNumber(const PbrtParamList& params, const char* name, double defaultValue) {
+		const PbrtParam* param = FindParam(params, name);
+		return param != nullptr && !param->Numbers.empty() ? param->Numbers[0] : defaultValue;
+	}
+
+	std::string FindString(const PbrtParamList& params, const char* name) {
+		const PbrtParam* param = FindParam(params, name);
+		return param != nullptr && !param->Strings.empty() ? param->Strings[0] : std::string();
+	}
+
+	bool FindBool(const PbrtParamList& params, const char* name, bool defaultValue) {
+		std::string value = FindString(params, name);
+		return value.empty() ? defaultValue : value == "true";
+	}
+
+	// rgb取三个分量，float与blackbody以外的spectrum取平均值作为灰度
+	bool FindColor(const PbrtParamList& params, const char* name, XMFLOAT3& color) {
+		const PbrtParam* param = FindParam(params, name);
+		if (param == nullptr || param->Numbers.empty()) {
+			return false;
+		}
+
+		if (param->Type == "rgb" && param->Numbers.size() >= 3) {
+			color = XMFLOAT3(float(param->Numbers[0]), float(param->Numbers[1]), float(param->Numbers[2]));
+		}
+		else if (param->Type == "spectrum" && param->Numbers.size() >= 2) {
+			// (波长, 值)交替排列
+			double sum = 0.0;
+			size_t count = 0;
+			for (size_t i = 1; i < param->Numbers.size(); i += 2, ++count) {
+				sum += param->Numbers[i];
+			}
+			float value = float(sum / count);
+			color = XMFLOAT3(value, value, value);
+		}
+		else if (param->Type == "float") {
+			float value = float(param->Numbers[0]);
+			color = XMFLOAT3(value, value, value);
+		}
+		else {
+			return false;
+		}
+		return true;
+	}
+
+	// 由折射率(与消光系数)计算法线方向入射时的反射率
+	inline float FresnelR0(float eta, float k) {
+		return ((eta - 1.0f) * (eta - 1.0f) + k * k) / ((eta + 1.0f) * (eta + 1.0f) + k * k);
+	}
+
+	struct PbrtTexture {
+		std::string Filename;		// imagemap，相对于场景文件
+		bool HasAverage = false;	// 其余可求出平均颜色的纹理
+		XMFLOAT3 Average = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	};
+
+	// 几何体的来源，同一PLY文件只对应一个
+	struct ShapeSource {
+		std::string PlyPath;	// 为空时为场景文件中内联的网格，数据已在Mesh中
+		PlyMesh Mesh;
+		bool Valid = false;
+	};
+
+	struct ShapeRef {
+		UINT Source;
+		UINT Material;
+		XMFLOAT4X4 World;
+	};
+
+	struct GraphicsState {
+		XMFLOAT4X4 Transform;
+		UINT Material = UINT_MAX;	// UINT_MAX为默认材质
+	};
+
+	class PbrtParser {
+	public:
+		PbrtParser(const std::string& path) : mDirectory(path.substr(0, path.find_last_of("\\/") + 1)) {
+			XMStoreFloat4x4(&mState.Transform, XMMatrixIdentity());
+		}
+
+		bool Parse(const std::string& path);
+
+		// 读取所有几何体并生成结果
+		void Build(PbrtScene& scene);
+
+	private:
+		bool PushFile(const std::string& path);
+		bool Next(std::string_view& token);
+		bool Peek(std::string_view& token);
+
+		std::string NextString();
+		bool NextNumbers(double* values, size_t count);
+		void ParseParams(PbrtParamList& params);
+		void SkipArguments();
+
+		void ConcatTransform(FXMMATRIX m);
+
+		void MakeTexture(const std::string& name, const std::string& textureClass, const PbrtParamList& params);
+		UINT MakeMaterial(const std::string& type, const PbrtParamList& params);
+		void MakeShape(const std::string& type, const PbrtParamList& params);
+
+		std::string ResolvePath(const std::string& relativePath) const {
+			bool absolute = !relativePath.empty() && (relativePath[0] == '/' || relativePath[0] == '\\' ||
+				(relativePath.size() > 1 && relativePath[1] == ':'));
+			return absolute ? relativePath : mDirectory + relativePath;
+		}
+
+		std::string mDirectory;
+
+		// 所有打开过的文件保留到解析结束，已返回的Token始终有效
+		std::vector<std::unique_ptr<PbrtTokenizer>> mFiles;
+		std::vector<PbrtTokenizer*> mFileStack;
+		std::string_view mPeeked;
+		bool mHasPeeked = false;
+
+		GraphicsState mState;
+		std::vector<GraphicsState> mStateStack;
+		std::vector<bool> mStateStackIsTransformOnly;
+		std::unordered_map<std::string, XMFLOAT4X4> mNamedCoordinateSystems;
+
+		std::unordered_map<std::string, PbrtTexture> mTextures;
+		std::vector<MaterialDesc> mMaterials;
+		std::unordered_map<std::string, UINT> mNamedMaterials;
+
+		std::vector<ShapeSource> mSources;
+		std::unordered_map<std::string, UINT> mPlySources;
+
+		std::vector<ShapeRef> mShapes;
+		std::unordered_map<std::string, std::vector<ShapeRef>> mObjects;
+		std::vector<ShapeRef>* mCurrentObject = nullptr;
+
+		std::unordered_map<std::string, UINT> mSkippedShapes;
+		UINT mSkippedInstances = 0;
+	};
+
+	bool PbrtParser::PushFile(const std::string& path) {
+		auto file = std::make_unique<PbrtTokenizer>();
+		if (!file->Open(path)) {
+			Util::DebugLog("[PbrtLoader] Failed to open %s\n", path.c_str());
+			return false;
+		}
+		mFileStack.push_back(file.get());
+		mFiles.push_back(std::move(file));
+		return true;
+	}
+
+	bool PbrtParser::Next(std::string_view& token) {
+		if (mHasPeeked) {
+			token = mPeeked;
+			mHasPeeked = false;
+			return true;
+		}
+
+		// 被Include的文件结束后回到上一层
+		while (!mFileStack.empty()) {
+			if (mFileStack.back()->Next(token)) {
+				return true;
+			}
+			mFileStack.pop_back();
+		}
+		return false;
+	}
+
+	bool PbrtParser::Peek(std::string_view& token) {
+		if (!mHasPeeked) {
+			mHasPeeked = Next(mPeeked);
+		}
+		token = mPeeked;
+		return mHasPeeked;
+	}
+
+	std::string PbrtParser::NextString() {
+		std::string_view token;
+		if (!Peek(token) || !IsQuoted(token)) {
+			return std::string();
+		}
+		Next(token);
+		return Unquote(token);
+	}
+
+	// 数字可以放在[]中
+	bool PbrtParser::NextNumbers(double* values, size_t count) {
+		std::string_view token;
+		bool bracket = Peek(token) && token == "[";
+		if (bracket) {
+			Next(token);
+		}
+
+		bool ok = true;
+		for (size_t i = 0; i < count; ++i) {
+			if (!Peek(token) || std::from_chars(token.data(), token.data() + token.size(), values[i]).ec != std::errc()) {
+				ok = false;
+				break;
+			}
+			Next(token);
+		}
+
+		if (bracket) {
+			while (Next(token) && token != "]") {}
+		}
+		return ok;
+	}
+
+	// "type name" value 或 "type name" [ values ]
+	void PbrtParser::ParseParams(PbrtParamList& params) {
+		std::string_view token;
+		while (Peek(token) && IsQuoted(token)) {
+			Next(token);
+
+			PbrtParam param;
+			const std::string declaration = Unquote(token);
+			const size_t typeEnd = declaration.find_first_of(" \t");
+			const size_t nameBegin = declaration.find_first_not_of(" \t", typeEnd);
+			if (typeEnd == std::string::npos || nameBegin == std::string::npos) {
+				Util::DebugLog("[PbrtLoader] Invalid parameter declaration \"%s\"\n", declaration.c_str());
+				continue;
+			}
+			param.Type = declaration.substr(0, typeEnd);
+			param.Name = declaration.substr(nameBegin, declaration.find_last_not_of(" \t") + 1 - nameBegin);
+
+			auto AddValue = [&](std::string_view value) {
+				if (IsQuoted(value) || value == "true" || value == "false") {
+					param.Strings.push_back(Unquote(value));
+					return;
+				}
+				double number = 0.0;
+				const char* first = value.data() + (value.size() > 1 && value[0] == '+' ? 1 : 0);
+				if (std::from_chars(first, value.data() + value.size(), number).ec == std::errc()) {
+					param.Numbers.push_back(number);
+				}
+			};
+
+			if (Peek(token) && token == "[") {
+				Next(token);
+				while (Next(token) && token != "]") {
+					AddValue(token);
+				}
+			}
+			else if (Peek(token) && !IsDirective(token)) {
+				Next(token);
+				AddValue(token);
+			}
+
+			params.push_back(std::move(param));
+		}
+	}
+
+	// 不处理的指令: 跳过到下一条指令
+	void PbrtParser::SkipArguments() {
+		std::string_view token;
+		while (Peek(token) && !IsDirective(token)) {
+			Next(token);
+		}
+	}
+
+	// PBRT的变换作用于列向量，新的变换先于已有的CTM作用于顶点，在行向量约定下左乘
+	void PbrtParser::ConcatTransform(FXMMATRIX m) {
+		XMStoreFloat4x4(&mState.Transform, m * XMLoadFloat4x4(&mState.Transform));
+	}
+
+	bool PbrtParser::Parse(const std::string& path) {
+		if (!PushFile(path)) {
+			return false;
+		}
+
+		std::string_view token;
+		while (Next(token)) {
+			const std::string_view directive = token;
+
+			if (directive == "Identity") {
+				XMStoreFloat4x4(&mState.Transform, XMMatrixIdentity());
+			}
+			else if (directive == "Translate") {
+				double v[3];
+				if (NextNumbers(v, 3)) {
+					ConcatTransform(XMMatrixTranslation(float(v[0]), float(v[1]), float(v[2])));
+				}
+			}
+			else if (directive == "Scale") {
+				double v[3];
+				if (NextNumbers(v, 3)) {
+					ConcatTransform(XMMatrixScaling(float(v[0]), float(v[1]), float(v[2])));
+				}
+			}
+			else if (directive == "Rotate") {
+				double v[4];
+				if (NextNumbers(v, 4) && (v[1] != 0.0 || v[2] != 0.0 || v[3] != 0.0)) {
+					XMVECTOR axis = XMVectorSet(float(v[1]), float(v[2]), float(v[3]), 0.0f);
+					ConcatTransform(XMMatrixRotationAxis(axis, XMConvertToRadians(float(v[0]))));
+				}
+			}
+			else if (directive == "LookAt") {
+				double v[9];
+				if (NextNumbers(v, 9)) {
+					ConcatTransform(XMMatrixLookAtLH(
+						XMVectorSet(float(v[0]), float(v[1]), float(v[2]), 1.0f),
+						XMVectorSet(float(v[3]), float(v[4]), float(v[5]), 1.0f),
+						XMVectorSet(float(v[6]), float(v[7]), float(v[8]), 0.0f)));
+				}
+			}
+			else if (directive == "Transform" || directive == "ConcatTransform") {
+				// 16个数按列主序给出PBRT的矩阵，即行向量约定下按行排列的矩阵
+				double v[16];
+				if (NextNumbers(v, 16)) {
+					XMFLOAT4X4 m;
+					for (int i = 0; i < 16; ++i) {
+						m.m[i / 4][i % 4] = float(v[i]);
+					}
+					if (directive == "Transform") {
+						mState.Transform = m;
+					}
+					else {
+						ConcatTransform(XMLoadFloat4x4(&m));
+					}
+				}
+			}
+			else if (directive == "CoordinateSystem") {
+				mNamedCoordinateSystems[NextString()] = mState.Transform;
+			}
+			else if (directive == "CoordSysTransform") {
+				auto it = mNamedCoordinateSystems.find(NextString());
+				if (it != mNamedCoordinateSystems.end()) {
+					mState.Transform = it->second;
+				}
+			}
+			else if (directive == "AttributeBegin" || directive == "TransformBegin") {
+				mStateStack.push_back(mState);
+				mStateStackIsTransformOnly.push_back(directive == "TransformBegin");
+			}
+			else if (directive == "AttributeEnd" || directive == "TransformEnd") {
+				if (mStateStack.empty()) {
+					Util::DebugLog("[PbrtLoader] Unmatched %.*s\n", int(directive.size()), directive.data());
+					continue;
+				}
+				if (mStateStackIsTransformOnly.back()) {
+					mState.Transform = mStateStack.back().Transform;
+				}
+				else {
+					mState = mStateStack.back();
+				}
+				mStateStack.pop_back();
+				mStateStackIsTransformOnly.pop_back();
+			}
+			else if (directive == "WorldBegin") {
+				// 之前的CTM为摄像机变换
+				XMStoreFloat4x4(&mState.Transform, XMMatrixIdentity());
+				mNamedCoordinateSystems["world"] = mState.Transform;
+			}
+			else if (directive == "Texture") {
+				std::string name = NextString();
+				NextString();	// spectrum / float
+				std::string textureClass = NextString();
+				PbrtParamList params;
+				ParseParams(params);
+				MakeTexture(name, textureClass, params);
+			}
+			else if (directive == "Material") {
+				std::string type = NextString();
+				PbrtParamList params;
+				ParseParams(params);
+				mState.Material = MakeMaterial(type, params);
+			}
+			else if (directive == "MakeNamedMaterial") {
+				std::string name = NextString();
+				PbrtParamList params;
+				ParseParams(params);
+				mNamedMaterials[name] = MakeMaterial(FindString(params, "type"), params);
+			}
+			else if (directive == "NamedMaterial") {
+				std::string name = NextString();
+				auto it = mNamedMaterials.find(name);
+				if (it != mNamedMaterials.end()) {
+					mState.Material = it->second;
+				}
+				else {
+					Util::DebugLog("[PbrtLoader] Undefined material \"%s\"\n", name.c_str());
+				}
+			}
+			else if (directive == "Shape") {
+				std::string type = NextString();
+				PbrtParamList params;
+				ParseParams(params);
+				MakeShape(type, params);
+			}
+			else if (directive == "ObjectBegin") {
+				// 与PBRT相同，ObjectBegin隐含AttributeBegin
+				mStateStack.push_back(mState);
+				mStateStackIsTransformOnly.push_back(false);
+				mCurrentObject = &mObjects[NextString()];
+				mCurrentObject->clear();
+			}
+			else if (directive == "ObjectEnd") {
+				mCurrentObject = nullptr;
+				if (!mStateStack.empty()) {
+					mState = mStateStack.back();
+					mStateStack.pop_back();
+					mStateStackIsTransformOnly.pop_back();
+				}
+			}
+			else if (directive == "ObjectInstance") {
+				std::string name = NextString();
+				auto it = mObjects.find(name);
+				if (it == mObjects.end()) {
+					Util::DebugLog("[PbrtLoader] Undefined object \"%s\"\n", name.c_str());
+					continue;
+				}
+
+				// 定义时的变换之后再作用实例的变换，几何体不复制
+				XMMATRIX instanceTransform = XMLoadFloat4x4(&mState.Transform);
+				for (const ShapeRef& shape : it->second) {
+					ShapeRef instance = shape;
+					XMStoreFloat4x4(&instance.World, XMLoadFloat4x4(&shape.World) * instanceTransform);
+					mShapes.push_back(instance);
+				}
+			}
+			else if (directive == "Include" || directive == "Import") {
+				std::string file = NextString();
+				if (!file.empty()) {
+					PushFile(ResolvePath(file));
+				}
+			}
+			else if (directive == "ActiveTransform") {
+				// 参数为不带引号的All/StartTime/EndTime
+				Next(token);
+			}
+			else {
+				// Camera、Film、LightSource等
+				SkipArguments();
+			}
+		}
+
+		return true;
+	}
+
+	void PbrtParser::MakeTexture(const std::string& name, const std::string& textureClass, const PbrtParamList& params) {
+		PbrtTexture texture;
+		if (textureClass == "imagemap") {
+			texture.Filename = FindString(params, "filename");
+		}
+		else if (textureClass == "checkerboard") {
+			XMFLOAT3 tex1(1.0f, 1.0f, 1.0f), tex2(0.0f, 0.0f, 0.0f);
+			FindColor(params, "tex1", tex1);
+			FindColor(params, "tex2", tex2);
+			texture.HasAverage = true;
+			texture.Average = XMFLOAT3((tex1.x + tex2.x) * 0.5f, (tex1.y + tex2.y) * 0.5f, (tex1.z + tex2.z) * 0.5f);
+		}
+		else if (textureClass == "constant") {
+			texture.HasAverage = FindColor(params, "value", texture.Average);
+		}
+		mTextures[name] = texture;
+	}
+
+	UINT PbrtParser::MakeMaterial(const std::string& type, const PbrtParamList& params) {
+		MaterialDesc desc;
+
+		// 漫反射: 颜色或纹理
+		XMFLOAT3 reflectance(0.5f, 0.5f, 0.5f);
+		FindColor(params, "reflectance", reflectance);
+		const PbrtParam* reflectanceTexture = FindParam(params, "reflectance");
+		if (reflectanceTexture != nullptr && reflectanceTexture->Type == "texture" && !reflectanceTexture->Strings.empty()) {
+			auto it = mTextures.find(reflectanceTexture->Strings[0]);
+			if (it != mTextures.end() && !it->second.Filename.empty()) {
+				desc.Textures.push_back({ TextureType::DiffuseTexture, it->second.Filename });
+				reflectance = XMFLOAT3(1.0f, 1.0f, 1.0f);
+			}
+			else if (it != mTextures.end() && it->second.HasAverage) {
+				reflectance = it->second.Average;
+			}
+		}
+
+		// 粗糙度: remaproughness为false时参数即为微表面分布的alpha
+		double roughness = FindNumber(params, "roughness", -1.0);
+		if (roughness < 0.0) {
+			roughness = 0.5 * (FindNumber(params, "uroughness", 0.0) + FindNumber(params, "vroughness", 0.0));
+		}
+		if (!FindBool(params, "remaproughness", true)) {
+			roughness = std::sqrt(roughness);
+		}
+		desc.Roughness = float(roughness);
+
+		const float eta = float(FindNumber(params, "eta", 1.5));
+		const float dielectricR0 = FresnelR0(eta, 0.0f);
+
+		if (type == "conductor") {
+			// 默认为铜
+			XMFLOAT3 conductorEta(0.200438f, 0.924033f, 1.102212f), k(3.912949f, 2.452848f, 2.142188f);
+			FindColor(params, "eta", conductorEta);
+			FindColor(params, "k", k);
+
+			XMFLOAT3 r0;
+			if (FindColor(params, "reflectance", r0)) {
+				desc.FresnelR0 = r0;
+			}
+			else {
+				desc.FresnelR0 = XMFLOAT3(FresnelR0(conductorEta.x, k.x), FresnelR0(conductorEta.y, k.y), FresnelR0(conductorEta.z, k.z));
+			}
+			desc.DiffuseAlbedo = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+			desc.Textures.clear();
+		}
+		else if (type == "dielectric" || type == "thindielectric") {
+			desc.DiffuseAlbedo = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+			desc.FresnelR0 = XMFLOAT3(dielectricR0, dielectricR0, dielectricR0);
+		}
+		else {
+			// diffuse、coateddiffuse等: 表面的涂层视作折射率为eta的电介质
+			desc.DiffuseAlbedo = XMFLOAT4(reflectance.x, reflectance.y, reflectance.z, 1.0f);
+			if (type == "diffuse") {
+				desc.Roughness = 1.0f;
+			}
+			else {
+				desc.FresnelR0 = XMFLOAT3(dielectricR0, dielectricR0, dielectricR0);
+			}
+		}
+
+		// 其余图片纹理
+		const std::pair<const char*, TextureType> textureSlots[] = {
+			{ "roughness",		TextureType::RoughnessTexture },
+			{ "displacement",	TextureType::BumpTexture },
+		};
+		for (const auto& [name, slot] : textureSlots) {
+			const PbrtParam* param = FindParam(params, name);
+			if (param != nullptr && param->Type == "texture" && !param->Strings.empty()) {
+				auto it = mTextures.find(param->Strings[0]);
+				if (it != mTextures.end() && !it->second.Filename.empty()) {
+					desc.Textures.push_back({ slot, it->second.Filename });
+				}
+			}
+		}
+		std::string normalMap = FindString(params, "normalmap");
+		if (!normalMap.empty()) {
+			desc.Textures.push_back({ TextureType::NormalTexture, normalMap });
+		}
+
+		mMaterials.push_back(std::move(desc));
+		return static_cast<UINT>(mMaterials.size() - 1);
+	}
+
+	void PbrtParser::MakeShape(const std::string& type, const PbrtParamList& params) {
+		UINT source = UINT_MAX;
+
+		if (type == "plymesh") {
+			const std::string filename = FindString(params, "filename");
+			if (filename.size() >= 3 && filename.compare(filename.size() - 3, 3, ".gz") == 0) {
+				mSkippedShapes["plymesh (gzip)"]++;
+				return;
+			}
+
+			// 同一文件只读取一次
+			const std::string path = ResolvePath(filename);
+			auto it = mPlySources.find(path);
+			if (it != mPlySources.end()) {
+				source = it->second;
+			}
+			else {
+				source = static_cast<UINT>(mSources.size());
+				mSources.emplace_back();
+				mSources.back().PlyPath = path;
+				mPlySources[path] = source;
+			}
+		}
+		else if (type == "trianglemesh" || type == "loopsubdiv" || type == "bilinearmesh") {
+			// loopsubdiv只使用控制网格，不做细分
+			const PbrtParam* P = FindParam(params, "P");
+			const PbrtParam* indices = FindParam(params, "indices");
+			const PbrtParam* N = FindParam(params, "N");
+			const PbrtParam* uv = FindParam(params, "uv");
+			if (uv == nullptr) {
+				uv = FindParam(params, "st");
+			}
+			if (P == nullptr || P->Numbers.size() < 9) {
+				mSkippedShapes[type]++;
+				return;
+			}
+
+			PlyMesh mesh;
+			const size_t vertexCount = P->Numbers.size() / 3;
+			mesh.Positions.resize(vertexCount);
+			for (size_t i = 0; i < vertexCount; ++i) {
+				mesh.Positions[i] = XMFLOAT3(float(P->Numbers[3 * i]), float(P->Numbers[3 * i + 1]), float(P->Numbers[3 * i + 2]));
+			}
+			if (N != nullptr && N->Numbers.size() == 3 * vertexCount) {
+				mesh.Normals.resize(vertexCount);
+				for (size_t i = 0; i < vertexCount; ++i) {
+					mesh.Normals[i] = XMFLOAT3(float(N->Numbers[3 * i]), float(N->Numbers[3 * i + 1]), float(N->Numbers[3 * i + 2]));
+				}
+			}
+			if (uv != nullptr && uv->Numbers.size() == 2 * vertexCount) {
+				mesh.TexCoords.resize(vertexCount);
+				for (size_t i = 0; i < vertexCount; ++i) {
+					mesh.TexCoords[i] = XMFLOAT2(float(uv->Numbers[2 * i]), float(uv->Numbers[2 * i + 1]));
+				}
+			}
+
+			std::vector<UINT> corners;
+			if (indices != nullptr) {
+				corners.reserve(indices->Numbers.size());
+				for (double index : indices->Numbers) {
+					corners.push_back(index >= 0.0 && index < double(vertexCount) ? UINT(index) : UINT_MAX);
+				}
+			}
+			else if (vertexCount == 3 || (type == "bilinearmesh" && vertexCount == 4)) {
+				for (UINT i = 0; i < vertexCount; ++i) {
+					corners.push_back(i);
+				}
+			}
+
+			// 双线性面片的四个顶点依次为p00、p10、p01、p11
+			const size_t cornersPerFace = type == "bilinearmesh" ? 4 : 3;
+			for (size_t f = 0; f + cornersPerFace <= corners.size(); f += cornersPerFace) {
+				const UINT* c = corners.data() + f;
+				if (std::any_of(c, c + cornersPerFace, [](UINT index) { return index == UINT_MAX; })) {
+					continue;
+				}
+				if (cornersPerFace == 4) {
+					mesh.Indices.insert(mesh.Indices.end(), { c[0], c[1], c[3], c[0], c[3], c[2] });
+				}
+				else {
+					mesh.Indices.insert(mesh.Indices.end(), { c[0], c[1], c[2] });
+				}
+			}
+			if (mesh.Indices.empty()) {
+				mSkippedShapes[type]++;
+				return;
+			}
+
+			source = static_cast<UINT>(mSources.size());
+			mSources.emplace_back();
+			mSources.back().Mesh = std::move(mesh);
+			mSources.back().Valid = true;
+		}
+		else {
+			mSkippedShapes[type]++;
+			return;
+		}
+
+		ShapeRef shape = { source, mState.Material, mState.Transform };
+		if (mCurrentObject != nullptr) {
+			mCurrentObject->push_back(shape);
+		}
+		else {
+			mShapes.push_back(shape);
+		}
+	}
+
+	// 转换为引擎的约定: 纹理坐标v翻转，三角形按法线调整为正面朝外(左手坐标系下顺时针)
+	// 没有法线时PBRT以(p1 - p0) x (p2 - p0)为几何法线，与正面的约定一致
+	// mirrored为true时在生成法线之后再反转绕序，用于行列式为负的变换
+	void BuildGeometry(const PlyMesh& mesh, bool mirrored, std::vector<PbrtVertex>& vertices, std::vector<UINT>& indices) {
+		const bool hasNormals = !mesh.Normals.empty();
+		const bool hasTexCoords = !mesh.TexCoords.empty();
+
+		vertices.resize(mesh.Positions.size());
+		for (size_t i = 0; i < vertices.size(); ++i) {
+			PbrtVertex& vertex = vertices[i];
+			vertex.position = mesh.Positions[i];
+			vertex.normal = hasNormals ? mesh.Normals[i] : XMFLOAT3(0.0f, 0.0f, 0.0f);
+			vertex.tangent = XMFLOAT3(0.0f, 0.0f, 0.0f);
+			vertex.textureCoordinate = hasTexCoords ? XMFLOAT2(mesh.TexCoords[i].x, 1.0f - mesh.TexCoords[i].y) : XMFLOAT2(0.0f, 0.0f);
+		}
+
+		indices = mesh.Indices;
+		for (size_t t = 0; hasNormals && t + 2 < indices.size(); t += 3) {
+			XMVECTOR p0 = XMLoadFloat3(&mesh.Positions[indices[t]]);
+			XMVECTOR faceNormal = XMVector3Cross(
+				XMLoadFloat3(&mesh.Positions[indices[t + 1]]) - p0,
+				XMLoadFloat3(&mesh.Positions[indices[t + 2]]) - p0);
+			XMVECTOR vertexNormal = XMLoadFloat3(&mesh.Normals[indices[t]]) +
+				XMLoadFloat3(&mesh.Normals[indices[t + 1]]) +
+				XMLoadFloat3(&mesh.Normals[indices[t + 2]]);
+			if (XMVectorGetX(XMVector3Dot(faceNormal, vertexNormal)) < 0.0f) {
+				std::swap(indices[t + 1], indices[t + 2]);
+			}
+		}
+
+		TangentSpace::GenerateNormals(vertices.data(), vertices.size(), indices.data(), indices.size());
+
+		// Tangent与绕序无关
+		if (mirrored) {
+			for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+				std::swap(indices[t + 1], indices[t + 2]);
+			}
+		}
+		std::vector<PbrtVertex> splitVertices;
+		TangentSpace::GenerateTangents(vertices.data(), vertices.size(), indices.data(), indices.size(), splitVertices);
+		vertices.insert(vertices.end(), splitVertices.begin(), splitVertices.end());
+	}
+
+	void PbrtParser::Build(PbrtScene& scene) {
+		INT64 stageStart = Util::QueryTimestamp();
+
+		// 并行读取PLY文件，每个文件内部的顶点转换同样是并行的
+		ThreadPool::Get().ParallelFor(mSources.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				ShapeSource& source = mSources[i];
+				if (!source.PlyPath.empty()) {
+					source.Valid = PlyLoader::Load(source.PlyPath, source.Mesh);
+				}
+			}
+		});
+
+		const double loadTime = Util::MillisecondsSince(stageStart);
+		stageStart = Util::QueryTimestamp();
+
+		// 每个(来源, 是否镜像)组合对应一个SubMesh
+		struct GeometryKey {
+			UINT Source;
+			bool Mirrored;
+		};
+		std::vector<GeometryKey> geometries;
+		std::unordered_map<UINT64, UINT> geometryIndices;
+		std::vector<UINT> geometryMaterials;
+
+		scene.Instances.clear();
+		scene.Instances.reserve(mShapes.size());
+		for (const ShapeRef& shape : mShapes) {
+			if (!mSources[shape.Source].Valid) {
+				mSkippedInstances++;
+				continue;
+			}
+
+			XMMATRIX world = XMLoadFloat4x4(&shape.World);
+			const bool mirrored = XMVectorGetX(XMMatrixDeterminant(world)) < 0.0f;
+			const UINT64 key = (UINT64(shape.Source) << 1) | (mirrored ? 1 : 0);
+
+			auto it = geometryIndices.find(key);
+			if (it == geometryIndices.end()) {
+				it = geometryIndices.emplace(key, static_cast<UINT>(geometries.size())).first;
+				geometries.push_back({ shape.Source, mirrored });
+				geometryMaterials.push_back(shape.Material);
+			}
+
+			PbrtShapeInstance instance;
+			instance.SubMeshIndex = it->second;
+			instance.MaterialIndex = shape.Material;
+			instance.World = shape.World;
+			scene.Instances.push_back(instance);
+		}
+
+		std::vector<std::vector<PbrtVertex>> vertices(geometries.size());
+		std::vector<std::vector<UINT>> indices(geometries.size());
+		ThreadPool::Get().ParallelFor(geometries.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				BuildGeometry(mSources[geometries[i].Source].Mesh, geometries[i].Mirrored, vertices[i], indices[i]);
+			}
+		});
+
+		const double buildTime = Util::MillisecondsSince(stageStart);
+
+		// 只保留被引用的材质，未指定材质的Shape使用PBRT的默认材质(漫反射0.5)
+		ObjModel& model = scene.Geometry;
+		model = ObjModel();
+		std::unordered_map<UINT, UINT> materialRemap;
+		auto RemapMaterial = [&](UINT material) {
+			auto it = materialRemap.find(material);
+			if (it != materialRemap.end()) {
+				return it->second;
+			}
+
+			UINT index = static_cast<UINT>(model.Materials.size());
+			if (material == UINT_MAX) {
+				MaterialDesc desc;
+				desc.DiffuseAlbedo = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
+				model.Materials.push_back(desc);
+			}
+			else {
+				model.Materials.push_back(mMaterials[material]);
+			}
+			materialRemap[material] = index;
+			return index;
+		};
+		for (PbrtShapeInstance& instance : scene.Instances) {
+			instance.MaterialIndex = RemapMaterial(instance.MaterialIndex);
+		}
+
+		size_t totalVertices = 0, totalIndices = 0;
+		model.SubMeshes.resize(geometries.size());
+		for (size_t i = 0; i < geometries.size(); ++i) {
+			ObjSubMesh& submesh = model.SubMeshes[i];
+			submesh.BaseVertexLocation = static_cast<UINT>(totalVertices);
+			submesh.NumVertices = static_cast<UINT>(vertices[i].size());
+			submesh.StartIndexLocation = static_cast<UINT>(totalIndices);
+			submesh.NumIndices = static_cast<UINT>(indices[i].size());
+			submesh.MaterialIndex = RemapMaterial(geometryMaterials[i]);
+
+			totalVertices += submesh.NumVertices;
+			totalIndices += submesh.NumIndices;
+		}
+
+		model.Vertices.resize(totalVertices);
+		model.Indices.resize(totalIndices);
+		ThreadPool::Get().ParallelFor(geometries.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				std::copy(vertices[i].begin(), vertices[i].end(), model.Vertices.begin() + model.SubMeshes[i].BaseVertexLocation);
+				std::copy(indices[i].begin(), indices[i].end(), model.Indices.begin() + model.SubMeshes[i].StartIndexLocation);
+			}
+		});
+
+		for (const auto& [type, count] : mSkippedShapes) {
+			Util::DebugLog("[PbrtLoader] Skipped %u unsupported shapes of type %s\n", count, type.c_str());
+		}
+		if (mSkippedInstances > 0) {
+			Util::DebugLog("[PbrtLoader] Skipped %u shapes whose geometry failed to load\n", mSkippedInstances);
+		}
+		Util::DebugLog("[PbrtLoader] %zu files, %zu geometry sources, %zu submeshes, %zu instances, %zu vertices, %zu triangles, %zu materials: "
+			"load %.2f ms, build %.2f ms\n",
+			mFiles.size(), mSources.size(), geometries.size(), scene.Instances.size(), totalVertices, totalIndices / 3, model.Materials.size(),
+			loadTime, buildTime);
+	}
+}
+
+bool PbrtLoader::Load(const std::string& path, PbrtScene& scene) {
+	const INT64 parseStart = Util::QueryTimestamp();
+
+	PbrtParser parser(path);
+	if (!parser.Parse(path)) {
+		return false;
+	}
+	Util::DebugLog("[PbrtLoader] %s: parse %.2f ms\n", path.c_str(), Util::MillisecondsSince(parseStart));
+
+	parser.Build(scene);
+	return !scene.Instances.empty();
+}
@@ -0,0 +1,474 @@
+#include "PlyLoader.h"
+#include "MeshCache.h"
+#include "ThreadPool.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace {
+	enum class PlyType {
+		Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid
+	};
+
+	struct PlyProperty {
+		std::string Name;
+		PlyType Type = PlyType::Invalid;
+		PlyType CountType = PlyType::Invalid;	// 只对列表有效
+		bool IsList = false;
+		UINT Offset = 0;						// 元素长度固定时在一行中的位置
+	};
+
+	struct PlyElement {
+		std::string Name;
+		UINT64 Count = 0;
+		std::vector<PlyProperty> Properties;
+
+		// 不含列表时每行长度固定
+		bool FixedSize = true;
+		UINT Stride = 0;
+
+		int Find(const char* name) const {
+			for (size_t i = 0; i < Properties.size(); ++i) {
+				if (Properties[i].Name == name) {
+					return static_cast<int>(i);
+				}
+			}
+			return -1;
+		}
+	};
+
+	enum class PlyFormat {
+		Ascii, BinaryLittleEndian, BinaryBigEndian
+	};
+
+	PlyType ParseType(const std::string& name) {
+		if (name == "char" || name == "int8")		return PlyType::Int8;
+		if (name == "uchar" || name == "uint8")		return PlyType::UInt8;
+		if (name == "short" || name == "int16")		return PlyType::Int16;
+		if (name == "ushort" || name == "uint16")	return PlyType::UInt16;
+		if (name == "int" || name == "int32")		return PlyType::Int32;
+		if (name == "uint" || name == "uint32")		return PlyType::UInt32;
+		if (name == "float" || name == "float32")	return PlyType::Float32;
+		if (name == "double" || name == "float64")	return PlyType::Float64;
+		return PlyType::Invalid;
+	}
+
+	UINT TypeSize(PlyType type) {
+		switch (type) {
+		case PlyType::Int8: case PlyType::UInt8:	return 1;
+		case PlyType::Int16: case PlyType::UInt16:	return 2;
+		case PlyType::Int32: case PlyType::UInt32: case PlyType::Float32: return 4;
+		case PlyType::Float64:						return 8;
+		default:									return 0;
+		}
+	}
+
+	template<typename T>
+	inline T Load(const BYTE* p, bool swap) {
+		BYTE bytes[sizeof(T)];
+		if (swap) {
+			for (size_t i = 0; i < sizeof(T); ++i) {
+				bytes[i] = p[sizeof(T) - 1 - i];
+			}
+		}
+		else {
+			memcpy(bytes, p, sizeof(T));
+		}
+
+		T value;
+		memcpy(&value, bytes, sizeof(T));
+		return value;
+	}
+
+	inline double ReadBinary(const BYTE* p, PlyType type, bool swap) {
+		switch (type) {
+		case PlyType::Int8:		return static_cast<INT8>(*p);
+		case PlyType::UInt8:	return *p;
+		case PlyType::Int16:	return Load<INT16>(p, swap);
+		case PlyType::UInt16:	return Load<UINT16>(p, swap);
+		case PlyType::Int32:	return Load<INT32>(p, swap);
+		case PlyType::UInt32:	return Load<UINT32>(p, swap);
+		case PlyType::Float32:	return Load<float>(p, swap);
+		case PlyType::Float64:	return Load<double>(p, swap);
+		default:				return 0.0;
+		}
+	}
+
+	// 顶点属性在PlyElement::Properties中的位置，不存在时为-1
+	struct VertexLayout {
+		int Position[3];
+		int Normal[3];
+		int TexCoord[2];
+
+		explicit VertexLayout(const PlyElement& element) {
+			Position[0] = element.Find("x");
+			Position[1] = element.Find("y");
+			Position[2] = element.Find("z");
+			Normal[0] = element.Find("nx");
+			Normal[1] = element.Find("ny");
+			Normal[2] = element.Find("nz");
+
+			const char* texCoordNames[][2] = { { "u", "v" }, { "s", "t" }, { "texture_u", "texture_v" }, { "texture_s", "texture_t" } };
+			TexCoord[0] = TexCoord[1] = -1;
+			for (const auto& names : texCoordNames) {
+				if (element.Find(names[0]) >= 0 && element.Find(names[1]) >= 0) {
+					TexCoord[0] = element.Find(names[0]);
+					TexCoord[1] = element.Find(names[1]);
+					break;
+				}
+			}
+		}
+
+		bool HasPosition() const { return Position[0] >= 0 && Position[1] >= 0 && Position[2] >= 0; }
+		bool HasNormal() const { return Normal[0] >= 0 && Normal[1] >= 0 && Normal[2] >= 0; }
+		bool HasTexCoord() const { return TexCoord[0] >= 0; }
+	};
+
+	// 将一个顶点的各属性值(按Properties的顺序)写入mesh
+	inline void StoreVertex(PlyMesh& mesh, const VertexLayout& layout, size_t i, const double* values) {
+		mesh.Positions[i] = XMFLOAT3(
+			static_cast<float>(values[layout.Position[0]]),
+			static_cast<float>(values[layout.Position[1]]),
+			static_cast<float>(values[layout.Position[2]]));
+		if (layout.HasNormal()) {
+			mesh.Normals[i] = XMFLOAT3(
+				static_cast<float>(values[layout.Normal[0]]),
+				static_cast<float>(values[layout.Normal[1]]),
+				static_cast<float>(values[layout.Normal[2]]));
+		}
+		if (layout.HasTexCoord()) {
+			mesh.TexCoords[i] = XMFLOAT2(
+				static_cast<float>(values[layout.TexCoord[0]]),
+				static_cast<float>(values[layout.TexCoord[1]]));
+		}
+	}
+
+	// 扇形三角化，序号越界的面被丢弃
+	inline bool AppendFace(PlyMesh& mesh, const UINT* face, size_t count) {
+		const size_t vertexCount = mesh.Positions.size();
+		for (size_t i = 0; i < count; ++i) {
+			if (face[i] >= vertexCount) {
+				return false;
+			}
+		}
+
+		for (size_t i = 1; i + 1 < count; ++i) {
+			mesh.Indices.push_back(face[0]);
+			mesh.Indices.push_back(face[i]);
+			mesh.Indices.push_back(face[i + 1]);
+		}
+		return count >= 3;
+	}
+
+	// 以空白分隔的数字
+	class AsciiReader {
+	public:
+		AsciiReader(const char* begin, const char* end) : mPos(begin), mEnd(end) {}
+
+		bool Read(double& value) {
+			while (mPos < mEnd && (*mPos == ' ' || *mPos == '\t' || *mPos == '\r' || *mPos == '\n')) {
+				++mPos;
+			}
+			if (mPos < mEnd && *mPos == '+') {
+				++mPos;
+			}
+
+			auto result = std::from_chars(mPos, mEnd, value);
+			if (result.ec != std::errc()) {
+				return false;
+			}
+			mPos = result.ptr;
+			return true;
+		}
+
+	private:
+		const char* mPos;
+		const char* mEnd;
+	};
+
+	bool ParseHeader(const char*& p, const char* end, PlyFormat& format, std::vector<PlyElement>& elements) {
+		bool hasFormat = false;
+		bool first = true;
+
+		while (p < end) {
+			const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+			if (lineEnd == nullptr) {
+				return false;
+			}
+
+			std::string line(p, lineEnd);
+			p = lineEnd + 1;
+			if (!line.empty() && line.back() == '\r') {
+				line.pop_back();
+			}
+
+			// 按空白切分
+			std::vector<std::string> words;
+			for (size_t i = 0; i < line.size();) {
+				size_t j = line.find_first_of(" \t", i);
+				if (j == std::string::npos) {
+					j = line.size();
+				}
+				if (j > i) {
+					words.push_back(line.substr(i, j - i));
+				}
+				i = j + 1;
+			}
+
+			if (first) {
+				if (words.empty() || words[0] != "ply") {
+					return false;
+				}
+				first = false;
+			}
+			else if (words.empty() || words[0] == "comment" || words[0] == "obj_info") {
+				continue;
+			}
+			else if (words[0] == "format" && words.size() >= 2) {
+				if (words[1] == "ascii")					format = PlyFormat::Ascii;
+				else if (words[1] == "binary_little_endian")	format = PlyFormat::BinaryLittleEndian;
+				else if (words[1] == "binary_big_endian")		format = PlyFormat::BinaryBigEndian;
+				else return false;
+				hasFormat = true;
+			}
+			else if (words[0] == "element" && words.size() >= 3) {
+				PlyElement element;
+				element.Name = words[1];
+				if (std::from_chars(words[2].data(), words[2].data() + words[2].size(), element.Count).ec != std::errc()) {
+					return false;
+				}
+				elements.push_back(std::move(element));
+			}
+			else if (words[0] == "property" && !elements.empty()) {
+				PlyElement& element = elements.back();
+				PlyProperty prop;
+				if (words.size() >= 5 && words[1] == "list") {
+					prop.IsList = true;
+					prop.CountType = ParseType(words[2]);
+					prop.Type = ParseType(words[3]);
+					prop.Name = words[4];
+					if (prop.CountType == PlyType::Invalid) {
+						return false;
+					}
+					element.FixedSize = false;
+				}
+				else if (words.size() >= 3) {
+					prop.Type = ParseType(words[1]);
+					prop.Name = words[2];
+					prop.Offset = element.Stride;
+					element.Stride += TypeSize(prop.Type);
+				}
+				if (prop.Type == PlyType::Invalid) {
+					return false;
+				}
+				element.Properties.push_back(std::move(prop));
+			}
+			else if (words[0] == "end_header") {
+				return hasFormat;
+			}
+		}
+
+		return false;
+	}
+
+	// 长度不固定的一行，返回下一行的起点，越界时返回nullptr
+	// values按Properties的顺序存放标量属性，indexList不为空时存放名为listName的列表
+	const BYTE* ReadBinaryItem(const BYTE* p, const BYTE* end, const PlyElement& element, bool swap,
+		double* values, int listIndex, std::vector<UINT>* indexList) {
+		for (size_t k = 0; k < element.Properties.size(); ++k) {
+			const PlyProperty& prop = element.Properties[k];
+			if (!prop.IsList) {
+				if (p + TypeSize(prop.Type) > end) {
+					return nullptr;
+				}
+				if (values != nullptr) {
+					values[k] = ReadBinary(p, prop.Type, swap);
+				}
+				p += TypeSize(prop.Type);
+				continue;
+			}
+
+			if (p + TypeSize(prop.CountType) > end) {
+				return nullptr;
+			}
+			const UINT64 count = static_cast<UINT64>(ReadBinary(p, prop.CountType, swap));
+			p += TypeSize(prop.CountType);
+
+			const UINT size = TypeSize(prop.Type);
+			if (static_cast<UINT64>(end - p) < count * size) {
+				return nullptr;
+			}
+			if (static_cast<int>(k) == listIndex && indexList != nullptr) {
+				indexList->resize(count);
+				for (UINT64 i = 0; i < count; ++i) {
+					(*indexList)[i] = static_cast<UINT>(ReadBinary(p + i * size, prop.Type, swap));
+				}
+			}
+			p += count * size;
+		}
+
+		return p;
+	}
+
+	bool ReadAsciiItem(AsciiReader& reader, const PlyElement& element, double* values, int listIndex, std::vector<UINT>* indexList) {
+		for (size_t k = 0; k < element.Properties.size(); ++k) {
+			const PlyProperty& prop = element.Properties[k];
+			double value = 0.0;
+			if (!reader.Read(value)) {
+				return false;
+			}
+			if (!prop.IsList) {
+				if (values != nullptr) {
+					values[k] = value;
+				}
+				continue;
+			}
+
+			const UINT64 count = static_cast<UINT64>(value);
+			const bool store = static_cast<int>(k) == listIndex && indexList != nullptr;
+			if (store) {
+				indexList->resize(count);
+			}
+			for (UINT64 i = 0; i < count; ++i) {
+				if (!reader.Read(value)) {
+					return false;
+				}
+				if (store) {
+					(*indexList)[i] = static_cast<UINT>(value);
+				}
+			}
+		}
+
+		return true;
+	}
+}
+
+bool PlyLoader::Load(const std::string& path, PlyMesh& mesh) {
+	MappedFile file;
+	if (!file.Open(path)) {
+		Util::DebugLog("[PlyLoader] Failed to open %s\n", path.c_str());
+		return false;
+	}
+
+	const char* p = reinterpret_cast<const char*>(file.Data());
+	const char* textEnd = p + file.Size();
+
+	PlyFormat format = PlyFormat::Ascii;
+	std::vector<PlyElement> elements;
+	if (!ParseHeader(p, textEnd, format, elements)) {
+		Util::DebugLog("[PlyLoader] %s: invalid header\n", path.c_str());
+		return false;
+	}
+
+	const BYTE* data = reinterpret_cast<const BYTE*>(p);
+	const BYTE* dataEnd = reinterpret_cast<const BYTE*>(textEnd);
+	const bool swap = format == PlyFormat::BinaryBigEndian;
+	AsciiReader ascii(p, textEnd);
+
+	mesh = PlyMesh();
+	UINT invalidFaces = 0;
+	bool truncated = false;
+
+	for (const PlyElement& element : elements) {
+		std::vector<double> values(element.Properties.size());
+
+		if (element.Name == "vertex") {
+			VertexLayout layout(element);
+			if (!layout.HasPosition()) {
+				Util::DebugLog("[PlyLoader] %s: vertices have no position\n", path.c_str());
+				return false;
+			}
+
+			const size_t count = static_cast<size_t>(element.Count);
+			mesh.Positions.resize(count);
+			mesh.Normals.resize(layout.HasNormal() ? count : 0);
+			mesh.TexCoords.resize(layout.HasTexCoord() ? count : 0);
+
+			if (format != PlyFormat::Ascii && element.FixedSize) {
+				// 每行长度固定，可以直接定位到任意顶点
+				if (static_cast<UINT64>(dataEnd - data) < element.Count * element.Stride) {
+					truncated = true;
+					break;
+				}
+
+				ThreadPool::Get().ParallelFor(count, 16384, [&](size_t begin, size_t end) {
+					std::vector<double> local(element.Properties.size());
+					for (size_t i = begin; i < end; ++i) {
+						const BYTE* item = data + i * element.Stride;
+						for (size_t k = 0; k < element.Properties.size(); ++k) {
+							local[k] = ReadBinary(item + element.Properties[k].Offset, element.Properties[k].Type, swap);
+						}
+						StoreVertex(mesh, layout, i, local.data());
+					}
+				});
+				data += element.Count * element.Stride;
+			}
+			else {
+				for (size_t i = 0; i < count && !truncated; ++i) {
+					if (format == PlyFormat::Ascii) {
+						truncated = !ReadAsciiItem(ascii, element, values.data(), -1, nullptr);
+					}
+					else {
+						data = ReadBinaryItem(data, dataEnd, element, swap, values.data(), -1, nullptr);
+						truncated = data == nullptr;
+					}
+					if (!truncated) {
+						StoreVertex(mesh, layout, i, values.data());
+					}
+				}
+			}
+		}
+		else if (element.Name == "face") {
+			int listIndex = element.Find("vertex_indices");
+			if (listIndex < 0) {
+				listIndex = element.Find("vertex_index");
+			}
+
+			mesh.Indices.reserve(element.Count * 3);
+			std::vector<UINT> face;
+			for (UINT64 i = 0; i < element.Count && !truncated; ++i) {
+				face.clear();
+				if (format == PlyFormat::Ascii) {
+					truncated = !ReadAsciiItem(ascii, element, nullptr, listIndex, &face);
+				}
+				else {
+					data = ReadBinaryItem(data, dataEnd, element, swap, nullptr, listIndex, &face);
+					truncated = data == nullptr;
+				}
+				if (!truncated && !AppendFace(mesh, face.data(), face.size())) {
+					invalidFaces++;
+				}
+			}
+		}
+		else {
+			// 跳过其余元素
+			for (UINT64 i = 0; i < element.Count && !truncated; ++i) {
+				if (format == PlyFormat::Ascii) {
+					truncated = !ReadAsciiItem(ascii, element, nullptr, -1, nullptr);
+				}
+				else {
+					data = ReadBinaryItem(data, dataEnd, element, swap, nullptr, -1, nullptr);
+					truncated = data == nullptr;
+				}
+			}
+		}
+
+		if (truncated) {
+			break;
+		}
+	}
+
+	if (truncated) {
+		Util::DebugLog("[PlyLoader] %s: unexpected end of file\n", path.c_str());
+		return false;
+	}
+	if (invalidFaces > 0) {
+		Util::DebugLog("[PlyLoader] %s: skipped %u faces with invalid indices\n", path.c_str(), invalidFaces);
+	}
+
+	return !mesh.Positions.empty() && !mesh.Indices.empty();
+}
@@ -0,0 +1,79 @@
+#include "RadixSort.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <array>
+
+namespace {
+	// 元素较少时只用一个块，避免线程调度的开销
+	const size_t MinBlockSize = 4096;
+}
+
+void RadixSort::Sort(std::vector<KeyValue>& items, std::vector<KeyValue>& scratch) {
+	const size_t count = items.size();
+	if (count < 2) {
+		return;
+	}
+	scratch.resize(count);
+
+	// 所有键的按位或与按位与不同的位即存在差异的位
+	UINT64 anyBits = 0, allBits = ~0ull;
+	for (const KeyValue& item : items) {
+		anyBits |= item.Key;
+		allBits &= item.Key;
+	}
+	const UINT64 differingBits = anyBits ^ allBits;
+
+	ThreadPool& threadPool = ThreadPool::Get();
+	const size_t blockSize = (std::max)(MinBlockSize, (count + threadPool.ThreadCount() - 1) / threadPool.ThreadCount());
+	const size_t blockCount = (count + blockSize - 1) / blockSize;
+	std::vector<std::array<UINT, 256>> histograms(blockCount);
+
+	KeyValue* source = items.data();
+	KeyValue* destination = scratch.data();
+	for (UINT shift = 0; shift < 64; shift += 8) {
+		if (((differingBits >> shift) & 0xFF) == 0) {
+			continue;
+		}
+
+		// 1. 各块的直方图
+		threadPool.ParallelFor(blockCount, 1, [&](size_t begin, size_t end) {
+			for (size_t block = begin; block < end; ++block) {
+				std::array<UINT, 256>& histogram = histograms[block];
+				histogram.fill(0);
+				const size_t last = (std::min)(count, (block + 1) * blockSize);
+				for (size_t i = block * blockSize; i < last; ++i) {
+					histogram[(source[i].Key >> shift) & 0xFF]++;
+				}
+			}
+		});
+
+		// 2. 前缀和: 先按数字、再按块排列，同一数字中靠前的块写在前面
+		UINT offset = 0;
+		for (UINT digit = 0; digit < 256; ++digit) {
+			for (std::array<UINT, 256>& histogram : histograms) {
+				const UINT digitCount = histogram[digit];
+				histogram[digit] = offset;
+				offset += digitCount;
+			}
+		}
+
+		// 3. 各块分散到各自的位置
+		threadPool.ParallelFor(blockCount, 1, [&](size_t begin, size_t end) {
+			for (size_t block = begin; block < end; ++block) {
+				std::array<UINT, 256>& histogram = histograms[block];
+				const size_t last = (std::min)(count, (block + 1) * blockSize);
+				for (size_t i = block * blockSize; i < last; ++i) {
+					destination[histogram[(source[i].Key >> shift) & 0xFF]++] = source[i];
+				}
+			}
+		});
+
+		std::swap(source, destination);
+	}
+
+	// 结果位于scratch中时交换两者
+	if (source != items.data()) {
+		items.swap(scratch);
+	}
+}
@@ -10,7 +10,7 @@ const wchar_t* RayTracingApp::mMissShaderName = L"MyMissShader";
 void RayTracingApp::CheckRayTracingSupport() {
 	D3D12_FEATURE_DATA_D3D12_OPTIONS5 rayTracingSupportData = {};
 
-	// RayTracingְ֧D3D12_FEATURE_D3D12_OPTIONS5
+	// RayTracing的支持包含在D3D12_FEATURE_D3D12_OPTIONS5特性中
 	HRESULT hr = mDevice->CheckFeatureSupport(
 		D3D12_FEATURE_D3D12_OPTIONS5,
 		&rayTracingSupportData,
@@ -18,6 +18,7 @@ void RayTracingApp::CheckRayTracingSupport() {
 	);
 
 	bSupportRayTracing = SUCCEEDED(hr) && (rayTracingSupportData.RaytracingTier != D3D12_RAYTRACING_TIER_NOT_SUPPORTED);
+	mRayTracingTier = SUCCEEDED(hr) ? rayTracingSupportData.RaytracingTier : D3D12_RAYTRACING_TIER_NOT_SUPPORTED;
 }
 
 void RayTracingApp::CreateDescriptorHeap() {
@@ -34,7 +35,7 @@ void RayTracingApp::CreateDescriptorHeap() {
 }
 
 void RayTracingApp::CreateRayTracingOutput() {
-	// 1. Դ
+	// 1. 资源创建
 	D3D12_RESOURCE_DESC rayTracingOutputDesc = CD3DX12_RESOURCE_DESC::Tex2D(
 		mBackBufferFormat,
 		mClientWidth,
@@ -56,11 +57,11 @@ void RayTracingApp::CreateRayTracingOutput() {
 		IID_PPV_ARGS(&mRayTracingOutput)
 	));
 
-	// 2.  + д
+	// 2. 描述符创建 + 写入描述符堆
 	D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
 	uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
 
-	// ˴UAVDescriptor Heap
+	// 此处将UAV置于Descriptor Heap的最后
 	CD3DX12_CPU_DESCRIPTOR_HANDLE descHandle(
 		mDescriptorHeap->GetCPUDescriptorHandleForHeapStart(),
 		mDescriptorHeap->GetDesc().NumDescriptors - 1,
@@ -75,8 +76,8 @@ void RayTracingApp::CreateRayTracingOutput() {
 
 void RayTracingApp::CreateRootSignature() {
 	// Global Root Signature
-	// ˴밴˳ִУǰûϵ
-	// ɵԹͻ
+	// 此处代码按顺序执行，且前后没有依赖关系
+	// 可单独分离作用域以规避命名冲突
 	{
 		CD3DX12_ROOT_PARAMETER rootParameters[GlobalRootParameter::ParameterCount];
 
@@ -114,11 +115,11 @@ void RayTracingApp::CreateRootSignature() {
 	// Local Root Signature
 	{
 		CD3DX12_ROOT_PARAMETER rootParameters[LocalRootParameter::ParameterCount];
-		// ׸Ϊ32-bitΪλĴС
+		// 首个参数为以32-bit为单位衡量的大小
 		rootParameters[LocalRootParameter::ViewportConstant].InitAsConstants(SizeInUINT32(mRayGenCB), 0);
 
 		CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc(ARRAYSIZE(rootParameters), rootParameters);
-		// Local SignatureָFlag
+		// Local Signature必须指定该Flag
 		rootSignatureDesc.Flags = D3D12_ROOT_SIGNATURE_FLAG_LOCAL_ROOT_SIGNATURE;
 
 		HRESULT hr = S_OK;
@@ -149,16 +150,16 @@ void RayTracingApp::CreateRootSignature() {
 void RayTracingApp::CreateStateObject() {
 	CD3DX12_STATE_OBJECT_DESC rayTracingPipeline(D3D12_STATE_OBJECT_TYPE_RAYTRACING_PIPELINE);
 
-	// 1. Subobject
-	// SubobjectState ObjectеĴ洢ʽΪһƬڴ
+	// 1. 创建Subobject
+	// Subobject在State Object中的存储方式为一片连续的内存
 
 	// DXIL Library
-	// Shader뱻fxcԤȱãֽʽװһͷļ
-	// ˴RayTracing.hlslװRayTracing.hlsl.hеgpRayTracing
+	// Shader代码被fxc预先编译好，打包成字节数组的形式，封装在一个头文件内
+	// 此处RayTracing.hlsl被封装进RayTracing.hlsl.h中的gpRayTracing中
 	auto lib = rayTracingPipeline.CreateSubobject<CD3DX12_DXIL_LIBRARY_SUBOBJECT>();
 	//CD3DX12_SHADER_BYTECODE libDXIL = CD3DX12_SHADER_BYTECODE((void*)gpRayTracing, ARRAYSIZE(gpRayTracing));
 	//lib->SetDXILLibrary(&libDXIL);
-	// Entrypoint(Shader Export)
+	// 接下来定义Entrypoint(Shader Export)
 	{
 		lib->DefineExport(mRaygenShaderName);
 		lib->DefineExport(mClosestHitShaderName);
@@ -166,7 +167,7 @@ void RayTracingApp::CreateStateObject() {
 	}
 
 	// Hit Group
-	// ҵ⣬Hit Group൱ڽӿڵ
+	// 以我的理解，Hit Group相当于接口的链接器
 	auto hitGroup = rayTracingPipeline.CreateSubobject<CD3DX12_HIT_GROUP_SUBOBJECT>();
 	hitGroup->SetHitGroupType(D3D12_HIT_GROUP_TYPE_TRIANGLES);
 	hitGroup->SetClosestHitShaderImport(mClosestHitShaderName);
@@ -187,21 +188,21 @@ void RayTracingApp::CreateStateObject() {
 	globalRootSignature->SetRootSignature(mGlobalRootSignature.Get());
 
 	// Shader Config
-	// ڶShaderĲ
-	// ˴payloadattributeĴС
+	// 用于定义Shader的参数性质
+	// 此处定义的是payload和attribute的大小
 	auto shaderConfig = rayTracingPipeline.CreateSubobject<CD3DX12_RAYTRACING_SHADER_CONFIG_SUBOBJECT>();
 	UINT payloadSize = 4 * sizeof(float); // float4 color
 	UINT attributeSize = 2 * sizeof(float); // float2 barycentric
 	shaderConfig->Config(payloadSize, attributeSize);
 
 	// Pipeline Config
-	// 涨Shaderݹ
+	// 规定了Shader的最大递归深度
 	auto pipelineConfig = rayTracingPipeline.CreateSubobject<CD3DX12_RAYTRACING_PIPELINE_CONFIG_SUBOBJECT>();
 	UINT maxRecursionDepth = 1; // only primary ray
 	pipelineConfig->Config(maxRecursionDepth);
 
-	// 2. State Object
-	// CD3DX12_STATE_OBJECTCD3DX12_STATE_OBJECT -> const D3D12_STATE_OBJECT *ת
+	// 2. 创建State Object
+	// CD3DX12_STATE_OBJECT内置了CD3DX12_STATE_OBJECT -> const D3D12_STATE_OBJECT *类型转换函数
 	ThrowIfFailed(mDevice->CreateStateObject(
 		rayTracingPipeline, 
 		IID_PPV_ARGS(&mRTPSO)
@@ -210,27 +211,46 @@ void RayTracingApp::CreateStateObject() {
 
 void RayTracingApp::BuildGeometryDescForBottomLevelAS(std::vector<D3D12_RAYTRACING_GEOMETRY_DESC>& geometryDescs) {
 	// ONLY For Triangles
-	// ڹٽṹ֮ǰģ͵
-	UINT meshCount = mScene.MeshCount();
-	geometryDescs.resize(meshCount);
-
-	for (UINT i = 0; i < meshCount; ++i) {
-		geometryDescs[i].Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
-		geometryDescs[i].Triangles.IndexBuffer = mScene.IndexBufferAddress(i);
-		geometryDescs[i].Triangles.IndexCount = mScene.IndexCount(i);
-		geometryDescs[i].Triangles.IndexFormat = mScene.IndexFormat(i);
-		geometryDescs[i].Triangles.Transform3x4 = 0;	// D3D12_GPU_VIRTUAL_ADDRESS
-		geometryDescs[i].Triangles.VertexBuffer = mScene.VertexBufferAddressAndStride(i);
-		geometryDescs[i].Triangles.VertexCount = mScene.VertexCount(i);
-		geometryDescs[i].Triangles.VertexFormat = mScene.VertexPositionFormat(i);
-
-		// ΪܣڲӰǰ½primitiveΪopaque
-		geometryDescs[i].Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
+	// 必须在构建加速结构之前完成模型导入
+	UINT geometryCount = mScene.GeometryCount();
+	geometryDescs.clear();
+	geometryDescs.reserve(geometryCount);
+
+	// Transform3x4需16字节对齐，XMFLOAT3X4为48字节，逐个紧密排列即可
+	mGeometryTransforms = std::make_unique<UploadBuffer<XMFLOAT3X4>>(mDevice.Get(), (std::max)(geometryCount, 1u), false);
+
+	UINT skipped = 0;
+	for (UINT i = 0; i < geometryCount; ++i) {
+		// UNORM的顶点格式从Tier 1.1开始支持
+		if (mScene.VertexPositionFormat(i) != DXGI_FORMAT_R32G32B32_FLOAT && mRayTracingTier < D3D12_RAYTRACING_TIER_1_1) {
+			skipped++;
+			continue;
+		}
+
+		mGeometryTransforms->Copydata(i, mScene.GeometryTransform(i));
+
+		D3D12_RAYTRACING_GEOMETRY_DESC geometryDesc = {};
+		geometryDesc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
+		geometryDesc.Triangles.IndexBuffer = mScene.IndexBufferAddress(i);
+		geometryDesc.Triangles.IndexCount = mScene.IndexCount(i);
+		geometryDesc.Triangles.IndexFormat = mScene.IndexFormat(i);
+		geometryDesc.Triangles.Transform3x4 = mGeometryTransforms->GetBufferPointer() + i * mGeometryTransforms->GetElementSizeInBytes();
+		geometryDesc.Triangles.VertexBuffer = mScene.VertexBufferAddressAndStride(i);
+		geometryDesc.Triangles.VertexCount = mScene.VertexCount(i);
+		geometryDesc.Triangles.VertexFormat = mScene.VertexPositionFormat(i);
+
+		// 为了提高性能，可以在不影响表现力的前提下将所有primitive视为opaque的
+		geometryDesc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
+		geometryDescs.push_back(geometryDesc);
+	}
+
+	if (skipped > 0) {
+		Util::DebugLog("[RayTracing] %u of %u geometries use compact vertices, which need Raytracing Tier 1.1, skipped\n", skipped, geometryCount);
 	}
 }
 
 AccelerationStructureBuffers RayTracingApp::BuildBottomLevelAS(std::vector<D3D12_RAYTRACING_GEOMETRY_DESC>& geometryDescs) {
-	// 1. ԤԴС
+	// 1. 计算预分配资源大小
 	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS bottomLevelInputs = {};
 	bottomLevelInputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
 	bottomLevelInputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
@@ -286,7 +306,7 @@ D3D12_GPU_VIRTUAL_ADDRESS RayTracingApp::BuildInstanceDescForTopLevelAS(D3D12_GP
 	XMMATRIX transform = XMMatrixIdentity();
 	XMStoreFloat3x4(reinterpret_cast<XMFLOAT3X4*>(instanceDescs[0].Transform), transform);	// FLOAT
 
-	// ʵϴGPU
+	// 将实例化数据上传至GPU
 	UploadBuffer<D3D12_RAYTRACING_INSTANCE_DESC> buffer(mDevice.Get(), instanceDescs.size(), false);
 	for (UINT i = 0; i < instanceDescs.size(); ++i) {
 		buffer.Copydata(i, instanceDescs[i]);
@@ -296,7 +316,7 @@ D3D12_GPU_VIRTUAL_ADDRESS RayTracingApp::BuildInstanceDescForTopLevelAS(D3D12_GP
 }
 
 AccelerationStructureBuffers RayTracingApp::BuildTopLevelAS(D3D12_GPU_VIRTUAL_ADDRESS instanceAddress) {
-	// 1. ԤԴС
+	// 1. 计算预分配资源大小
 	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS topLevelInputs = {};
 	topLevelInputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
 	topLevelInputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
@@ -353,12 +373,12 @@ void RayTracingApp::BuildAccelerationStructures() {
 	D3D12_GPU_VIRTUAL_ADDRESS instanceAddress = BuildInstanceDescForTopLevelAS(bottomLevelBuffers.accelerationStructure->GetGPUVirtualAddress());
 	AccelerationStructureBuffers topLevelBuffers = BuildTopLevelAS(instanceAddress);
 
-	// 3. ɣResource StateתΪUAV׷ʹ
-	// ΪʲôֻתBottomLevelAS
+	// 3. 构建完成，将Resource State转为UAV供光追使用
+	// 为什么只转换BottomLevelAS？
 	D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::UAV(bottomLevelBuffers.accelerationStructure.Get());
 	mCommandList->ResourceBarrier(1, &barrier);
 
-	// 4. GPUִй裬ȴ
+	// 4. 令GPU执行构建步骤，并等待至完成
 	ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
 	mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
 
@@ -1,8 +1,76 @@
 #include "Scene.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <tuple>
+#include <unordered_set>
+
+namespace {
+	// Upload Heap为Write-Combined内存，以Non-Temporal Store整行写入，不读取也不占用缓存
+	inline void StreamMatrix(BYTE* destination, FXMMATRIX matrix) {
+#if defined(_XM_SSE_INTRINSICS_)
+		float* f = reinterpret_cast<float*>(destination);
+		_mm_stream_ps(f + 0, matrix.r[0]);
+		_mm_stream_ps(f + 4, matrix.r[1]);
+		_mm_stream_ps(f + 8, matrix.r[2]);
+		_mm_stream_ps(f + 12, matrix.r[3]);
+#else
+		XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(destination), matrix);
+#endif
+	}
+
+	// 几何位置相同即为同一SubMesh的同一级LOD，键相同的Render Item可以合并为一次实例化绘制
+	inline auto DrawKey(const RenderItem& item) {
+		return std::make_tuple(item.BaseVertexLocation, item.StartIndexLocation, item.NumIndices,
+			item.IndexFormat, item.PrimitiveTopology, item.MaterialIndex);
+	}
+
+	// 64位排序键，自高位起:
+	// [63:62] Pass: 0为不透明，1为Alpha Test(MaskTexture)，后者在不透明物体之后绘制以利用已写入的深度
+	// [61:53] PSO(TextureFlags)
+	// [52:39] 材质的编号，只对Render Item用到的材质按MaterialIndex的顺序连续编号
+	// [38:16] 几何(SubMesh的一级LOD)的编号，按在几何Arena中的位置编号
+	// [15:0]  量化的深度，由近到远
+	// 两个编号都是稠密的，超出位数时Debug下断言，Release下截断只影响顺序；能否合并为一次实例化绘制仍由DrawKey判断
+	const UINT kMaterialIdBits = 14;
+	const UINT kGeometryIdBits = 23;
+
+	inline UINT64 StateSortKey(TextureFlags type, UINT materialId, UINT geometryId) {
+		assert(materialId < (1u << kMaterialIdBits));
+		assert(geometryId < (1u << kGeometryIdBits));
+		const UINT64 pass = (type & TextureType::MaskTexture) ? 1 : 0;
+		return (pass << 62) |
+			((static_cast<UINT64>(type) & 0x1FF) << 53) |
+			((static_cast<UINT64>(materialId) & ((1u << kMaterialIdBits) - 1)) << 39) |
+			((static_cast<UINT64>(geometryId) & ((1u << kGeometryIdBits) - 1)) << 16);
+	}
+
+	// 正的浮点数的位模式与其大小的顺序相同，取高16位(指数与7位尾数)即为对数分布的量化
+	// 位于摄像机之后(w <= 0)的物体视为最近
+	inline UINT64 DepthSortKey(float depth) {
+		if (!(depth > 0.0f)) {
+			return 0;
+		}
+		UINT bits;
+		std::memcpy(&bits, &depth, sizeof(bits));
+		return bits >> 16;
+	}
+
+	// 至少增长一半以使扩容次数为对数级，再向上取整到chunk
+	inline UINT GrowCapacity(UINT capacity, UINT required, UINT chunk) {
+		const UINT grown = std::max(required, capacity + capacity / 2);
+		return (grown + chunk - 1) / chunk * chunk;
+	}
+}
 
 void Scene::Init(ComPtr<ID3D12Device> device,
 	ComPtr<ID3D12GraphicsCommandList> cmdList,
-	ComPtr<ID3D12DescriptorHeap> srvHeap, UINT srvHeapOffset) {
+	DescriptorHeap* srvHeap, UINT srvHeapOffset) {
 	mDevice = device;
 	mCommandList = cmdList;
 	mSrvHeap = srvHeap;
@@ -10,131 +78,802 @@ void Scene::Init(ComPtr<ID3D12Device> device,
 
 	BuildConstantBuffer();
 
-	// 
+	// 几何Arena，天空球也从中分配
+	mMeshManager = std::make_unique<MeshManager>(device, cmdList);
+
+	// 创建天空球
 	GenerateSkySphere();
 }
 
-bool Scene::ImportModel(const std::string& path) {
+ModelHandle Scene::ImportModel(const std::string& path, MeshImportFlags importFlags) {
+	mImportedModel = ModelHandle();
+	mImportMeshBegin = mMeshes.size();
+
+	bool ret = false;
 	// PBRT Format
 	if (path.find(".pbrt") != std::string::npos) {
-		//ImportPBRT(path);
+		ret = ImportPBRT(path, importFlags);
+	}
+	// OBJ使用自带的多线程读取器
+	else if (mUseNativeObjLoader && path.size() >= 4 && _stricmp(path.c_str() + path.size() - 4, ".obj") == 0) {
+		ret = ImportObj(path, importFlags);
 	}
 	// Other Formats
 	else {
-		ImportAssimp(path);
+		ret = ImportAssimp(path, importFlags);
 	}
 
-	return true;
+	if (ret) {
+		for (size_t meshIndex = mImportMeshBegin; meshIndex < mMeshes.size(); ++meshIndex) {
+			const std::vector<SubMesh>& submeshes = mMeshes[meshIndex].SubMeshes;
+			for (UINT i = 0; i < submeshes.size(); ++i) {
+				if (!submeshes[i].IsShared && submeshes[i].PrimitiveTopology == D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST) {
+					mGeometries.push_back({ static_cast<UINT>(meshIndex), i });
+				}
+			}
+		}
+	}
+
+	return ret ? mImportedModel : ModelHandle();
 }
 
 bool Scene::LoadCubeMap(const std::string& path)
 {
 	//if (mRenderItems[EnvironmentMapping].size() == 0) {
-	//	// 
+	//	// 创建天空球
 	//	GenerateSkySphere();
 	//}
 
-	// µTextureDescriptor
+	// 创建新的Texture及Descriptor
 	mTextures.emplace_back(mDevice, mCommandList);
 	ID3D12Resource* tex = mTextures.back().LoadTexture(path);
 
-	// CubeMapDescriptor̶SRV HeapĿͷΪD3D12_SRV_DIMENSION_TEXTURECUBE
+	// CubeMap的Descriptor固定在SRV Heap的开头，类型为D3D12_SRV_DIMENSION_TEXTURECUBE
 	CreateShaderResourceView(tex, 0, D3D12_SRV_DIMENSION_TEXTURECUBE);  
 
 	return true;
 }
 
-void Scene::SetProperties(const std::string& name, XMFLOAT3 scale, float rotationAngle, XMFLOAT3 rotationAxis, XMFLOAT3 pos) {
-	// SRT Matrix
-	XMMATRIX S = XMMatrixScaling(scale.x, scale.y, scale.z);
-	XMMATRIX R = XMMatrixRotationAxis(XMLoadFloat3(&rotationAxis), rotationAngle);
-	XMMATRIX T = XMMatrixTranslation(pos.x, pos.y, pos.z);
+bool Scene::UnloadModel(ModelHandle handle) {
+	if (!IsValid(handle) || handle == mSkyModel) {
+		return false;
+	}
+	SceneModel& model = mModels[handle.Index];
+
+	std::unordered_set<UINT> itemIndices(model.RenderItems.begin(), model.RenderItems.end());
+	// 模型自身导入的Mesh，以及其Render Item引用的其他模型的Mesh(SubMesh去重)
+	std::unordered_set<UINT> meshIndices(model.Meshes.begin(), model.Meshes.end());
+
+	for (auto& [type, itemList] : mRenderItems) {
+		auto removed = std::remove_if(itemList.begin(), itemList.end(), [&](const RenderItem& item) {
+			if (itemIndices.count(item.RenderItemIndex) == 0) {
+				return false;
+			}
+			meshIndices.insert(item.MeshIndex);
+			return true;
+		});
+		itemList.erase(removed, itemList.end());
+
+		// 剩余Render Item的位置可能已改变
+		for (UINT i = 0; i < itemList.size(); ++i) {
+			mItemLocations[itemList[i].RenderItemIndex].Position = i;
+		}
+	}
+
+	// 仍被其他模型的Render Item引用的Mesh暂不释放，在引用它的模型卸载时释放
+	for (const auto& [type, itemList] : mRenderItems) {
+		for (const RenderItem& item : itemList) {
+			meshIndices.erase(item.MeshIndex);
+		}
+	}
+
+	// Mesh留在mMeshes中以保持其余Render Item的MeshIndex不变，只释放数据
+	for (UINT meshIndex : meshIndices) {
+		Mesh& mesh = mMeshes[meshIndex];
+		mSubMeshRegistry.RemoveMesh(meshIndex);
+		mesh.ReleaseGeometry();
+		mesh.SubMeshes.clear();
+		mesh.VertexBufferCPU.clear();
+		mesh.VertexBufferCPU.shrink_to_fit();
+		mesh.IndexBufferCPU.clear();
+		mesh.IndexBufferCPU.shrink_to_fit();
+	}
+
+	auto released = std::remove_if(mGeometries.begin(), mGeometries.end(), [&](const SubMeshRef& geometry) {
+		return meshIndices.count(geometry.MeshIndex) != 0;
+	});
+	mGeometries.erase(released, mGeometries.end());
+
+	// 使模型与Render Item的句柄失效
+	for (UINT itemIndex : model.RenderItems) {
+		mItemGenerations[itemIndex]++;
+		mOctree.Remove(itemIndex);
+	}
+
+	auto nameIt = mModelNames.find(model.Name);
+	if (nameIt != mModelNames.end() && nameIt->second == handle) {
+		mModelNames.erase(nameIt);
+	}
+
+	Util::DebugLog("[Scene] Unloaded %s: %zu render items, %zu meshes\n", model.Name.c_str(), itemIndices.size(), meshIndices.size());
+
+	const UINT generation = model.Generation + 1;
+	model = SceneModel();
+	model.Generation = generation;
+	mFreeModelSlots.push_back(handle.Index);
+	mModelNum--;
+	mInstancesDirty = true;
+
+	return true;
+}
+
+bool Scene::IsValid(ModelHandle model) const {
+	return model.Index < mModels.size() && mModels[model.Index].Alive && mModels[model.Index].Generation == model.Generation;
+}
+
+bool Scene::IsValid(RenderItemHandle item) const {
+	return item.Index < mItemGenerations.size() && mItemGenerations[item.Index] == item.Generation;
+}
+
+ModelHandle Scene::FindModel(const std::string& name) const {
+	auto nameIt = mModelNames.find(name);
+	return nameIt != mModelNames.end() ? nameIt->second : ModelHandle();
+}
+
+UINT Scene::RenderItemCount(ModelHandle model) const {
+	return IsValid(model) ? static_cast<UINT>(mModels[model.Index].RenderItems.size()) : 0;
+}
+
+RenderItemHandle Scene::GetRenderItem(ModelHandle model, UINT i) const {
+	RenderItemHandle item;
+	if (i < RenderItemCount(model)) {
+		item.Index = mModels[model.Index].RenderItems[i];
+		item.Generation = mItemGenerations[item.Index];
+	}
+	return item;
+}
+
+void Scene::ReleaseUploadBuffers() {
+	for (Mesh& mesh : mMeshes) {
+		mesh.VertexBufferUploader = nullptr;
+		mesh.IndexBufferUploader = nullptr;
+	}
+
+	mMeshManager->ReleaseRetiredBuffers();
+	mRetiredBuffers.clear();
+	mSrvHeap->ReleaseRetiredHeaps();
+}
+
+bool Scene::SetProperties(ModelHandle handle, XMFLOAT3 scale, float rotationAngle, XMFLOAT3 rotationAxis, XMFLOAT3 pos) {
+	if (!IsValid(handle)) {
+		return false;
+	}
+	SceneModel& model = mModels[handle.Index];
+
+	XMFLOAT4 rotation;
+	XMStoreFloat4(&rotation, XMQuaternionRotationAxis(XMLoadFloat3(&rotationAxis), rotationAngle));
+
+	// 变换未改变的模型不做任何更新
+	if (model.HasTransform &&
+		std::memcmp(&model.Scale, &scale, sizeof(XMFLOAT3)) == 0 &&
+		std::memcmp(&model.Rotation, &rotation, sizeof(XMFLOAT4)) == 0 &&
+		std::memcmp(&model.Translation, &pos, sizeof(XMFLOAT3)) == 0) {
+		return true;
+	}
+	model.Scale = scale;
+	model.Rotation = rotation;
+	model.Translation = pos;
+	model.HasTransform = true;
+
+	for (UINT itemIndex : model.RenderItems) {
+		mTransforms.Set(itemIndex, scale, rotation, pos);
+		MarkTransformDirty(itemIndex);
+	}
+	return true;
+}
+
+bool Scene::SetProperties(RenderItemHandle item, const XMFLOAT3& scale, const XMFLOAT4& rotationQuaternion, const XMFLOAT3& pos) {
+	if (!IsValid(item)) {
+		return false;
+	}
+
+	mTransforms.Set(item.Index, scale, rotationQuaternion, pos);
+	MarkTransformDirty(item.Index);
+
+	// 模型的SRT不再代表所有Render Item，下一次SetProperties总会重新写入
+	mModels[mItemModels[item.Index]].HasTransform = false;
+	return true;
+}
+
+bool Scene::SetTransform(RenderItemHandle item, const XMFLOAT4X4& transform) {
+	if (!IsValid(item)) {
+		return false;
+	}
+
+	mItemTransforms[item.Index] = transform;
+	mHasItemTransform[item.Index] = XMMatrixIsIdentity(XMLoadFloat4x4(&transform)) ? 0 : 1;
+	MarkTransformDirty(item.Index);
+	return true;
+}
+
+bool Scene::SetMaterial(RenderItemHandle item, UINT materialIndex) {
+	// 天空球不在mRenderItems中，材质固定
+	if (!IsValid(item) || item.Index == mSkySphere.RenderItemIndex || materialIndex >= mMaterials.size()) {
+		return false;
+	}
+
+	RenderItemLocation& location = mItemLocations[item.Index];
+	std::vector<RenderItem>& itemList = mRenderItems[location.Type];
+
+	// 顶点格式不随材质改变
+	TextureFlags type = mMaterials[materialIndex].ItemType | (location.Type & TextureType::CompactVertex);
+	if (type != location.Type) {
+		// 与列表末尾交换后移入新的列表
+		RenderItem renderItem = itemList[location.Position];
+		itemList[location.Position] = itemList.back();
+		mItemLocations[itemList[location.Position].RenderItemIndex].Position = location.Position;
+		itemList.pop_back();
+
+		std::vector<RenderItem>& newList = mRenderItems[type];
+		location.Type = type;
+		location.Position = static_cast<UINT>(newList.size());
+		newList.push_back(renderItem);
+	}
+	mRenderItems[location.Type][location.Position].MaterialIndex = materialIndex;
+
+	mObjectCBGPU->Copydata(item.Index, offsetof(RenderItemData, MaterialIndex), materialIndex);
+	mUploadedBytes += sizeof(UINT);
+	mInstancesDirty = true;
+	return true;
+}
+
+bool Scene::SetOccluderMode(ModelHandle model, OccluderMode::Value mode) {
+	if (!IsValid(model)) {
+		return false;
+	}
+	mModels[model.Index].Occluder = mode;
+	return true;
+}
+
+void Scene::MarkTransformDirty(UINT itemIndex) {
+	if (!mItemDirty[itemIndex]) {
+		mItemDirty[itemIndex] = 1;
+		mDirtyItems.push_back(itemIndex);
+	}
+}
+
+void Scene::FlushTransforms() {
+	mTransformsUpdated = static_cast<UINT>(mDirtyItems.size());
+	mTransformUpdateMs = 0.0;
+	if (mDirtyItems.empty()) {
+		return;
+	}
+
+	const INT64 start = Util::QueryTimestamp();
+
+	// 按RenderItemIndex排序，写入Upload Buffer的地址单调递增，连续的Render Item连成一片
+	std::sort(mDirtyItems.begin(), mDirtyItems.end());
+	mTransformScratch.resize(mDirtyItems.size());
+
+	BYTE* worldMatrices = mWorldMatrixGPU->MappedData();
+	const UINT worldStride = mWorldMatrixGPU->GetElementSizeInBytes();
+
+	// 每个区间先以SoA批量计算SRT矩阵，再逐个合成World Matrix、变换包围体并写出
+	ThreadPool::Get().ParallelFor(mDirtyItems.size(), 4096, [&](size_t begin, size_t end) {
+		mTransforms.ComputeMatrices(mDirtyItems.data() + begin, end - begin, mTransformScratch.data() + begin);
+
+		for (size_t i = begin; i < end; ++i) {
+			const UINT itemIndex = mDirtyItems[i];
+
+			// World Matrix: Render Item在模型内部的变换先于SRT作用
+			XMMATRIX world = XMLoadFloat4x4(&mTransformScratch[i]);
+			if (mHasItemTransform[itemIndex]) {
+				world = XMMatrixMultiply(XMLoadFloat4x4(&mItemTransforms[itemIndex]), world);
+			}
+			XMStoreFloat4x4(&mWorldMatrices[itemIndex], world);
+			mWorldBounds[itemIndex] = MeshBounds::Transform(mLocalBounds[itemIndex], world);
+			mPackedBounds.Set(itemIndex, mWorldBounds[itemIndex].Box);
+
+			StreamMatrix(worldMatrices + itemIndex * worldStride, XMMatrixTranspose(world));
+			mItemDirty[itemIndex] = 0;
+		}
+	});
+#if defined(_XM_SSE_INTRINSICS_)
+	_mm_sfence();
+#endif
+
+	// 八叉树与模型的包围体在所有Render Item更新之后串行更新
+	for (UINT itemIndex : mDirtyItems) {
+		if (mOctree.Contains(itemIndex)) {
+			mOctree.Update(itemIndex, mWorldBounds[itemIndex].Box);
+		}
+
+		SceneModel& model = mModels[mItemModels[itemIndex]];
+		if (!model.BoundsDirty) {
+			model.BoundsDirty = true;
+			mDirtyModels.push_back(mItemModels[itemIndex]);
+		}
+	}
+	for (UINT modelSlot : mDirtyModels) {
+		UpdateModelBounds(modelSlot);
+	}
+	mDirtyModels.clear();
+
+	mUploadedBytes += mDirtyItems.size() * sizeof(XMFLOAT4X4);
+	mDirtyItems.clear();
+
+	mTransformUpdateMs = Util::MillisecondsSince(start);
+}
+
+void Scene::UpdateModelBounds(UINT modelSlot) {
+	SceneModel& model = mModels[modelSlot];
+	model.BoundsDirty = false;
+	for (size_t i = 0; i < model.RenderItems.size(); ++i) {
+		MeshBounds::Merge(model.Bounds, mWorldBounds[model.RenderItems[i]], i == 0);
+	}
+}
+
+void Scene::UpdateLODs(const XMFLOAT3& cameraPos, float pixelsPerUnit) {
+	XMVECTOR eye = XMLoadFloat3(&cameraPos);
+
+	for (auto& [type, itemList] : mRenderItems) {
+		for (RenderItem& item : itemList) {
+			const SubMesh& submesh = mMeshes[item.MeshIndex].SubMeshes[item.SubMeshIndex];
+			if (submesh.LODs.size() <= 1) {
+				continue;
+			}
+
+			// LOD误差以包围球半径为单位，世界空间的包围球已按最大的缩放系数放大
+			const BoundingSphere& sphere = mWorldBounds[item.RenderItemIndex].Sphere;
+			XMVECTOR center = XMLoadFloat3(&sphere.Center);
+			float radius = sphere.Radius;
+
+			// 摄像机位于包围球内时使用完整精度
+			float distance = XMVectorGetX(XMVector3Length(center - eye)) - radius;
+			float projectedRadius = distance > 0.0f ? radius * pixelsPerUnit / distance : FLT_MAX;
+
+			auto ErrorInPixels = [&](UINT lod) {
+				return submesh.LODs[lod].Error * projectedRadius;
+			};
+
+			UINT lod = (std::min)(item.CurrentLOD, static_cast<UINT>(submesh.LODs.size()) - 1);
+			while (lod > 0 && ErrorInPixels(lod) > mLODErrorThreshold) {
+				lod--;
+			}
+			while (lod + 1 < submesh.LODs.size() && ErrorInPixels(lod + 1) <= mLODErrorThreshold * mLODHysteresis) {
+				lod++;
+			}
+
+			if (lod == item.CurrentLOD) {
+				continue;
+			}
+
+			const SubMeshLOD& selected = submesh.LODs[lod];
+			item.CurrentLOD = lod;
+			mInstancesDirty = true;
+			item.NumIndices = selected.NumIndices;
+			item.StartIndexLocation = mMeshes[item.MeshIndex].StartIndexLocation(selected.IndexBufferOffsetInBytes, submesh.IndexFormat);
+		}
+	}
+}
+
+void Scene::CullView(CullingView::Value view, FXMMATRIX viewProj, bool occlusion) {
+	const INT64 start = Util::QueryTimestamp();
+
+	ViewDrawList& viewList = mViews[view];
+	const FrustumPlanes frustum = FrustumCulling::ExtractPlanes(viewProj);
+
+	// 排序键中的深度随ViewProj改变
+	XMFLOAT4X4 viewProjF;
+	XMStoreFloat4x4(&viewProjF, viewProj);
+	if (std::memcmp(&viewProjF, &viewList.ViewProj, sizeof(XMFLOAT4X4)) != 0) {
+		viewList.ViewProj = viewProjF;
+		viewList.Changed = true;
+	}
+
+	mCullScratch.resize(mRenderItemNum);
+	if (mUseOctreeCulling) {
+		mOctreeResults.clear();
+		mOctree.QueryFrustum(frustum, mOctreeResults);
+		std::fill(mCullScratch.begin(), mCullScratch.end(), 0);
+		for (UINT itemIndex : mOctreeResults) {
+			mCullScratch[itemIndex] = 1;
+		}
+	}
+	else {
+		ThreadPool::Get().ParallelFor(mRenderItemNum, 4096, [&](size_t begin, size_t end) {
+			mPackedBounds.Cull(frustum, begin, end, mCullScratch.data() + begin);
+		});
+	}
+
+	viewList.OccludedItems = 0;
+	viewList.OccluderCount = 0;
+	viewList.OcclusionMs = 0.0;
+	if (occlusion && mUseOcclusionCulling) {
+		CullOccluded(viewList, viewProj);
+	}
+
+	// 只统计场景中的Render Item，已卸载的槽位与天空球不在mRenderItems中
+	viewList.Visible.resize(mRenderItemNum, 0);
+	viewList.VisibleItems = 0;
+	viewList.CulledItems = 0;
+	for (const auto& [type, itemList] : mRenderItems) {
+		for (const RenderItem& item : itemList) {
+			const UINT itemIndex = item.RenderItemIndex;
+			if (mCullScratch[itemIndex]) {
+				viewList.VisibleItems++;
+			}
+			else {
+				viewList.CulledItems++;
+			}
+			if (mCullScratch[itemIndex] != viewList.Visible[itemIndex]) {
+				viewList.Changed = true;
+			}
+		}
+	}
+	viewList.Visible.swap(mCullScratch);
+
+	viewList.CullMs = Util::MillisecondsSince(start);
+}
+
+void Scene::CullOccluded(ViewDrawList& viewList, FXMMATRIX viewProj) {
+	const INT64 start = Util::QueryTimestamp();
+	mOcclusionBuffer.Clear(viewProj);
+
+	// 1. 视锥内带有遮挡体数据的Render Item按屏幕面积排序，取前mMaxOccluders个
+	mOccluderCandidates.clear();
+	mOcclusionTests.clear();
+	for (const auto& [type, itemList] : mRenderItems) {
+		for (const RenderItem& item : itemList) {
+			const UINT itemIndex = item.RenderItemIndex;
+			if (!mCullScratch[itemIndex]) {
+				continue;
+			}
+			mOcclusionTests.push_back(itemIndex);
+
+			const OccluderMode::Value mode = mModels[mItemModels[itemIndex]].Occluder;
+			const SubMesh& submesh = mMeshes[item.MeshIndex].SubMeshes[item.SubMeshIndex];
+			if (mode == OccluderMode::Never || submesh.OccluderIndices.empty()) {
+				continue;
+			}
+			const float area = mode == OccluderMode::Always ? FLT_MAX : mOcclusionBuffer.ScreenArea(mWorldBounds[itemIndex].Box);
+			mOccluderCandidates.emplace_back(area, itemIndex);
+		}
+	}
+
+	const size_t occluderCount = (std::min)(mOccluderCandidates.size(), static_cast<size_t>(mMaxOccluders));
+	std::partial_sort(mOccluderCandidates.begin(), mOccluderCandidates.begin() + occluderCount, mOccluderCandidates.end(),
+		[](const std::pair<float, UINT>& a, const std::pair<float, UINT>& b) { return a.first > b.first; });
+
+	mOccluders.resize(occluderCount);
+	for (size_t i = 0; i < occluderCount; ++i) {
+		const UINT itemIndex = mOccluderCandidates[i].second;
+		const RenderItem& item = mRenderItems[mItemLocations[itemIndex].Type][mItemLocations[itemIndex].Position];
+		const SubMesh& submesh = mMeshes[item.MeshIndex].SubMeshes[item.SubMeshIndex];
+
+		OccluderDesc& occluder = mOccluders[i];
+		occluder.Positions = submesh.OccluderPositions.data();
+		occluder.VertexCount = static_cast<UINT>(submesh.OccluderPositions.size());
+		occluder.Indices = submesh.OccluderIndices.data();
+		occluder.IndexCount = static_cast<UINT>(submesh.OccluderIndices.size());
+		XMStoreFloat4x4(&occluder.WorldViewProj, XMLoadFloat4x4(&mWorldMatrices[itemIndex]) * viewProj);
+	}
+
+	// 2. 光栅化最多使用一半的预算，其余留给测试
+	viewList.OccluderCount = mOcclusionBuffer.Rasterize(mOccluders.data(), mOccluders.size(), start, mOcclusionBudgetMs * 0.5);
+
+	// 3. 测试视锥内的Render Item，超出预算后剩余的视为可见
+	std::atomic<UINT> occludedItems{ 0 };
+	if (viewList.OccluderCount > 0) {
+		ThreadPool::Get().ParallelFor(mOcclusionTests.size(), 256, [&](size_t begin, size_t end) {
+			if (Util::MillisecondsSince(start) > mOcclusionBudgetMs) {
+				return;
+			}
+			UINT occluded = 0;
+			for (size_t i = begin; i < end; ++i) {
+				const UINT itemIndex = mOcclusionTests[i];
+				if (mOcclusionBuffer.IsOccluded(mWorldBounds[itemIndex].Box)) {
+					mCullScratch[itemIndex] = 0;
+					occluded++;
+				}
+			}
+			occludedItems += occluded;
+		});
+	}
+
+	viewList.OccludedItems = occludedItems;
+	viewList.OcclusionMs = Util::MillisecondsSince(start);
+}
+
+void Scene::BuildInstancedDraws() {
+	if (mInstancesDirty) {
+		mInstancesDirty = false;
+
+		// 几何按在几何Arena中的位置编号，相邻编号的几何在内存中也相邻
+		// 材质同样只对用到的编号，MaterialIndex本身可能超出排序键中的位数
+		std::map<std::tuple<DXGI_FORMAT, UINT, INT, UINT>, UINT> geometryIds;
+		std::map<UINT, UINT> materialIds;
+		for (const auto& [type, itemList] : mRenderItems) {
+			for (const RenderItem& item : itemList) {
+				geometryIds.emplace(std::make_tuple(item.IndexFormat, item.StartIndexLocation, item.BaseVertexLocation, item.NumIndices), 0);
+				materialIds.emplace(item.MaterialIndex, 0);
+			}
+		}
+		UINT geometryId = 0;
+		for (auto& [geometry, id] : geometryIds) {
+			id = geometryId++;
+		}
+		UINT materialId = 0;
+		for (auto& [material, id] : materialIds) {
+			id = materialId++;
+		}
+		if (geometryId > (1u << kGeometryIdBits) || materialId > (1u << kMaterialIdBits)) {
+			Util::DebugLog("[Scene] %u geometries, %u materials exceed the sort key fields\n", geometryId, materialId);
+		}
+
+		mItemStateKeys.resize(mRenderItemNum);
+		for (const auto& [type, itemList] : mRenderItems) {
+			for (const RenderItem& item : itemList) {
+				const UINT id = geometryIds[std::make_tuple(item.IndexFormat, item.StartIndexLocation, item.BaseVertexLocation, item.NumIndices)];
+				mItemStateKeys[item.RenderItemIndex] = StateSortKey(type, materialIds[item.MaterialIndex], id);
+			}
+		}
+
+		for (ViewDrawList& viewList : mViews) {
+			viewList.Changed = true;
+		}
 
-	// World Matrix
-	XMMATRIX World = XMMatrixTranspose(S * R * T);
+		mSkyInstanceBase = CullingView::Count * mItemCapacity;
+		mInstanceItemsGPU->Copydata(mSkyInstanceBase, mSkySphere.RenderItemIndex);
+		mUploadedBytes += sizeof(UINT);
+	}
 
-	std::vector<UINT>& indexList = mNameIndexMap[name];
-	for (int i = 0; i < indexList.size(); ++i) {
-		mObjectCBGPU->Copydata(indexList[i], World);
+	for (UINT view = 0; view < CullingView::Count; ++view) {
+		if (mViews[view].Changed) {
+			BuildViewDraws(mViews[view], view * mItemCapacity);
+		}
 	}
 }
 
-UINT Scene::MeshCount() const {
-	return mMeshManager->MeshCount();
+void Scene::BuildViewDraws(ViewDrawList& viewList, UINT instanceBase) {
+	viewList.Changed = false;
+	// 尚未剔除过的Render Item视为可见
+	viewList.Visible.resize(mRenderItemNum, 1);
+
+	// 1. 可见的Render Item的排序键: 状态键与包围球球心的深度(裁剪空间的w)
+	const INT64 start = Util::QueryTimestamp();
+	const XMMATRIX viewProj = XMLoadFloat4x4(&viewList.ViewProj);
+	mSortKeys.clear();
+	for (const auto& [type, itemList] : mRenderItems) {
+		for (const RenderItem& item : itemList) {
+			const UINT itemIndex = item.RenderItemIndex;
+			if (!viewList.Visible[itemIndex]) {
+				continue;
+			}
+			const float depth = XMVectorGetW(XMVector3Transform(XMLoadFloat3(&mWorldBounds[itemIndex].Sphere.Center), viewProj));
+			mSortKeys.push_back({ mItemStateKeys[itemIndex] | DepthSortKey(depth), itemIndex });
+		}
+	}
+	RadixSort::Sort(mSortKeys, mSortScratch);
+	viewList.SortMs = Util::MillisecondsSince(start);
+
+	// 2. 按顺序合并几何与材质相同的相邻Render Item，实例在一次绘制中由近到远排列
+	std::vector<InstancedDraw>& draws = viewList.Draws;
+	draws.clear();
+	UINT instanceCount = instanceBase;
+	for (const RadixSort::KeyValue& sortKey : mSortKeys) {
+		const RenderItemLocation& location = mItemLocations[sortKey.Value];
+		const RenderItem& item = mRenderItems[location.Type][location.Position];
+		if (draws.empty() || draws.back().Type != location.Type || DrawKey(draws.back().Item) != DrawKey(item)) {
+			InstancedDraw draw;
+			draw.Item = item;
+			draw.Type = location.Type;
+			draw.InstanceBase = instanceCount;
+			draws.push_back(draw);
+		}
+		draws.back().InstanceCount++;
+		mInstanceItemsGPU->Copydata(instanceCount++, item.RenderItemIndex);
+	}
+
+	mUploadedBytes += (instanceCount - instanceBase) * sizeof(UINT);
 }
 
-D3D12_GPU_VIRTUAL_ADDRESS Scene::IndexBufferAddress(UINT meshIndex) const {
-	return mMeshManager->IndexBufferAddress(meshIndex);
+UINT Scene::GeometryCount() const {
+	return static_cast<UINT>(mGeometries.size());
 }
 
-UINT Scene::IndexCount(UINT meshIndex) const {
-	return mMeshManager->IndexCount(meshIndex);
+const SubMesh& Scene::GeometrySubMesh(UINT geometryIndex) const {
+	const SubMeshRef& geometry = mGeometries[geometryIndex];
+	return mMeshes[geometry.MeshIndex].SubMeshes[geometry.SubMeshIndex];
 }
 
-DXGI_FORMAT Scene::IndexFormat(UINT meshIndex) const {
-	return mMeshManager->IndexFormat(meshIndex);
+D3D12_GPU_VIRTUAL_ADDRESS Scene::IndexBufferAddress(UINT geometryIndex) const {
+	const Mesh& mesh = mMeshes[mGeometries[geometryIndex].MeshIndex];
+	return mMeshManager->IndexArenaAddress(mesh.Geometry.IndexOffsetInBytes + GeometrySubMesh(geometryIndex).IndexBufferOffsetInBytes);
 }
 
-D3D12_GPU_VIRTUAL_ADDRESS_AND_STRIDE Scene::VertexBufferAddressAndStride(UINT meshIndex) const {
-	return mMeshManager->VertexBufferAddressAndStride(meshIndex);
+UINT Scene::IndexCount(UINT geometryIndex) const {
+	return GeometrySubMesh(geometryIndex).NumIndices;
 }
 
-UINT Scene::VertexCount(UINT meshIndex) const {
-	return mMeshManager->VertexCount(meshIndex);
+DXGI_FORMAT Scene::IndexFormat(UINT geometryIndex) const {
+	return GeometrySubMesh(geometryIndex).IndexFormat;
 }
 
-DXGI_FORMAT Scene::VertexPositionFormat(UINT meshIndex) const {
-	return mMeshManager->VertexPositionFormat(meshIndex);
+D3D12_GPU_VIRTUAL_ADDRESS_AND_STRIDE Scene::VertexBufferAddressAndStride(UINT geometryIndex) const {
+	const Mesh& mesh = mMeshes[mGeometries[geometryIndex].MeshIndex];
+	return mMeshManager->PositionStreamAddressAndStride(mesh.CompactVertices,
+		mesh.BaseVertexLocation(GeometrySubMesh(geometryIndex).BaseVertexLocation));
+}
+
+UINT Scene::VertexCount(UINT geometryIndex) const {
+	return GeometrySubMesh(geometryIndex).NumVertices;
+}
+
+DXGI_FORMAT Scene::VertexPositionFormat(UINT geometryIndex) const {
+	// 压缩格式的第四个分量不被使用
+	return mMeshes[mGeometries[geometryIndex].MeshIndex].CompactVertices ? DXGI_FORMAT_R16G16B16A16_UNORM : DXGI_FORMAT_R32G32B32_FLOAT;
+}
+
+XMFLOAT3X4 Scene::GeometryTransform(UINT geometryIndex) const {
+	if (!mMeshes[mGeometries[geometryIndex].MeshIndex].CompactVertices) {
+		XMFLOAT3X4 identity;
+		XMStoreFloat3x4(&identity, XMMatrixIdentity());
+		return identity;
+	}
+
+	const PositionQuantization& quantization = GeometrySubMesh(geometryIndex).Quantization;
+	return XMFLOAT3X4(
+		quantization.Scale.x, 0.0f, 0.0f, quantization.Offset.x,
+		0.0f, quantization.Scale.y, 0.0f, quantization.Offset.y,
+		0.0f, 0.0f, quantization.Scale.z, quantization.Offset.z);
 }
 
 void Scene::GenerateSkySphere() {
 	const float skySphereRadius = 5000.0f;
+	// 天空球只显示CubeMap，1度的边长足以保证轮廓光滑
+	const float skySphereAngularError = XMConvertToRadians(1.0f);
 
-	Mesh mesh(mDevice, mCommandList);
-	mesh.GenerateSphere(skySphereRadius);
+	Mesh mesh(mDevice, mCommandList, mMeshManager.get());
+	mesh.GenerateSphere(skySphereRadius, skySphereAngularError);
 	mMeshes.push_back(std::move(mesh));
 
-	// MeshϢ
+	// 设置Mesh信息
 	mSkySphere.MeshIndex = mMeshes.size() - 1;
 	mSkySphere.NumVertices = mMeshes[mSkySphere.MeshIndex].NumVertices;
 	mSkySphere.NumIndices = mMeshes[mSkySphere.MeshIndex].NumIndices;
-	mSkySphere.BaseVertexLocation = 0;
-	mSkySphere.StartIndexLocation = 0;
+	mSkySphere.IndexFormat = mMeshes[mSkySphere.MeshIndex].IndexFormat;
+	mSkySphere.BaseVertexLocation = mMeshes[mSkySphere.MeshIndex].BaseVertexLocation();
+	mSkySphere.StartIndexLocation = mMeshes[mSkySphere.MeshIndex].StartIndexLocation(0, mSkySphere.IndexFormat);
 	mSkySphere.PrimitiveTopology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
+	ReserveItems(mRenderItemNum + 1);
 	mSkySphere.RenderItemIndex = mRenderItemNum++;
+	mItemTransforms.resize(mRenderItemNum, Identity4X4());
+	mWorldMatrices.resize(mRenderItemNum, Identity4X4());
+	mItemDirty.resize(mRenderItemNum, 0);
+	mItemGenerations.resize(mRenderItemNum, 0);
+	mItemModels.resize(mRenderItemNum, 0);
+	mItemLocations.resize(mRenderItemNum);
+	mTransforms.Resize(mRenderItemNum);
+	mHasItemTransform.resize(mRenderItemNum, 0);
+	mLocalBounds.resize(mRenderItemNum);
+	mWorldBounds.resize(mRenderItemNum);
+	mPackedBounds.Resize(mRenderItemNum);
+
+	// 拷贝Object Constant Buffer
+	mWorldMatrixGPU->Copydata(mSkySphere.RenderItemIndex, Identity4X4());
 
-	// Object Constant Buffer
 	RenderItemData objectCBCPU;
-	objectCBCPU.World = Identity4X4();
 	objectCBCPU.TexTransform = Identity4X4();
 	objectCBCPU.MaterialIndex = 0;
+	objectCBCPU.PositionScale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+	objectCBCPU.PositionOffset = XMFLOAT3(0.0f, 0.0f, 0.0f);
 
 	mObjectCBGPU->Copydata(mSkySphere.RenderItemIndex, objectCBCPU);
 
-	mNameIndexMap["sky"].push_back(mSkySphere.RenderItemIndex);
+	mSkyModel = CreateModel("sky");
+	mModels[mSkyModel.Index].RenderItems.push_back(mSkySphere.RenderItemIndex);
+	mItemModels[mSkySphere.RenderItemIndex] = mSkyModel.Index;
 }
 
 void Scene::BuildConstantBuffer() {
-	mObjectCBGPU = std::make_unique<UploadBuffer<RenderItemData>>(mDevice.Get(), mMaximumItemNum, true);
-	mMaterialCBGPU = std::make_unique<UploadBuffer<MaterialData>>(mDevice.Get(), mMaximumItemNum, false);
+	mItemCapacity = mCapacityChunk;
+	mMaterialCapacity = mCapacityChunk;
+
+	// 以Structured Buffer的形式绑定，由实例列表间接索引
+	mObjectCBGPU = std::make_unique<UploadBuffer<RenderItemData>>(mDevice.Get(), mItemCapacity, false);
+	mWorldMatrixGPU = std::make_unique<UploadBuffer<XMFLOAT4X4>>(mDevice.Get(), mItemCapacity, false);
+	mMaterialCBGPU = std::make_unique<UploadBuffer<MaterialData>>(mDevice.Get(), mMaterialCapacity, false);
+	// 每个视角中每个Render Item至多出现一次，天空球位于所有视角之后
+	mInstanceItemsGPU = std::make_unique<UploadBuffer<UINT>>(mDevice.Get(), CullingView::Count * mItemCapacity + 1, false);
+}
+
+void Scene::ReserveItems(UINT count) {
+	if (count <= mItemCapacity) {
+		return;
+	}
+
+	const UINT capacity = GrowCapacity(mItemCapacity, count, mCapacityChunk);
+	Util::DebugLog("[Scene] Render item capacity: %u -> %u\n", mItemCapacity, capacity);
+
+	mObjectCBGPU->Grow(mDevice.Get(), capacity, true, mRetiredBuffers);
+	mWorldMatrixGPU->Grow(mDevice.Get(), capacity, true, mRetiredBuffers);
+	// 实例列表按新的容量重新布局，由BuildInstancedDraws重建，不必保留
+	mInstanceItemsGPU->Grow(mDevice.Get(), CullingView::Count * capacity + 1, false, mRetiredBuffers);
+
+	mItemCapacity = capacity;
+	mCapacityGrowths++;
+	mInstancesDirty = true;
+}
+
+void Scene::ReserveMaterials(UINT count) {
+	if (count <= mMaterialCapacity) {
+		return;
+	}
+
+	const UINT capacity = GrowCapacity(mMaterialCapacity, count, mCapacityChunk);
+	Util::DebugLog("[Scene] Material capacity: %u -> %u\n", mMaterialCapacity, capacity);
+
+	mMaterialCBGPU->Grow(mDevice.Get(), capacity, true, mRetiredBuffers);
+
+	mMaterialCapacity = capacity;
+	mCapacityGrowths++;
+}
+
+bool Scene::TryImportFromCache(const std::string& path, UINT32 cacheFlags, UINT64& sourceHash, bool& hashed) {
+	sourceHash = 0;
+	hashed = false;
+	if (!mUseMeshCache) {
+		return false;
+	}
+
+	const INT64 hashStart = Util::QueryTimestamp();
+	hashed = MeshCache::HashFile(path, sourceHash);
+	const double hashTime = Util::MillisecondsSince(hashStart);
+
+	MeshCacheView cache;
+	if (!hashed || !cache.Open(MeshCache::CachePath(path), sourceHash, cacheFlags)) {
+		return false;
+	}
+
+	const INT64 loadStart = Util::QueryTimestamp();
+	InitFromCache(cache, path);
+	Util::DebugLog("[Scene] %s: mesh cache hit, hash %.2f ms, load %.2f ms\n",
+		path.c_str(), hashTime, Util::MillisecondsSince(loadStart));
+	return true;
 }
 
-bool Scene::ImportAssimp(const std::string& path) {
+bool Scene::ImportAssimp(const std::string& path, MeshImportFlags importFlags) {
+	// 网格缓存命中时跳过Assimp
+	const std::string cachePath = MeshCache::CachePath(path);
+	UINT64 sourceHash = 0;
+	bool hashed = false;
+	if (TryImportFromCache(path, importFlags, sourceHash, hashed)) {
+		return true;
+	}
+
 	unsigned int flags =
-		aiProcess_Triangulate |				// ǻ
-		aiProcess_FixInfacingNormals |		// γ
-		aiProcess_JoinIdenticalVertices |	// ȥͬ
-		aiProcess_CalcTangentSpace |		// ԶΪ㸽Tangent
-		aiProcess_ConvertToLeftHanded;		// תΪϵ
+		aiProcess_Triangulate |				// 多边形三角化
+		aiProcess_FixInfacingNormals |		// 修正三角形朝向
+		aiProcess_JoinIdenticalVertices |	// 去除相同顶点
+		aiProcess_ConvertToLeftHanded;		// 转换为左手坐标系
+
+	// 单线程的aiProcess_CalcTangentSpace只在关闭TangentGeneration时使用，否则由Mesh::GenerateTangents生成
+	if (!(importFlags & TangentGeneration)) {
+		flags |= aiProcess_CalcTangentSpace;
+	}
 
 	bool ret = false;
 
-	// ReadFileĲֻ֧string
-	// ζҪȫӢ·
+	// ReadFile的参数只支持string
+	// 这意味着我们需要保持全英文路径
 	const aiScene* pAiScene = nullptr;
+	const INT64 readStart = Util::QueryTimestamp();
 	try {
 		pAiScene = mAiImporter.ReadFile(path, flags);
+		Util::DebugLog("[Scene] %s: Assimp ReadFile %.2f ms (CalcTangentSpace %s)\n", path.c_str(), Util::MillisecondsSince(readStart),
+			(flags & aiProcess_CalcTangentSpace) ? "on" : "off");
 	}
 	catch (std::runtime_error& e) {
 		std::cerr << e.what() << std::endl;
@@ -142,188 +881,397 @@ bool Scene::ImportAssimp(const std::string& path) {
 	if (pAiScene == nullptr) {
 		OutputDebugStringA((LPCSTR)mAiImporter.GetErrorString());
 	}
+	else if (hashed) {
+		MeshCacheWriter cacheWriter;
+		ret = InitFromAiScene(pAiScene, path, importFlags, &cacheWriter);
+		if (ret && !cacheWriter.Write(cachePath, sourceHash, importFlags)) {
+			Util::DebugLog("[Scene] %s: failed to write mesh cache\n", cachePath.c_str());
+		}
+	}
 	else {
-		ret = InitFromAiScene(pAiScene, path);
+		ret = InitFromAiScene(pAiScene, path, importFlags);
 	}
 
+	// 导入结果已全部拷贝，释放Assimp持有的场景
+	mAiImporter.FreeScene();
+
 	return ret;
 }
 
-bool Scene::InitFromAiScene(const aiScene* pAiScene, const std::string& path) {
-	// ·תȡļеľ·
+bool Scene::ImportObj(const std::string& path, MeshImportFlags importFlags) {
+	// 与Assimp路径共用网格缓存文件，键中的kNativeObjLoader区分两者写出的缓存
+	const std::string cachePath = MeshCache::CachePath(path);
+	const UINT32 cacheFlags = importFlags | MeshCache::kNativeObjLoader;
+	UINT64 sourceHash = 0;
+	bool hashed = false;
+	if (TryImportFromCache(path, cacheFlags, sourceHash, hashed)) {
+		return true;
+	}
+
+	ObjModel model;
+	const INT64 readStart = Util::QueryTimestamp();
+	if (!ObjLoader::Load(path, model)) {
+		Util::DebugLog("[Scene] %s: failed to load OBJ\n", path.c_str());
+		return false;
+	}
+	// 与Assimp ReadFile的耗时对应，可通过mUseNativeObjLoader切换比较
+	Util::DebugLog("[Scene] %s: ObjLoader %.2f ms\n", path.c_str(), Util::MillisecondsSince(readStart));
+
 	const std::string directory = path.substr(0, path.find_last_of('\\') + 1);
+	const std::string name = path.substr(path.find_last_of('\\') + 1,
+		path.find_last_of('.') - path.find_last_of('\\') - 1);
+
+	MeshCacheWriter cacheWriter;
+	MeshCacheWriter* pCacheWriter = hashed ? &cacheWriter : nullptr;
+
+	if (!model.SubMeshes.empty()) {
+		Mesh mesh = CreateMesh();
+		mesh.InitFromObj(model, importFlags, pCacheWriter);
+		mMeshes.push_back(std::move(mesh));
+	}
+
+	if (pCacheWriter != nullptr) {
+		pCacheWriter->SetMaterials(model.Materials);
+	}
+	UINT baseMaterialIndex = CreateMaterials(model.Materials, directory);
+
+	CreateRenderItems(name, baseMaterialIndex);
 
-	// ģ
+	mModelNum++;
+
+	if (pCacheWriter != nullptr && !pCacheWriter->Write(cachePath, sourceHash, cacheFlags)) {
+		Util::DebugLog("[Scene] %s: failed to write mesh cache\n", cachePath.c_str());
+	}
+	return true;
+}
+
+bool Scene::ImportPBRT(const std::string& path, MeshImportFlags importFlags) {
+	// 场景引用多个文件，不使用网格缓存
+	PbrtScene pbrtScene;
+	const INT64 readStart = Util::QueryTimestamp();
+	if (!PbrtLoader::Load(path, pbrtScene)) {
+		Util::DebugLog("[Scene] %s: failed to load PBRT scene\n", path.c_str());
+		return false;
+	}
+	Util::DebugLog("[Scene] %s: PbrtLoader %.2f ms\n", path.c_str(), Util::MillisecondsSince(readStart));
+
+	const std::string directory = path.substr(0, path.find_last_of('\\') + 1);
+	const std::string name = path.substr(path.find_last_of('\\') + 1,
+		path.find_last_of('.') - path.find_last_of('\\') - 1);
+
+	// 所有Shape共用一个Mesh，实例只增加Render Item
+	Mesh mesh = CreateMesh();
+	mesh.InitFromObj(pbrtScene.Geometry, importFlags);
+	mMeshes.push_back(std::move(mesh));
+
+	UINT baseMaterialIndex = CreateMaterials(pbrtScene.Geometry.Materials, directory);
+
+	CreateRenderItems(name, baseMaterialIndex, pbrtScene.Instances);
+
+	mModelNum++;
+	return true;
+}
+
+bool Scene::InitFromAiScene(const aiScene* pAiScene, const std::string& path, MeshImportFlags importFlags, MeshCacheWriter* cacheWriter) {
+	// 路径转换，提取父文件夹的绝对路径
+	const std::string directory = path.substr(0, path.find_last_of('\\') + 1);
+
+	// 解析模型名称
 	const std::string name = path.substr(path.find_last_of('\\') + 1,
 		path.find_last_of('.') - path.find_last_of('\\') - 1);
 
-	// 1. 
+	// 1. 处理网格
 	if (pAiScene->HasMeshes()) {
-		Mesh mesh(mDevice, mCommandList);
-		mesh.InitFromAssimp(pAiScene);
+		Mesh mesh = CreateMesh();
+		mesh.InitFromAssimp(pAiScene, importFlags, cacheWriter);
 		mMeshes.push_back(std::move(mesh));
 	}
 
-	// ¼ǰMaterialбеԪԽԵMaterialIndexתΪԵMaterialIndex
-	unsigned int baseMaterialIndex = mMaterials.size();
-
-	// 2.
-	// Textures Supported:
-	//   [Diffuse Texture]
-	//   [Normal Texture]
-	//   [Bump Texture]
-	//   [Roughness Texture]
-	//   [Specular Texture]
-	//   [Mask Texture]
-	if (pAiScene->HasMaterials()) {
-		unsigned int NumMaterials = pAiScene->mNumMaterials;
-		for (unsigned int i = 0; i < NumMaterials; ++i) {
-			// һ²
-			Material mat;
-			const aiMaterial* pAiMaterial = pAiScene->mMaterials[i];
-
-			// Specular Color
-			aiColor3D specular;
-			if (pAiMaterial->Get(AI_MATKEY_SPECULAR_FACTOR, specular) == AI_SUCCESS) {
-				mat.FresnelR0 = XMFLOAT3(specular.r, specular.g, specular.b);
-			}
+	// 2.处理材质
+	std::vector<MaterialDesc> materials = ExtractMaterials(pAiScene);
+	if (cacheWriter != nullptr) {
+		cacheWriter->SetMaterials(materials);
+	}
+	UINT baseMaterialIndex = CreateMaterials(materials, directory);
 
-			// Lambda
-			auto LoadTexture = [&](aiTextureType textureType) {
-				aiString relativePath;
-				pAiMaterial->GetTexture(textureType, 0, &relativePath);
+	// 3.填入RenderItem列表
+	CreateRenderItems(name, baseMaterialIndex);
 
-				std::string absolutePath = directory + relativePath.data;
+	mModelNum++;
+	return true;
+}
 
-				// µTextureDescriptor
-				mTextures.emplace_back(mDevice, mCommandList);
-				ID3D12Resource* tex = mTextures.back().LoadTexture(absolutePath);
-				CreateShaderResourceView(tex, mSrvHeapOffset++);
-			};
+bool Scene::InitFromCache(const MeshCacheView& cache, const std::string& path) {
+	const std::string directory = path.substr(0, path.find_last_of('\\') + 1);
+	const std::string name = path.substr(path.find_last_of('\\') + 1,
+		path.find_last_of('.') - path.find_last_of('\\') - 1);
 
-			// Ŀǰÿֲÿֻһ
-			// ----------------------------------- Diffuse Texture -----------------------------------
-			if (pAiMaterial->GetTextureCount(aiTextureType_DIFFUSE) != 0) {
-				LoadTexture(aiTextureType_DIFFUSE);
+	Mesh mesh = CreateMesh();
+	mesh.InitFromCache(cache);
+	mMeshes.push_back(std::move(mesh));
 
-				mat.DiffuseTextureIndex = mTextureNum++;
-				mat.ItemType |= TextureType::DiffuseTexture;
-			}
+	std::vector<MaterialDesc> materials;
+	cache.ReadMaterials(materials);
+	UINT baseMaterialIndex = CreateMaterials(materials, directory);
 
+	CreateRenderItems(name, baseMaterialIndex);
 
-			// ----------------------------------- Normal Texture -----------------------------------
-			if (pAiMaterial->GetTextureCount(aiTextureType_NORMALS) != 0) {
-				LoadTexture(aiTextureType_NORMALS);
+	mModelNum++;
+	return true;
+}
 
-				mat.NormalTextureIndex = mTextureNum++;
-				mat.ItemType |= TextureType::NormalTexture;
-			}
+// Textures Supported:
+//   [Diffuse Texture]
+//   [Normal Texture]
+//   [Bump Texture]
+//   [Roughness Texture]
+//   [Specular Texture]
+//   [Mask Texture]
+std::vector<MaterialDesc> Scene::ExtractMaterials(const aiScene* pAiScene) {
+	std::vector<MaterialDesc> materials;
+	if (!pAiScene->HasMaterials()) {
+		return materials;
+	}
 
-			// ----------------------------------- Bump Texture --------------------------------------
-			if (pAiMaterial->GetTextureCount(aiTextureType_HEIGHT) != 0) {
-				LoadTexture(aiTextureType_HEIGHT);
+	// 目前假设每种材质内每种纹理只含一张
+	// Shininess Texture与Roughness Texture共用同一位置
+	const std::pair<aiTextureType, TextureType> textureSlots[] = {
+		{ aiTextureType_DIFFUSE,			TextureType::DiffuseTexture },
+		{ aiTextureType_NORMALS,			TextureType::NormalTexture },
+		{ aiTextureType_HEIGHT,				TextureType::BumpTexture },
+		{ aiTextureType_DIFFUSE_ROUGHNESS,	TextureType::RoughnessTexture },
+		{ aiTextureType_SHININESS,			TextureType::RoughnessTexture },
+		{ aiTextureType_SPECULAR,			TextureType::SpecularTexture },
+		{ aiTextureType_OPACITY,			TextureType::MaskTexture },
+	};
+
+	materials.resize(pAiScene->mNumMaterials);
+	for (unsigned int i = 0; i < pAiScene->mNumMaterials; ++i) {
+		const aiMaterial* pAiMaterial = pAiScene->mMaterials[i];
+
+		// Specular Color
+		aiColor3D specular;
+		if (pAiMaterial->Get(AI_MATKEY_SPECULAR_FACTOR, specular) == AI_SUCCESS) {
+			materials[i].FresnelR0 = XMFLOAT3(specular.r, specular.g, specular.b);
+		}
 
-				mat.BumpTextureIndex = mTextureNum++;
-				mat.ItemType |= TextureType::BumpTexture;
+		for (const auto& [aiType, slot] : textureSlots) {
+			if (pAiMaterial->GetTextureCount(aiType) != 0) {
+				aiString relativePath;
+				pAiMaterial->GetTexture(aiType, 0, &relativePath);
+				materials[i].Textures.push_back({ slot, relativePath.C_Str() });
 			}
+		}
+	}
 
-			// ----------------------------------- Roughness Texture ---------------------------------
-			if (pAiMaterial->GetTextureCount(aiTextureType_DIFFUSE_ROUGHNESS) != 0) {
-				LoadTexture(aiTextureType_DIFFUSE_ROUGHNESS);
+	return materials;
+}
 
-				mat.RoughnessTextureIndex = mTextureNum++;
-				mat.ItemType |= TextureType::RoughnessTexture;
+UINT Scene::CreateMaterials(const std::vector<MaterialDesc>& materials, const std::string& directory) {
+	// 记录当前Material列表中的元素数量，以将相对的MaterialIndex转化为绝对的MaterialIndex
+	UINT baseMaterialIndex = static_cast<UINT>(mMaterials.size());
+
+	ReserveMaterials(baseMaterialIndex + static_cast<UINT>(materials.size()));
+
+	for (const MaterialDesc& desc : materials) {
+		// 创建一种新材质
+		Material mat;
+		mat.DiffuseAlbedo = desc.DiffuseAlbedo;
+		mat.FresnelR0 = desc.FresnelR0;
+		mat.Roughness = desc.Roughness;
+
+		for (const MaterialTextureRef& texture : desc.Textures) {
+			// 创建新的Texture及Descriptor
+			mTextures.emplace_back(mDevice, mCommandList);
+			ID3D12Resource* tex = mTextures.back().LoadTexture(directory + texture.RelativePath);
+			CreateShaderResourceView(tex, mSrvHeapOffset++);
+
+			switch (texture.Slot) {
+			case TextureType::DiffuseTexture:	mat.DiffuseTextureIndex = mTextureNum; break;
+			case TextureType::NormalTexture:	mat.NormalTextureIndex = mTextureNum; break;
+			case TextureType::BumpTexture:		mat.BumpTextureIndex = mTextureNum; break;
+			case TextureType::RoughnessTexture:	mat.RoughnessTextureIndex = mTextureNum; break;
+			case TextureType::ShininessTexture:	mat.ShininessTextureIndex = mTextureNum; break;
+			case TextureType::SpecularTexture:	mat.SpecularTextureIndex = mTextureNum; break;
+			case TextureType::MaskTexture:		mat.MaskTextureIndex = mTextureNum; break;
+			default: break;
 			}
+			mat.ItemType |= texture.Slot;
+			mTextureNum++;
+		}
 
-			// ----------------------------------- Shininess Texture ---------------------------------
-			if (pAiMaterial->GetTextureCount(aiTextureType_SHININESS) != 0) {
-				LoadTexture(aiTextureType_SHININESS);
+		mMaterials.push_back(mat);
 
-				mat.RoughnessTextureIndex = mTextureNum++;
-				mat.ItemType |= TextureType::RoughnessTexture;
-			}
 
-			// ----------------------------------- Specular Texture ---------------------------------
-			if (pAiMaterial->GetTextureCount(aiTextureType_SPECULAR) != 0) {
-				LoadTexture(aiTextureType_SPECULAR);
+		// 拷贝Material Constant Buffer
+		UINT materialIndex = mMaterials.size() - 1;
 
-				mat.SpecularTextureIndex = mTextureNum++;
-				mat.ItemType |= TextureType::SpecularTexture;
-			}
+		MaterialData materialCBCPU;
+		materialCBCPU.DiffuseAlbedo = mMaterials[materialIndex].DiffuseAlbedo;
+		materialCBCPU.FresnelR0 = mMaterials[materialIndex].FresnelR0;
+		materialCBCPU.Roughness = mMaterials[materialIndex].Roughness;
+		materialCBCPU.MatTransform = Identity4X4();
+		materialCBCPU.DiffuseTextureIndex = mMaterials[materialIndex].DiffuseTextureIndex;
+		materialCBCPU.NormalTextureIndex = mMaterials[materialIndex].NormalTextureIndex;
+		materialCBCPU.BumpTextureIndex = mMaterials[materialIndex].BumpTextureIndex;
+		materialCBCPU.RoughnessTextureIndex = mMaterials[materialIndex].RoughnessTextureIndex;
+		materialCBCPU.ShininessTextureIndex = mMaterials[materialIndex].ShininessTextureIndex;
+		materialCBCPU.SpecularTextureIndex = mMaterials[materialIndex].SpecularTextureIndex;
+		materialCBCPU.MaskTextureIndex = mMaterials[materialIndex].MaskTextureIndex;
 
-			// ----------------------------------- Mask Texture -----------------------------------
-			if (pAiMaterial->GetTextureCount(aiTextureType_OPACITY) != 0) {
-				LoadTexture(aiTextureType_OPACITY);
+		mMaterialCBGPU->Copydata(materialIndex, materialCBCPU);
+	}
 
-				mat.MaskTextureIndex = mTextureNum++;
-				mat.ItemType |= TextureType::MaskTexture;
-			}
+	return baseMaterialIndex;
+}
 
-			mMaterials.push_back(mat);
+Mesh Scene::CreateMesh() {
+	Mesh mesh(mDevice, mCommandList, mMeshManager.get());
+	mesh.Registry = &mSubMeshRegistry;
+	mesh.MeshIndex = static_cast<UINT>(mMeshes.size());
+	return mesh;
+}
 
+ModelHandle Scene::CreateModel(const std::string& name) {
+	UINT slot = 0;
+	if (!mFreeModelSlots.empty()) {
+		slot = mFreeModelSlots.back();
+		mFreeModelSlots.pop_back();
+	}
+	else {
+		slot = static_cast<UINT>(mModels.size());
+		mModels.emplace_back();
+	}
+
+	SceneModel& model = mModels[slot];
+	model.Name = name;
+	model.Alive = true;
 
-			// Material Constant Buffer
-			UINT materialIndex = mMaterials.size() - 1;
+	ModelHandle handle;
+	handle.Index = slot;
+	handle.Generation = model.Generation;
+	mModelNames[name] = handle;
+	return handle;
+}
 
-			MaterialData materialCBCPU;
-			materialCBCPU.DiffuseAlbedo = mMaterials[materialIndex].DiffuseAlbedo;
-			materialCBCPU.FresnelR0 = mMaterials[materialIndex].FresnelR0;
-			materialCBCPU.Roughness = mMaterials[materialIndex].Roughness;
-			materialCBCPU.MatTransform = Identity4X4();
-			materialCBCPU.DiffuseTextureIndex = mMaterials[materialIndex].DiffuseTextureIndex;
-			materialCBCPU.NormalTextureIndex = mMaterials[materialIndex].NormalTextureIndex;
-			materialCBCPU.BumpTextureIndex = mMaterials[materialIndex].BumpTextureIndex;
-			materialCBCPU.RoughnessTextureIndex = mMaterials[materialIndex].RoughnessTextureIndex;
-			materialCBCPU.ShininessTextureIndex = mMaterials[materialIndex].ShininessTextureIndex;
-			materialCBCPU.SpecularTextureIndex = mMaterials[materialIndex].SpecularTextureIndex;
-			materialCBCPU.MaskTextureIndex = mMaterials[materialIndex].MaskTextureIndex;
+void Scene::CreateRenderItems(const std::string& name, UINT baseMaterialIndex) {
+	mImportedModel = CreateModel(name);
+	SceneModel& model = mModels[mImportedModel.Index];
+	for (size_t i = mImportMeshBegin; i < mMeshes.size(); ++i) {
+		model.Meshes.push_back(static_cast<UINT>(i));
+	}
 
-			mMaterialCBGPU->Copydata(materialIndex, materialCBCPU);
+	if (!model.Meshes.empty()) {
+		const std::vector<SubMesh>& submeshes = mMeshes.back().SubMeshes;
+		for (UINT i = 0; i < submeshes.size(); ++i) {
+			CreateRenderItem(mImportedModel.Index, i, baseMaterialIndex + submeshes[i].MaterialIndex, Identity4X4());
 		}
 	}
 
-	// 3.RenderItemб
-	std::vector<SubMesh>& submeshes = mMeshes.back().SubMeshes;
-	for (unsigned int i = 0; i < submeshes.size(); ++i) {
-		RenderItem item;
+	UpdateModelBounds(mImportedModel.Index);
+}
 
-		// MeshϢ
-		item.MeshIndex = mMeshes.size() - 1;
-		item.NumVertices = submeshes[i].NumVertices;
-		item.NumIndices = submeshes[i].NumIndices;
-		item.BaseVertexLocation = submeshes[i].BaseVertexLocation;
-		item.StartIndexLocation = submeshes[i].StartIndexLocation;
-		item.PrimitiveTopology = submeshes[i].PrimitiveTopology;
+void Scene::CreateRenderItems(const std::string& name, UINT baseMaterialIndex, const std::vector<PbrtShapeInstance>& instances) {
+	mImportedModel = CreateModel(name);
+	SceneModel& model = mModels[mImportedModel.Index];
+	for (size_t i = mImportMeshBegin; i < mMeshes.size(); ++i) {
+		model.Meshes.push_back(static_cast<UINT>(i));
+	}
 
-		item.RenderItemIndex = mRenderItemNum;
-		UINT materialIndex = baseMaterialIndex + submeshes[i].MaterialIndex;
+	for (const PbrtShapeInstance& instance : instances) {
+		CreateRenderItem(mImportedModel.Index, instance.SubMeshIndex, baseMaterialIndex + instance.MaterialIndex, instance.World);
+	}
 
-		// Object Constant Buffer
-		RenderItemData objectCBCPU;
-		objectCBCPU.World = Identity4X4();
-		objectCBCPU.TexTransform = Identity4X4();
-		objectCBCPU.MaterialIndex = materialIndex;
+	UpdateModelBounds(mImportedModel.Index);
+}
 
-		mObjectCBGPU->Copydata(item.RenderItemIndex, objectCBCPU);
+void Scene::CreateRenderItem(UINT modelSlot, UINT submeshIndex, UINT materialIndex, const XMFLOAT4X4& transform) {
+	ReserveItems(mRenderItemNum + 1);
 
-		TextureFlags type = mMaterials[materialIndex].ItemType;
-		mRenderItems[type].push_back(item);
+	// 内容与已上传的SubMesh相同时，直接引用其几何数据
+	UINT meshIndex = static_cast<UINT>(mMeshes.size() - 1);
+	if (mMeshes[meshIndex].SubMeshes[submeshIndex].IsShared) {
+		const SubMeshRef shared = mMeshes[meshIndex].SubMeshes[submeshIndex].SharedWith;
+		meshIndex = shared.MeshIndex;
+		submeshIndex = shared.SubMeshIndex;
+	}
 
-		// NameIndexMap
-		mNameIndexMap[name].push_back(item.RenderItemIndex);
+	const Mesh& mesh = mMeshes[meshIndex];
+	const SubMesh& submesh = mesh.SubMeshes[submeshIndex];
 
-		// ¼
-		mRenderItemNum++;
-	}
+	RenderItem item;
 
-	mModelNum++;
-	return true;
+	// 设置Mesh信息
+	item.MeshIndex = meshIndex;
+	item.NumVertices = submesh.NumVertices;
+	item.NumIndices = submesh.NumIndices;
+	item.BaseVertexLocation = mesh.BaseVertexLocation(submesh.BaseVertexLocation);
+	item.IndexFormat = submesh.IndexFormat;
+	item.StartIndexLocation = mesh.StartIndexLocation(submesh.IndexBufferOffsetInBytes, submesh.IndexFormat);
+	item.PrimitiveTopology = submesh.PrimitiveTopology;
+	item.SubMeshIndex = submeshIndex;
+	item.CurrentLOD = 0;
+	item.MaterialIndex = materialIndex;
+
+	item.RenderItemIndex = mRenderItemNum;
+
+	// 拷贝Object Constant Buffer
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixTranspose(XMLoadFloat4x4(&transform)));
+	mWorldMatrixGPU->Copydata(item.RenderItemIndex, world);
+
+	RenderItemData objectCBCPU;
+	objectCBCPU.TexTransform = Identity4X4();
+	objectCBCPU.MaterialIndex = materialIndex;
+	objectCBCPU.PositionScale = submesh.Quantization.Scale;
+	objectCBCPU.PositionOffset = submesh.Quantization.Offset;
+
+	mObjectCBGPU->Copydata(item.RenderItemIndex, objectCBCPU);
+
+	// 顶点格式不同的Render Item需要不同的PSO
+	TextureFlags type = mMaterials[materialIndex].ItemType;
+	if (mesh.CompactVertices) {
+		type |= TextureType::CompactVertex;
+	}
+	std::vector<RenderItem>& itemList = mRenderItems[type];
+	itemList.push_back(item);
+
+	// 登记到模型中
+	mModels[modelSlot].RenderItems.push_back(item.RenderItemIndex);
+
+	// 更新计数
+	mRenderItemNum++;
+	mItemTransforms.resize(mRenderItemNum, Identity4X4());
+	mWorldMatrices.resize(mRenderItemNum, Identity4X4());
+	mItemDirty.resize(mRenderItemNum, 0);
+	mItemGenerations.resize(mRenderItemNum, 0);
+	mItemModels.resize(mRenderItemNum, 0);
+	mItemLocations.resize(mRenderItemNum);
+	mTransforms.Resize(mRenderItemNum);
+	mHasItemTransform.resize(mRenderItemNum, 0);
+	mLocalBounds.resize(mRenderItemNum);
+	mWorldBounds.resize(mRenderItemNum);
+	mPackedBounds.Resize(mRenderItemNum);
+	mInstancesDirty = true;
+
+	mHasItemTransform[item.RenderItemIndex] = XMMatrixIsIdentity(XMLoadFloat4x4(&transform)) ? 0 : 1;
+
+	mItemModels[item.RenderItemIndex] = modelSlot;
+	mItemLocations[item.RenderItemIndex].Type = type;
+	mItemLocations[item.RenderItemIndex].Position = static_cast<UINT>(itemList.size() - 1);
+
+	// 包围体
+	mItemTransforms[item.RenderItemIndex] = transform;
+	mWorldMatrices[item.RenderItemIndex] = transform;
+	mLocalBounds[item.RenderItemIndex].Box = submesh.Bounds;
+	mLocalBounds[item.RenderItemIndex].Sphere = submesh.Sphere;
+	mWorldBounds[item.RenderItemIndex] = MeshBounds::Transform(mLocalBounds[item.RenderItemIndex], XMLoadFloat4x4(&transform));
+	mPackedBounds.Set(item.RenderItemIndex, mWorldBounds[item.RenderItemIndex].Box);
+	mOctree.Insert(item.RenderItemIndex, mWorldBounds[item.RenderItemIndex].Box);
 }
 
 void Scene::CreateShaderResourceView(ID3D12Resource* tex, UINT srvHeapOffset, D3D12_SRV_DIMENSION viewDimension) {
-	static UINT srvSize = mDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-
-	// SRV Descriptor
+	// 创建SRV Descriptor
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 	srvDesc.Format = tex != nullptr ? tex->GetDesc().Format : DXGI_FORMAT_R8G8B8A8_UNORM;
@@ -332,14 +1280,7 @@ void Scene::CreateShaderResourceView(ID3D12Resource* tex, UINT srvHeapOffset, D3
 	srvDesc.Texture2D.MipLevels = tex != nullptr ? tex->GetDesc().MipLevels : 1;
 	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
 
-	// SRV DescriptorSRV Descriptor Heap
-	CD3DX12_CPU_DESCRIPTOR_HANDLE descHandle(mSrvHeap->GetCPUDescriptorHandleForHeapStart());
-	descHandle.Offset(srvHeapOffset, srvSize);
-
-	mDevice->CreateShaderResourceView(
-		tex,
-		&srvDesc,
-		descHandle
-	);
+	// 将SRV Descriptor填入SRV Descriptor Heap，超出容量时扩容
+	mSrvHeap->CreateShaderResourceView(srvHeapOffset, tex, &srvDesc);
 
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "SceneApp.h"
 
 #include <fstream>
+#include <random>
 #include <sstream>
 
 SceneApp::SceneApp(HINSTANCE hInstance)
@@ -21,37 +22,49 @@ bool SceneApp::Init() {
 
 	ThrowIfFailed(mCommandList->Reset(mCommandAllocator.Get(), nullptr));
 
+	BuildConstantBuffer();
 	ConfigLights();
 
-	BuildConstantBuffer();
 	BuildRootSignature();
 	BuildShadowMap();
 
 	BuildSrvHeap();
 
-	// Scene
-	// SRV HeapǰΪEnvironment MappingShadow Mapping
-	mScene.Init(mDevice, mCommandList, mSrvHeap, 2);
+	// 启动Scene
+	// SRV Heap前两个为Environment Mapping和Shadow Mapping
+	mScene.Init(mDevice, mCommandList, mSrvHeap.get(), 2);
 
 	ThrowIfFailed(mCommandList->Close());
 	ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
 	mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
 
 	FlushCommandQueue();
+	mScene.ReleaseUploadBuffers();
 
 	return true;
 }
 
-void SceneApp::LoadModel(const std::string& path) {
+ModelHandle SceneApp::LoadModel(const std::string& path, MeshImportFlags importFlags) {
 	ThrowIfFailed(mCommandList->Reset(mCommandAllocator.Get(), nullptr));
 
-	mScene.ImportModel(path);
+	ModelHandle model = mScene.ImportModel(path, importFlags);
 
 	ThrowIfFailed(mCommandList->Close());
 	ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
 	mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
 
 	FlushCommandQueue();
+
+	// 拷贝已完成
+	mScene.ReleaseUploadBuffers();
+
+	return model;
+}
+
+void SceneApp::UnloadModel(ModelHandle model) {
+	// 每帧结束时都会等待GPU，此时Arena中的范围已不再被使用
+	FlushCommandQueue();
+	mScene.UnloadModel(model);
 }
 
 void SceneApp::LoadCubeMap(const std::string& path) {
@@ -66,6 +79,14 @@ void SceneApp::LoadCubeMap(const std::string& path) {
 	FlushCommandQueue();
 }
 
+void SceneApp::SetProperties(ModelHandle model, XMFLOAT3 scale, float rotationAngle, XMFLOAT3 rotationAxis, XMFLOAT3 pos) {
+	mScene.SetProperties(model, scale, rotationAngle, rotationAxis, pos);
+}
+
+void SceneApp::SetOccluderMode(ModelHandle model, OccluderMode::Value mode) {
+	mScene.SetOccluderMode(model, mode);
+}
+
 void SceneApp::ConfigLights() {
 	// Directional Lights
 	mLights.NumDirectionalLights = 0;
@@ -77,26 +98,22 @@ void SceneApp::ConfigLights() {
 	mLights.DirectionalLights[2].Direction = { 0.0f, -0.707f, -0.707f };
 	mLights.DirectionalLights[2].Strength = { 0.15f, 0.15f, 0.15f };
 
-	// Point Lights
-	mLights.NumPointLights = 0;
-	
-	// Spot Lights
-	mLights.NumSpotLights = 0;
-
-	// Rect Lights
-	// 
-	mLights.NumRectLights = 1;
-	mLights.RectLights[0].Direction = { 1.0f, 0.0f, 0.0f };
-	mLights.RectLights[0].Position = { -1.0f, 1.3f, 0.0f };
-	mLights.RectLights[0].Strength = { 1.0f, 1.0f, 1.0f };
-	mLights.RectLights[0].AttenuationRange = 1000.0f;
+	// Point/Spot/Rect Lights
+	// 数量不受限制，每帧分配到与之相交的Cluster
+	// 侧光，同时作为ShadowMap的光源
+	mShadowLight = {};
+	mShadowLight.Direction = { 1.0f, 0.0f, 0.0f };
+	mShadowLight.Position = { -1.0f, 1.3f, 0.0f };
+	mShadowLight.Strength = { 1.0f, 1.0f, 1.0f };
+	mShadowLight.AttenuationRange = 1000.0f;
+	mClusteredLighting->AddRectLight(mShadowLight);
 
 	// Ambient Lighting
 	mAmbientLightStrength = { 0.25f, 0.25f, 0.35f, 1.0f };
 }
 
 void SceneApp::BuildConstantBuffer() {
-	// UploadBuffer
+	// 构建UploadBuffer
 
 	//mObjectCBGPU = std::make_unique<UploadBuffer<cbPerObject>>(mDevice.Get(), maximumItemNum, true);
 	//mMaterialCBGPU = std::make_unique<UploadBuffer<cbMaterial>>(mDevice.Get(), maximumItemNum, true);
@@ -104,18 +121,21 @@ void SceneApp::BuildConstantBuffer() {
 	// 0: PassCB, 1: Shadow Map PassCB
 	mPassCBGPU = std::make_unique<UploadBuffer<PassData>>(mDevice.Get(), 2, true);
 
+	// 光源、Cluster与光源索引的Structured Buffer
+	mClusteredLighting = std::make_unique<ClusteredLighting>(mDevice.Get());
+
 }
 
 void SceneApp::BuildShaders(PipelineStateFlags pipelineStateFlags) {
-	// ߱HLSLļErrorMsgsܼذǽDebug
+	// 由于我们是在线编译HLSL文件，ErrorMsgs能极大地帮助我们进行Debug
 	HRESULT hr = S_OK;
 	ComPtr<ID3DBlob> ErrorMsgs;
 
-	// ˴˼·ǣ
-	// ݼģʱǷԴصĺ꣬ȻЩ긽ShaderĿͷλ
-	// ֻʱShader
+	// 此处的设计思路是：
+	// 根据加载模型时是否含有相关资源，定义相关的宏，然后将这些宏附于Shader代码的开头位置
+	// 但这样只能在运行时编译Shader代码
 
-	// Ӳ·
+	// 硬编码路径
 	std::string shaderPath = "C:\\Users\\Lenovo\\Desktop\\EngineZeroOne\\Shaders\\Light.hlsl";
 	if (pipelineStateFlags & ShadowMapping) {
 		shaderPath = "C:\\Users\\Lenovo\\Desktop\\EngineZeroOne\\Shaders\\ShadowMapping.hlsl";
@@ -149,6 +169,9 @@ void SceneApp::BuildShaders(PipelineStateFlags pipelineStateFlags) {
 	if (pipelineStateFlags & MaskTexture) {
 		macros += "#define HAS_MASK_TEXTURE\n";
 	}
+	if (pipelineStateFlags & CompactVertex) {
+		macros += "#define COMPACT_VERTEX\n";
+	}
 
 	std::string shader = macros + buffer.str();
 
@@ -156,7 +179,7 @@ void SceneApp::BuildShaders(PipelineStateFlags pipelineStateFlags) {
 	hr = D3DCompile(
 		shader.c_str(),
 		shader.length(),
-		shaderPath.c_str(), // Ϊ˽#includeļ·
+		shaderPath.c_str(), // 为了解析#include文件的相对路径
 		nullptr,
 		D3D_COMPILE_STANDARD_FILE_INCLUDE,
 		"VS",
@@ -232,32 +255,48 @@ void SceneApp::BuildShaders(PipelineStateFlags pipelineStateFlags) {
 }
 
 void SceneApp::BuildRootSignature() {
-	// б
+	// 创建根参数列表
 	CD3DX12_ROOT_PARAMETER slotRootParameter[RootSignatureParameter::ParameterCount];
 	
-	// Parameter[0]: PerObjectCB
+	// Parameter[0]: DrawConstants
 	// Parameter[1]: PerPassCB
 	// Parameter[2]: MaterialCB
 	// Parameter[3]: TextureTable
-	slotRootParameter[RootSignatureParameter::PerObjectCB].InitAsConstantBufferView(0);
+	// Parameter[4]: RenderItemData
+	// Parameter[5]: InstanceItems
+	// Parameter[6]: WorldMatrices
+	// Parameter[7]: ClusterLights
+	// Parameter[8]: LightClusters
+	// Parameter[9]: LightIndices
+	slotRootParameter[RootSignatureParameter::DrawConstants].InitAsConstants(1, 0);
 	slotRootParameter[RootSignatureParameter::PerPassCB].InitAsConstantBufferView(1);
 
 	// MaterialCB
 	slotRootParameter[RootSignatureParameter::MaterialCB].InitAsShaderResourceView(0, 1);
 
+	// 实例化绘制: 实例列表给出每个实例的RenderItemIndex
+	slotRootParameter[RootSignatureParameter::RenderItemData].InitAsShaderResourceView(1, 1);
+	slotRootParameter[RootSignatureParameter::InstanceItems].InitAsShaderResourceView(2, 1);
+	slotRootParameter[RootSignatureParameter::WorldMatrices].InitAsShaderResourceView(3, 1);
+
+	// Clustered Lighting
+	slotRootParameter[RootSignatureParameter::ClusterLights].InitAsShaderResourceView(4, 1);
+	slotRootParameter[RootSignatureParameter::LightClusters].InitAsShaderResourceView(5, 1);
+	slotRootParameter[RootSignatureParameter::LightIndices].InitAsShaderResourceView(6, 1);
+
 	// TextureTable
+	// 纹理数量随场景增长，使用无界的Descriptor Range(需要Resource Binding Tier 2)
 	CD3DX12_DESCRIPTOR_RANGE srvTable;
-	UINT textureNum = mScene.mMaxTextureNum; // ̶
-	srvTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 2 + textureNum, 0, 0);
+	srvTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 0);
 	slotRootParameter[RootSignatureParameter::TextureTable].InitAsDescriptorTable(1, &srvTable, D3D12_SHADER_VISIBILITY_PIXEL);
 
 
-	// Static Samplersб
+	// 创建Static Samplers列表
 	auto staticSamplers = GetStaticSamplers();
 	UINT numStaticSamplers = staticSamplers.size();
 	const D3D12_STATIC_SAMPLER_DESC* pStaticSamplerDesc = staticSamplers.data();
 
-	// л
+	// 序列化根参数
 	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(
 		ARRAYSIZE(slotRootParameter),
 		slotRootParameter,
@@ -282,7 +321,7 @@ void SceneApp::BuildRootSignature() {
 
 	ThrowIfFailed(hr);
 
-	// ǩ
+	// 创建根签名
 	ThrowIfFailed(mDevice->CreateRootSignature(
 		0,
 		serializedRootSig->GetBufferPointer(),
@@ -292,25 +331,13 @@ void SceneApp::BuildRootSignature() {
 }
 
 void SceneApp::BuildShadowMap() {
-	// Ŀǰ賡ֻһԴ
-	mShadowMap = std::make_unique<ShadowMap<RectLight>>(mDevice.Get(), 2048, 2048, &mLights.RectLights[0]);
+	// 目前仅假设场景中只有一个面光源
+	mShadowMap = std::make_unique<ShadowMap<RectLight>>(mDevice.Get(), 2048, 2048, &mShadowLight);
 }
 
 void SceneApp::BuildSrvHeap() {
-	// SRV Heap
-	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc;
-	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	srvHeapDesc.NumDescriptors = 128;
-	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	srvHeapDesc.NodeMask = 0;
-
-	ThrowIfFailed(mDevice->CreateDescriptorHeap(
-		&srvHeapDesc,
-		IID_PPV_ARGS(&mSrvHeap)
-	));
-
-	// SRV
-	auto srvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(mSrvHeap->GetCPUDescriptorHandleForHeapStart());
+	// SRV Heap，初始容量128，场景的纹理超出时扩容
+	mSrvHeap = std::make_unique<DescriptorHeap>(mDevice.Get(), 128);
 
 	D3D12_SHADER_RESOURCE_VIEW_DESC environmentMapDesc = {};
 	environmentMapDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
@@ -320,16 +347,10 @@ void SceneApp::BuildSrvHeap() {
 	environmentMapDesc.Texture2D.MipLevels = 1;
 	environmentMapDesc.Texture2D.ResourceMinLODClamp = 0.0f;
 
-	// Environment Cube Mapռλ
-	mDevice->CreateShaderResourceView(
-		nullptr,
-		&environmentMapDesc,
-		srvHandle
-	);
-
-	srvHandle.Offset(1, mCbvSrvUavDescriptorSize);
+	// Environment Cube Map占位符
+	mSrvHeap->CreateShaderResourceView(0, nullptr, &environmentMapDesc);
 
-	// ˴FormatҲShadowMapFormatͬ
+	// 此处的Format也与ShadowMap的Format不同
 	D3D12_SHADER_RESOURCE_VIEW_DESC shadowMapDesc = {};
 	shadowMapDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 	shadowMapDesc.Format = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
@@ -339,21 +360,26 @@ void SceneApp::BuildSrvHeap() {
 	shadowMapDesc.Texture2D.ResourceMinLODClamp = 0.0f;
 	shadowMapDesc.Texture2D.PlaneSlice = 0;
 
-	mDevice->CreateShaderResourceView(
-		mShadowMap->Resource(),
-		&shadowMapDesc,
-		srvHandle
-	);
+	mSrvHeap->CreateShaderResourceView(1, mShadowMap->Resource(), &shadowMapDesc);
 }
 
 void SceneApp::BuildPSO(PipelineStateFlags pipelineStateFlags) {
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc;
 	ZeroMemory(&psoDesc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
 
-	psoDesc.InputLayout = VertexPositionNormalTangentTexture::InputLayout;
+	if (UsesPositionStreamOnly(pipelineStateFlags)) {
+		psoDesc.InputLayout = (pipelineStateFlags & CompactVertex) ?
+			VertexPositionNormalTangentTextureCompact::PositionOnlyInputLayout :
+			VertexPositionNormalTangentTexture::PositionOnlyInputLayout;
+	}
+	else {
+		psoDesc.InputLayout = (pipelineStateFlags & CompactVertex) ?
+			VertexPositionNormalTangentTextureCompact::SplitInputLayout :
+			VertexPositionNormalTangentTexture::SplitInputLayout;
+	}
 	psoDesc.pRootSignature = mRootSignature.Get();
 
-	// ڶӦtexFlagsShader룬ֳ
+	// 不存在对应texFlags的Shader代码，则现场编译
 	if (mVsByteCode.count(pipelineStateFlags) == 0) {
 		BuildShaders(pipelineStateFlags);
 	}
@@ -373,7 +399,7 @@ void SceneApp::BuildPSO(PipelineStateFlags pipelineStateFlags) {
 	psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
 
 	psoDesc.SampleMask = UINT_MAX;
-	// ˴Swap Chainñһ
+	// 此处与Swap Chain的设置保持一致
 	psoDesc.SampleDesc.Count = 1;
 	psoDesc.SampleDesc.Quality = 0;
 
@@ -405,19 +431,19 @@ void SceneApp::BuildPSO(PipelineStateFlags pipelineStateFlags) {
 		psoDesc.DSVFormat = DXGI_FORMAT_R24G8_TYPELESS;
 	}
 	if (pipelineStateFlags & EnvironmentMapping) {
-		// λڣñ޳
+		// 摄像机位于天空球内，禁用背面剔除
 		psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
 
-		// ȲԺLESS_EQUAL
+		// 深度测试函数采用LESS_EQUAL
 		psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL;
 	}
 
 	if (pipelineStateFlags & MaskTexture) {
-		// ҶƬģͣñ޳
+		// 叶片类模型，禁用背面剔除
 		psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
 	}
 
-	// PSO
+	// 创建PSO
 	ThrowIfFailed(mDevice->CreateGraphicsPipelineState(
 		&psoDesc,
 		IID_PPV_ARGS(&mPSOs[pipelineStateFlags])
@@ -425,6 +451,14 @@ void SceneApp::BuildPSO(PipelineStateFlags pipelineStateFlags) {
 
 }
 
+bool SceneApp::UsesPositionStreamOnly(PipelineStateFlags pipelineStateFlags) {
+	// Mask纹理的Alpha Test需要TextureCoordinate
+	if (pipelineStateFlags & ShadowMapping) {
+		return (pipelineStateFlags & MaskTexture) == 0;
+	}
+	return (pipelineStateFlags & EnvironmentMapping) != 0;
+}
+
 void SceneApp::OnResize() {
 	D3D12App::OnResize();
 
@@ -434,30 +468,42 @@ void SceneApp::OnResize() {
 }
 
 void SceneApp::Update(const GameTimer& gt) {
+	mScene.mUploadedBytes = 0;
 
 	UpdateRenderItemCB(gt);
+
+	// PassCB中的Cluster常量依赖于当前的投影
+	mClusteredLighting->Update(mCamera.ViewMatrix(), mCamera.ProjectionMatrix(), mCamera.mNearZ, mCamera.mFarZ);
 	UpdatePassCB(gt);
-}
 
-void SceneApp::UpdateRenderItemCB(const GameTimer& gt) {
-	mScene.SetProperties("marble_bust_01_4k",
-		XMFLOAT3(1.0f, 1.0f, 1.0f),
-		XM_PIDIV2, XMFLOAT3(1.0f, 0.0f, 0.0f),
-		XMFLOAT3(0.0f, 1.02f, 0.0f));
+	// LOD的选择依赖于UpdateRenderItemCB中设置的World Matrix
+	XMFLOAT4X4 proj;
+	XMStoreFloat4x4(&proj, mCamera.ProjectionMatrix());
+	mScene.UpdateLODs(mCamera.CartesianPos(), proj._22 * 0.5f * mClientHeight);
 
-	mScene.SetProperties("round_wooden_table_01_4k",
-		XMFLOAT3(1.0f, 1.0f, 1.0f),
-		XM_PIDIV2, XMFLOAT3(1.0f, 0.0f, 0.0f));
+	// 剔除依赖于UpdateRenderItemCB中更新的包围体
+	// 阴影Pass只需要光源摄像机能看到的投射物
+	mScene.CullView(CullingView::Main, XMMatrixMultiply(mCamera.ViewMatrix(), mCamera.ProjectionMatrix()), true);
+	const Camera* pLightCamera = mShadowMap->LightCamera();
+	mScene.CullView(CullingView::Shadow, XMMatrixMultiply(pLightCamera->ViewMatrix(), pLightCamera->ProjectionMatrix()));
+
+	// 实例的分组依赖于所选的LOD与各视角的剔除结果
+	mScene.BuildInstancedDraws();
 
-	mScene.SetProperties("sponza",
-		XMFLOAT3(0.01f, 0.01f, 0.01f),
-		0, XMFLOAT3(1.0f, 0.0f, 0.0f));
+	// 两个Pass的PassCB每帧都会重写
+	mUploadedBytes = mScene.mUploadedBytes + 2 * sizeof(PassData) + mClusteredLighting->mUploadedBytes;
+}
 
-	// ʼΪ
-	mScene.SetProperties("sky",
+void SceneApp::UpdateRenderItemCB(const GameTimer& gt) {
+	// 静态模型的变换在加载后设置一次，此处只有天空球随摄像机移动
+	// 设置天空球的中心始终为摄像机，摄像机静止时不会产生任何写入
+	mScene.SetProperties(mScene.mSkyModel,
 		XMFLOAT3(1.0f, 1.0f, 1.0f),
 		0, XMFLOAT3(1.0f, 0.0f, 0.0f),
 		mCamera.CartesianPos());
+
+	// 只上传变换改变过的Render Item
+	mScene.FlushTransforms();
 }
 
 void SceneApp::UpdatePassCB(const GameTimer& gt) {
@@ -488,6 +534,7 @@ void SceneApp::UpdatePassCB(const GameTimer& gt) {
 	mPassCBCPU.DeltaTime = mTimer.DeltaTime();
 
 	// Lights
+	mClusteredLighting->WriteConstants(mLights);
 	CopyMemory(&mPassCBCPU.Lights, &mLights, sizeof(Light));
 	mPassCBCPU.AmbientLightStrength = mAmbientLightStrength;
 
@@ -545,21 +592,38 @@ void SceneApp::Draw(const GameTimer& gt) {
 
 	ImGui::Render();
 
+	// UI中显示的是上一帧的统计信息
+	mTrianglesDrawn = 0;
+	mDrawCalls = 0;
+	mInstancesDrawn = 0;
+	mPipelineStateChanges = 0;
+
 	// ----------------------------- Command List Starts-----------------------------------
 
-	// Shader-visibleSRV Descriptor Heap
-	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvHeap.Get() };
+	// 绑定Shader-visible的SRV Descriptor Heap
+	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvHeap->Heap() };
 	mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 
-	// PassһRoot Signatureʽ
-	// øǩԴ
+	// 多个Pass共用一套Root Signature格式
+	// 设置根签名并绑定资源
 	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
 
 	mCommandList->SetGraphicsRootShaderResourceView(RootSignatureParameter::MaterialCB, 
 		mScene.mMaterialCBGPU->Resource()->GetGPUVirtualAddress()); // StructuredBuffer
+	mCommandList->SetGraphicsRootShaderResourceView(RootSignatureParameter::RenderItemData,
+		mScene.mObjectCBGPU->Resource()->GetGPUVirtualAddress());
+	mCommandList->SetGraphicsRootShaderResourceView(RootSignatureParameter::InstanceItems,
+		mScene.mInstanceItemsGPU->Resource()->GetGPUVirtualAddress());
+	mCommandList->SetGraphicsRootShaderResourceView(RootSignatureParameter::WorldMatrices,
+		mScene.mWorldMatrixGPU->Resource()->GetGPUVirtualAddress());
+	mCommandList->SetGraphicsRootShaderResourceView(RootSignatureParameter::ClusterLights,
+		mClusteredLighting->LightBufferAddress());
+	mCommandList->SetGraphicsRootShaderResourceView(RootSignatureParameter::LightClusters,
+		mClusteredLighting->ClusterBufferAddress());
+	mCommandList->SetGraphicsRootShaderResourceView(RootSignatureParameter::LightIndices,
+		mClusteredLighting->LightIndexBufferAddress());
 	// Texture Table
-	CD3DX12_GPU_DESCRIPTOR_HANDLE srvHandle(mSrvHeap->GetGPUDescriptorHandleForHeapStart());
-	mCommandList->SetGraphicsRootDescriptorTable(RootSignatureParameter::TextureTable, srvHandle);
+	mCommandList->SetGraphicsRootDescriptorTable(RootSignatureParameter::TextureTable, mSrvHeap->GpuHandle(0));
 
 	// PASS 1: ShadowMapping
 	DrawShadowMap(gt);
@@ -568,7 +632,7 @@ void SceneApp::Draw(const GameTimer& gt) {
 	mCommandList->RSSetViewports(1, &mViewPort);
 	mCommandList->RSSetScissorRects(1, &mScissorRect);
 
-	// ״״̬ת
+	// 首次状态转换
 	if (mMsaaState) {
 		// MSAA Render Target: RESOLVE_SOURCE -> RENDER_TARGET
 		D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
@@ -588,7 +652,7 @@ void SceneApp::Draw(const GameTimer& gt) {
 		mCommandList->ResourceBarrier(1, &barrier);
 	}
 	
-	// ڻǰ
+	// 在绘制前进行清空
 	if (mMsaaState) {
 		// MSAA Render Target
 		mCommandList->ClearRenderTargetView(
@@ -617,7 +681,7 @@ void SceneApp::Draw(const GameTimer& gt) {
 		nullptr
 	);
 
-	// Output Merge׶εԴ
+	// 设置Output Merge阶段的输出缓冲区，即资源绑定
 	if (mMsaaState) {
 		D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = mMsaaRtvHeap->GetCPUDescriptorHandleForHeapStart();
 		D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = DepthStencilView();
@@ -640,12 +704,12 @@ void SceneApp::Draw(const GameTimer& gt) {
 	}
 	
 
-	// Render ItemͨԴPassData
+	// 绑定Render Item间通用资源：PassData
 	mCommandList->SetGraphicsRootConstantBufferView(RootSignatureParameter::PerPassCB, 
 		mPassCBGPU->Resource()->GetGPUVirtualAddress());
 	
 
-	// Pipeline State Flags
+	// 设置Pipeline State Flags
 	PipelineStateFlags pipelineStateFlags = 0;
 	if (mMsaaState) {
 		pipelineStateFlags |= MSAA;
@@ -653,10 +717,10 @@ void SceneApp::Draw(const GameTimer& gt) {
 	if (mIsWireFrame) {
 		pipelineStateFlags |= WireFrame;
 	}
-	// ƣ
-	DrawRenderItems(gt, pipelineStateFlags);
+	// 绘制！
+	DrawRenderItems(gt, pipelineStateFlags, CullingView::Main);
 
-	// ͼ
+	// 环境贴图
 	DrawEnvironmentMap(gt, pipelineStateFlags);
 
 	// ImGui
@@ -665,7 +729,7 @@ void SceneApp::Draw(const GameTimer& gt) {
 
 	ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), mCommandList.Get());
 
-	// ڶ״̬ת
+	// 第二次状态转换
 	if (mMsaaState) {
 		// MSAA Render Target: RENDER_TARGET -> RESOLVE_SOURCE
 		// Back Buffer Render Target : PRESENT -> RESOLVE_DEST
@@ -682,7 +746,7 @@ void SceneApp::Draw(const GameTimer& gt) {
 
 		mCommandList->ResourceBarrier(2, barriers);
 
-		// MSAA Render TargetBack Buffer Render Target
+		// 将MSAA Render Target解析到Back Buffer Render Target中
 		mCommandList->ResolveSubresource(CurrentBackBuffer(), 0, mMsaaRenderTarget.Get(), 0, mBackBufferFormat);
 
 		// Back Buffer Render Target : RESOLVE_DEST -> PRESENT
@@ -713,47 +777,61 @@ void SceneApp::Draw(const GameTimer& gt) {
 	mCurrentBackBuffer = (mCurrentBackBuffer + 1) % swapChainBufferCount;
 
 	FlushCommandQueue();
+	mClusteredLighting->ReleaseRetiredBuffers();
 }
 
-void SceneApp::DrawRenderItems(const GameTimer& gt, PipelineStateFlags pipelineStateFlags) {
-	// Render Itemе
-	for (auto& [textureFlags, itemList] : mScene.mRenderItems) {
-		// ôбRender ItemPSO
-		PipelineStateFlags flags = pipelineStateFlags | textureFlags;
-
-		// ܵŻ
-		//if (flags & ShadowMapping) {
-		//	flags = pipelineStateFlags;
-		//}
-
-		// ֻᱻһ
-		// ԷֹԤ׶ɹPSOͬʱֿԶ̬ؼģ
-		// TODO: ҲԽBuildPSOĹԴ߳
-		if (mPSOs.count(flags) == 0) {
-			BuildPSO(flags);
+void SceneApp::DrawRenderItems(const GameTimer& gt, PipelineStateFlags pipelineStateFlags, CullingView::Value view) {
+	// 绘制该视角中所有可见的物体，几何与材质相同的Render Item已合并为一次实例化绘制
+	// 绘制列表按排序键排列，PSO、顶点格式、Index Buffer与Primitive Topology只在改变时重新设置
+	const MeshManager& meshManager = mScene.GetMeshManager();
+	bool hasPipelineState = false;
+	PipelineStateFlags boundFlags = 0;
+	DXGI_FORMAT boundIndexFormat = DXGI_FORMAT_UNKNOWN;
+	D3D_PRIMITIVE_TOPOLOGY boundTopology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+
+	for (const InstancedDraw& draw : mScene.mViews[view].Draws) {
+		const RenderItem& item = draw.Item;
+
+		// 设置此Render Item所需的PSO
+		PipelineStateFlags flags = pipelineStateFlags | draw.Type;
+		if (!hasPipelineState || flags != boundFlags) {
+			// 以下语句只会被调用一次
+			// 这样可以防止预处理阶段生成过多的PSO，同时又可以动态地加载模型
+			// TODO: 或者也可以将BuildPSO的工作交给资源加载线程
+			if (mPSOs.count(flags) == 0) {
+				BuildPSO(flags);
+			}
+			mCommandList->SetPipelineState(mPSOs[flags].Get());
+			mPipelineStateChanges++;
+
+			// 顶点格式随PSO确定，几何Arena只在PSO改变时重新绑定
+			bool compactVertices = (draw.Type & TextureType::CompactVertex) != 0;
+			D3D12_VERTEX_BUFFER_VIEW vbvs[] = { meshManager.PositionBufferView(compactVertices), meshManager.AttributeBufferView(compactVertices) };
+			mCommandList->IASetVertexBuffers(0, UsesPositionStreamOnly(flags) ? 1 : 2, vbvs);
+
+			hasPipelineState = true;
+			boundFlags = flags;
 		}
-		mCommandList->SetPipelineState(mPSOs[flags].Get());
-
-		// б
-		UINT objCBByteSize = mScene.mObjectCBGPU->GetElementSizeInBytes();
-		auto objCB = mScene.mObjectCBGPU->Resource();
-		for (int itemIndex = 0; itemIndex < itemList.size(); ++itemIndex) {
-			RenderItem& item = itemList[itemIndex];
-			// Vertex BufferIndex BufferPrimitive Topology
-			D3D12_VERTEX_BUFFER_VIEW vbv = mScene.mMeshes[item.MeshIndex].VertexBufferView();
-			mCommandList->IASetVertexBuffers(0, 1, &vbv);
-			D3D12_INDEX_BUFFER_VIEW ibv = mScene.mMeshes[item.MeshIndex].IndexBufferView();
+
+		if (item.IndexFormat != boundIndexFormat) {
+			D3D12_INDEX_BUFFER_VIEW ibv = meshManager.IndexBufferView(item.IndexFormat);
 			mCommandList->IASetIndexBuffer(&ibv);
+			boundIndexFormat = item.IndexFormat;
+		}
+		if (item.PrimitiveTopology != boundTopology) {
 			mCommandList->IASetPrimitiveTopology(item.PrimitiveTopology);
+			boundTopology = item.PrimitiveTopology;
+		}
 
-			// Դ
-			// Constant Buffer
-			D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objCB->GetGPUVirtualAddress() + item.RenderItemIndex * objCBByteSize;
-			mCommandList->SetGraphicsRootConstantBufferView(RootSignatureParameter::PerObjectCB, objCBAddress);
+		// 绑定资源
+		// 实例在实例列表中的起始位置，SV_InstanceID不包含StartInstanceLocation
+		mCommandList->SetGraphicsRoot32BitConstant(RootSignatureParameter::DrawConstants, draw.InstanceBase, 0);
 
-			// ƣ
-			mCommandList->DrawIndexedInstanced(item.NumIndices, 1, item.StartIndexLocation, item.BaseVertexLocation, 0);
-		}
+		// 绘制！
+		mCommandList->DrawIndexedInstanced(item.NumIndices, draw.InstanceCount, item.StartIndexLocation, item.BaseVertexLocation, 0);
+		mTrianglesDrawn += item.NumIndices / 3 * draw.InstanceCount;
+		mDrawCalls++;
+		mInstancesDrawn += draw.InstanceCount;
 	}
 }
 
@@ -787,6 +865,85 @@ void SceneApp::DrawUI() {
 	ImGui::Text("Settings:");
 	ImGui::Checkbox("Wire Frame", &mIsWireFrame);
 	ImGui::Checkbox("4X MSAA", &mMsaaState);
+	ImGui::SliderFloat("LOD Error (px)", &mScene.mLODErrorThreshold, 0.25f, 8.0f);
+
+	ImGui::Text("Triangles: %u", mTrianglesDrawn);
+	ImGui::Text("Draw Calls: %u (%u instances), %u PSO changes", mDrawCalls, mInstancesDrawn, mPipelineStateChanges);
+	ImGui::Text("Uploads: %llu bytes/frame (%llu render item)", mUploadedBytes, mScene.mUploadedBytes);
+	ImGui::Text("Transforms: %u updated in %.3f ms", mScene.mTransformsUpdated, mScene.mTransformUpdateMs);
+
+	// 各视角的视锥剔除结果
+	const ViewDrawList& mainView = mScene.mViews[CullingView::Main];
+	const ViewDrawList& shadowView = mScene.mViews[CullingView::Shadow];
+	ImGui::Text("Camera Culling: %u visible, %u culled (%.3f ms)", mainView.VisibleItems, mainView.CulledItems, mainView.CullMs);
+	ImGui::Text("Shadow Culling: %u visible, %u culled (%.3f ms)", shadowView.VisibleItems, shadowView.CulledItems, shadowView.CullMs);
+	ImGui::Text("Draw Sorting: camera %.3f ms, shadow %.3f ms", mainView.SortMs, shadowView.SortMs);
+	ImGui::Checkbox("Octree Culling", &mScene.mUseOctreeCulling);
+	ImGui::Text("Octree: %zu items in %zu nodes", mScene.mOctree.ItemCount(), mScene.mOctree.NodeCount());
+	// 以当前摄像机的视锥比较八叉树与逐个测试，结果输出到调试窗口
+	if (ImGui::Button("Benchmark Culling")) {
+		FrustumPlanes frustum = FrustumCulling::ExtractPlanes(XMMatrixMultiply(mCamera.ViewMatrix(), mCamera.ProjectionMatrix()));
+		mScene.mOctree.Benchmark(frustum);
+	}
+
+	// 摄像机视角的软件遮挡剔除，被遮挡的数量包括在Camera Culling的culled中
+	ImGui::Checkbox("Occlusion Culling", &mScene.mUseOcclusionCulling);
+	ImGui::SliderFloat("Occlusion Budget (ms)", &mScene.mOcclusionBudgetMs, 0.1f, 4.0f);
+	int maxOccluders = static_cast<int>(mScene.mMaxOccluders);
+	if (ImGui::SliderInt("Max Occluders", &maxOccluders, 1, 64)) {
+		mScene.mMaxOccluders = static_cast<UINT>(maxOccluders);
+	}
+	const UINT frustumVisible = mainView.VisibleItems + mainView.OccludedItems;
+	ImGui::Text("Occlusion: %u occluded (%.1f%%), %u occluders, %.3f ms", mainView.OccludedItems,
+		frustumVisible > 0 ? 100.0f * mainView.OccludedItems / frustumVisible : 0.0f, mainView.OccluderCount, mainView.OcclusionMs);
+
+	// 分簇光照: 光源索引的总数即所有像素最多需要计算的光源数之和的上界
+	ImGui::Text("Clustered Lights: %u lights, %u indices (max %u per cluster), %.3f ms",
+		mClusteredLighting->LightCount(), mClusteredLighting->mLightIndexCount, mClusteredLighting->mMaxClusterLights, mClusteredLighting->mUpdateMs);
+	ImGui::Text("Light buffers: %u lights, %u indices capacity, %u growths",
+		mClusteredLighting->LightCapacity(), mClusteredLighting->LightIndexCapacity(), mClusteredLighting->mCapacityGrowths);
+	if (mClusteredLighting->mDroppedIndices > 0) {
+		ImGui::Text("Light indices over the limit (%u): %u dropped", ClusteredLighting::MaxLightIndices, mClusteredLighting->mDroppedIndices);
+	}
+	// 在摄像机周围随机放置点光源，用于观察大量光源时的开销
+	if (ImGui::Button("Add 1024 Point Lights")) {
+		static std::mt19937 rng(1);
+		std::uniform_real_distribution<float> offset(-30.0f, 30.0f);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		const XMFLOAT3 center = mCamera.CartesianPos();
+		for (UINT i = 0; i < 1024; ++i) {
+			PointLight light = {};
+			light.Position = { center.x + offset(rng), center.y + 0.25f * offset(rng), center.z + offset(rng) };
+			light.Strength = { 0.2f * unit(rng), 0.2f * unit(rng), 0.2f * unit(rng) };
+			light.AttenuationRange = 1.0f + 3.0f * unit(rng);
+			mClusteredLighting->AddPointLight(light);
+		}
+	}
+
+	// 几何Arena的占用与碎片情况
+	if (ImGui::CollapsingHeader("Geometry Arenas")) {
+		const MeshManager& meshManager = mScene.GetMeshManager();
+		auto ArenaText = [](const char* label, const GeometryArenaStats& stats) {
+			ImGui::Text("%s: %.1f / %.1f MB, %llu free blocks, largest %.1f MB, fragmentation %.1f%%",
+				label, stats.UsedInBytes / 1048576.0, stats.CapacityInBytes / 1048576.0,
+				stats.FreeBlockCount, stats.LargestFreeBlockInBytes / 1048576.0, 100.0f * stats.Fragmentation());
+		};
+		ArenaText("Vertices", meshManager.VertexArenaStats(false));
+		ArenaText("Compact Vertices", meshManager.VertexArenaStats(true));
+		ArenaText("Indices", meshManager.IndexArenaStats());
+	}
+
+	// GPU侧Buffer与SRV Heap的容量，RenderItemIndex不回收，已分配的数量即最高水位
+	if (ImGui::CollapsingHeader("Scene Capacity")) {
+		size_t liveItems = 0;
+		for (const auto& [type, itemList] : mScene.mRenderItems) {
+			liveItems += itemList.size();
+		}
+		ImGui::Text("Render Items: %u / %u (%zu live)", mScene.mRenderItemNum, mScene.mItemCapacity, liveItems);
+		ImGui::Text("Materials: %zu / %u", mScene.mMaterials.size(), mScene.mMaterialCapacity);
+		ImGui::Text("SRV Descriptors: %u / %u (%u textures)", mSrvHeap->UsedCount(), mSrvHeap->Capacity(), mScene.mTextureNum);
+		ImGui::Text("Growths: %u buffer, %u descriptor heap", mScene.mCapacityGrowths, mSrvHeap->GrowthCount());
+	}
 
 	// Show Current Position
 	XMFLOAT3 cameraPos = mCamera.CartesianPos();
@@ -802,7 +959,7 @@ void SceneApp::DrawShadowMap(const GameTimer& gt) {
 	mCommandList->RSSetViewports(1, &viewPort);
 	mCommandList->RSSetScissorRects(1, &scissorRect);
 
-	// ShadowMap״̬ת
+	// ShadowMap状态转换
 	// ShadowMap: PIXEL_SHADER_RESOURCE -> DEPTH_WRITE
 	D3D12_RESOURCE_BARRIER barrier1 = CD3DX12_RESOURCE_BARRIER::Transition(
 		mShadowMap->Resource(),
@@ -811,7 +968,7 @@ void SceneApp::DrawShadowMap(const GameTimer& gt) {
 	);
 	mCommandList->ResourceBarrier(1, &barrier1);
 
-	// ShadowMap
+	// 清空ShadowMap
 	mCommandList->ClearDepthStencilView(
 		mShadowMap->DsvHandle(),
 		D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL,
@@ -821,17 +978,17 @@ void SceneApp::DrawShadowMap(const GameTimer& gt) {
 		nullptr
 	);
 
-	// Render TargetΪ0
+	// 将Render Target设置为0
 	D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = mShadowMap->DsvHandle();
 	mCommandList->OMSetRenderTargets(0, nullptr, false, &dsvHandle);
 
-	// Root Signature Parameter
+	// 绑定Root Signature Parameter
 	D3D12_GPU_VIRTUAL_ADDRESS passCBAdress = mPassCBGPU->GetBufferPointer() + mPassCBGPU->GetElementSizeInBytes();
 	mCommandList->SetGraphicsRootConstantBufferView(1, passCBAdress);
 
-	// Pipeline State Flags
+	// 设置Pipeline State Flags
 	PipelineStateFlags pipelineStateFlags = ShadowMapping;
-	DrawRenderItems(gt, pipelineStateFlags);
+	DrawRenderItems(gt, pipelineStateFlags, CullingView::Shadow);
 
 
 	// ShadowMap: DEPTH_WRITE -> PIXEL_SHADER_RESOURCE
@@ -851,25 +1008,26 @@ void SceneApp::DrawEnvironmentMap(const GameTimer& gt, PipelineStateFlags pipeli
 		BuildPSO(flags);
 	}
 	mCommandList->SetPipelineState(mPSOs[flags].Get());
-
-	UINT objCBByteSIze = mScene.mObjectCBGPU->GetElementSizeInBytes();
-	auto objCB = mScene.mObjectCBGPU->Resource();
+	mPipelineStateChanges++;
 
 	RenderItem& skySphere = mScene.mSkySphere;
-	// Vertex BufferIndex BufferPrimitive Topology
-	D3D12_VERTEX_BUFFER_VIEW vbv = mScene.mMeshes[skySphere.MeshIndex].VertexBufferView();
+	// 设置Vertex Buffer、Index Buffer、Primitive Topology
+	const MeshManager& meshManager = mScene.GetMeshManager();
+	D3D12_VERTEX_BUFFER_VIEW vbv = meshManager.PositionBufferView(false);
 	mCommandList->IASetVertexBuffers(0, 1, &vbv);
-	D3D12_INDEX_BUFFER_VIEW ibv = mScene.mMeshes[skySphere.MeshIndex].IndexBufferView();
+	D3D12_INDEX_BUFFER_VIEW ibv = meshManager.IndexBufferView(skySphere.IndexFormat);
 	mCommandList->IASetIndexBuffer(&ibv);
 	mCommandList->IASetPrimitiveTopology(skySphere.PrimitiveTopology);
 
-	// Դ
-	// Constant Buffer
-	D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objCB->GetGPUVirtualAddress() + skySphere.RenderItemIndex * objCBByteSIze;
-	mCommandList->SetGraphicsRootConstantBufferView(0, objCBAddress);
+	// 绑定资源
+	// 天空球位于实例列表的末尾
+	mCommandList->SetGraphicsRoot32BitConstant(RootSignatureParameter::DrawConstants, mScene.mSkyInstanceBase, 0);
 
-	// ƣ
+	// 绘制！
 	mCommandList->DrawIndexedInstanced(skySphere.NumIndices, 1, skySphere.StartIndexLocation, skySphere.BaseVertexLocation, 0);
+	mTrianglesDrawn += skySphere.NumIndices / 3;
+	mDrawCalls++;
+	mInstancesDrawn++;
 }
 
 void SceneApp::OnMouseDown(WPARAM btnState, int x, int y) {
@@ -884,7 +1042,7 @@ void SceneApp::OnMouseUp(WPARAM btnState, int x, int y) {
 }
 
 void SceneApp::OnMouseMove(WPARAM btnState, int x, int y) {
-	// ת
+	// 左键旋转
 	if ((btnState & MK_LBUTTON) != 0) {
 		float rotScale = 0.25f;
 		float dTheta = XMConvertToRadians(rotScale * static_cast<float>(y - mLastMousePos.y));
@@ -893,7 +1051,7 @@ void SceneApp::OnMouseMove(WPARAM btnState, int x, int y) {
 		mCamera.Pitch(dTheta);
 		mCamera.Yaw(dPhi);
 	}
-	// Ҽ
+	// 右键放缩
 	else if ((btnState & MK_RBUTTON) != 0) {
 		//float magScale = 0.005f;
 		//float dx = magScale * static_cast<float>(x - mLastMousePos.x);
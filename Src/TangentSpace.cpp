@@ -0,0 +1,165 @@
+#include "TangentSpace.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+using namespace DirectX;
+
+void TangentSpace::GenerateNormals(VertexPositionNormalTangentTexture* vertices, size_t vertexCount, const UINT* indices, size_t indexCount) {
+	// 先记录需要生成法线的顶点，累加过程中法线不再为零
+	std::vector<bool> missing(vertexCount);
+	bool anyMissing = false;
+	for (size_t i = 0; i < vertexCount; ++i) {
+		const XMFLOAT3& n = vertices[i].normal;
+		missing[i] = n.x == 0.0f && n.y == 0.0f && n.z == 0.0f;
+		anyMissing |= missing[i];
+	}
+
+	// 叉积的长度即为面积的两倍
+	for (size_t t = 0; anyMissing && t + 2 < indexCount; t += 3) {
+		XMVECTOR p0 = XMLoadFloat3(&vertices[indices[t]].position);
+		XMVECTOR e1 = XMLoadFloat3(&vertices[indices[t + 1]].position) - p0;
+		XMVECTOR e2 = XMLoadFloat3(&vertices[indices[t + 2]].position) - p0;
+		XMVECTOR faceNormal = XMVector3Cross(e1, e2);
+
+		for (UINT k = 0; k < 3; ++k) {
+			UINT index = indices[t + k];
+			if (missing[index]) {
+				XMStoreFloat3(&vertices[index].normal, XMLoadFloat3(&vertices[index].normal) + faceNormal);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < vertexCount; ++i) {
+		XMVECTOR n = XMLoadFloat3(&vertices[i].normal);
+		if (XMVectorGetX(XMVector3LengthSq(n)) > 1e-20f) {
+			XMStoreFloat3(&vertices[i].normal, XMVector3Normalize(n));
+		}
+	}
+}
+
+void TangentSpace::GenerateTangents(VertexPositionNormalTangentTexture* vertices, size_t vertexCount, UINT* indices, size_t indexCount,
+	std::vector<VertexPositionNormalTangentTexture>& splitVertices) {
+	const size_t triangleCount = indexCount / 3;
+
+	// 1. 每个角的贡献: 三角形的Tangent投影到该顶点法线的切平面上，以角在切平面上的张角为权重
+	// orientation记录纹理坐标的绕向，0表示纹理坐标退化，不参与平均
+	std::vector<XMFLOAT3> cornerTangents(3 * triangleCount);
+	std::vector<INT8> orientations(triangleCount);
+
+	ThreadPool::Get().ParallelFor(triangleCount, 16 * 1024, [&](size_t begin, size_t end) {
+		for (size_t t = begin; t < end; ++t) {
+			const UINT* triangle = indices + 3 * t;
+			const VertexPositionNormalTangentTexture& v0 = vertices[triangle[0]];
+			const VertexPositionNormalTangentTexture& v1 = vertices[triangle[1]];
+			const VertexPositionNormalTangentTexture& v2 = vertices[triangle[2]];
+
+			float du1 = v1.textureCoordinate.x - v0.textureCoordinate.x;
+			float dv1 = v1.textureCoordinate.y - v0.textureCoordinate.y;
+			float du2 = v2.textureCoordinate.x - v0.textureCoordinate.x;
+			float dv2 = v2.textureCoordinate.y - v0.textureCoordinate.y;
+			float signedArea = du1 * dv2 - du2 * dv1;
+
+			XMVECTOR p[3] = { XMLoadFloat3(&v0.position), XMLoadFloat3(&v1.position), XMLoadFloat3(&v2.position) };
+			XMVECTOR faceTangent = (p[1] - p[0]) * dv2 - (p[2] - p[0]) * dv1;
+			float lengthSq = XMVectorGetX(XMVector3LengthSq(faceTangent));
+			if (std::fabs(signedArea) < 1e-20f || lengthSq < 1e-30f) {
+				orientations[t] = 0;
+				continue;
+			}
+
+			// 与MikkTSpace相同，先归一化，使每个三角形的方向权重只取决于张角而与大小无关
+			orientations[t] = signedArea > 0.0f ? 1 : -1;
+			faceTangent = faceTangent * ((signedArea > 0.0f ? 1.0f : -1.0f) / std::sqrt(lengthSq));
+
+			for (UINT k = 0; k < 3; ++k) {
+				XMVECTOR n = XMLoadFloat3(&vertices[triangle[k]].normal);
+				XMVECTOR tangent = faceTangent - n * XMVector3Dot(n, faceTangent);
+				XMVECTOR edge1 = p[(k + 1) % 3] - p[k];
+				XMVECTOR edge2 = p[(k + 2) % 3] - p[k];
+				edge1 = edge1 - n * XMVector3Dot(n, edge1);
+				edge2 = edge2 - n * XMVector3Dot(n, edge2);
+
+				float weight = 0.0f;
+				if (XMVectorGetX(XMVector3LengthSq(edge1)) > 1e-30f && XMVectorGetX(XMVector3LengthSq(edge2)) > 1e-30f) {
+					float cosine = XMVectorGetX(XMVector3Dot(XMVector3Normalize(edge1), XMVector3Normalize(edge2)));
+					weight = std::acos((std::max)(-1.0f, (std::min)(1.0f, cosine)));
+				}
+				if (XMVectorGetX(XMVector3LengthSq(tangent)) > 1e-30f) {
+					tangent = XMVector3Normalize(tangent) * weight;
+				}
+				XMStoreFloat3(&cornerTangents[3 * t + k], tangent);
+			}
+		}
+	});
+
+	// 2. 按顶点与纹理坐标绕向分组累加，两种绕向在同一顶点相遇(纹理镜像的接缝)时分为两组
+	struct TangentGroups {
+		XMFLOAT3 Sum[2];
+		UINT CornerCount[2];
+	};
+	std::vector<TangentGroups> groups(vertexCount, TangentGroups{ { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f) }, { 0, 0 } });
+	for (size_t t = 0; t < triangleCount; ++t) {
+		if (orientations[t] == 0) {
+			continue;
+		}
+		const UINT group = orientations[t] > 0 ? 0 : 1;
+		for (UINT k = 0; k < 3; ++k) {
+			TangentGroups& vertexGroups = groups[indices[3 * t + k]];
+			XMStoreFloat3(&vertexGroups.Sum[group], XMLoadFloat3(&vertexGroups.Sum[group]) + XMLoadFloat3(&cornerTangents[3 * t + k]));
+			vertexGroups.CornerCount[group]++;
+		}
+	}
+
+	// 3. 顶点格式中没有副切线的符号，两组都存在时拆分顶点: 角较多的一组保留原顶点，另一组使用新顶点
+	// splitIndex[i]为顶点i的另一组对应的新Index，未拆分时为UINT_MAX
+	std::vector<UINT> splitIndex(vertexCount, UINT_MAX);
+	std::vector<UINT8> keptGroup(vertexCount, 0);
+	const size_t splitBase = splitVertices.size();
+	for (size_t i = 0; i < vertexCount; ++i) {
+		const TangentGroups& vertexGroups = groups[i];
+		keptGroup[i] = vertexGroups.CornerCount[1] > vertexGroups.CornerCount[0] ? 1 : 0;
+		if (vertexGroups.CornerCount[0] > 0 && vertexGroups.CornerCount[1] > 0) {
+			splitIndex[i] = static_cast<UINT>(vertexCount + splitVertices.size() - splitBase);
+			splitVertices.push_back(vertices[i]);
+		}
+	}
+
+	if (splitVertices.size() > splitBase) {
+		for (size_t t = 0; t < triangleCount; ++t) {
+			if (orientations[t] == 0) {
+				continue;
+			}
+			const UINT group = orientations[t] > 0 ? 0 : 1;
+			for (UINT k = 0; k < 3; ++k) {
+				UINT& index = indices[3 * t + k];
+				if (splitIndex[index] != UINT_MAX && keptGroup[index] != group) {
+					index = splitIndex[index];
+				}
+			}
+		}
+	}
+
+	// 4. 归一化，纹理坐标退化的顶点任取一个与法线垂直的方向
+	auto resolve = [](VertexPositionNormalTangentTexture& vertex, const XMFLOAT3& sum) {
+		XMVECTOR n = XMLoadFloat3(&vertex.normal);
+		XMVECTOR t = XMLoadFloat3(&sum);
+		t = t - n * XMVector3Dot(n, t);
+		if (XMVectorGetX(XMVector3LengthSq(t)) < 1e-20f) {
+			XMVECTOR axis = std::fabs(vertex.normal.x) < 0.9f ? XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+			t = axis - n * XMVector3Dot(n, axis);
+		}
+		XMStoreFloat3(&vertex.tangent, XMVector3Normalize(t));
+	};
+
+	ThreadPool::Get().ParallelFor(vertexCount, 16 * 1024, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			resolve(vertices[i], groups[i].Sum[keptGroup[i]]);
+			if (splitIndex[i] != UINT_MAX) {
+				resolve(splitVertices[splitBase + splitIndex[i] - vertexCount], groups[i].Sum[1 - keptGroup[i]]);
+			}
+		}
+	});
+}
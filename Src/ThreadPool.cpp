@@ -0,0 +1,121 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace {
+	// 一次ParallelFor的共享状态
+	// 排队中的任务可能在ParallelFor返回之后才开始执行，因此以shared_ptr持有
+	struct ParallelForState {
+		std::function<void(size_t, size_t)> Func;
+		size_t Count = 0;
+		size_t ChunkSize = 0;
+		size_t ChunkCount = 0;
+
+		std::atomic<size_t> NextChunk{ 0 };
+		std::atomic<size_t> CompletedChunks{ 0 };
+
+		std::mutex Mutex;
+		std::condition_variable Finished;
+
+		// 不断领取区间直至全部被领取
+		void Run() {
+			size_t chunk;
+			while ((chunk = NextChunk.fetch_add(1)) < ChunkCount) {
+				size_t begin = chunk * ChunkSize;
+				size_t end = (std::min)(begin + ChunkSize, Count);
+				Func(begin, end);
+
+				if (CompletedChunks.fetch_add(1) + 1 == ChunkCount) {
+					std::lock_guard<std::mutex> lock(Mutex);
+					Finished.notify_all();
+				}
+			}
+		}
+	};
+}
+
+ThreadPool::ThreadPool(UINT workerCount) {
+	mWorkers.reserve(workerCount);
+	for (UINT i = 0; i < workerCount; ++i) {
+		mWorkers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mCondition.notify_all();
+
+	for (std::thread& worker : mWorkers) {
+		worker.join();
+	}
+}
+
+ThreadPool& ThreadPool::Get() {
+	static ThreadPool pool;
+	return pool;
+}
+
+UINT ThreadPool::DefaultWorkerCount() {
+	UINT hardwareThreads = std::thread::hardware_concurrency();
+	return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+}
+
+UINT ThreadPool::ThreadCount() const {
+	return static_cast<UINT>(mWorkers.size()) + 1;
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& func) {
+	if (count == 0) {
+		return;
+	}
+
+	// 区间数取线程数的数倍，以平衡各区间耗时不均的情况
+	grainSize = (std::max)(grainSize, size_t(1));
+	size_t chunkCount = (std::min)((count + grainSize - 1) / grainSize, size_t(ThreadCount()) * 4);
+	if (chunkCount <= 1 || mWorkers.empty()) {
+		func(0, count);
+		return;
+	}
+
+	auto state = std::make_shared<ParallelForState>();
+	state->Func = func;
+	state->Count = count;
+	state->ChunkSize = (count + chunkCount - 1) / chunkCount;
+	state->ChunkCount = (count + state->ChunkSize - 1) / state->ChunkSize;
+
+	size_t helperCount = (std::min)(mWorkers.size(), state->ChunkCount - 1);
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		for (size_t i = 0; i < helperCount; ++i) {
+			mTasks.emplace_back([state]() { state->Run(); });
+		}
+	}
+	mCondition.notify_all();
+
+	state->Run();
+
+	// 其余线程领取的区间可能仍在执行
+	std::unique_lock<std::mutex> lock(state->Mutex);
+	state->Finished.wait(lock, [&state]() { return state->CompletedChunks.load() == state->ChunkCount; });
+}
+
+void ThreadPool::WorkerLoop() {
+	for (;;) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mCondition.wait(lock, [this]() { return mStopping || !mTasks.empty(); });
+			if (mStopping && mTasks.empty()) {
+				return;
+			}
+
+			task = std::move(mTasks.front());
+			mTasks.pop_front();
+		}
+
+		task();
+	}
+}
@@ -0,0 +1,183 @@
+#include "TransformArray.h"
+
+#include <intrin.h>
+#include <immintrin.h>
+
+using namespace DirectX;
+
+void TransformArray::Resize(size_t count) {
+	mScaleX.resize(count, 1.0f);
+	mScaleY.resize(count, 1.0f);
+	mScaleZ.resize(count, 1.0f);
+	mRotationX.resize(count, 0.0f);
+	mRotationY.resize(count, 0.0f);
+	mRotationZ.resize(count, 0.0f);
+	mRotationW.resize(count, 1.0f);
+	mTranslationX.resize(count, 0.0f);
+	mTranslationY.resize(count, 0.0f);
+	mTranslationZ.resize(count, 0.0f);
+}
+
+void TransformArray::Set(size_t i, const XMFLOAT3& scale, const XMFLOAT4& rotation, const XMFLOAT3& translation) {
+	mScaleX[i] = scale.x;
+	mScaleY[i] = scale.y;
+	mScaleZ[i] = scale.z;
+	mRotationX[i] = rotation.x;
+	mRotationY[i] = rotation.y;
+	mRotationZ[i] = rotation.z;
+	mRotationW[i] = rotation.w;
+	mTranslationX[i] = translation.x;
+	mTranslationY[i] = translation.y;
+	mTranslationZ[i] = translation.z;
+}
+
+bool TransformArray::SupportsAVX2() {
+	static const bool supported = [] {
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) {
+			return false;
+		}
+
+		// AVX与OSXSAVE，且操作系统在线程切换时保存YMM寄存器
+		__cpuid(info, 1);
+		if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) {
+			return false;
+		}
+		if ((_xgetbv(0) & 0x6) != 0x6) {
+			return false;
+		}
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+	}();
+	return supported;
+}
+
+void TransformArray::ComputeMatrices(const UINT* indices, size_t count, XMFLOAT4X4* matrices) const {
+	if (SupportsAVX2()) {
+		ComputeMatricesAVX2(indices, count, matrices);
+		return;
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		ComputeMatrix(indices[i], matrices[i]);
+	}
+}
+
+void TransformArray::ComputeMatrix(UINT index, XMFLOAT4X4& matrix) const {
+	// 与XMMatrixScaling * XMMatrixRotationQuaternion * XMMatrixTranslation相同，只是省去了两次矩阵乘法
+	XMMATRIX rotation = XMMatrixRotationQuaternion(XMVectorSet(mRotationX[index], mRotationY[index], mRotationZ[index], mRotationW[index]));
+	rotation.r[0] = XMVectorScale(rotation.r[0], mScaleX[index]);
+	rotation.r[1] = XMVectorScale(rotation.r[1], mScaleY[index]);
+	rotation.r[2] = XMVectorScale(rotation.r[2], mScaleZ[index]);
+	rotation.r[3] = XMVectorSet(mTranslationX[index], mTranslationY[index], mTranslationZ[index], 1.0f);
+	XMStoreFloat4x4(&matrix, rotation);
+}
+
+namespace {
+	// 4个8通道向量的转置: 第k个输出的低128位为各输入的第k个元素，高128位为第k + 4个
+	inline void Transpose4x8(__m256 a, __m256 b, __m256 c, __m256 d, __m256 out[4]) {
+		__m256 t0 = _mm256_unpacklo_ps(a, b);
+		__m256 t1 = _mm256_unpackhi_ps(a, b);
+		__m256 t2 = _mm256_unpacklo_ps(c, d);
+		__m256 t3 = _mm256_unpackhi_ps(c, d);
+		out[0] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+		out[1] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+		out[2] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+		out[3] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+	}
+
+	// 写出8个矩阵的第row行，rows由Transpose4x8得到
+	inline void StoreRow(XMFLOAT4X4* matrices, size_t row, const __m256 rows[4]) {
+		for (size_t k = 0; k < 4; ++k) {
+			_mm_storeu_ps(&matrices[k].m[row][0], _mm256_castps256_ps128(rows[k]));
+			_mm_storeu_ps(&matrices[k + 4].m[row][0], _mm256_extractf128_ps(rows[k], 1));
+		}
+	}
+}
+
+void TransformArray::ComputeMatricesAVX2(const UINT* indices, size_t count, XMFLOAT4X4* matrices) const {
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 two = _mm256_set1_ps(2.0f);
+	const __m256i laneOffsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		// 8个Index恰为first, first + 1, ..., first + 7时(大批量的动画物体)直接读取，否则使用Gather
+		// 逐通道比较，未排序或有重复的Index即使首尾之差为7也不会被当作连续
+		__m256 sx, sy, sz, qx, qy, qz, qw, tx, ty, tz;
+		const __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + i));
+		const __m256i contiguous = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(indices[i])), laneOffsets);
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(index, contiguous)) == -1) {
+			const size_t first = indices[i];
+			sx = _mm256_loadu_ps(&mScaleX[first]);
+			sy = _mm256_loadu_ps(&mScaleY[first]);
+			sz = _mm256_loadu_ps(&mScaleZ[first]);
+			qx = _mm256_loadu_ps(&mRotationX[first]);
+			qy = _mm256_loadu_ps(&mRotationY[first]);
+			qz = _mm256_loadu_ps(&mRotationZ[first]);
+			qw = _mm256_loadu_ps(&mRotationW[first]);
+			tx = _mm256_loadu_ps(&mTranslationX[first]);
+			ty = _mm256_loadu_ps(&mTranslationY[first]);
+			tz = _mm256_loadu_ps(&mTranslationZ[first]);
+		}
+		else {
+			sx = _mm256_i32gather_ps(mScaleX.data(), index, 4);
+			sy = _mm256_i32gather_ps(mScaleY.data(), index, 4);
+			sz = _mm256_i32gather_ps(mScaleZ.data(), index, 4);
+			qx = _mm256_i32gather_ps(mRotationX.data(), index, 4);
+			qy = _mm256_i32gather_ps(mRotationY.data(), index, 4);
+			qz = _mm256_i32gather_ps(mRotationZ.data(), index, 4);
+			qw = _mm256_i32gather_ps(mRotationW.data(), index, 4);
+			tx = _mm256_i32gather_ps(mTranslationX.data(), index, 4);
+			ty = _mm256_i32gather_ps(mTranslationY.data(), index, 4);
+			tz = _mm256_i32gather_ps(mTranslationZ.data(), index, 4);
+		}
+
+		// 四元数到旋转矩阵，与XMMatrixRotationQuaternion的结果一致(行向量约定)
+		__m256 x2 = _mm256_mul_ps(qx, two);
+		__m256 y2 = _mm256_mul_ps(qy, two);
+		__m256 z2 = _mm256_mul_ps(qz, two);
+		__m256 xx = _mm256_mul_ps(qx, x2);
+		__m256 yy = _mm256_mul_ps(qy, y2);
+		__m256 zz = _mm256_mul_ps(qz, z2);
+		__m256 xy = _mm256_mul_ps(qx, y2);
+		__m256 xz = _mm256_mul_ps(qx, z2);
+		__m256 yz = _mm256_mul_ps(qy, z2);
+		__m256 wx = _mm256_mul_ps(qw, x2);
+		__m256 wy = _mm256_mul_ps(qw, y2);
+		__m256 wz = _mm256_mul_ps(qw, z2);
+
+		// 每行乘以对应轴的缩放，转置为8个矩阵的行后写出
+		__m256 rows[4];
+		Transpose4x8(
+			_mm256_mul_ps(sx, _mm256_sub_ps(one, _mm256_add_ps(yy, zz))),
+			_mm256_mul_ps(sx, _mm256_add_ps(xy, wz)),
+			_mm256_mul_ps(sx, _mm256_sub_ps(xz, wy)),
+			zero, rows);
+		StoreRow(matrices + i, 0, rows);
+
+		Transpose4x8(
+			_mm256_mul_ps(sy, _mm256_sub_ps(xy, wz)),
+			_mm256_mul_ps(sy, _mm256_sub_ps(one, _mm256_add_ps(xx, zz))),
+			_mm256_mul_ps(sy, _mm256_add_ps(yz, wx)),
+			zero, rows);
+		StoreRow(matrices + i, 1, rows);
+
+		Transpose4x8(
+			_mm256_mul_ps(sz, _mm256_add_ps(xz, wy)),
+			_mm256_mul_ps(sz, _mm256_sub_ps(yz, wx)),
+			_mm256_mul_ps(sz, _mm256_sub_ps(one, _mm256_add_ps(xx, yy))),
+			zero, rows);
+		StoreRow(matrices + i, 2, rows);
+
+		Transpose4x8(tx, ty, tz, one, rows);
+		StoreRow(matrices + i, 3, rows);
+	}
+
+	for (; i < count; ++i) {
+		ComputeMatrix(indices[i], matrices[i]);
+	}
+}
@@ -1,16 +1,19 @@
 #include "Util.h"
 
+#include <cstdarg>
+#include <cstdio>
+
 void Util::UploadResource(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList,
 	const void* initData, UINT64 byteSize,
 	ComPtr<ID3D12Resource>& defaultBuffer,
 	ComPtr<ID3D12Resource>& uploadBuffer) {
 
-	// Դز
+	// 资源创建相关参数
 	D3D12_HEAP_PROPERTIES defaultHeapProp = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
 	D3D12_HEAP_PROPERTIES uploadHeapProp = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
 	D3D12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
 
-	// Default BufferԴ
+	// 创建Default Buffer资源
 	ThrowIfFailed(device->CreateCommittedResource(
 		&defaultHeapProp,
 		D3D12_HEAP_FLAG_NONE,
@@ -20,7 +23,7 @@ void Util::UploadResource(ID3D12Device* device, ID3D12GraphicsCommandList* cmdLi
 		IID_PPV_ARGS(defaultBuffer.GetAddressOf())
 	));
 
-	// Upload BufferԴ
+	// 创建Upload Buffer资源
 	ThrowIfFailed(device->CreateCommittedResource(
 		&uploadHeapProp,
 		D3D12_HEAP_FLAG_NONE,
@@ -30,14 +33,14 @@ void Util::UploadResource(ID3D12Device* device, ID3D12GraphicsCommandList* cmdLi
 		IID_PPV_ARGS(uploadBuffer.GetAddressOf())
 	));
 
-	// Դ
+	// 描述待拷贝的资源
 	D3D12_SUBRESOURCE_DATA subResourceData;
 	subResourceData.pData = initData;
 	subResourceData.RowPitch = byteSize;
 	subResourceData.SlicePitch = subResourceData.RowPitch;
 
-	// Upload BufferΪнԴϴ
-	// һҪDefault Buffer״̬ת
+	// 利用Upload Buffer作为中介进行资源上传
+	// 这一过程中需要对Default Buffer的状态做转换
 	D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
 		defaultBuffer.Get(),
 		D3D12_RESOURCE_STATE_COMMON,
@@ -60,6 +63,29 @@ void Util::UploadResource(ID3D12Device* device, ID3D12GraphicsCommandList* cmdLi
 }
 
 
+void Util::CreateUploadBuffer(ID3D12Device* device,
+	const void* initData, UINT64 byteSize,
+	ComPtr<ID3D12Resource>& uploadBuffer) {
+
+	D3D12_HEAP_PROPERTIES uploadHeapProp = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	D3D12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
+
+	ThrowIfFailed(device->CreateCommittedResource(
+		&uploadHeapProp,
+		D3D12_HEAP_FLAG_NONE,
+		&bufferDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(uploadBuffer.GetAddressOf())
+	));
+
+	void* mappedData = nullptr;
+	CD3DX12_RANGE readRange(0, 0);
+	ThrowIfFailed(uploadBuffer->Map(0, &readRange, &mappedData));
+	memcpy(mappedData, initData, byteSize);
+	uploadBuffer->Unmap(0, nullptr);
+}
+
 void Util::UploadTexture2DResource(
 	ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, 
 	const ScratchImage* scratchImage,
@@ -68,13 +94,13 @@ void Util::UploadTexture2DResource(
 	// Metadata
 	TexMetadata metadata = scratchImage->GetMetadata();
 
-	// Դز
+	// 资源创建相关参数
 	D3D12_HEAP_PROPERTIES defaultHeapProp = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
 	D3D12_HEAP_PROPERTIES uploadHeapProp = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
 
 	D3D12_RESOURCE_DESC textureDesc = 
 		CD3DX12_RESOURCE_DESC::Tex2D(metadata.format, metadata.width, metadata.height, metadata.arraySize, metadata.mipLevels);
-	// Default BufferԴ
+	// 创建Default Buffer资源
 	ThrowIfFailed(device->CreateCommittedResource(
 		&defaultHeapProp,
 		D3D12_HEAP_FLAG_NONE,
@@ -84,10 +110,10 @@ void Util::UploadTexture2DResource(
 		IID_PPV_ARGS(defaultBuffer.GetAddressOf())
 	));
 
-	// Upload Buffer
+	// 用于Upload Buffer
 	const UINT64 uploadBufferSize = GetRequiredIntermediateSize(defaultBuffer.Get(), 0, metadata.mipLevels);
 	D3D12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize);
-	// Upload BufferԴ
+	// 创建Upload Buffer资源
 	ThrowIfFailed(device->CreateCommittedResource(
 		&uploadHeapProp,
 		D3D12_HEAP_FLAG_NONE,
@@ -97,7 +123,7 @@ void Util::UploadTexture2DResource(
 		IID_PPV_ARGS(uploadBuffer.GetAddressOf())
 	));
 
-	// Դ
+	// 描述待拷贝的资源
 	//D3D12_SUBRESOURCE_DATA subResourceData;
 	//const Image* image = scratchImage->GetImage(0, 0, 0);
 	//subResourceData.pData = image->pixels;
@@ -111,8 +137,8 @@ void Util::UploadTexture2DResource(
 		subResourceDatas[mipLevel].SlicePitch = image->slicePitch;
 	}
 
-	// Upload BufferΪнԴϴ
-	// һҪDefault Buffer״̬ת
+	// 利用Upload Buffer作为中介进行资源上传
+	// 这一过程中需要对Default Buffer的状态做转换
 	D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
 		defaultBuffer.Get(),
 		D3D12_RESOURCE_STATE_COMMON,
@@ -132,7 +158,7 @@ void Util::UploadTexture2DResource(
 	D3D12_RESOURCE_BARRIER barrier2 = CD3DX12_RESOURCE_BARRIER::Transition(
 		defaultBuffer.Get(),
 		D3D12_RESOURCE_STATE_COPY_DEST,
-		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE // ӦResource State
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE // 纹理对应的Resource State
 	);
 	cmdList->ResourceBarrier(1, &barrier2);
 }
@@ -144,13 +170,13 @@ void Util::UploadTextureCubeResource(ID3D12Device* device, ID3D12GraphicsCommand
 	// Metadata
 	TexMetadata metadata = scratchImage->GetMetadata();
 
-	// Դز
+	// 资源创建相关参数
 	D3D12_HEAP_PROPERTIES defaultHeapProp = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
 	D3D12_HEAP_PROPERTIES uploadHeapProp = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
 
-	// DepthOrArraySizeΪ6
+	// DepthOrArraySize设置为6
 	D3D12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(metadata.format, metadata.width, metadata.height, metadata.arraySize, 1);
-	// Default BufferԴ
+	// 创建Default Buffer资源
 	ThrowIfFailed(device->CreateCommittedResource(
 		&defaultHeapProp,
 		D3D12_HEAP_FLAG_NONE,
@@ -160,10 +186,10 @@ void Util::UploadTextureCubeResource(ID3D12Device* device, ID3D12GraphicsCommand
 		IID_PPV_ARGS(defaultBuffer.GetAddressOf())
 	));
 
-	// UploadBufferĻС
+	// 计算UploadBuffer所需的缓冲区大小
 	const UINT64 uploadBufferSize = GetRequiredIntermediateSize(defaultBuffer.Get(), 0, 6);
 	D3D12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize);
-	// Upload BufferԴ
+	// 创建Upload Buffer资源
 	ThrowIfFailed(device->CreateCommittedResource(
 		&uploadHeapProp,
 		D3D12_HEAP_FLAG_NONE,
@@ -173,8 +199,8 @@ void Util::UploadTextureCubeResource(ID3D12Device* device, ID3D12GraphicsCommand
 		IID_PPV_ARGS(uploadBuffer.GetAddressOf())
 	));
 
-	// Upload BufferΪнԴϴ
-	// һҪDefault Buffer״̬ת
+	// 利用Upload Buffer作为中介进行资源上传
+	// 这一过程中需要对Default Buffer的状态做转换
 	D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
 		defaultBuffer.Get(),
 		D3D12_RESOURCE_STATE_COMMON,
@@ -182,7 +208,7 @@ void Util::UploadTextureCubeResource(ID3D12Device* device, ID3D12GraphicsCommand
 	);
 	cmdList->ResourceBarrier(1, &barrier);
 
-	// Դ
+	// 描述待拷贝的资源
 	std::array<D3D12_SUBRESOURCE_DATA, 6> subResourceDatas;
 	for (int i = 0; i < 6; ++i) {
 		const Image* image = scratchImage->GetImage(0, i, 0);
@@ -203,7 +229,7 @@ void Util::UploadTextureCubeResource(ID3D12Device* device, ID3D12GraphicsCommand
 	D3D12_RESOURCE_BARRIER barrier2 = CD3DX12_RESOURCE_BARRIER::Transition(
 		defaultBuffer.Get(),
 		D3D12_RESOURCE_STATE_COPY_DEST,
-		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE // ӦResource State
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE // 纹理对应的Resource State
 	);
 	cmdList->ResourceBarrier(1, &barrier2);
 
@@ -225,3 +251,30 @@ void Util::AllocateUAVBuffer(ID3D12Device* device, ID3D12GraphicsCommandList* cm
 		IID_PPV_ARGS(&defaultBuffer)
 	));
 }
+
+void Util::DebugLog(const char* format, ...) {
+	char buffer[1024];
+
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+
+	OutputDebugStringA(buffer);
+}
+
+INT64 Util::QueryTimestamp() {
+	INT64 timestamp;
+	QueryPerformanceCounter((LARGE_INTEGER*)&timestamp);
+	return timestamp;
+}
+
+double Util::MillisecondsSince(INT64 timestamp) {
+	// 频率在系统启动时确定，之后不会改变；局部静态变量的初始化是线程安全的
+	static const double millisecondsPerCount = [] {
+		INT64 countsPerSec;
+		QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
+		return 1000.0 / countsPerSec;
+	}();
+	return (QueryTimestamp() - timestamp) * millisecondsPerCount;
+}
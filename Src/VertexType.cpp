@@ -1,5 +1,8 @@
 #include "VertexType.h"
 
+#include <algorithm>
+#include <cmath>
+
 const D3D12_INPUT_ELEMENT_DESC VertexPositionNormalTangentTexture::InputElements[] =
 {
     { "SV_Position",    0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
@@ -14,4 +17,175 @@ const D3D12_INPUT_LAYOUT_DESC VertexPositionNormalTangentTexture::InputLayout =
 {
     VertexPositionNormalTangentTexture::InputElements,
     VertexPositionNormalTangentTexture::InputElementCount
-};
\ No newline at end of file
+};
+
+const D3D12_INPUT_ELEMENT_DESC VertexPositionNormalTangentTexture::SplitInputElements[] =
+{
+    { "SV_Position",    0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "NORMAL",         0, DXGI_FORMAT_R32G32B32_FLOAT,    1, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "TANGENT",        0, DXGI_FORMAT_R32G32B32_FLOAT,    1, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "TEXCOORD",       0, DXGI_FORMAT_R32G32_FLOAT,       1, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+};
+
+const D3D12_INPUT_LAYOUT_DESC VertexPositionNormalTangentTexture::SplitInputLayout =
+{
+    VertexPositionNormalTangentTexture::SplitInputElements,
+    VertexPositionNormalTangentTexture::InputElementCount
+};
+
+const D3D12_INPUT_LAYOUT_DESC VertexPositionNormalTangentTexture::PositionOnlyInputLayout =
+{
+    VertexPositionNormalTangentTexture::SplitInputElements,
+    1
+};
+
+
+const D3D12_INPUT_ELEMENT_DESC VertexPositionNormalTangentTextureCompact::InputElements[] =
+{
+    { "SV_Position",    0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "NORMAL",         0, DXGI_FORMAT_R16G16_SNORM,       0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "TANGENT",        0, DXGI_FORMAT_R16G16_SNORM,       0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "TEXCOORD",       0, DXGI_FORMAT_R16G16_FLOAT,       0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+};
+
+static_assert(sizeof(VertexPositionNormalTangentTextureCompact) == 20, "Vertex struct/layout mismatch");
+
+const D3D12_INPUT_LAYOUT_DESC VertexPositionNormalTangentTextureCompact::InputLayout =
+{
+    VertexPositionNormalTangentTextureCompact::InputElements,
+    VertexPositionNormalTangentTextureCompact::InputElementCount
+};
+
+const D3D12_INPUT_ELEMENT_DESC VertexPositionNormalTangentTextureCompact::SplitInputElements[] =
+{
+    { "SV_Position",    0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "NORMAL",         0, DXGI_FORMAT_R16G16_SNORM,       1, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "TANGENT",        0, DXGI_FORMAT_R16G16_SNORM,       1, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "TEXCOORD",       0, DXGI_FORMAT_R16G16_FLOAT,       1, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+};
+
+const D3D12_INPUT_LAYOUT_DESC VertexPositionNormalTangentTextureCompact::SplitInputLayout =
+{
+    VertexPositionNormalTangentTextureCompact::SplitInputElements,
+    VertexPositionNormalTangentTextureCompact::InputElementCount
+};
+
+const D3D12_INPUT_LAYOUT_DESC VertexPositionNormalTangentTextureCompact::PositionOnlyInputLayout =
+{
+    VertexPositionNormalTangentTextureCompact::SplitInputElements,
+    1
+};
+
+PositionQuantization PositionQuantization::FromBounds(const DirectX::BoundingBox& bounds) {
+    PositionQuantization quantization;
+
+    // UNORM解码后的范围为[0, 1]
+    quantization.Scale = DirectX::XMFLOAT3(2.0f * bounds.Extents.x, 2.0f * bounds.Extents.y, 2.0f * bounds.Extents.z);
+    quantization.Offset = DirectX::XMFLOAT3(
+        bounds.Center.x - bounds.Extents.x,
+        bounds.Center.y - bounds.Extents.y,
+        bounds.Center.z - bounds.Extents.z);
+
+    return quantization;
+}
+
+DirectX::XMFLOAT2 VertexPositionNormalTangentTextureCompact::OctahedralEncode(const DirectX::XMFLOAT3& direction) {
+    // 投影到八面体 |x| + |y| + |z| = 1 上
+    // 长度为0或含NaN/无穷大的方向(缺失或损坏的Normal/Tangent)统一编码为(0, 0)，解码为+Z
+    float l1Norm = std::fabs(direction.x) + std::fabs(direction.y) + std::fabs(direction.z);
+    if (!(l1Norm > 0.0f) || !std::isfinite(l1Norm)) {
+        return DirectX::XMFLOAT2(0.0f, 0.0f);
+    }
+
+    float x = direction.x / l1Norm;
+    float y = direction.y / l1Norm;
+
+    // 下半球沿对角线翻折到外侧的四个三角形
+    if (direction.z < 0.0f) {
+        float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+
+    return DirectX::XMFLOAT2(x, y);
+}
+
+DirectX::XMFLOAT3 VertexPositionNormalTangentTextureCompact::OctahedralDecode(const DirectX::XMFLOAT2& encoded) {
+    DirectX::XMFLOAT3 direction(encoded.x, encoded.y, 1.0f - std::fabs(encoded.x) - std::fabs(encoded.y));
+
+    float t = direction.z < 0.0f ? -direction.z : 0.0f;
+    direction.x += direction.x >= 0.0f ? -t : t;
+    direction.y += direction.y >= 0.0f ? -t : t;
+
+    DirectX::XMStoreFloat3(&direction, DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&direction)));
+    return direction;
+}
+
+float VertexPositionNormalTangentTextureCompact::PositionErrorBound(float scale, float offset) {
+    return 0.5f * scale / 65535.0f + 1e-6f * (std::fabs(offset) + scale);
+}
+
+float VertexPositionNormalTangentTextureCompact::DirectionErrorBound() {
+    // 八面体坐标各有半个16位SNORM步长的误差，展开与归一化至多将其放大3倍
+    return 3.0f * std::sqrt(2.0f) * 0.5f / 32767.0f + 1e-6f;
+}
+
+float VertexPositionNormalTangentTextureCompact::TexCoordErrorBound(float value) {
+    // 非规格化数的步长固定为2^-24
+    return (std::max)(std::fabs(value) * 0x1p-11f, 0x1p-25f);
+}
+
+VertexPositionNormalTangentTextureCompact VertexPositionNormalTangentTextureCompact::Encode(
+    const VertexPositionNormalTangentTexture& vertex,
+    const PositionQuantization& quantization) {
+    using namespace DirectX;
+    using namespace DirectX::PackedVector;
+
+    VertexPositionNormalTangentTextureCompact ret;
+
+    // 包围盒在某一维度上退化时，该维度的量化结果恒为0
+    auto Normalize = [](float value, float offset, float scale) {
+        return scale > 0.0f ? (value - offset) / scale : 0.0f;
+    };
+    XMVECTOR position = XMVectorSet(
+        Normalize(vertex.position.x, quantization.Offset.x, quantization.Scale.x),
+        Normalize(vertex.position.y, quantization.Offset.y, quantization.Scale.y),
+        Normalize(vertex.position.z, quantization.Offset.z, quantization.Scale.z),
+        0.0f);
+    XMStoreUShortN4(&ret.position, XMVectorSaturate(position));
+
+    XMFLOAT2 normal = OctahedralEncode(vertex.normal);
+    XMFLOAT2 tangent = OctahedralEncode(vertex.tangent);
+    XMStoreShortN2(&ret.normal, XMLoadFloat2(&normal));
+    XMStoreShortN2(&ret.tangent, XMLoadFloat2(&tangent));
+
+    XMStoreHalf2(&ret.textureCoordinate, XMLoadFloat2(&vertex.textureCoordinate));
+
+    return ret;
+}
+
+VertexPositionNormalTangentTexture VertexPositionNormalTangentTextureCompact::Decode(
+    const VertexPositionNormalTangentTextureCompact& vertex,
+    const PositionQuantization& quantization) {
+    using namespace DirectX;
+    using namespace DirectX::PackedVector;
+
+    VertexPositionNormalTangentTexture ret;
+
+    XMVECTOR position = XMVectorMultiplyAdd(
+        XMLoadUShortN4(&vertex.position),
+        XMLoadFloat3(&quantization.Scale),
+        XMLoadFloat3(&quantization.Offset));
+    XMStoreFloat3(&ret.position, position);
+
+    XMFLOAT2 normal, tangent;
+    XMStoreFloat2(&normal, XMLoadShortN2(&vertex.normal));
+    XMStoreFloat2(&tangent, XMLoadShortN2(&vertex.tangent));
+    ret.normal = OctahedralDecode(normal);
+    ret.tangent = OctahedralDecode(tangent);
+
+    XMStoreFloat2(&ret.textureCoordinate, XMLoadHalf2(&vertex.textureCoordinate));
+
+    return ret;
+}
@@ -0,0 +1,246 @@
+// VertexPositionNormalTangentTextureCompact编码-解码往返误差的单元测试，只依赖Src/VertexType.cpp，不需要D3D12设备
+// 误差上界与导入时的检查(Mesh::EncodeCompactVertices)共用CompactVertex::*ErrorBound
+#include "VertexType.h"
+#include "../TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+	using Vertex = VertexPositionNormalTangentTexture;
+	using CompactVertex = VertexPositionNormalTangentTextureCompact;
+
+	Vertex RoundTrip(const Vertex& vertex, const PositionQuantization& quantization) {
+		return CompactVertex::Decode(CompactVertex::Encode(vertex, quantization), quantization);
+	}
+
+	Vertex MakeVertex(const XMFLOAT3& position, const XMFLOAT3& normal, const XMFLOAT3& tangent, const XMFLOAT2& uv) {
+		return Vertex(position, normal, tangent, uv);
+	}
+
+	float Length(const XMFLOAT3& v) {
+		return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+	}
+
+	// 解码结果与原方向(归一化后)之差的长度，先除以最大分量，避免平方时上溢或下溢
+	float DirectionError(const XMFLOAT3& decoded, const XMFLOAT3& original) {
+		float maxComponent = (std::max)({ std::fabs(original.x), std::fabs(original.y), std::fabs(original.z) });
+		XMFLOAT3 scaled(original.x / maxComponent, original.y / maxComponent, original.z / maxComponent);
+		float length = Length(scaled);
+		XMFLOAT3 d(decoded.x - scaled.x / length, decoded.y - scaled.y / length, decoded.z - scaled.z / length);
+		return Length(d);
+	}
+
+	bool IsFiniteUnit(const XMFLOAT3& v) {
+		return std::isfinite(v.x) && std::isfinite(v.y) && std::isfinite(v.z) && std::fabs(Length(v) - 1.0f) < 1e-5f;
+	}
+
+	void CheckDirection(const XMFLOAT3& direction) {
+		Vertex decoded = RoundTrip(MakeVertex(XMFLOAT3(0, 0, 0), direction, direction, XMFLOAT2(0, 0)), PositionQuantization());
+		float error = DirectionError(decoded.normal, direction);
+		CHECK(error <= CompactVertex::DirectionErrorBound(), "direction (%g, %g, %g): error %g > bound %g",
+			direction.x, direction.y, direction.z, error, CompactVertex::DirectionErrorBound());
+		CHECK(IsFiniteUnit(decoded.normal), "direction (%g, %g, %g) decoded to (%g, %g, %g)",
+			direction.x, direction.y, direction.z, decoded.normal.x, decoded.normal.y, decoded.normal.z);
+		CHECK(decoded.tangent.x == decoded.normal.x && decoded.tangent.y == decoded.normal.y && decoded.tangent.z == decoded.normal.z,
+			"normal and tangent encode differently");
+	}
+
+	// 坐标轴方向，包括各分量为±0的组合
+	void TestAxisAligned() {
+		const float zeros[] = { 0.0f, -0.0f };
+		for (float a : zeros) {
+			for (float b : zeros) {
+				for (float one : { 1.0f, -1.0f }) {
+					CheckDirection(XMFLOAT3(one, a, b));
+					CheckDirection(XMFLOAT3(a, one, b));
+					CheckDirection(XMFLOAT3(a, b, one));
+				}
+			}
+		}
+
+		// 坐标轴方向在八面体的顶点上，应精确往返
+		Vertex decoded = RoundTrip(MakeVertex(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, -1), XMFLOAT3(-1, 0, 0), XMFLOAT2(0, 0)), PositionQuantization());
+		CHECK(decoded.normal.x == 0.0f && decoded.normal.y == 0.0f && decoded.normal.z == -1.0f,
+			"-Z decoded to (%g, %g, %g)", decoded.normal.x, decoded.normal.y, decoded.normal.z);
+		CHECK(decoded.tangent.x == -1.0f && decoded.tangent.y == 0.0f && decoded.tangent.z == 0.0f,
+			"-X decoded to (%g, %g, %g)", decoded.tangent.x, decoded.tangent.y, decoded.tangent.z);
+	}
+
+	// 两极附近(下半球翻折的中心与八面体的四个角)与赤道、翻折的对角线附近
+	void TestNearSingularities() {
+		const float epsilons[] = { 1e-7f, 1e-5f, 1e-3f };
+		for (float e : epsilons) {
+			for (float sx : { 1.0f, -1.0f }) {
+				for (float sy : { 1.0f, -1.0f }) {
+					CheckDirection(XMFLOAT3(sx * e, sy * e, 1.0f));
+					CheckDirection(XMFLOAT3(sx * e, sy * e, -1.0f));
+					CheckDirection(XMFLOAT3(sx, sy, e));
+					CheckDirection(XMFLOAT3(sx, sy, -e));
+					CheckDirection(XMFLOAT3(sx, sy * e, -e));
+					CheckDirection(XMFLOAT3(sx * e, sy, -e));
+				}
+			}
+		}
+
+		// 未归一化的输入
+		CheckDirection(XMFLOAT3(1e-20f, 0.0f, -3e-20f));
+		CheckDirection(XMFLOAT3(1e20f, -2e20f, 5e19f));
+	}
+
+	void TestRandomDirections() {
+		std::mt19937 rng(7);
+		std::normal_distribution<float> gaussian;
+		float maxError = 0.0f;
+		for (int i = 0; i < 200000; ++i) {
+			XMFLOAT3 direction(gaussian(rng), gaussian(rng), gaussian(rng));
+			if (Length(direction) < 1e-3f) {
+				continue;
+			}
+			Vertex decoded = RoundTrip(MakeVertex(XMFLOAT3(0, 0, 0), direction, direction, XMFLOAT2(0, 0)), PositionQuantization());
+			float error = DirectionError(decoded.normal, direction);
+			maxError = (std::max)(maxError, error);
+		}
+		CHECK(maxError <= CompactVertex::DirectionErrorBound(), "max random direction error %g > bound %g",
+			maxError, CompactVertex::DirectionErrorBound());
+		std::printf("random directions: max error %.3e (bound %.3e)\n", maxError, CompactVertex::DirectionErrorBound());
+	}
+
+	// 长度为0、含NaN或无穷大的方向统一解码为+Z，不会把NaN带入着色
+	void TestDegenerateDirections() {
+		const float nan = std::numeric_limits<float>::quiet_NaN();
+		const float inf = std::numeric_limits<float>::infinity();
+		const XMFLOAT3 directions[] = {
+			XMFLOAT3(0.0f, 0.0f, 0.0f),
+			XMFLOAT3(-0.0f, -0.0f, -0.0f),
+			XMFLOAT3(nan, 0.0f, -1.0f),
+			XMFLOAT3(nan, nan, nan),
+			XMFLOAT3(inf, 0.0f, 0.0f),
+			XMFLOAT3(-inf, inf, -1.0f),
+		};
+		for (const XMFLOAT3& direction : directions) {
+			Vertex decoded = RoundTrip(MakeVertex(XMFLOAT3(0, 0, 0), direction, direction, XMFLOAT2(0, 0)), PositionQuantization());
+			CHECK(decoded.normal.x == 0.0f && decoded.normal.y == 0.0f && decoded.normal.z == 1.0f,
+				"direction (%g, %g, %g) decoded to (%g, %g, %g), expected +Z",
+				direction.x, direction.y, direction.z, decoded.normal.x, decoded.normal.y, decoded.normal.z);
+		}
+
+		// 非规格化数的分量仍是有效的方向
+		const float denormal = std::numeric_limits<float>::denorm_min();
+		CheckDirection(XMFLOAT3(denormal, 0.0f, -denormal));
+		CheckDirection(XMFLOAT3(-denormal, denormal, 0.0f));
+	}
+
+	void CheckPositions(const BoundingBox& bounds, const char* name) {
+		PositionQuantization quantization = PositionQuantization::FromBounds(bounds);
+		const float* center = &bounds.Center.x;
+		const float* extents = &bounds.Extents.x;
+		const float* scale = &quantization.Scale.x;
+		const float* offset = &quantization.Offset.x;
+
+		// 包围盒的8个角、中心与内部的随机点
+		std::vector<XMFLOAT3> positions;
+		for (int corner = 0; corner < 8; ++corner) {
+			positions.push_back(XMFLOAT3(
+				center[0] + (corner & 1 ? extents[0] : -extents[0]),
+				center[1] + (corner & 2 ? extents[1] : -extents[1]),
+				center[2] + (corner & 4 ? extents[2] : -extents[2])));
+		}
+		positions.push_back(bounds.Center);
+		std::mt19937 rng(11);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		for (int i = 0; i < 10000; ++i) {
+			positions.push_back(XMFLOAT3(
+				center[0] + unit(rng) * extents[0],
+				center[1] + unit(rng) * extents[1],
+				center[2] + unit(rng) * extents[2]));
+		}
+
+		for (const XMFLOAT3& position : positions) {
+			Vertex decoded = RoundTrip(MakeVertex(position, XMFLOAT3(0, 0, 1), XMFLOAT3(1, 0, 0), XMFLOAT2(0, 0)), quantization);
+			for (int axis = 0; axis < 3; ++axis) {
+				float error = std::fabs((&decoded.position.x)[axis] - (&position.x)[axis]);
+				float bound = CompactVertex::PositionErrorBound(scale[axis], offset[axis]);
+				CHECK(error <= bound, "%s: axis %d value %g decoded to %g, error %g > bound %g",
+					name, axis, (&position.x)[axis], (&decoded.position.x)[axis], error, bound);
+			}
+		}
+
+		// 超出包围盒的坐标被钳制到边界上
+		XMFLOAT3 outside(center[0] + 2.0f * extents[0] + 1.0f, center[1] - 2.0f * extents[1] - 1.0f, center[2]);
+		Vertex decoded = RoundTrip(MakeVertex(outside, XMFLOAT3(0, 0, 1), XMFLOAT3(1, 0, 0), XMFLOAT2(0, 0)), quantization);
+		CHECK(std::fabs(decoded.position.x - (offset[0] + scale[0])) <= CompactVertex::PositionErrorBound(scale[0], offset[0]),
+			"%s: x above bounds decoded to %g", name, decoded.position.x);
+		CHECK(std::fabs(decoded.position.y - offset[1]) <= CompactVertex::PositionErrorBound(scale[1], offset[1]),
+			"%s: y below bounds decoded to %g", name, decoded.position.y);
+	}
+
+	void TestPositions() {
+		CheckPositions(BoundingBox(XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1)), "unit");
+		CheckPositions(BoundingBox(XMFLOAT3(-3, 5, 7), XMFLOAT3(0.5f, 20.0f, 1e-3f)), "anisotropic");
+		// 远离原点的大范围与小范围: 单精度本身的舍入误差占主导
+		CheckPositions(BoundingBox(XMFLOAT3(1e6f, -2e6f, 5e5f), XMFLOAT3(1e5f, 1e5f, 1e5f)), "large offset, large range");
+		CheckPositions(BoundingBox(XMFLOAT3(1e4f, -1e4f, 1e4f), XMFLOAT3(1e-3f, 1e-3f, 1e-3f)), "large offset, tiny range");
+		CheckPositions(BoundingBox(XMFLOAT3(0, 0, 0), XMFLOAT3(1e30f, 1e30f, 1e30f)), "huge range");
+		CheckPositions(BoundingBox(XMFLOAT3(0, 0, 0), XMFLOAT3(1e-30f, 1e-30f, 1e-30f)), "tiny range");
+		// 退化为平面的包围盒: 该维度的Scale为0，解码结果恒为Offset
+		CheckPositions(BoundingBox(XMFLOAT3(1, 2, 3), XMFLOAT3(4, 0, 4)), "flat");
+	}
+
+	void CheckTexCoord(float value) {
+		Vertex decoded = RoundTrip(MakeVertex(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 1), XMFLOAT3(1, 0, 0), XMFLOAT2(value, -value)), PositionQuantization());
+		float bound = CompactVertex::TexCoordErrorBound(value);
+		float errorU = std::fabs(decoded.textureCoordinate.x - value);
+		float errorV = std::fabs(decoded.textureCoordinate.y + value);
+		CHECK(errorU <= bound && errorV <= bound, "uv %g decoded to (%g, %g), bound %g",
+			value, decoded.textureCoordinate.x, decoded.textureCoordinate.y, bound);
+	}
+
+	void TestTexCoords() {
+		const float values[] = {
+			0.0f, -0.0f, 1.0f, 0.5f, 0.1f, 1.0f / 3.0f, 17.25f, 1024.3f, 4096.7f,
+			// 半精度的非规格化数与最小规格化数附近
+			1e-7f, 3e-8f, 0x1p-24f, 0x1p-14f, 6.1e-5f,
+			// 最大有限值65504，以及仍会舍入到65504的值
+			65504.0f, 65519.0f,
+		};
+		for (float value : values) {
+			CheckTexCoord(value);
+		}
+
+		std::mt19937 rng(3);
+		std::uniform_real_distribution<float> range(-70000.0f, 70000.0f);
+		for (int i = 0; i < 100000; ++i) {
+			float value = range(rng);
+			if (std::fabs(value) < 65520.0f) {
+				CheckTexCoord(value);
+			}
+		}
+
+		// 超出半精度范围的UV溢出为无穷大，导入时作为超限计数并输出日志
+		for (float value : { 65520.0f, 1e6f, -1e6f }) {
+			Vertex decoded = RoundTrip(MakeVertex(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 1), XMFLOAT3(1, 0, 0), XMFLOAT2(value, 0)), PositionQuantization());
+			CHECK(std::isinf(decoded.textureCoordinate.x) && (decoded.textureCoordinate.x > 0) == (value > 0),
+				"uv %g decoded to %g, expected infinity", value, decoded.textureCoordinate.x);
+			CHECK(!(std::fabs(decoded.textureCoordinate.x - value) <= CompactVertex::TexCoordErrorBound(value)),
+				"uv %g overflow should exceed the error bound", value);
+		}
+	}
+}
+
+int main() {
+	TestAxisAligned();
+	TestNearSingularities();
+	TestRandomDirections();
+	TestDegenerateDirections();
+	TestPositions();
+	TestTexCoords();
+
+	return TestResult("CompactVertexTest");
+}
@@ -0,0 +1,228 @@
+// LooseOctree的单元测试: 视锥与球查询的结果与逐个测试所有AABB(PackedBoxArray::Cull)相同
+// 包括插入、移动、删除之后，以及最大深度MaxDepthLimit下落入最深一层的物体
+#include "LooseOctree.h"
+#include "FrustumCulling.h"
+#include "../TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+	const float kPi = 3.14159265f;
+
+	struct TestScene {
+		XMFLOAT3 Center;
+		float HalfSize;
+		std::vector<BoundingBox> Boxes;
+		std::vector<bool> Present;
+	};
+
+	std::vector<FrustumPlanes> MakeFrusta(const XMFLOAT3& center, float distance) {
+		std::vector<FrustumPlanes> frusta;
+		const float nearZ[] = { 0.1f, 0.1f * distance };
+		for (int i = 0; i < 8; ++i) {
+			float angle = 2.0f * kPi * i / 8;
+			XMVECTOR target = XMLoadFloat3(&center);
+			XMVECTOR eye = target + XMVectorSet(distance * std::cos(angle), 0.3f * distance * (i % 3 - 1), distance * std::sin(angle), 0.0f);
+			// 一半相机朝向中心，一半朝向外侧，视锥只覆盖部分物体
+			if (i % 2 == 1) {
+				target = eye + (eye - target);
+			}
+			XMMATRIX view = XMMatrixLookAtLH(eye, target, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+			XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f * kPi * (1 + i % 3), 16.0f / 9.0f, nearZ[i % 2], 2.0f * distance);
+			frusta.push_back(FrustumCulling::ExtractPlanes(view * proj));
+		}
+		return frusta;
+	}
+
+	float DistanceSquared(const XMFLOAT3& point, const BoundingBox& box) {
+		float dx = (std::max)(std::fabs(point.x - box.Center.x) - box.Extents.x, 0.0f);
+		float dy = (std::max)(std::fabs(point.y - box.Center.y) - box.Extents.y, 0.0f);
+		float dz = (std::max)(std::fabs(point.z - box.Center.z) - box.Extents.z, 0.0f);
+		return dx * dx + dy * dy + dz * dz;
+	}
+
+	// 八叉树的查询结果与逐个测试的结果逐项比较
+	void CheckQueries(const LooseOctree& octree, const TestScene& scene, const char* name) {
+		const size_t count = scene.Boxes.size();
+		PackedBoxArray packed;
+		packed.Resize(count);
+		for (size_t i = 0; i < count; ++i) {
+			packed.Set(i, scene.Boxes[i]);
+		}
+
+		std::vector<UINT8> visible(count);
+		std::vector<UINT8> found(count);
+		std::vector<UINT> results;
+		for (const FrustumPlanes& frustum : MakeFrusta(scene.Center, 1.5f * scene.HalfSize)) {
+			packed.Cull(frustum, 0, count, visible.data());
+			results.clear();
+			octree.QueryFrustum(frustum, results);
+
+			std::fill(found.begin(), found.end(), UINT8(0));
+			bool duplicate = false;
+			for (UINT id : results) {
+				duplicate = duplicate || found[id] != 0;
+				found[id] = 1;
+			}
+			CHECK(!duplicate, "%s: frustum query returned an id twice", name);
+
+			size_t mismatches = 0, expected = 0;
+			for (size_t i = 0; i < count; ++i) {
+				bool shouldBeFound = scene.Present[i] && visible[i] != 0;
+				expected += shouldBeFound;
+				mismatches += shouldBeFound != (found[i] != 0);
+			}
+			CHECK(mismatches == 0, "%s: frustum query differs from PackedBoxArray::Cull for %zu of %zu items (%zu expected, %zu returned)",
+				name, mismatches, count, expected, results.size());
+		}
+
+		std::mt19937 rng(5);
+		std::uniform_real_distribution<float> offset(-scene.HalfSize, scene.HalfSize);
+		std::uniform_real_distribution<float> radius(0.0f, 0.3f * scene.HalfSize);
+		for (int s = 0; s < 16; ++s) {
+			BoundingSphere sphere(XMFLOAT3(scene.Center.x + offset(rng), scene.Center.y + offset(rng), scene.Center.z + offset(rng)), radius(rng));
+			results.clear();
+			octree.QuerySphere(sphere, results);
+
+			std::fill(found.begin(), found.end(), UINT8(0));
+			for (UINT id : results) {
+				found[id] = 1;
+			}
+			size_t mismatches = 0;
+			for (size_t i = 0; i < count; ++i) {
+				bool shouldBeFound = scene.Present[i] && DistanceSquared(sphere.Center, scene.Boxes[i]) <= sphere.Radius * sphere.Radius;
+				mismatches += shouldBeFound != (found[i] != 0);
+			}
+			CHECK(mismatches == 0, "%s: sphere query differs from brute force for %zu items", name, mismatches);
+		}
+	}
+
+	// 物体大小跨越多个数量级，少数位于根格子之外或大于根格子
+	TestScene MakeScene(size_t count, float minExtent, float maxExtent, UINT seed) {
+		TestScene scene;
+		scene.Center = XMFLOAT3(10.0f, -5.0f, 3.0f);
+		scene.HalfSize = 256.0f;
+		scene.Boxes.resize(count);
+		scene.Present.assign(count, true);
+
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> position(-1.1f * scene.HalfSize, 1.1f * scene.HalfSize);
+		std::uniform_real_distribution<float> logExtent(std::log(minExtent), std::log(maxExtent));
+		for (size_t i = 0; i < count; ++i) {
+			BoundingBox& box = scene.Boxes[i];
+			box.Center = XMFLOAT3(scene.Center.x + position(rng), scene.Center.y + position(rng), scene.Center.z + position(rng));
+			box.Extents = XMFLOAT3(std::exp(logExtent(rng)), std::exp(logExtent(rng)), std::exp(logExtent(rng)));
+		}
+		return scene;
+	}
+
+	void TestInsertMoveRemove(UINT maxDepth) {
+		char name[64];
+		TestScene scene = MakeScene(20000, 0.01f, 300.0f, 1 + maxDepth);
+		LooseOctree octree(scene.Center, scene.HalfSize, maxDepth);
+		for (size_t i = 0; i < scene.Boxes.size(); ++i) {
+			octree.Insert(static_cast<UINT>(i), scene.Boxes[i]);
+		}
+		CHECK(octree.ItemCount() == scene.Boxes.size(), "item count %zu after inserting %zu", octree.ItemCount(), scene.Boxes.size());
+		std::snprintf(name, sizeof(name), "depth %u, inserted", maxDepth);
+		CheckQueries(octree, scene, name);
+
+		// 移动: 小幅移动多数仍在原节点中，大幅移动跨越节点或移出根格子
+		std::mt19937 rng(17);
+		std::uniform_real_distribution<float> small(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> large(-scene.HalfSize, scene.HalfSize);
+		for (size_t i = 0; i < scene.Boxes.size(); ++i) {
+			BoundingBox& box = scene.Boxes[i];
+			const float step = i % 4 == 0 ? large(rng) : small(rng);
+			box.Center.x += step;
+			box.Center.z -= step;
+			if (i % 7 == 0) {
+				box.Extents.y *= 4.0f;
+			}
+			octree.Update(static_cast<UINT>(i), box);
+		}
+		std::snprintf(name, sizeof(name), "depth %u, moved", maxDepth);
+		CheckQueries(octree, scene, name);
+
+		// 删除一半，再重新插入其中一部分；删除不存在的id没有影响
+		for (size_t i = 0; i < scene.Boxes.size(); i += 2) {
+			octree.Remove(static_cast<UINT>(i));
+			scene.Present[i] = false;
+		}
+		octree.Remove(static_cast<UINT>(scene.Boxes.size() + 100));
+		for (size_t i = 0; i < scene.Boxes.size(); i += 6) {
+			octree.Insert(static_cast<UINT>(i), scene.Boxes[i]);
+			scene.Present[i] = true;
+		}
+		size_t present = std::count(scene.Present.begin(), scene.Present.end(), true);
+		CHECK(octree.ItemCount() == present, "item count %zu, expected %zu", octree.ItemCount(), present);
+		std::snprintf(name, sizeof(name), "depth %u, removed", maxDepth);
+		CheckQueries(octree, scene, name);
+
+		// 全部删除后只剩根节点
+		for (size_t i = 0; i < scene.Boxes.size(); ++i) {
+			octree.Remove(static_cast<UINT>(i));
+		}
+		CHECK(octree.ItemCount() == 0 && octree.NodeCount() == 1, "after removing everything: %zu items, %zu nodes",
+			octree.ItemCount(), octree.NodeCount());
+	}
+
+	// 足够小的物体落入最深一层: 层号与格子坐标必须在节点键中各自可区分，
+	// 否则最深一层的节点会与根节点或其他层的节点共用键
+	void TestDeepestLevel() {
+		TestScene scene;
+		scene.Center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		scene.HalfSize = 1024.0f;
+		const float cellHalfSize = scene.HalfSize / static_cast<float>(1u << LooseOctree::MaxDepthLimit);
+
+		// 靠近根格子的各个角落与中心，最深一层格子坐标取到0与2^15 - 1
+		std::mt19937 rng(23);
+		std::uniform_real_distribution<float> jitter(0.0f, 1.0f);
+		const float anchors[] = { -scene.HalfSize, -0.5f * scene.HalfSize, 0.0f, 0.5f * scene.HalfSize, scene.HalfSize - 4.0f * cellHalfSize };
+		for (float ax : anchors) {
+			for (float ay : anchors) {
+				for (float az : anchors) {
+					for (int k = 0; k < 4; ++k) {
+						XMFLOAT3 center(ax + 4.0f * cellHalfSize * jitter(rng), ay + 4.0f * cellHalfSize * jitter(rng), az + 4.0f * cellHalfSize * jitter(rng));
+						scene.Boxes.push_back(BoundingBox(center, XMFLOAT3(0.2f * cellHalfSize, 0.3f * cellHalfSize, 0.1f * cellHalfSize)));
+					}
+				}
+			}
+		}
+		// 放在根节点的大物体
+		scene.Boxes.push_back(BoundingBox(scene.Center, XMFLOAT3(scene.HalfSize, scene.HalfSize, scene.HalfSize)));
+		scene.Present.assign(scene.Boxes.size(), true);
+
+		LooseOctree octree(scene.Center, scene.HalfSize, LooseOctree::MaxDepthLimit);
+		// 超过上限的深度被钳制
+		LooseOctree clamped(scene.Center, scene.HalfSize, LooseOctree::MaxDepthLimit + 5);
+		for (size_t i = 0; i < scene.Boxes.size(); ++i) {
+			octree.Insert(static_cast<UINT>(i), scene.Boxes[i]);
+			clamped.Insert(static_cast<UINT>(i), scene.Boxes[i]);
+		}
+		CHECK(octree.NodeCount() == clamped.NodeCount(), "depth clamp: %zu vs %zu nodes", octree.NodeCount(), clamped.NodeCount());
+		// 每个深层物体各自的祖先链共有MaxDepthLimit个非根节点，至少有这么多节点
+		CHECK(octree.NodeCount() > LooseOctree::MaxDepthLimit, "only %zu nodes for items at the deepest level", octree.NodeCount());
+		CheckQueries(octree, scene, "deepest level");
+
+		for (size_t i = 0; i + 1 < scene.Boxes.size(); ++i) {
+			octree.Remove(static_cast<UINT>(i));
+		}
+		CHECK(octree.ItemCount() == 1 && octree.NodeCount() == 1, "after removing deep items: %zu items, %zu nodes",
+			octree.ItemCount(), octree.NodeCount());
+	}
+}
+
+int main() {
+	TestInsertMoveRemove(5);
+	TestInsertMoveRemove(LooseOctree::MaxDepthLimit);
+	TestDeepestLevel();
+
+	return TestResult("LooseOctreeTest");
+}
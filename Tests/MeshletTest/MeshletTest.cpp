@@ -0,0 +1,268 @@
+// MeshletBuilder的单元测试与吞吐量测试，只依赖Src/Meshlet.cpp，不需要D3D12设备
+// 失败时返回非0，Release配置下同样检查(不使用assert)
+#include "Meshlet.h"
+#include "../TestCheck.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <tuple>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+	const float kPi = 3.14159265f;
+
+	struct TestMesh {
+		std::vector<XMFLOAT3> Positions;
+		std::vector<UINT> Indices;
+	};
+
+	// 单位UV球，从外部看为顺时针，即法线朝外
+	TestMesh MakeSphere(UINT rings, UINT segments) {
+		TestMesh mesh;
+		for (UINT i = 0; i <= rings; ++i) {
+			float theta = kPi * i / rings;
+			for (UINT j = 0; j <= segments; ++j) {
+				float phi = 2.0f * kPi * j / segments;
+				mesh.Positions.push_back(XMFLOAT3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+			}
+		}
+		for (UINT i = 0; i < rings; ++i) {
+			for (UINT j = 0; j < segments; ++j) {
+				UINT a = i * (segments + 1) + j;
+				UINT b = a + 1;
+				UINT c = a + segments + 1;
+				UINT d = c + 1;
+				mesh.Indices.insert(mesh.Indices.end(), { a, c, b, b, c, d });
+			}
+		}
+		return mesh;
+	}
+
+	// 打乱三角形的顺序: 相邻三角形几乎不共享顶点，每个Meshlet都会先触及顶点上限
+	void ShuffleTriangles(TestMesh& mesh, UINT seed) {
+		std::vector<std::tuple<UINT, UINT, UINT>> triangles;
+		for (size_t t = 0; t < mesh.Indices.size(); t += 3) {
+			triangles.emplace_back(mesh.Indices[t], mesh.Indices[t + 1], mesh.Indices[t + 2]);
+		}
+		std::shuffle(triangles.begin(), triangles.end(), std::mt19937(seed));
+		for (size_t t = 0; t < triangles.size(); ++t) {
+			std::tie(mesh.Indices[t * 3], mesh.Indices[t * 3 + 1], mesh.Indices[t * 3 + 2]) = triangles[t];
+		}
+	}
+
+	// 逐分量计算，与MeshletBuilder的实现相互独立
+	float Dot(const XMFLOAT3& a, const XMFLOAT3& b) {
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b) {
+		return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	XMFLOAT3 TriangleNormal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2) {
+		XMFLOAT3 a = Subtract(p1, p0);
+		XMFLOAT3 b = Subtract(p2, p0);
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	// 检查Meshlet表的结构、覆盖与包围体，cameras用于检查法线锥剔除是否保守
+	void Validate(const char* name, const TestMesh& mesh, const MeshletData& data, UINT meshletCount,
+		const std::vector<XMFLOAT3>& cameras) {
+		CHECK(meshletCount == data.Meshlets.size(), "%s", name);
+		CHECK(data.Bounds.size() == data.Meshlets.size(), "%s", name);
+
+		std::vector<std::tuple<UINT, UINT, UINT>> expected;
+		std::vector<std::tuple<UINT, UINT, UINT>> covered;
+		for (size_t t = 0; t < mesh.Indices.size(); t += 3) {
+			expected.emplace_back(mesh.Indices[t], mesh.Indices[t + 1], mesh.Indices[t + 2]);
+		}
+
+		UINT culled = 0;
+		for (UINT m = 0; m < data.Meshlets.size(); ++m) {
+			const Meshlet& meshlet = data.Meshlets[m];
+			const MeshletBounds& bounds = data.Bounds[m];
+
+			// 上限与对齐
+			CHECK(meshlet.VertexCount > 0 && meshlet.VertexCount <= MeshletBuilder::kMaxVertices, "%s meshlet %u: %u vertices", name, m, meshlet.VertexCount);
+			CHECK(meshlet.TriangleCount > 0 && meshlet.TriangleCount <= MeshletBuilder::kMaxTriangles, "%s meshlet %u: %u triangles", name, m, meshlet.TriangleCount);
+			CHECK(meshlet.TriangleOffset % 4 == 0, "%s meshlet %u", name, m);
+			CHECK(meshlet.VertexOffset + meshlet.VertexCount <= data.VertexIndices.size(), "%s meshlet %u", name, m);
+			CHECK(meshlet.TriangleOffset + meshlet.TriangleCount * 3 <= data.TriangleIndices.size(), "%s meshlet %u", name, m);
+
+			// 包围球包含所有顶点，容差为半径的相对误差
+			for (UINT v = 0; v < meshlet.VertexCount; ++v) {
+				const XMFLOAT3& p = mesh.Positions[data.VertexIndices[meshlet.VertexOffset + v]];
+				XMFLOAT3 d = Subtract(p, bounds.Center);
+				float distance = std::sqrt(Dot(d, d));
+				CHECK(distance <= bounds.Radius * 1.0001f + 1e-6f, "%s meshlet %u: distance %g > radius %g", name, m, distance, bounds.Radius);
+			}
+
+			const UINT8* triangles = &data.TriangleIndices[meshlet.TriangleOffset];
+			for (UINT t = 0; t < meshlet.TriangleCount; ++t) {
+				UINT local[3] = { triangles[t * 3], triangles[t * 3 + 1], triangles[t * 3 + 2] };
+				CHECK(local[0] < meshlet.VertexCount && local[1] < meshlet.VertexCount && local[2] < meshlet.VertexCount, "%s meshlet %u", name, m);
+				covered.emplace_back(data.VertexIndices[meshlet.VertexOffset + local[0]],
+					data.VertexIndices[meshlet.VertexOffset + local[1]],
+					data.VertexIndices[meshlet.VertexOffset + local[2]]);
+			}
+
+			// 法线锥剔除必须保守: 判定为背面时，Meshlet中每个三角形对该相机都是背面
+			for (const XMFLOAT3& camera : cameras) {
+				if (!MeshletBuilder::IsBackFacing(bounds, camera)) {
+					continue;
+				}
+				culled++;
+				for (UINT t = 0; t < meshlet.TriangleCount; ++t) {
+					const XMFLOAT3& p0 = mesh.Positions[data.VertexIndices[meshlet.VertexOffset + triangles[t * 3]]];
+					const XMFLOAT3& p1 = mesh.Positions[data.VertexIndices[meshlet.VertexOffset + triangles[t * 3 + 1]]];
+					const XMFLOAT3& p2 = mesh.Positions[data.VertexIndices[meshlet.VertexOffset + triangles[t * 3 + 2]]];
+					XMFLOAT3 normal = TriangleNormal(p0, p1, p2);
+					XMFLOAT3 view = Subtract(p0, camera);
+					float scale = std::sqrt(Dot(normal, normal) * Dot(view, view));
+					CHECK(Dot(normal, view) >= -1e-4f * scale, "%s meshlet %u triangle %u faces camera (%g, %g, %g)",
+						name, m, t, camera.x, camera.y, camera.z);
+				}
+			}
+		}
+
+		// 每个三角形恰好出现一次，顶点顺序(朝向)不变
+		std::sort(expected.begin(), expected.end());
+		std::sort(covered.begin(), covered.end());
+		CHECK(expected == covered, "%s: %zu triangles in meshlets, %zu in mesh", name, covered.size(), expected.size());
+
+		std::printf("%-24s %6u meshlets, %.1f triangles each, %u meshlet-camera pairs culled\n", name, meshletCount,
+			meshletCount > 0 ? static_cast<float>(expected.size()) / meshletCount : 0.0f, culled);
+	}
+
+	std::vector<XMFLOAT3> MakeCameras() {
+		// 远处与贴近表面的相机都要覆盖，后者最容易暴露锥顶位置的错误
+		std::vector<XMFLOAT3> cameras;
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		const float distances[] = { 1.01f, 1.2f, 2.0f, 10.0f, 1000.0f };
+		for (float distance : distances) {
+			for (UINT i = 0; i < 16; ++i) {
+				XMFLOAT3 direction(unit(random), unit(random), unit(random));
+				float scale = distance / std::sqrt((std::max)(Dot(direction, direction), 1e-6f));
+				cameras.push_back(XMFLOAT3(direction.x * scale, direction.y * scale, direction.z * scale));
+			}
+		}
+		return cameras;
+	}
+
+	void TestSphere(const std::vector<XMFLOAT3>& cameras) {
+		TestMesh mesh = MakeSphere(64, 128);
+		MeshletData data;
+		UINT count = MeshletBuilder::BuildMeshlets(data, mesh.Indices.data(), mesh.Indices.size(),
+			mesh.Positions.data(), mesh.Positions.size(), sizeof(XMFLOAT3));
+		Validate("sphere", mesh, data, count, cameras);
+
+		// 按行生成的Index使Meshlet沿纬线方向跨度较大，法线锥较宽，但远处的相机仍应能剔除相当一部分
+		UINT culled = 0;
+		for (const MeshletBounds& bounds : data.Bounds) {
+			culled += MeshletBuilder::IsBackFacing(bounds, XMFLOAT3(1000.0f, 0.0f, 0.0f)) ? 1 : 0;
+		}
+		CHECK(culled > count / 8, "only %u of %u meshlets culled", culled, count);
+	}
+
+	void TestShuffled(const std::vector<XMFLOAT3>& cameras) {
+		TestMesh mesh = MakeSphere(32, 64);
+		ShuffleTriangles(mesh, 1);
+		MeshletData data;
+		UINT count = MeshletBuilder::BuildMeshlets(data, mesh.Indices.data(), mesh.Indices.size(),
+			mesh.Positions.data(), mesh.Positions.size(), sizeof(XMFLOAT3));
+		Validate("shuffled sphere", mesh, data, count, cameras);
+	}
+
+	// 交错的顶点布局与两个Mesh追加到同一张表
+	void TestStrideAndAppend(const std::vector<XMFLOAT3>& cameras) {
+		struct PaddedVertex {
+			XMFLOAT3 Position;
+			float Padding[5];
+		};
+
+		TestMesh first = MakeSphere(16, 32);
+		TestMesh second = MakeSphere(24, 24);
+		std::vector<PaddedVertex> padded(second.Positions.size());
+		for (size_t v = 0; v < padded.size(); ++v) {
+			padded[v].Position = second.Positions[v];
+		}
+
+		MeshletData data;
+		UINT firstCount = MeshletBuilder::BuildMeshlets(data, first.Indices.data(), first.Indices.size(),
+			first.Positions.data(), first.Positions.size(), sizeof(XMFLOAT3));
+		MeshletData firstOnly = data;
+		UINT secondCount = MeshletBuilder::BuildMeshlets(data, second.Indices.data(), second.Indices.size(),
+			&padded[0].Position, padded.size(), sizeof(PaddedVertex));
+		Validate("first of two", first, firstOnly, firstCount, cameras);
+
+		// 第二个Mesh的部分单独取出，偏移相对于追加之前的表尾
+		MeshletData secondOnly;
+		const Meshlet& begin = data.Meshlets[firstCount];
+		for (UINT m = firstCount; m < firstCount + secondCount; ++m) {
+			Meshlet meshlet = data.Meshlets[m];
+			meshlet.VertexOffset -= begin.VertexOffset;
+			meshlet.TriangleOffset -= begin.TriangleOffset;
+			secondOnly.Meshlets.push_back(meshlet);
+			secondOnly.Bounds.push_back(data.Bounds[m]);
+		}
+		secondOnly.VertexIndices.assign(data.VertexIndices.begin() + begin.VertexOffset, data.VertexIndices.end());
+		secondOnly.TriangleIndices.assign(data.TriangleIndices.begin() + begin.TriangleOffset, data.TriangleIndices.end());
+		Validate("second of two, strided", second, secondOnly, secondCount, cameras);
+	}
+
+	// 退化三角形(重复顶点或面积为0)仍需出现在Meshlet中，且不能使锥失效以外的检查失败
+	void TestDegenerate(const std::vector<XMFLOAT3>& cameras) {
+		TestMesh mesh = MakeSphere(8, 16);
+		const UINT extra[] = { 0, 0, 1, 5, 5, 5, 20, 21, 20 };
+		mesh.Indices.insert(mesh.Indices.end(), std::begin(extra), std::end(extra));
+		MeshletData data;
+		UINT count = MeshletBuilder::BuildMeshlets(data, mesh.Indices.data(), mesh.Indices.size(),
+			mesh.Positions.data(), mesh.Positions.size(), sizeof(XMFLOAT3));
+		Validate("degenerate triangles", mesh, data, count, cameras);
+	}
+
+	void TestEmpty() {
+		MeshletData data;
+		XMFLOAT3 position(0.0f, 0.0f, 0.0f);
+		UINT count = MeshletBuilder::BuildMeshlets(data, nullptr, 0, &position, 1, sizeof(XMFLOAT3));
+		CHECK(count == 0 && data.Meshlets.empty() && data.TriangleIndices.empty(), "empty mesh produced %u meshlets", count);
+	}
+
+	void Benchmark() {
+		TestMesh mesh = MakeSphere(512, 1024);
+		const size_t triangleCount = mesh.Indices.size() / 3;
+		const UINT iterations = 5;
+
+		double best = 1e30;
+		UINT count = 0;
+		for (UINT i = 0; i < iterations; ++i) {
+			MeshletData data;
+			auto start = std::chrono::steady_clock::now();
+			count = MeshletBuilder::BuildMeshlets(data, mesh.Indices.data(), mesh.Indices.size(),
+				mesh.Positions.data(), mesh.Positions.size(), sizeof(XMFLOAT3));
+			best = (std::min)(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+
+		std::printf("benchmark: %zu triangles -> %u meshlets, best of %u: %.2f ms, %.2f M triangles/s\n",
+			triangleCount, count, iterations, best, best > 0.0 ? triangleCount / best / 1000.0 : 0.0);
+	}
+}
+
+int main() {
+	std::vector<XMFLOAT3> cameras = MakeCameras();
+
+	TestSphere(cameras);
+	TestShuffled(cameras);
+	TestStrideAndAppend(cameras);
+	TestDegenerate(cameras);
+	TestEmpty();
+	Benchmark();
+
+	return TestResult("MeshletTest");
+}
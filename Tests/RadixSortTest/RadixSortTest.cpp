@@ -0,0 +1,80 @@
+// RadixSort::Sort的单元测试: 结果与以Key比较的std::stable_sort逐项相同(包括相同Key的Value顺序)
+// 覆盖单块与多块、跳过部分趟(奇数趟时结果位于scratch中)以及大量重复的Key
+// 块数取决于线程池的线程数，只有一个线程时所有输入都只有一个块
+#include "RadixSort.h"
+#include "ThreadPool.h"
+#include "../TestCheck.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace {
+	using RadixSort::KeyValue;
+
+	// Value为原始位置，相同Key的Value递增即说明排序是稳定的
+	std::vector<KeyValue> MakeItems(size_t count, const std::function<UINT64(size_t)>& key) {
+		std::vector<KeyValue> items(count);
+		for (size_t i = 0; i < count; ++i) {
+			items[i] = { key(i), static_cast<UINT>(i) };
+		}
+		return items;
+	}
+
+	void CheckSort(std::vector<KeyValue> items, const char* name) {
+		std::vector<KeyValue> expected = items;
+		std::stable_sort(expected.begin(), expected.end(), [](const KeyValue& a, const KeyValue& b) { return a.Key < b.Key; });
+
+		// scratch中残留的内容不影响结果
+		std::vector<KeyValue> scratch(items.size() / 2 + 3, KeyValue{ 0xDEADBEEFull, 7u });
+		RadixSort::Sort(items, scratch);
+
+		CHECK(items.size() == expected.size(), "%s: %zu items after sorting, expected %zu", name, items.size(), expected.size());
+		if (items.size() != expected.size()) {
+			return;
+		}
+		size_t mismatches = 0, first = items.size();
+		for (size_t i = 0; i < items.size(); ++i) {
+			if (items[i].Key != expected[i].Key || items[i].Value != expected[i].Value) {
+				first = (std::min)(first, i);
+				mismatches++;
+			}
+		}
+		CHECK(mismatches == 0, "%s: %zu of %zu items differ from std::stable_sort, first at %zu", name, mismatches, items.size(), first);
+	}
+}
+
+int main() {
+	const UINT threadCount = ThreadPool::Get().ThreadCount();
+	std::printf("%u thread(s)%s\n", threadCount, threadCount > 1 ? "" : ", multi-block sorting is not covered");
+
+	std::mt19937_64 rng(3);
+	auto any = [&](size_t) { return rng(); };
+
+	CheckSort({}, "empty");
+	CheckSort(MakeItems(1, any), "one item");
+	CheckSort(MakeItems(2, [](size_t i) { return UINT64(1 - i); }), "two items, reversed");
+	CheckSort(MakeItems(2, [](size_t) { return UINT64(5); }), "two equal keys");
+
+	// 单块(少于4096个)与多块
+	CheckSort(MakeItems(1000, any), "random, single block");
+	CheckSort(MakeItems(300000, any), "random, many blocks");
+
+	// 大量重复的Key，检查块之间与块之内的稳定性
+	CheckSort(MakeItems(200000, [&](size_t) { return rng() % 17; }), "17 distinct keys");
+	CheckSort(MakeItems(200000, [&](size_t) { return (rng() % 5) << 56 | (rng() % 3) << 8; }), "few distinct keys in two bytes");
+	CheckSort(MakeItems(50000, [](size_t) { return 0x0123456789ABCDEFull; }), "all keys equal");
+
+	// 只有一个字节不同时只执行一趟，结果位于scratch中再交换
+	CheckSort(MakeItems(100000, [&](size_t) { return 0xAA00000000000000ull | (rng() & 0xFF) << 24; }), "one differing byte");
+	CheckSort(MakeItems(100000, [&](size_t) { return (rng() & 0xFF) | (rng() & 0xFF) << 16 | (rng() & 0xFF) << 56; }), "three differing bytes");
+
+	// 极值与已排序、逆序的输入
+	CheckSort(MakeItems(20000, [](size_t i) { return i % 3 == 0 ? 0ull : i % 3 == 1 ? ~0ull : 0x8000000000000000ull; }), "extreme keys");
+	CheckSort(MakeItems(100000, [](size_t i) { return UINT64(i) * 0x9E3779B9ull; }), "already sorted");
+	CheckSort(MakeItems(100000, [](size_t i) { return ~UINT64(i / 3); }), "reversed with runs");
+
+	return TestResult("RadixSortTest");
+}
@@ -0,0 +1,26 @@
+#pragma once
+// Tests下各测试程序共用的检查宏
+// 失败时打印位置与原因并计数，不中断后续检查；Release配置下同样生效(不使用assert)
+#include <cstdio>
+
+inline int gFailures = 0;
+
+#define CHECK(condition, ...) \
+	do { \
+		if (!(condition)) { \
+			std::printf("FAILED %s:%d: %s: ", __FILE__, __LINE__, #condition); \
+			std::printf(__VA_ARGS__); \
+			std::printf("\n"); \
+			gFailures++; \
+		} \
+	} while (false)
+
+// 各测试程序main的返回值
+inline int TestResult(const char* name) {
+	if (gFailures > 0) {
+		std::printf("%s: %d check(s) failed\n", name, gFailures);
+		return 1;
+	}
+	std::printf("%s: all checks passed\n", name);
+	return 0;
+}
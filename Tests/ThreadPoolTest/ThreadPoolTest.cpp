@@ -0,0 +1,150 @@
+// ThreadPool::ParallelFor的单元测试: 每个下标恰好被处理一次，嵌套调用(包括多层、工作线程数少于区间数)不会死锁
+// 以不同的工作线程数(包括0)分别测试；超时未完成时视为死锁，打印正在执行的测试后退出
+#include "ThreadPool.h"
+#include "../TestCheck.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+	std::atomic<const char*> gCurrentTest{ "" };
+	std::atomic<bool> gDone{ false };
+
+	// 统计每个下标被处理的次数
+	class Coverage {
+	public:
+		explicit Coverage(size_t count) : mHits(new std::atomic<UINT>[count]), mCount(count) {
+			for (size_t i = 0; i < count; ++i) {
+				mHits[i] = 0;
+			}
+		}
+
+		void Hit(size_t index) { mHits[index].fetch_add(1); }
+
+		// 处理次数不为1的下标数
+		size_t Errors() const {
+			size_t errors = 0;
+			for (size_t i = 0; i < mCount; ++i) {
+				errors += mHits[i].load() != 1;
+			}
+			return errors;
+		}
+
+	private:
+		std::unique_ptr<std::atomic<UINT>[]> mHits;
+		size_t mCount;
+	};
+
+	void TestFlat(ThreadPool& pool, const char* name) {
+		gCurrentTest = name;
+		const size_t counts[] = { 1, 2, 7, 100, 4097, 100000 };
+		const size_t grainSizes[] = { 0, 1, 3, 64, 1000000 };
+		for (size_t count : counts) {
+			for (size_t grainSize : grainSizes) {
+				Coverage coverage(count);
+				std::atomic<size_t> badRanges{ 0 };
+				pool.ParallelFor(count, grainSize, [&](size_t begin, size_t end) {
+					if (!(begin < end && end <= count)) {
+						badRanges++;
+						return;
+					}
+					for (size_t i = begin; i < end; ++i) {
+						coverage.Hit(i);
+					}
+				});
+				CHECK(badRanges == 0 && coverage.Errors() == 0, "%s: count %zu, grain %zu: %zu bad ranges, %zu indices not processed exactly once",
+					name, count, grainSize, badRanges.load(), coverage.Errors());
+			}
+		}
+
+		bool called = false;
+		pool.ParallelFor(0, 1, [&](size_t, size_t) { called = true; });
+		CHECK(!called, "%s: func called for an empty range", name);
+	}
+
+	// 外层的每个区间中再调用ParallelFor，内层再嵌套一层；所有工作线程都可能阻塞在外层的任务中
+	void TestNested(ThreadPool& pool, const char* name) {
+		gCurrentTest = name;
+		const size_t outer = 37, middle = 11, inner = 251;
+		Coverage coverage(outer * middle * inner);
+		pool.ParallelFor(outer, 1, [&](size_t outerBegin, size_t outerEnd) {
+			for (size_t i = outerBegin; i < outerEnd; ++i) {
+				pool.ParallelFor(middle, 1, [&, i](size_t middleBegin, size_t middleEnd) {
+					for (size_t j = middleBegin; j < middleEnd; ++j) {
+						pool.ParallelFor(inner, 16, [&, i, j](size_t begin, size_t end) {
+							for (size_t k = begin; k < end; ++k) {
+								coverage.Hit((i * middle + j) * inner + k);
+							}
+						});
+					}
+				});
+			}
+		});
+		CHECK(coverage.Errors() == 0, "%s: %zu indices not processed exactly once", name, coverage.Errors());
+	}
+
+	// 多个外部线程同时向同一线程池提交嵌套的ParallelFor
+	void TestConcurrentCallers(ThreadPool& pool, const char* name) {
+		gCurrentTest = name;
+		const size_t callers = 4, outer = 16, inner = 1000;
+		Coverage coverage(callers * outer * inner);
+		std::vector<std::thread> threads;
+		for (size_t c = 0; c < callers; ++c) {
+			threads.emplace_back([&, c]() {
+				pool.ParallelFor(outer, 1, [&](size_t outerBegin, size_t outerEnd) {
+					for (size_t i = outerBegin; i < outerEnd; ++i) {
+						pool.ParallelFor(inner, 8, [&, i](size_t begin, size_t end) {
+							for (size_t k = begin; k < end; ++k) {
+								coverage.Hit((c * outer + i) * inner + k);
+							}
+						});
+					}
+				});
+			});
+		}
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+		CHECK(coverage.Errors() == 0, "%s: %zu indices not processed exactly once", name, coverage.Errors());
+	}
+}
+
+int main() {
+	// 死锁时测试不会结束，由监视线程报告并退出
+	std::thread watchdog([]() {
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::minutes(2);
+		while (!gDone) {
+			if (std::chrono::steady_clock::now() > deadline) {
+				std::printf("FAILED: %s did not finish, possible deadlock\n", gCurrentTest.load());
+				std::fflush(stdout);
+				std::_Exit(1);
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+	});
+
+	const UINT workerCounts[] = { 0, 1, 3, 8 };
+	for (UINT workerCount : workerCounts) {
+		// 监视线程可能正在读取上一个名称，每个测试使用各自的缓冲
+		char flatName[64], nestedName[64], concurrentName[64];
+		std::snprintf(flatName, sizeof(flatName), "%u workers, flat", workerCount);
+		std::snprintf(nestedName, sizeof(nestedName), "%u workers, nested", workerCount);
+		std::snprintf(concurrentName, sizeof(concurrentName), "%u workers, concurrent callers", workerCount);
+
+		ThreadPool pool(workerCount);
+		TestFlat(pool, flatName);
+		TestNested(pool, nestedName);
+		TestConcurrentCallers(pool, concurrentName);
+		gCurrentTest = "";
+	}
+	TestNested(ThreadPool::Get(), "shared pool, nested");
+
+	gDone = true;
+	watchdog.join();
+	return TestResult("ThreadPoolTest");
+}
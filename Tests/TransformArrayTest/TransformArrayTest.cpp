@@ -0,0 +1,123 @@
+// TransformArray::ComputeMatrices的单元测试: 各种Index序列的结果与逐个以DirectXMath计算的 S * R * T 相同
+// CPU支持AVX2时覆盖连续读取与Gather两条路径，包括首尾之差为7但并不连续的Index
+#include "TransformArray.h"
+#include "../TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+	struct Transform {
+		XMFLOAT3 Scale;
+		XMFLOAT4 Rotation;
+		XMFLOAT3 Translation;
+	};
+
+	std::vector<Transform> MakeTransforms(size_t count) {
+		std::mt19937 rng(9);
+		std::uniform_real_distribution<float> scale(0.1f, 4.0f);
+		std::normal_distribution<float> gaussian;
+		std::uniform_real_distribution<float> translation(-100.0f, 100.0f);
+
+		std::vector<Transform> transforms(count);
+		for (Transform& transform : transforms) {
+			transform.Scale = XMFLOAT3(scale(rng), scale(rng), scale(rng));
+			XMVECTOR rotation = XMVectorSet(gaussian(rng), gaussian(rng), gaussian(rng), gaussian(rng));
+			XMStoreFloat4(&transform.Rotation, XMVectorScale(rotation, 1.0f / std::sqrt(XMVectorGetX(XMVector4Dot(rotation, rotation)))));
+			transform.Translation = XMFLOAT3(translation(rng), translation(rng), translation(rng));
+		}
+		return transforms;
+	}
+
+	XMFLOAT4X4 Reference(const Transform& transform) {
+		XMMATRIX matrix = XMMatrixScaling(transform.Scale.x, transform.Scale.y, transform.Scale.z) *
+			XMMatrixRotationQuaternion(XMLoadFloat4(&transform.Rotation)) *
+			XMMatrixTranslation(transform.Translation.x, transform.Translation.y, transform.Translation.z);
+		XMFLOAT4X4 result;
+		XMStoreFloat4x4(&result, matrix);
+		return result;
+	}
+
+	void CheckIndices(const TransformArray& array, const std::vector<Transform>& transforms, const std::vector<UINT>& indices, const char* name) {
+		// 前后各多留一个矩阵，检查没有越界写入
+		std::vector<XMFLOAT4X4> matrices(indices.size() + 2);
+		XMFLOAT4X4 guard;
+		std::fill(&guard.m[0][0], &guard.m[0][0] + 16, -12345.0f);
+		std::fill(matrices.begin(), matrices.end(), guard);
+		array.ComputeMatrices(indices.data(), indices.size(), matrices.data() + 1);
+
+		size_t mismatches = 0;
+		float maxError = 0.0f;
+		for (size_t i = 0; i < indices.size(); ++i) {
+			XMFLOAT4X4 expected = Reference(transforms[indices[i]]);
+			bool match = true;
+			for (int r = 0; r < 4; ++r) {
+				for (int c = 0; c < 4; ++c) {
+					float error = std::fabs(matrices[i + 1].m[r][c] - expected.m[r][c]);
+					maxError = (std::max)(maxError, error);
+					match = match && error <= 1e-5f * (1.0f + std::fabs(expected.m[r][c]));
+				}
+			}
+			mismatches += !match;
+		}
+		CHECK(mismatches == 0, "%s: %zu of %zu matrices differ from the reference, max error %g", name, mismatches, indices.size(), maxError);
+		CHECK(std::equal(&guard.m[0][0], &guard.m[0][0] + 16, &matrices.front().m[0][0]) &&
+			std::equal(&guard.m[0][0], &guard.m[0][0] + 16, &matrices.back().m[0][0]),
+			"%s: wrote outside of the output range", name);
+	}
+}
+
+int main() {
+	const size_t count = 4096;
+	std::vector<Transform> transforms = MakeTransforms(count);
+	TransformArray array;
+	array.Resize(count);
+	for (size_t i = 0; i < count; ++i) {
+		array.Set(i, transforms[i].Scale, transforms[i].Rotation, transforms[i].Translation);
+	}
+	std::printf("AVX2 %s\n", TransformArray::SupportsAVX2() ? "supported" : "not supported, testing the scalar path only");
+
+	std::vector<UINT> indices(count);
+	std::iota(indices.begin(), indices.end(), 0u);
+	CheckIndices(array, transforms, indices, "contiguous");
+
+	// 从非8的倍数处开始，且长度不是8的倍数，最后几个由标量路径处理
+	CheckIndices(array, transforms, std::vector<UINT>(indices.begin() + 3, indices.begin() + 3 + 1001), "contiguous, unaligned");
+
+	std::vector<UINT> reversed(indices.rbegin(), indices.rend());
+	CheckIndices(array, transforms, reversed, "reversed");
+
+	std::vector<UINT> shuffled = indices;
+	std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(4));
+	CheckIndices(array, transforms, shuffled, "shuffled");
+
+	// 首尾之差为7，但中间不连续或有重复
+	std::vector<UINT> tricky;
+	for (UINT base = 0; base + 8 <= count; base += 64) {
+		tricky.insert(tricky.end(), { base, base + 5, base + 5, base + 5, base + 2, base + 1, base + 3, base + 7 });
+		tricky.insert(tricky.end(), { base + 8, base + 10, base + 9, base + 11, base + 12, base + 13, base + 14, base + 15 });
+		tricky.insert(tricky.end(), { base + 20, base + 20, base + 20, base + 20, base + 20, base + 20, base + 20, base + 27 });
+	}
+	CheckIndices(array, transforms, tricky, "first and last 7 apart, not contiguous");
+
+	// 重复与随机的Index
+	std::vector<UINT> random(5000);
+	std::mt19937 rng(6);
+	std::uniform_int_distribution<UINT> anyIndex(0, count - 1);
+	for (UINT& index : random) {
+		index = anyIndex(rng);
+	}
+	CheckIndices(array, transforms, random, "random with duplicates");
+	CheckIndices(array, transforms, std::vector<UINT>(37, 11u), "all equal");
+
+	CheckIndices(array, transforms, std::vector<UINT>(indices.begin(), indices.begin() + 5), "fewer than 8");
+	CheckIndices(array, transforms, std::vector<UINT>(), "empty");
+
+	return TestResult("TransformArrayTest");
+}